@@ -0,0 +1,162 @@
+#include "AsyncHttpClient.h"
+
+#include "DebugLog.h"
+#include "SocketHttpTransport.h"
+#ifdef _WIN32
+#include "HttpClient.h"
+#endif
+
+#include <cstdlib>
+
+AsyncHttpClient::AsyncHttpClient(std::unique_ptr<IHttpTransport> transport, size_t workerCount)
+    : transport_(std::move(transport))
+{
+    if (workerCount == 0) {
+        workerCount = 1;
+    }
+    workers_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers_.emplace_back(&AsyncHttpClient::WorkerProc, this);
+    }
+}
+
+AsyncHttpClient::~AsyncHttpClient()
+{
+    Shutdown();
+}
+
+std::future<HttpJsonResult> AsyncHttpClient::PostJsonAsync(const std::wstring& baseUrl, const std::wstring& path, std::string jsonBody)
+{
+    auto job = std::make_unique<Job>();
+    job->baseUrl = baseUrl;
+    job->path = path;
+    job->body = std::move(jsonBody);
+    std::future<HttpJsonResult> future = job->promise.get_future();
+    Enqueue(std::move(job));
+    return future;
+}
+
+void AsyncHttpClient::PostJsonAsync(const std::wstring& baseUrl, const std::wstring& path, std::string jsonBody, Completion onComplete)
+{
+    auto job = std::make_unique<Job>();
+    job->baseUrl = baseUrl;
+    job->path = path;
+    job->body = std::move(jsonBody);
+    job->onComplete = std::move(onComplete);
+    Enqueue(std::move(job));
+}
+
+HttpJsonResult AsyncHttpClient::PostJson(const std::wstring& baseUrl, const std::wstring& path, std::string jsonBody)
+{
+    return PostJsonAsync(baseUrl, path, std::move(jsonBody)).get();
+}
+
+void AsyncHttpClient::Enqueue(std::unique_ptr<Job> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_) {
+            queue_.push_back(std::move(job));
+            cv_.notify_one();
+            return;
+        }
+    }
+
+    // Already shut down: complete immediately as a transport failure.
+    Complete(*job, HttpJsonResult());
+}
+
+void AsyncHttpClient::Complete(Job& job, HttpJsonResult result)
+{
+    if (job.onComplete) {
+        try {
+            job.onComplete(result);
+        }
+        catch (...) {
+            DebugLog("AsyncHttpClient: completion callback threw; ignored.");
+        }
+    }
+    job.promise.set_value(std::move(result));
+}
+
+void AsyncHttpClient::WorkerProc()
+{
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        HttpJsonResult result;
+        if (transport_) {
+            result = transport_->PostJson(job->baseUrl, job->path, job->body);
+        }
+        Complete(*job, std::move(result));
+    }
+}
+
+void AsyncHttpClient::EvictIdle()
+{
+    if (transport_) {
+        transport_->EvictIdle();
+    }
+}
+
+HttpClientStats AsyncHttpClient::GetStats() const
+{
+    return transport_ ? transport_->GetStats() : HttpClientStats{};
+}
+
+void AsyncHttpClient::Shutdown()
+{
+    std::deque<std::unique_ptr<Job>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && workers_.empty()) {
+            return;
+        }
+        stopping_ = true;
+        pending.swap(queue_);
+    }
+    cv_.notify_all();
+
+    for (auto& job : pending) {
+        Complete(*job, HttpJsonResult());
+    }
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+std::unique_ptr<IHttpTransport> CreateDefaultHttpTransport()
+{
+#ifdef _WIN32
+    char* selected = nullptr;
+    size_t selectedLen = 0;
+    _dupenv_s(&selected, &selectedLen, "HAYATEKOMOREBI_HTTP_TRANSPORT");
+    const std::string name = selected ? selected : "";
+    if (selected) free(selected);
+
+    if (name != "socket") {
+        return std::make_unique<HttpClient>();
+    }
+#else
+    const char* selected = std::getenv("HAYATEKOMOREBI_HTTP_TRANSPORT");
+    const std::string name = selected ? selected : "";
+#endif
+    if (!name.empty() && name != "socket") {
+        DebugLog("CreateDefaultHttpTransport: unknown HAYATEKOMOREBI_HTTP_TRANSPORT=" + name + "; using socket transport.");
+    }
+    DebugLog("CreateDefaultHttpTransport: using plain socket transport (http:// only).");
+    return std::make_unique<SocketHttpTransport>();
+}
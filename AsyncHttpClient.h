@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HttpTransport.h"
+
+// AsyncHttpClient
+// - Non-blocking front end over an IHttpTransport.
+// - Requests are queued and executed on a small set of worker threads; callers get a future
+//   (or a completion callback that runs on the worker thread).
+// - Shutdown() completes every queued request with transportOk=false, so no caller blocks forever.
+class AsyncHttpClient
+{
+public:
+    using Completion = std::function<void(const HttpJsonResult&)>;
+
+    AsyncHttpClient(std::unique_ptr<IHttpTransport> transport, size_t workerCount = 2);
+    ~AsyncHttpClient();
+
+    AsyncHttpClient(const AsyncHttpClient&) = delete;
+    AsyncHttpClient& operator=(const AsyncHttpClient&) = delete;
+
+    std::future<HttpJsonResult> PostJsonAsync(const std::wstring& baseUrl, const std::wstring& path, std::string jsonBody);
+    void PostJsonAsync(const std::wstring& baseUrl, const std::wstring& path, std::string jsonBody, Completion onComplete);
+
+    // Convenience for background threads that want the old blocking behaviour.
+    HttpJsonResult PostJson(const std::wstring& baseUrl, const std::wstring& path, std::string jsonBody);
+
+    void EvictIdle();
+    HttpClientStats GetStats() const;
+
+    void Shutdown();
+
+private:
+    struct Job {
+        std::wstring baseUrl;
+        std::wstring path;
+        std::string body;
+        std::promise<HttpJsonResult> promise;
+        Completion onComplete;
+    };
+
+    void Enqueue(std::unique_ptr<Job> job);
+    void WorkerProc();
+
+    // Runs the completion callback (an exception from it is logged and ignored), then fulfils
+    // the promise.
+    static void Complete(Job& job, HttpJsonResult result);
+
+    std::unique_ptr<IHttpTransport> transport_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<Job>> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// Picks the transport for the activation endpoints:
+//   HAYATEKOMOREBI_HTTP_TRANSPORT=socket -> SocketHttpTransport (http:// base URLs only)
+//   otherwise                            -> HttpClient (WinHTTP)
+std::unique_ptr<IHttpTransport> CreateDefaultHttpTransport();
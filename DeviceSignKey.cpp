@@ -9,7 +9,9 @@
 #include <shlobj.h>
 #include <wincrypt.h>
 
+#include <cstring>
 #include <fstream>
+#include <mutex>
 #include <vector>
 
 #pragma comment(lib, "crypt32.lib")
@@ -207,19 +209,188 @@ namespace DeviceSignKey
             (void)WriteFileAll(path, outFile);
             return true;
         }
+
+        struct KeyFileStamp
+        {
+            bool exists = false;
+            uint64_t size = 0;
+            uint64_t writeTime = 0;
+
+            bool operator==(const KeyFileStamp& o) const
+            {
+                return exists == o.exists && size == o.size && writeTime == o.writeTime;
+            }
+        };
+
+        static KeyFileStamp StatKeyFile(const std::wstring& path)
+        {
+            KeyFileStamp stamp;
+            WIN32_FILE_ATTRIBUTE_DATA fad{};
+            if (GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fad)) {
+                stamp.exists = true;
+                stamp.size = (static_cast<uint64_t>(fad.nFileSizeHigh) << 32) | fad.nFileSizeLow;
+                stamp.writeTime = (static_cast<uint64_t>(fad.ftLastWriteTime.dwHighDateTime) << 32) | fad.ftLastWriteTime.dwLowDateTime;
+            }
+            return stamp;
+        }
+
+        // Process-lifetime holder of the unsealed key.
+        // - The file is read and DPAPI-unprotected once; afterwards each use costs one metadata
+        //   check of the key file (size / last write time), and a changed file is reloaded.
+        // - The expanded key (hk_sign_ctx) lives on its own page between two PAGE_NOACCESS guard
+        //   pages. The page is locked into memory (not paged to disk) and is itself PAGE_NOACCESS
+        //   except while a signature is being made.
+        class KeyHolder
+        {
+        public:
+            ~KeyHolder()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ReleaseLocked();
+            }
+
+            // Runs fn(const hk_sign_ctx&) with the key loaded (created on first use).
+            template <typename Fn>
+            bool Use(Fn&& fn, std::string* outError)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (path_.empty()) {
+                    path_ = KeyFilePath();
+                }
+                const KeyFileStamp stamp = StatKeyFile(path_);
+                if (!loaded_ || !(stamp == stamp_)) {
+                    if (!LoadLocked(outError)) {
+                        return false;
+                    }
+                }
+                if (!SetAccessLocked(PAGE_READONLY)) {
+                    SetError(outError, "VirtualProtect failed");
+                    return false;
+                }
+                const bool ok = fn(*Context());
+                (void)SetAccessLocked(PAGE_NOACCESS);
+                return ok;
+            }
+
+            // Forgets the key; the next use reads the file again.
+            void Drop()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (region_ && SetAccessLocked(PAGE_READWRITE)) {
+                    hk_sign_ctx_wipe(Context());
+                    (void)SetAccessLocked(PAGE_NOACCESS);
+                }
+                loaded_ = false;
+                stamp_ = KeyFileStamp{};
+            }
+
+        private:
+            hk_sign_ctx* Context() const
+            {
+                return reinterpret_cast<hk_sign_ctx*>(region_ + pageSize_);
+            }
+
+            bool AllocateLocked()
+            {
+                SYSTEM_INFO si{};
+                GetSystemInfo(&si);
+                pageSize_ = si.dwPageSize;
+                static_assert(sizeof(hk_sign_ctx) <= 4096, "key context must fit in one page");
+
+                region_ = static_cast<uint8_t*>(VirtualAlloc(nullptr, pageSize_ * 3, MEM_RESERVE | MEM_COMMIT, PAGE_NOACCESS));
+                if (!region_) {
+                    return false;
+                }
+                if (!SetAccessLocked(PAGE_READWRITE)) {
+                    VirtualFree(region_, 0, MEM_RELEASE);
+                    region_ = nullptr;
+                    return false;
+                }
+                // Best-effort: fails only when the working-set quota is exhausted.
+                locked_ = VirtualLock(region_ + pageSize_, pageSize_) != 0;
+                return true;
+            }
+
+            void ReleaseLocked()
+            {
+                if (!region_) {
+                    return;
+                }
+                if (SetAccessLocked(PAGE_READWRITE)) {
+                    SecureZeroMemory(region_ + pageSize_, pageSize_);
+                }
+                if (locked_) {
+                    VirtualUnlock(region_ + pageSize_, pageSize_);
+                    locked_ = false;
+                }
+                VirtualFree(region_, 0, MEM_RELEASE);
+                region_ = nullptr;
+                loaded_ = false;
+            }
+
+            bool SetAccessLocked(DWORD protect)
+            {
+                DWORD old = 0;
+                return VirtualProtect(region_ + pageSize_, pageSize_, protect, &old) != 0;
+            }
+
+            bool LoadLocked(std::string* outError)
+            {
+                loaded_ = false;
+                std::array<uint8_t, 64> sk{};
+                std::array<uint8_t, 32> pk{};
+                if (!LoadOrCreateSecretKey(sk, pk, outError)) {
+                    return false;
+                }
+                if (!region_ && !AllocateLocked()) {
+                    SecureZeroMemory(sk.data(), sk.size());
+                    SetError(outError, "VirtualAlloc failed");
+                    return false;
+                }
+                if (!SetAccessLocked(PAGE_READWRITE)) {
+                    SecureZeroMemory(sk.data(), sk.size());
+                    SetError(outError, "VirtualProtect failed");
+                    return false;
+                }
+                (void)hk_sign_ctx_init(Context(), sk.data());
+                SecureZeroMemory(sk.data(), sk.size());
+                (void)SetAccessLocked(PAGE_NOACCESS);
+
+                // Stamp after loading: a newly created key file is part of what was loaded.
+                stamp_ = StatKeyFile(path_);
+                loaded_ = true;
+                return true;
+            }
+
+            std::mutex mutex_;
+            std::wstring path_;
+            uint8_t* region_ = nullptr;     // guard page | key page | guard page
+            size_t pageSize_ = 0;
+            bool locked_ = false;
+            bool loaded_ = false;
+            KeyFileStamp stamp_;
+        };
+
+        static KeyHolder& Holder()
+        {
+            static KeyHolder holder;
+            return holder;
+        }
     }
 
     bool GetOrCreatePublicKeyBase64(std::string& outPublicKeyB64, std::string* outError)
     {
         outPublicKeyB64.clear();
-        std::array<uint8_t, 64> sk{};
         std::array<uint8_t, 32> pk{};
-        if (!LoadOrCreateSecretKey(sk, pk, outError)) {
+        const bool loaded = Holder().Use([&pk](const hk_sign_ctx& ctx) {
+            std::memcpy(pk.data(), ctx.pk, pk.size());
+            return true;
+        }, outError);
+        if (!loaded) {
             return false;
         }
 
         bool ok = Base64EncodeNoCrlf(pk.data(), (DWORD)pk.size(), outPublicKeyB64);
-        SecureZeroMemory(sk.data(), sk.size());
         if (!ok) {
             SetError(outError, "base64 encode failed");
         }
@@ -230,29 +401,22 @@ namespace DeviceSignKey
     {
         outSignatureB64.clear();
 
-        std::array<uint8_t, 64> sk{};
-        std::array<uint8_t, 32> pk{};
-        if (!LoadOrCreateSecretKey(sk, pk, outError)) {
-            return false;
-        }
-
-        const uint8_t* m = reinterpret_cast<const uint8_t*>(messageUtf8.data());
-        uint64_t mlen = static_cast<uint64_t>(messageUtf8.size());
-
-        // crypto_sign outputs sm = sig||m
-        std::vector<uint8_t> sm;
-        sm.resize(static_cast<size_t>(mlen + 64));
-        uint64_t smlen = 0;
-        if (crypto_sign(sm.data(), &smlen, m, mlen, sk.data()) != 0 || smlen != mlen + 64) {
-            SecureZeroMemory(sk.data(), sk.size());
-            SetError(outError, "crypto_sign failed");
+        // Detached signature straight into a 64-byte buffer; the message is hashed in place.
+        std::array<uint8_t, 64> sig{};
+        bool signFailed = false;
+        const bool loaded = Holder().Use([&](const hk_sign_ctx& ctx) {
+            const uint8_t* m = reinterpret_cast<const uint8_t*>(messageUtf8.data());
+            signFailed = hk_sign_detached(sig.data(), m, static_cast<uint64_t>(messageUtf8.size()), &ctx) != 0;
+            return !signFailed;
+        }, outError);
+        if (!loaded) {
+            if (signFailed) {
+                SetError(outError, "crypto_sign failed");
+            }
             return false;
         }
 
-        bool ok = Base64EncodeNoCrlf(sm.data(), 64, outSignatureB64);
-
-        SecureZeroMemory(sk.data(), sk.size());
-        SecureZeroMemory(sm.data(), sm.size());
+        bool ok = Base64EncodeNoCrlf(sig.data(), 64, outSignatureB64);
 
         if (!ok) {
             SetError(outError, "base64 encode failed");
@@ -264,6 +428,7 @@ namespace DeviceSignKey
 
     bool DeleteStoredKey(std::string* outError)
     {
+        Holder().Drop();
         const std::wstring path = KeyFilePath();
         if (DeleteFileW(path.c_str()) != 0) {
             return true;
@@ -9,6 +9,8 @@
 // - The private key is NOT stored in AppData.
 // - Public key is sent to the site at device enrollment.
 // - Signatures are used for /api/device_refresh.php request authentication.
+// - The key is unsealed once per process and kept in locked, guard-paged memory. It is reloaded
+//   when the key file changes or after DeleteStoredKey().
 //
 // File path:
 //   %ProgramData%\HayateKomorebi\DeviceKeys\device_ed25519_sign.key
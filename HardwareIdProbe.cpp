@@ -0,0 +1,215 @@
+#include "HardwareIdProbe.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <fstream>
+#include <iterator>
+#if defined(__i386__) || defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace HardwareIdProbe
+{
+    namespace
+    {
+        std::string TrimValue(const std::string& s)
+        {
+            size_t b = 0;
+            while (b < s.size() && (s[b] == ' ' || s[b] == '\t' || s[b] == '\r' || s[b] == '\n')) b++;
+            size_t e = s.size();
+            while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t' || s[e - 1] == '\r' || s[e - 1] == '\n')) e--;
+            return s.substr(b, e - b);
+        }
+
+        // strings: first byte after the formatted area; end: end of the table.
+        std::string SmbiosString(const uint8_t* strings, const uint8_t* end, uint8_t index)
+        {
+            if (index == 0) return std::string();
+            const uint8_t* p = strings;
+            for (uint8_t i = 1; p < end && *p != 0; ++i) {
+                const uint8_t* s = p;
+                while (p < end && *p != 0) ++p;
+                if (i == index) {
+                    return TrimValue(std::string(reinterpret_cast<const char*>(s), static_cast<size_t>(p - s)));
+                }
+                ++p; // skip NUL
+            }
+            return std::string();
+        }
+
+#ifndef _WIN32
+        bool ReadFileBytes(const char* path, std::vector<uint8_t>& out)
+        {
+            std::ifstream ifs(path, std::ios::binary);
+            if (!ifs) return false;
+            out.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+            return !out.empty();
+        }
+
+        std::string ReadSysfsValue(const char* path)
+        {
+            std::vector<uint8_t> bytes;
+            if (!ReadFileBytes(path, bytes)) return std::string();
+            return TrimValue(std::string(bytes.begin(), bytes.end()));
+        }
+#endif
+    }
+
+    std::string FormatProcessorId(uint32_t eax, uint32_t edx)
+    {
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%08X%08X", static_cast<unsigned>(edx), static_cast<unsigned>(eax));
+        return std::string(buf, 16);
+    }
+
+    std::string FormatSmbiosUuid(const uint8_t u[16], bool littleEndianFields)
+    {
+        char buf[37];
+        if (littleEndianFields) {
+            std::snprintf(buf, sizeof(buf), "%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+                u[3], u[2], u[1], u[0], u[5], u[4], u[7], u[6],
+                u[8], u[9], u[10], u[11], u[12], u[13], u[14], u[15]);
+        } else {
+            std::snprintf(buf, sizeof(buf), "%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+                u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7],
+                u[8], u[9], u[10], u[11], u[12], u[13], u[14], u[15]);
+        }
+        return std::string(buf, 36);
+    }
+
+    bool ParseSmbiosTable(const uint8_t* table, size_t size, uint8_t majorVersion, uint8_t minorVersion, SmbiosInfo& out)
+    {
+        out = SmbiosInfo();
+        if (!table || size < 4) return false;
+
+        const bool littleEndianUuid = majorVersion > 2 || (majorVersion == 2 && minorVersion >= 6);
+        bool haveSystem = false;
+        bool haveBaseboard = false;
+
+        const uint8_t* p = table;
+        const uint8_t* end = table + size;
+        while (p + 4 <= end) {
+            const uint8_t type = p[0];
+            const uint8_t length = p[1];
+            if (length < 4 || p + length > end) break;
+
+            const uint8_t* strings = p + length;
+
+            if (type == 1 && !haveSystem) {
+                haveSystem = true;
+                if (length >= 0x08) {
+                    out.systemSerial = SmbiosString(strings, end, p[0x07]);
+                }
+                if (length >= 0x19) {
+                    out.systemUuid = FormatSmbiosUuid(p + 0x08, littleEndianUuid);
+                }
+            } else if (type == 2 && !haveBaseboard) {
+                haveBaseboard = true;
+                if (length >= 0x08) {
+                    out.baseboardSerial = SmbiosString(strings, end, p[0x07]);
+                }
+            }
+
+            // Skip the string set: terminated by two NULs (an empty set is just "\0\0").
+            const uint8_t* q = strings;
+            while (q + 1 < end && !(q[0] == 0 && q[1] == 0)) ++q;
+            if (q + 1 >= end) break;
+            p = q + 2;
+
+            if (type == 127) break; // end-of-table
+        }
+
+        out.valid = haveSystem;
+        return out.valid;
+    }
+
+    bool ParseRawSmbiosData(const uint8_t* data, size_t size, SmbiosInfo& out)
+    {
+        out = SmbiosInfo();
+        if (!data || size < 8) return false;
+        const uint8_t major = data[1];
+        const uint8_t minor = data[2];
+        const uint32_t length = static_cast<uint32_t>(data[4]) | (static_cast<uint32_t>(data[5]) << 8) |
+            (static_cast<uint32_t>(data[6]) << 16) | (static_cast<uint32_t>(data[7]) << 24);
+        if (length > size - 8) return false;
+        return ParseSmbiosTable(data + 8, length, major, minor, out);
+    }
+
+#ifdef _WIN32
+    bool ReadSmbios(SmbiosInfo& out)
+    {
+        out = SmbiosInfo();
+        const DWORD provider = 'RSMB';
+        const UINT needed = GetSystemFirmwareTable(provider, 0, nullptr, 0);
+        if (needed == 0) return false;
+        std::vector<uint8_t> buf(needed);
+        const UINT got = GetSystemFirmwareTable(provider, 0, buf.data(), needed);
+        if (got == 0 || got > needed) return false;
+        return ParseRawSmbiosData(buf.data(), got, out);
+    }
+
+    std::string ProcessorId()
+    {
+#if defined(_M_IX86) || defined(_M_X64)
+        int regs[4] = { 0, 0, 0, 0 };
+        __cpuid(regs, 0);
+        if (regs[0] < 1) return std::string();
+        __cpuid(regs, 1);
+        return FormatProcessorId(static_cast<uint32_t>(regs[0]), static_cast<uint32_t>(regs[3]));
+#else
+        return std::string();
+#endif
+    }
+#else
+    bool ReadSmbios(SmbiosInfo& out)
+    {
+        out = SmbiosInfo();
+
+        std::vector<uint8_t> entry;
+        std::vector<uint8_t> table;
+        if (ReadFileBytes("/sys/firmware/dmi/tables/smbios_entry_point", entry) &&
+            ReadFileBytes("/sys/firmware/dmi/tables/DMI", table)) {
+            uint8_t major = 0;
+            uint8_t minor = 0;
+            if (entry.size() >= 9 && std::memcmp(entry.data(), "_SM3_", 5) == 0) {
+                major = entry[7];
+                minor = entry[8];
+            } else if (entry.size() >= 8 && std::memcmp(entry.data(), "_SM_", 4) == 0) {
+                major = entry[6];
+                minor = entry[7];
+            }
+            if (major != 0 && ParseSmbiosTable(table.data(), table.size(), major, minor, out)) {
+                return true;
+            }
+        }
+
+        // The raw table is root-only; the kernel's decoded view may still be readable.
+        std::string uuid = ReadSysfsValue("/sys/class/dmi/id/product_uuid");
+        for (char& c : uuid) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        out.systemUuid = uuid;
+        out.systemSerial = ReadSysfsValue("/sys/class/dmi/id/product_serial");
+        out.baseboardSerial = ReadSysfsValue("/sys/class/dmi/id/board_serial");
+        out.valid = !out.systemUuid.empty();
+        return out.valid;
+    }
+
+    std::string ProcessorId()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return std::string();
+        return FormatProcessorId(eax, edx);
+#else
+        return std::string();
+#endif
+    }
+#endif
+}
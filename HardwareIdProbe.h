@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// HardwareIdProbe
+// - In-process replacements for the wmic queries behind the MachineId:
+//     wmic cpu get ProcessorId        -> CPUID leaf 1 (EDX then EAX, 16 uppercase hex digits)
+//     wmic csproduct get UUID         -> SMBIOS type 1 UUID
+//     wmic bios get SerialNumber      -> SMBIOS type 1 serial number
+//     wmic baseboard get SerialNumber -> SMBIOS type 2 serial number
+// - Values are formatted exactly like the trimmed wmic output, so IDs derived from them are
+//   byte-compatible with the ones older builds computed.
+// - Windows reads the raw table with GetSystemFirmwareTable('RSMB'); Linux reads
+//   /sys/firmware/dmi/tables (or /sys/class/dmi/id when the raw table is not readable).
+// - The parser works on plain byte buffers, so recorded SMBIOS dumps can be fed to it directly.
+namespace HardwareIdProbe
+{
+    struct SmbiosInfo {
+        bool valid = false;             // a table was found and parsed
+        std::string systemUuid;         // type 1, "XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX"
+        std::string systemSerial;       // type 1 (what Win32_BIOS.SerialNumber reports)
+        std::string baseboardSerial;    // type 2
+    };
+
+    // Parses an SMBIOS structure table (no entry point / header in front).
+    bool ParseSmbiosTable(const uint8_t* table, size_t size, uint8_t majorVersion, uint8_t minorVersion, SmbiosInfo& out);
+
+    // Parses the RawSMBIOSData layout returned by GetSystemFirmwareTable('RSMB', 0, ...):
+    // 4 bytes (calling method, major, minor, DMI revision), u32 length, table data.
+    bool ParseRawSmbiosData(const uint8_t* data, size_t size, SmbiosInfo& out);
+
+    // Reads and parses the SMBIOS table of this machine.
+    bool ReadSmbios(SmbiosInfo& out);
+
+    // "EDX" + "EAX" of CPUID leaf 1, as Win32_Processor.ProcessorId; empty without CPUID.
+    std::string ProcessorId();
+
+    std::string FormatProcessorId(uint32_t eax, uint32_t edx);
+
+    // SMBIOS 2.6+ stores the first three UUID fields little-endian; older tables big-endian.
+    std::string FormatSmbiosUuid(const uint8_t uuid[16], bool littleEndianFields);
+}
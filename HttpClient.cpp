@@ -0,0 +1,344 @@
+#include "HttpClient.h"
+
+#include "DebugLog.h"
+
+#pragma comment(lib, "winhttp.lib")
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Filled from WinHTTP status notifications on the thread that issues the request.
+    struct RequestTrace {
+        Clock::time_point start;
+        Clock::time_point resolveStart;
+        Clock::time_point resolveEnd;
+        Clock::time_point connectStart;
+        Clock::time_point connectEnd;
+        Clock::time_point sendStart;
+        Clock::time_point headersReceived;
+        Clock::time_point end;
+    };
+
+    static double ElapsedMs(Clock::time_point from, Clock::time_point to)
+    {
+        if (from == Clock::time_point{} || to == Clock::time_point{} || to < from) {
+            return 0.0;
+        }
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    static std::string Win32ErrorToString(DWORD err)
+    {
+        LPSTR msg = nullptr;
+        const DWORD flags = FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
+        const DWORD n = FormatMessageA(flags, nullptr, err, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&msg, 0, nullptr);
+        std::string s;
+        if (n && msg) {
+            s.assign(msg, n);
+            while (!s.empty() && (s.back() == '\r' || s.back() == '\n' || s.back() == ' ' || s.back() == '\t')) {
+                s.pop_back();
+            }
+        } else {
+            s = "Unknown error";
+        }
+        if (msg) LocalFree(msg);
+        return s;
+    }
+
+    static void DebugLogWinHttpFailure(const char* stage)
+    {
+        const DWORD err = GetLastError();
+        DebugLog(std::string("HttpClient: ") + stage + " failed. GetLastError=" + std::to_string(err) + " (" + Win32ErrorToString(err) + ")");
+    }
+
+    static std::string NarrowAscii(const std::wstring& ws)
+    {
+        std::string s;
+        s.reserve(ws.size());
+        for (wchar_t ch : ws) {
+            s.push_back((ch >= 0x20 && ch < 0x7F) ? static_cast<char>(ch) : '?');
+        }
+        return s;
+    }
+}
+
+HttpClient::HttpClient(std::chrono::milliseconds idleTimeout)
+    : idleTimeout_(idleTimeout)
+{
+}
+
+HttpClient::~HttpClient()
+{
+    Close();
+}
+
+bool HttpClient::EnsureSessionLocked()
+{
+    if (hSession_) {
+        return true;
+    }
+
+    hSession_ = WinHttpOpen(L"HayateKomorebi/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+    if (!hSession_) {
+        DebugLogWinHttpFailure("WinHttpOpen");
+        return false;
+    }
+
+    const int timeoutMs = 15000;
+    (void)WinHttpSetTimeouts(hSession_, timeoutMs, timeoutMs, timeoutMs, timeoutMs);
+
+#ifdef WINHTTP_PROTOCOL_FLAG_HTTP2
+    // Best effort: older Windows builds reject the option and simply stay on HTTP/1.1 keep-alive.
+    DWORD protocols = WINHTTP_PROTOCOL_FLAG_HTTP2;
+    if (!WinHttpSetOption(hSession_, WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &protocols, sizeof(protocols))) {
+        DebugLog("HttpClient: HTTP/2 not available; using HTTP/1.1 keep-alive.");
+    }
+#endif
+
+    const DWORD notifyFlags =
+        WINHTTP_CALLBACK_FLAG_RESOLVE_NAME |
+        WINHTTP_CALLBACK_FLAG_CONNECT_TO_SERVER |
+        WINHTTP_CALLBACK_FLAG_SEND_REQUEST;
+    if (WinHttpSetStatusCallback(hSession_, &HttpClient::StatusCallback, notifyFlags, 0) == WINHTTP_INVALID_STATUS_CALLBACK) {
+        DebugLogWinHttpFailure("WinHttpSetStatusCallback");
+    }
+    return true;
+}
+
+void CALLBACK HttpClient::StatusCallback(HINTERNET, DWORD_PTR context, DWORD status, LPVOID, DWORD)
+{
+    auto* trace = reinterpret_cast<RequestTrace*>(context);
+    if (!trace) {
+        return;
+    }
+
+    const Clock::time_point now = Clock::now();
+    switch (status) {
+    case WINHTTP_CALLBACK_STATUS_RESOLVING_NAME:
+        trace->resolveStart = now;
+        break;
+    case WINHTTP_CALLBACK_STATUS_NAME_RESOLVED:
+        trace->resolveEnd = now;
+        break;
+    case WINHTTP_CALLBACK_STATUS_CONNECTING_TO_SERVER:
+        trace->connectStart = now;
+        break;
+    case WINHTTP_CALLBACK_STATUS_CONNECTED_TO_SERVER:
+        trace->connectEnd = now;
+        break;
+    case WINHTTP_CALLBACK_STATUS_SENDING_REQUEST:
+        if (trace->sendStart == Clock::time_point{}) {
+            trace->sendStart = now;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+HttpJsonResult HttpClient::PostJson(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody)
+{
+    HttpJsonResult r;
+
+    URL_COMPONENTS uc;
+    ZeroMemory(&uc, sizeof(uc));
+    uc.dwStructSize = sizeof(uc);
+    uc.dwSchemeLength = (DWORD)-1;
+    uc.dwHostNameLength = (DWORD)-1;
+    uc.dwUrlPathLength = (DWORD)-1;
+    uc.dwExtraInfoLength = (DWORD)-1;
+
+    std::wstring url = baseUrl;
+    if (!WinHttpCrackUrl(url.c_str(), (DWORD)url.size(), 0, &uc)) {
+        DebugLogWinHttpFailure("WinHttpCrackUrl");
+        return r;
+    }
+
+    const std::wstring host(uc.lpszHostName, uc.dwHostNameLength);
+    const INTERNET_PORT port = uc.nPort;
+    const bool isHttps = (uc.nScheme == INTERNET_SCHEME_HTTPS);
+    const std::wstring key = (isHttps ? L"https://" : L"http://") + host + L":" + std::to_wstring(port);
+
+    HINTERNET hConnect = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        EvictIdleLocked(Clock::now());
+        if (!EnsureSessionLocked()) {
+            ++stats_.failures;
+            return r;
+        }
+
+        Connection& conn = connections_[key];
+        if (!conn.hConnect) {
+            conn.hConnect = WinHttpConnect(hSession_, host.c_str(), port, 0);
+            if (!conn.hConnect) {
+                DebugLogWinHttpFailure("WinHttpConnect");
+                connections_.erase(key);
+                ++stats_.failures;
+                return r;
+            }
+            conn.isHttps = isHttps;
+        }
+        ++conn.inFlight;
+        conn.lastUsed = Clock::now();
+        hConnect = conn.hConnect;
+        ++stats_.requests;
+    }
+
+    RequestTrace trace;
+    trace.start = Clock::now();
+
+    DWORD flags = WINHTTP_FLAG_REFRESH;
+    if (isHttps) flags |= WINHTTP_FLAG_SECURE;
+
+    bool readOk = false;
+    DWORD statusCode = 0;
+    HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"POST", path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
+    if (!hRequest) {
+        DebugLogWinHttpFailure("WinHttpOpenRequest");
+    } else {
+        DWORD_PTR traceContext = reinterpret_cast<DWORD_PTR>(&trace);
+        (void)WinHttpSetOption(hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &traceContext, sizeof(traceContext));
+
+        const wchar_t* hdrs = L"Content-Type: application/json\r\nAccept: application/json\r\n";
+        if (!WinHttpSendRequest(hRequest, hdrs, (DWORD)-1L, (LPVOID)jsonBody.data(), (DWORD)jsonBody.size(), (DWORD)jsonBody.size(), 0)) {
+            DebugLogWinHttpFailure("WinHttpSendRequest");
+        } else if (!WinHttpReceiveResponse(hRequest, nullptr)) {
+            DebugLogWinHttpFailure("WinHttpReceiveResponse");
+        } else {
+            trace.headersReceived = Clock::now();
+
+            DWORD statusCodeSize = sizeof(statusCode);
+            if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &statusCodeSize, WINHTTP_NO_HEADER_INDEX)) {
+                DebugLogWinHttpFailure("WinHttpQueryHeaders(STATUS_CODE)");
+                statusCode = 0;
+            }
+
+            readOk = true;
+            DWORD avail = 0;
+            do {
+                avail = 0;
+                if (!WinHttpQueryDataAvailable(hRequest, &avail)) {
+                    DebugLogWinHttpFailure("WinHttpQueryDataAvailable");
+                    readOk = false;
+                    break;
+                }
+                if (!avail) break;
+                const size_t offset = r.body.size();
+                r.body.resize(offset + avail);
+                DWORD read = 0;
+                if (!WinHttpReadData(hRequest, &r.body[offset], avail, &read)) {
+                    DebugLogWinHttpFailure("WinHttpReadData");
+                    r.body.resize(offset);
+                    readOk = false;
+                    break;
+                }
+                r.body.resize(offset + read);
+            } while (avail > 0);
+        }
+
+        // Detach the trace so late notifications never see a dangling pointer.
+        traceContext = 0;
+        (void)WinHttpSetOption(hRequest, WINHTTP_OPTION_CONTEXT_VALUE, &traceContext, sizeof(traceContext));
+        WinHttpCloseHandle(hRequest);
+    }
+    trace.end = Clock::now();
+
+    HttpRequestTiming timing;
+    timing.connectionReused = (trace.connectEnd == Clock::time_point{});
+    timing.dnsMs = ElapsedMs(trace.resolveStart, trace.resolveEnd);
+    timing.connectMs = ElapsedMs(trace.connectStart, trace.connectEnd);
+    timing.tlsMs = isHttps ? ElapsedMs(trace.connectEnd, trace.sendStart) : 0.0;
+    timing.ttfbMs = ElapsedMs(trace.sendStart != Clock::time_point{} ? trace.sendStart : trace.start, trace.headersReceived);
+    timing.totalMs = ElapsedMs(trace.start, trace.end);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = connections_.find(key);
+        if (it != connections_.end()) {
+            --it->second.inFlight;
+            it->second.lastUsed = Clock::now();
+        }
+        if (readOk) {
+            if (timing.connectionReused) ++stats_.reusedConnections;
+            else ++stats_.newConnections;
+        } else {
+            ++stats_.failures;
+        }
+        stats_.last = timing;
+    }
+
+    DebugLog(std::string("HttpClient: POST ") + NarrowAscii(path)
+        + " status=" + std::to_string(statusCode)
+        + " reused=" + (timing.connectionReused ? "1" : "0")
+        + " dns=" + std::to_string(timing.dnsMs)
+        + "ms connect=" + std::to_string(timing.connectMs)
+        + "ms tls=" + std::to_string(timing.tlsMs)
+        + "ms ttfb=" + std::to_string(timing.ttfbMs)
+        + "ms total=" + std::to_string(timing.totalMs) + "ms");
+
+    if (!readOk) {
+        return r;
+    }
+    r.transportOk = true;
+    r.statusCode = statusCode;
+    return r;
+}
+
+void HttpClient::EvictIdle()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    EvictIdleLocked(Clock::now());
+}
+
+void HttpClient::EvictIdleLocked(Clock::time_point now)
+{
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        Connection& conn = it->second;
+        if (conn.inFlight == 0 && now - conn.lastUsed >= idleTimeout_) {
+            if (conn.hConnect) {
+                WinHttpCloseHandle(conn.hConnect);
+            }
+            ++stats_.idleEvictions;
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Closing the session drops WinHTTP's pooled sockets as well.
+    if (connections_.empty() && hSession_) {
+        WinHttpSetStatusCallback(hSession_, nullptr, WINHTTP_CALLBACK_FLAG_ALL_NOTIFICATIONS, 0);
+        WinHttpCloseHandle(hSession_);
+        hSession_ = nullptr;
+    }
+}
+
+void HttpClient::Close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    CloseLocked();
+}
+
+void HttpClient::CloseLocked()
+{
+    for (auto& entry : connections_) {
+        if (entry.second.hConnect) {
+            WinHttpCloseHandle(entry.second.hConnect);
+        }
+    }
+    connections_.clear();
+
+    if (hSession_) {
+        WinHttpSetStatusCallback(hSession_, nullptr, WINHTTP_CALLBACK_FLAG_ALL_NOTIFICATIONS, 0);
+        WinHttpCloseHandle(hSession_);
+        hSession_ = nullptr;
+    }
+}
+
+HttpClientStats HttpClient::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <windows.h>
+#include <winhttp.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "HttpTransport.h"
+
+// HttpClient
+// - Long-lived WinHTTP client owned by TaskTrayApp.
+// - Keeps one WinHTTP session and one connect handle per scheme/host/port alive between requests,
+//   so back-to-back calls (device_nonce -> device_refresh) reuse the pooled TCP+TLS connection.
+// - Requests HTTP/2 where the OS supports it; HTTP/1.1 keep-alive otherwise.
+// - Connect handles that stay unused for longer than the idle timeout are evicted; when the last
+//   one goes, the session is closed too so no idle sockets are kept around between refreshes.
+// - TLS time is approximated as CONNECTED_TO_SERVER -> SENDING_REQUEST on new HTTPS connections.
+// - Thread-safe: the activation poll thread and the control panel may post concurrently.
+class HttpClient : public IHttpTransport
+{
+public:
+    explicit HttpClient(std::chrono::milliseconds idleTimeout = std::chrono::seconds(90));
+    ~HttpClient();
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+
+    // POST application/json to baseUrl + path.
+    HttpJsonResult PostJson(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody) override;
+
+    // Closes connect handles that have been idle longer than the idle timeout.
+    void EvictIdle() override;
+
+    // Closes every handle. The next request reopens the session lazily.
+    void Close();
+
+    HttpClientStats GetStats() const override;
+
+private:
+    struct Connection {
+        HINTERNET hConnect = nullptr;
+        bool isHttps = false;
+        int inFlight = 0;
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
+    bool EnsureSessionLocked();
+    void EvictIdleLocked(std::chrono::steady_clock::time_point now);
+    void CloseLocked();
+
+    static void CALLBACK StatusCallback(HINTERNET hInternet, DWORD_PTR context, DWORD status, LPVOID info, DWORD infoLength);
+
+    const std::chrono::milliseconds idleTimeout_;
+
+    mutable std::mutex mutex_;
+    HINTERNET hSession_ = nullptr;
+    std::map<std::wstring, Connection> connections_;    // key: scheme://host:port
+    HttpClientStats stats_;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct HttpJsonResult {
+    bool transportOk = false;   // transport succeeded enough to get a status/body
+    uint32_t statusCode = 0;
+    std::string body;
+};
+
+// Per-request connection timing in milliseconds.
+// Phases that were skipped because a pooled connection was reused are reported as 0.
+struct HttpRequestTiming {
+    bool connectionReused = false;
+    double dnsMs = 0.0;
+    double connectMs = 0.0;
+    double tlsMs = 0.0;
+    double ttfbMs = 0.0;    // send start -> response headers received
+    double totalMs = 0.0;
+};
+
+struct HttpClientStats {
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    uint64_t newConnections = 0;
+    uint64_t reusedConnections = 0;
+    uint64_t idleEvictions = 0;
+    HttpRequestTiming last;
+};
+
+// IHttpTransport
+// - Blocking "POST application/json" used by activation traffic (device_nonce / device_refresh / device_enroll).
+// - Implementations:
+//     HttpClient           WinHTTP, pooled session (HTTPS, proxies, HTTP/2). Windows only.
+//     SocketHttpTransport  plain HTTP/1.1 over a TCP socket (http:// only). Portable; meant for
+//                          loopback/dev servers selected with HAYATEKOMOREBI_HTTP_TRANSPORT=socket.
+// - Returns status code + body even on non-2xx responses.
+// - Implementations must be safe to call from several threads at once.
+class IHttpTransport
+{
+public:
+    virtual ~IHttpTransport() = default;
+
+    virtual HttpJsonResult PostJson(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody) = 0;
+
+    // Drops idle pooled connections (no-op for transports that do not pool).
+    virtual void EvictIdle() {}
+
+    virtual HttpClientStats GetStats() const = 0;
+};
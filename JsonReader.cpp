@@ -0,0 +1,419 @@
+#include "JsonReader.h"
+
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr uint16_t kMaxDepth = 64;
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ReadHex4(const char* s, uint32_t& out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        const int h = HexValue(s[i]);
+        if (h < 0) return false;
+        v = (v << 4) | static_cast<uint32_t>(h);
+    }
+    out = v;
+    return true;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+} // namespace
+
+bool JsonReader::Parse(const std::string& text) {
+    text_ = text.data();
+    size_ = text.size();
+    valid_ = false;
+    members_.clear();
+
+    if (size_ >= std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    size_t p = 0;
+    Type type = Type::Null;
+    size_t begin = 0;
+    size_t end = 0;
+    bool escaped = false;
+    if (!ParseValue(p, 0, type, begin, end, escaped)) {
+        members_.clear();
+        return false;
+    }
+    SkipWs(p);
+    if (p != size_) {
+        members_.clear();
+        return false;
+    }
+    valid_ = true;
+    return true;
+}
+
+void JsonReader::SkipWs(size_t& p) const {
+    while (p < size_) {
+        const char c = text_[p];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        ++p;
+    }
+}
+
+bool JsonReader::ScanString(size_t& p, size_t& begin, size_t& end, bool& escaped) const {
+    // p points at the opening quote.
+    ++p;
+    begin = p;
+    escaped = false;
+    while (p < size_) {
+        const unsigned char c = static_cast<unsigned char>(text_[p]);
+        if (c == '"') {
+            end = p;
+            ++p;
+            return true;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            ++p;
+            continue;
+        }
+        escaped = true;
+        if (p + 1 >= size_) return false;
+        const char e = text_[p + 1];
+        switch (e) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                p += 2;
+                break;
+            case 'u': {
+                uint32_t unused = 0;
+                if (p + 6 > size_ || !ReadHex4(text_ + p + 2, unused)) return false;
+                p += 6;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+bool JsonReader::ScanNumber(size_t& p) const {
+    const size_t start = p;
+    if (p < size_ && text_[p] == '-') ++p;
+    if (p >= size_) return false;
+    if (text_[p] == '0') {
+        ++p;
+    } else if (text_[p] >= '1' && text_[p] <= '9') {
+        while (p < size_ && text_[p] >= '0' && text_[p] <= '9') ++p;
+    } else {
+        return false;
+    }
+    if (p < size_ && text_[p] == '.') {
+        ++p;
+        const size_t digits = p;
+        while (p < size_ && text_[p] >= '0' && text_[p] <= '9') ++p;
+        if (p == digits) return false;
+    }
+    if (p < size_ && (text_[p] == 'e' || text_[p] == 'E')) {
+        ++p;
+        if (p < size_ && (text_[p] == '+' || text_[p] == '-')) ++p;
+        const size_t digits = p;
+        while (p < size_ && text_[p] >= '0' && text_[p] <= '9') ++p;
+        if (p == digits) return false;
+    }
+    return p > start;
+}
+
+bool JsonReader::ParseValue(size_t& p, uint16_t depth, Type& type, size_t& begin, size_t& end, bool& escaped) {
+    SkipWs(p);
+    if (p >= size_) return false;
+
+    escaped = false;
+    const char c = text_[p];
+    switch (c) {
+        case '"':
+            type = Type::String;
+            return ScanString(p, begin, end, escaped);
+        case '{':
+            type = Type::Object;
+            begin = p;
+            if (!ParseObject(p, depth)) return false;
+            end = p;
+            return true;
+        case '[':
+            type = Type::Array;
+            begin = p;
+            if (!ParseArray(p, depth)) return false;
+            end = p;
+            return true;
+        case 't':
+            if (size_ - p < 4 || std::memcmp(text_ + p, "true", 4) != 0) return false;
+            type = Type::Bool;
+            begin = p;
+            p += 4;
+            end = p;
+            return true;
+        case 'f':
+            if (size_ - p < 5 || std::memcmp(text_ + p, "false", 5) != 0) return false;
+            type = Type::Bool;
+            begin = p;
+            p += 5;
+            end = p;
+            return true;
+        case 'n':
+            if (size_ - p < 4 || std::memcmp(text_ + p, "null", 4) != 0) return false;
+            type = Type::Null;
+            begin = p;
+            p += 4;
+            end = p;
+            return true;
+        default:
+            type = Type::Number;
+            begin = p;
+            if (!ScanNumber(p)) return false;
+            end = p;
+            return true;
+    }
+}
+
+bool JsonReader::ParseObject(size_t& p, uint16_t depth) {
+    if (depth >= kMaxDepth) return false;
+    const uint16_t memberDepth = static_cast<uint16_t>(depth + 1);
+
+    ++p; // '{'
+    SkipWs(p);
+    if (p < size_ && text_[p] == '}') {
+        ++p;
+        return true;
+    }
+
+    while (p < size_) {
+        SkipWs(p);
+        if (p >= size_ || text_[p] != '"') return false;
+
+        size_t keyBegin = 0;
+        size_t keyEnd = 0;
+        bool keyEscaped = false;
+        if (!ScanString(p, keyBegin, keyEnd, keyEscaped)) return false;
+
+        SkipWs(p);
+        if (p >= size_ || text_[p] != ':') return false;
+        ++p;
+
+        // Reserve the slot before descending so members stay in document order.
+        const size_t index = members_.size();
+        members_.push_back(Member{});
+
+        Type type = Type::Null;
+        size_t valueBegin = 0;
+        size_t valueEnd = 0;
+        bool valueEscaped = false;
+        if (!ParseValue(p, memberDepth, type, valueBegin, valueEnd, valueEscaped)) return false;
+
+        Member& m = members_[index];
+        m.keyBegin = static_cast<uint32_t>(keyBegin);
+        m.keyEnd = static_cast<uint32_t>(keyEnd);
+        m.valueBegin = static_cast<uint32_t>(valueBegin);
+        m.valueEnd = static_cast<uint32_t>(valueEnd);
+        m.depth = memberDepth;
+        m.type = type;
+        m.keyEscaped = keyEscaped;
+        m.valueEscaped = valueEscaped;
+
+        SkipWs(p);
+        if (p >= size_) return false;
+        if (text_[p] == ',') {
+            ++p;
+            continue;
+        }
+        if (text_[p] == '}') {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+bool JsonReader::ParseArray(size_t& p, uint16_t depth) {
+    if (depth >= kMaxDepth) return false;
+    const uint16_t elementDepth = static_cast<uint16_t>(depth + 1);
+
+    ++p; // '['
+    SkipWs(p);
+    if (p < size_ && text_[p] == ']') {
+        ++p;
+        return true;
+    }
+
+    while (p < size_) {
+        Type type = Type::Null;
+        size_t begin = 0;
+        size_t end = 0;
+        bool escaped = false;
+        if (!ParseValue(p, elementDepth, type, begin, end, escaped)) return false;
+
+        SkipWs(p);
+        if (p >= size_) return false;
+        if (text_[p] == ',') {
+            ++p;
+            continue;
+        }
+        if (text_[p] == ']') {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+void JsonReader::DecodeString(const char* s, size_t n, std::string& out) {
+    out.clear();
+    out.reserve(n);
+    size_t i = 0;
+    while (i < n) {
+        // Copy the run up to the next escape in one go.
+        const char* bs = static_cast<const char*>(std::memchr(s + i, '\\', n - i));
+        const size_t runEnd = bs ? static_cast<size_t>(bs - s) : n;
+        out.append(s + i, runEnd - i);
+        i = runEnd;
+        if (i >= n) break;
+
+        // Escapes were validated by ScanString.
+        const char e = s[i + 1];
+        i += 2;
+        switch (e) {
+            case '"': out.push_back('"'); break;
+            case '\\': out.push_back('\\'); break;
+            case '/': out.push_back('/'); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp = 0;
+                (void)ReadHex4(s + i, cp);
+                i += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t lo = 0;
+                    if (i + 6 <= n && s[i] == '\\' && s[i + 1] == 'u' && ReadHex4(s + i + 2, lo) &&
+                        lo >= 0xDC00 && lo <= 0xDFFF) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    } else {
+                        cp = 0xFFFD;
+                    }
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    cp = 0xFFFD;
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+bool JsonReader::KeyEquals(const Member& m, const char* key, size_t keyLen) const {
+    const size_t rawLen = m.keyEnd - m.keyBegin;
+    if (!m.keyEscaped) {
+        return rawLen == keyLen && std::memcmp(text_ + m.keyBegin, key, keyLen) == 0;
+    }
+    if (rawLen < keyLen) {
+        return false; // escapes only ever shrink the decoded key
+    }
+    std::string decoded;
+    DecodeString(text_ + m.keyBegin, rawLen, decoded);
+    return decoded.size() == keyLen && std::memcmp(decoded.data(), key, keyLen) == 0;
+}
+
+const JsonReader::Member* JsonReader::Find(const char* key) const {
+    if (!valid_ || !key) return nullptr;
+    const size_t keyLen = std::strlen(key);
+    const Member* best = nullptr;
+    for (const Member& m : members_) {
+        if (best && m.depth >= best->depth) continue;
+        if (KeyEquals(m, key, keyLen)) {
+            best = &m;
+            if (best->depth == 1) break;
+        }
+    }
+    return best;
+}
+
+bool JsonReader::GetString(const char* key, std::string& out) const {
+    out.clear();
+    const Member* m = Find(key);
+    if (!m || m->type != Type::String) return false;
+    if (m->valueEscaped) {
+        DecodeString(text_ + m->valueBegin, m->valueEnd - m->valueBegin, out);
+    } else {
+        out.assign(text_ + m->valueBegin, m->valueEnd - m->valueBegin);
+    }
+    return true;
+}
+
+bool JsonReader::GetBool(const char* key, bool& out) const {
+    const Member* m = Find(key);
+    if (!m || m->type != Type::Bool) return false;
+    out = (text_[m->valueBegin] == 't');
+    return true;
+}
+
+bool JsonReader::GetInt64(const char* key, int64_t& out) const {
+    const Member* m = Find(key);
+    if (!m || m->type != Type::Number) return false;
+
+    size_t p = m->valueBegin;
+    const bool negative = (text_[p] == '-');
+    if (negative) ++p;
+    uint64_t v = 0;
+    const uint64_t limit = negative ? static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1
+                                    : static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+    for (; p < m->valueEnd; ++p) {
+        const char c = text_[p];
+        if (c < '0' || c > '9') return false; // fractions / exponents are not integers
+        const uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (v > (limit - digit) / 10) return false;
+        v = v * 10 + digit;
+    }
+    out = negative ? static_cast<int64_t>(0 - v) : static_cast<int64_t>(v);
+    return true;
+}
+
+bool JsonReader::IsTrue(const char* key) const {
+    bool v = false;
+    return GetBool(key, v) && v;
+}
+
+std::string JsonReader::StringOr(const char* key, const std::string& fallback) const {
+    std::string out;
+    if (!GetString(key, out)) return fallback;
+    return out;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// JsonReader
+// - Parses a JSON response body once and indexes every object member as a span into the body.
+// - Lookups prefer the shallowest match (top-level members first) and never match text that
+//   only appears inside a string value.
+// - String values are decoded on demand; values without escapes are copied straight out of the
+//   body, so a multi-KB license_blob costs one scan during Parse and one copy on lookup.
+// - \uXXXX escapes (including surrogate pairs) are decoded to UTF-8; lone surrogates become U+FFFD.
+// - The reader keeps a pointer to the parsed text: the string passed to Parse must outlive it.
+class JsonReader
+{
+public:
+    enum class Type : uint8_t { Null, Bool, Number, String, Object, Array };
+
+    JsonReader() = default;
+    explicit JsonReader(const std::string& text) { (void)Parse(text); }
+    explicit JsonReader(std::string&&) = delete;   // would dangle
+
+    // Returns false (and leaves the reader empty) when text is not a single well-formed JSON value.
+    bool Parse(const std::string& text);
+    bool Parse(std::string&&) = delete;
+
+    bool IsValid() const { return valid_; }
+    bool Has(const char* key) const { return Find(key) != nullptr; }
+
+    // Typed lookups. Each returns false when the key is missing or holds a different type;
+    // out is cleared / left untouched respectively.
+    bool GetString(const char* key, std::string& out) const;
+    bool GetBool(const char* key, bool& out) const;
+    bool GetInt64(const char* key, int64_t& out) const;
+
+    // Convenience: key exists and is literally true.
+    bool IsTrue(const char* key) const;
+
+    // Convenience for optional fields: decoded string value or empty.
+    std::string StringOr(const char* key, const std::string& fallback = std::string()) const;
+
+private:
+    struct Member {
+        uint32_t keyBegin;      // offsets into text_, quotes excluded
+        uint32_t keyEnd;
+        uint32_t valueBegin;    // for strings: quotes excluded
+        uint32_t valueEnd;
+        uint16_t depth;         // 1 = member of the root object
+        Type type;
+        bool keyEscaped;
+        bool valueEscaped;
+    };
+
+    bool ParseValue(size_t& p, uint16_t depth, Type& type, size_t& begin, size_t& end, bool& escaped);
+    bool ParseObject(size_t& p, uint16_t depth);
+    bool ParseArray(size_t& p, uint16_t depth);
+    bool ScanString(size_t& p, size_t& begin, size_t& end, bool& escaped) const;
+    bool ScanNumber(size_t& p) const;
+    void SkipWs(size_t& p) const;
+
+    bool KeyEquals(const Member& m, const char* key, size_t keyLen) const;
+    const Member* Find(const char* key) const;
+
+    static void DecodeString(const char* s, size_t n, std::string& out);
+
+    const char* text_ = nullptr;
+    size_t size_ = 0;
+    bool valid_ = false;
+    std::vector<Member> members_;
+};
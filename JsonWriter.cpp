@@ -0,0 +1,115 @@
+#include "JsonWriter.h"
+
+#include <cstring>
+
+namespace {
+
+// 0: copy verbatim, 'u': \u00xx, otherwise the character that follows the backslash.
+struct EscapeTable {
+    char map[256];
+    constexpr EscapeTable() : map() {
+        for (int i = 0; i < 0x20; ++i) map[i] = 'u';
+        map[static_cast<unsigned char>('"')] = '"';
+        map[static_cast<unsigned char>('\\')] = '\\';
+        map[static_cast<unsigned char>('\n')] = 'n';
+        map[static_cast<unsigned char>('\r')] = 'r';
+        map[static_cast<unsigned char>('\t')] = 't';
+    }
+};
+
+constexpr EscapeTable kEscape;
+
+} // namespace
+
+JsonWriter::JsonWriter(size_t reserveBytes) {
+    out_.reserve(reserveBytes);
+}
+
+void JsonWriter::Reset() {
+    out_.clear();
+    needComma_ = false;
+}
+
+void JsonWriter::Reserve(size_t n) {
+    if (out_.capacity() - out_.size() < n) {
+        out_.reserve(out_.size() + n);
+    }
+}
+
+JsonWriter& JsonWriter::BeginObject() {
+    out_.push_back('{');
+    needComma_ = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    out_.push_back('}');
+    needComma_ = true;
+    return *this;
+}
+
+void JsonWriter::Key(const char* key) {
+    if (needComma_) out_.push_back(',');
+    needComma_ = true;
+    out_.push_back('"');
+    AppendEscaped(out_, key, std::strlen(key));
+    out_.append("\":", 2);
+}
+
+JsonWriter& JsonWriter::String(const char* key, const std::string& value) {
+    // Quotes, colon, comma and a little slack for escapes; large tokens/blobs are base64 and
+    // need none.
+    Reserve(std::strlen(key) + value.size() + 16);
+    Key(key);
+    out_.push_back('"');
+    AppendEscaped(out_, value.data(), value.size());
+    out_.push_back('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(const char* key, bool value) {
+    Key(key);
+    if (value) {
+        out_.append("true", 4);
+    } else {
+        out_.append("false", 5);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int64(const char* key, int64_t value) {
+    Key(key);
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    uint64_t v = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do {
+        *--p = static_cast<char>('0' + (v % 10));
+        v /= 10;
+    } while (v != 0);
+    if (value < 0) *--p = '-';
+    out_.append(p, static_cast<size_t>(end - p));
+    return *this;
+}
+
+void JsonWriter::AppendEscaped(std::string& out, const char* s, size_t n) {
+    static const char kHex[] = "0123456789abcdef";
+
+    size_t runStart = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        const char e = kEscape.map[c];
+        if (e == 0) continue;
+
+        out.append(s + runStart, i - runStart);
+        if (e == 'u') {
+            const char seq[6] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0x0F] };
+            out.append(seq, sizeof(seq));
+        } else {
+            const char seq[2] = { '\\', e };
+            out.append(seq, sizeof(seq));
+        }
+        runStart = i + 1;
+    }
+    out.append(s + runStart, n - runStart);
+}
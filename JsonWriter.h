@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// JsonWriter
+// - Builds small flat JSON objects (activation request bodies) into one reusable buffer.
+// - Capacity is reserved up front from the field sizes, so a body is normally built with a single
+//   allocation; Reset() keeps the buffer, so a writer owned by a polling thread stops allocating
+//   after the first request.
+// - String escaping is table-driven and copies unescaped runs in bulk. Output matches the previous
+//   JsonEscape: \" \\ \n \r \t, other control characters as \u00xx, everything else verbatim.
+class JsonWriter
+{
+public:
+    explicit JsonWriter(size_t reserveBytes = 256);
+
+    // Clears the output but keeps the allocated capacity.
+    void Reset();
+
+    // Ensures room for at least n more bytes.
+    void Reserve(size_t n);
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+
+    JsonWriter& String(const char* key, const std::string& value);
+    JsonWriter& Bool(const char* key, bool value);
+    JsonWriter& Int64(const char* key, int64_t value);
+
+    const std::string& str() const { return out_; }
+
+    // Appends s to out as the contents of a JSON string (no surrounding quotes).
+    static void AppendEscaped(std::string& out, const char* s, size_t n);
+
+private:
+    void Key(const char* key);
+
+    std::string out_;
+    bool needComma_ = false;
+};
@@ -0,0 +1,180 @@
+#include "LicenseBlob.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "JsonReader.h"
+#include "RefreshScheduler.h"
+#include "hk_tweetnacl_sign.h"
+
+// Pinned license signing key (base64 of the 32-byte Ed25519 public key); set from CMake.
+#ifndef HK_LICENSE_PUBKEY_B64
+#define HK_LICENSE_PUBKEY_B64 ""
+#endif
+
+namespace {
+
+constexpr size_t kPublicKeyBytes = 32;
+constexpr size_t kSignatureBytes = 64;
+
+int Base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+}
+
+// Standard or URL-safe alphabet, padding optional. Anything else (whitespace included) fails.
+bool Base64Decode(const char* s, size_t n, std::vector<uint8_t>& out) {
+    out.clear();
+    while (n > 0 && s[n - 1] == '=') --n;
+    if (n % 4 == 1) return false;
+    out.reserve(n * 3 / 4);
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const int v = Base64Value(s[i]);
+        if (v < 0) return false;
+        acc = (acc << 6) | static_cast<uint32_t>(v);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<uint8_t>(acc >> bits));
+        }
+    }
+    return true;
+}
+
+struct PinnedKey {
+    bool valid = false;
+    std::array<uint8_t, kPublicKeyBytes> bytes{};
+};
+
+const PinnedKey& GetPinnedKey() {
+    static const PinnedKey key = []() {
+        PinnedKey k;
+        const std::string b64 = HK_LICENSE_PUBKEY_B64;
+        std::vector<uint8_t> raw;
+        if (Base64Decode(b64.data(), b64.size(), raw) && raw.size() == kPublicKeyBytes) {
+            std::copy(raw.begin(), raw.end(), k.bytes.begin());
+            k.valid = true;
+        }
+        return k;
+    }();
+    return key;
+}
+
+// Signature check and payload parse for one blob; independent of the device and the clock.
+struct Decoded {
+    LicenseBlob::Verdict verdict = LicenseBlob::Verdict::Malformed;    // Valid, Malformed or BadSignature
+    LicenseBlob::Claims claims;
+};
+
+Decoded Decode(const std::string& blob, const PinnedKey& key) {
+    Decoded d;
+    const size_t dot = blob.find('.');
+    if (dot == std::string::npos || dot == 0 || blob.find('.', dot + 1) != std::string::npos) {
+        return d;
+    }
+
+    std::vector<uint8_t> sig;
+    if (!Base64Decode(blob.data() + dot + 1, blob.size() - dot - 1, sig) || sig.size() != kSignatureBytes) {
+        return d;
+    }
+    if (hk_sign_verify_detached(sig.data(), reinterpret_cast<const uint8_t*>(blob.data()), dot, key.bytes.data()) != 0) {
+        d.verdict = LicenseBlob::Verdict::BadSignature;
+        return d;
+    }
+
+    std::vector<uint8_t> payloadBytes;
+    if (!Base64Decode(blob.data(), dot, payloadBytes)) {
+        return d;
+    }
+    const std::string payload(payloadBytes.begin(), payloadBytes.end());
+    const JsonReader json(payload);
+    if (!json.IsValid() ||
+        !json.GetString("device_id", d.claims.deviceId) || d.claims.deviceId.empty() ||
+        !json.GetString("entitlement_expires_at", d.claims.entitlementExpiresAt) ||
+        !RefreshScheduler::ParseIso8601(d.claims.entitlementExpiresAt, d.claims.expiresAt)) {
+        d.claims = LicenseBlob::Claims{};
+        return d;
+    }
+    d.claims.machineId = json.StringOr("machine_id");
+    d.verdict = LicenseBlob::Verdict::Valid;
+    return d;
+}
+
+std::mutex g_mutex;
+std::string g_lastBlob;
+Decoded g_lastDecoded;
+bool g_hasLast = false;
+
+} // namespace
+
+namespace LicenseBlob
+{
+    bool HasPinnedKey()
+    {
+        return GetPinnedKey().valid;
+    }
+
+    Verdict Check(const std::string& blob, const std::string& deviceId, const std::string& machineId,
+        const std::string& entitlementExpiresAt, std::chrono::system_clock::time_point now, Claims* out)
+    {
+        const PinnedKey& key = GetPinnedKey();
+        if (!key.valid) {
+            return Verdict::NoPinnedKey;
+        }
+        if (blob.empty()) {
+            return Verdict::Malformed;
+        }
+
+        Decoded decoded;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            if (!g_hasLast || g_lastBlob != blob) {
+                g_lastDecoded = Decode(blob, key);
+                g_lastBlob = blob;
+                g_hasLast = true;
+            }
+            decoded = g_lastDecoded;
+        }
+        if (decoded.verdict != Verdict::Valid) {
+            return decoded.verdict;
+        }
+        if (out) {
+            *out = decoded.claims;
+        }
+
+        const Claims& c = decoded.claims;
+        if (c.deviceId != deviceId || (!c.machineId.empty() && c.machineId != machineId)) {
+            return Verdict::WrongDevice;
+        }
+        // The blob and entitlementExpiresAt arrive in the same response; if they disagree the
+        // stored state is not one the server vouched for.
+        std::chrono::system_clock::time_point stored;
+        if (!RefreshScheduler::ParseIso8601(entitlementExpiresAt, stored) || stored != c.expiresAt) {
+            return Verdict::Mismatch;
+        }
+        return (now < c.expiresAt) ? Verdict::Valid : Verdict::Expired;
+    }
+
+    const char* VerdictToString(Verdict verdict)
+    {
+        switch (verdict) {
+            case Verdict::Valid: return "valid";
+            case Verdict::Expired: return "expired";
+            case Verdict::NoPinnedKey: return "no_pinned_key";
+            case Verdict::Malformed: return "malformed";
+            case Verdict::BadSignature: return "bad_signature";
+            case Verdict::WrongDevice: return "wrong_device";
+            case Verdict::Mismatch: return "mismatch";
+        }
+        return "unknown";
+    }
+}
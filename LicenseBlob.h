@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// LicenseBlob
+// - Offline validation of the server-signed license_blob, so the tray app can tell whether its
+//   license is still good without a device_refresh round trip.
+// - Blob format: base64url(payload) "." base64url(signature). The payload is a JSON object with
+//   device_id, entitlement_expires_at (ISO8601) and optionally machine_id; the signature is a
+//   64-byte Ed25519 signature over the first segment exactly as it appears in the blob (the
+//   base64url text, so no JSON canonicalization is needed). Padding is optional and both base64
+//   alphabets are accepted.
+// - The server's public key is pinned at build time (CMake cache variable HK_LICENSE_PUBKEY_B64,
+//   32 bytes in base64). There is deliberately no runtime override. Without a pinned key every
+//   blob is reported as NoPinnedKey and the caller keeps relying on the server.
+// - The result of the signature check is kept for the last blob, so re-checking an unchanged
+//   blob (every poll tick) only re-evaluates the device and expiry checks.
+// - Thread-safe.
+namespace LicenseBlob
+{
+    enum class Verdict {
+        Valid,          // signed by the pinned key, for this device, not yet expired
+        Expired,        // signed and for this device, but entitlement_expires_at has passed
+        NoPinnedKey,    // offline validation not configured in this build
+        Malformed,      // empty, bad encoding or missing payload fields
+        BadSignature,
+        WrongDevice,    // device_id (or machine_id, when present) belongs to someone else
+        Mismatch,       // signed expiry differs from the stored entitlementExpiresAt
+    };
+
+    struct Claims {
+        std::string deviceId;
+        std::string machineId;                          // empty when the payload has none
+        std::string entitlementExpiresAt;               // as signed
+        std::chrono::system_clock::time_point expiresAt{};
+    };
+
+    bool HasPinnedKey();
+
+    // Checks blob against the pinned key, the enrolled device and the stored expiry. out receives
+    // the signed claims whenever the signature is good (also for WrongDevice / Mismatch / Expired).
+    Verdict Check(const std::string& blob, const std::string& deviceId, const std::string& machineId,
+        const std::string& entitlementExpiresAt, std::chrono::system_clock::time_point now, Claims* out);
+
+    const char* VerdictToString(Verdict verdict);
+}
@@ -0,0 +1,370 @@
+#include "MachineIdentity.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "DebugLog.h"
+#include "HardwareIdProbe.h"
+#include "NetworkIdentity.h"
+#include "ProcessRunner.h"
+
+#pragma comment(lib, "advapi32.lib")
+
+namespace {
+
+std::string Trim(const std::string& s) {
+    size_t b = 0;
+    while (b < s.size() && (s[b] == ' ' || s[b] == '\t' || s[b] == '\r' || s[b] == '\n')) b++;
+    size_t e = s.size();
+    while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t' || s[e - 1] == '\r' || s[e - 1] == '\n')) e--;
+    return s.substr(b, e - b);
+}
+
+std::string ExtractWmicValue(const std::string& text, const std::string& key) {
+    auto pos = text.find(key + "=");
+    if (pos != std::string::npos) {
+        pos += key.size() + 1;
+        auto end = text.find_first_of("\r\n", pos);
+        if (end == std::string::npos) end = text.size();
+        return Trim(text.substr(pos, end - pos));
+    }
+
+    std::istringstream iss(text);
+    std::string line;
+    while (std::getline(iss, line)) {
+        line = Trim(line);
+        if (line.empty()) continue;
+        if (line.find(key) != std::string::npos) continue;
+        return line;
+    }
+    return "";
+}
+
+std::string GetRegistryStringValueA(HKEY root, const char* subKey, const char* valueName) {
+    char buffer[512] = {0};
+    DWORD cb = sizeof(buffer);
+    DWORD type = 0;
+    if (RegGetValueA(root, subKey, valueName, RRF_RT_REG_SZ, &type, buffer, &cb) != ERROR_SUCCESS) {
+        return "";
+    }
+    if (cb == 0) {
+        return "";
+    }
+    buffer[sizeof(buffer) - 1] = '\0';
+    return Trim(std::string(buffer));
+}
+
+// The four hardware values the MachineId is built from, as trimmed wmic would print them.
+struct HardwareValues {
+    std::string processorId;
+    std::string systemUuid;
+    std::string baseboardSerial;
+    std::string biosSerial;
+};
+
+// wmic is slow to start (WMI service spin-up on a cold boot) and has been seen to hang, so the
+// queries run concurrently under one deadline: the slowest query bounds the wait, not the sum.
+constexpr std::chrono::milliseconds kWmicTimeout{ 10000 };
+
+struct WmicQuery {
+    const wchar_t* cmdLine;
+    const char* key;
+    std::string* out;
+};
+
+void RunWmicQueries(const std::vector<WmicQuery>& queries) {
+    if (queries.empty()) return;
+
+    std::vector<std::wstring> cmdLines;
+    cmdLines.reserve(queries.size());
+    for (const auto& q : queries) cmdLines.emplace_back(q.cmdLine);
+
+    auto results = ProcessRunner::RunAsync(cmdLines, kWmicTimeout);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const ProcessRunner::Result r = results[i].get();
+        if (r.timedOut) {
+            DebugLog(std::string("MachineIdentity: wmic query for ") + queries[i].key + " timed out.");
+        }
+        *queries[i].out = ExtractWmicValue(r.output, queries[i].key);
+    }
+}
+
+const wchar_t kWmicCpuId[] = L"cmd.exe /d /c wmic cpu get ProcessorId /value 2>nul";
+const wchar_t kWmicUuid[] = L"cmd.exe /d /c wmic csproduct get UUID /value 2>nul";
+const wchar_t kWmicBaseboardSerial[] = L"cmd.exe /d /c wmic baseboard get SerialNumber /value 2>nul";
+const wchar_t kWmicBiosSerial[] = L"cmd.exe /d /c wmic bios get SerialNumber /value 2>nul";
+
+HardwareValues ProbeWmic() {
+    HardwareValues v;
+    RunWmicQueries({
+        { kWmicCpuId, "ProcessorId", &v.processorId },
+        { kWmicUuid, "UUID", &v.systemUuid },
+        { kWmicBaseboardSerial, "SerialNumber", &v.baseboardSerial },
+        { kWmicBiosSerial, "SerialNumber", &v.biosSerial },
+    });
+    return v;
+}
+
+// CPUID + SMBIOS in-process; wmic only for values the native probes cannot provide.
+HardwareValues ProbeNative() {
+    HardwareValues v;
+    std::vector<WmicQuery> fallbacks;
+
+    v.processorId = HardwareIdProbe::ProcessorId();
+    if (v.processorId.empty()) {
+        fallbacks.push_back({ kWmicCpuId, "ProcessorId", &v.processorId });
+    }
+
+    HardwareIdProbe::SmbiosInfo smbios;
+    if (HardwareIdProbe::ReadSmbios(smbios)) {
+        v.systemUuid = smbios.systemUuid;
+        v.baseboardSerial = smbios.baseboardSerial;
+        v.biosSerial = smbios.systemSerial;
+    } else {
+        DebugLog("MachineIdentity: SMBIOS table unavailable; falling back to wmic.");
+    }
+    // Fields the table did not yield (no table, a missing structure, a blank string) are asked of
+    // wmic one by one, so the result never has less than wmic alone would have given.
+    if (v.systemUuid.empty()) {
+        fallbacks.push_back({ kWmicUuid, "UUID", &v.systemUuid });
+    }
+    if (v.baseboardSerial.empty()) {
+        fallbacks.push_back({ kWmicBaseboardSerial, "SerialNumber", &v.baseboardSerial });
+    }
+    if (v.biosSerial.empty()) {
+        fallbacks.push_back({ kWmicBiosSerial, "SerialNumber", &v.biosSerial });
+    }
+
+    RunWmicQueries(fallbacks);
+    return v;
+}
+
+std::string LegacyMachineIdFrom(const HardwareValues& v) {
+    std::string cpuId = v.processorId;
+    std::string sysUuid = v.systemUuid;
+    if (cpuId.empty()) cpuId = "UNKNOWNCPU";
+    if (sysUuid.empty()) sysUuid = "UNKNOWNUUID";
+    return cpuId + "-" + sysUuid;
+}
+
+std::string HexEncodeUpper(uint64_t value) {
+    std::ostringstream oss;
+    oss << std::uppercase << std::hex << std::setw(16) << std::setfill('0') << value;
+    return oss.str();
+}
+
+std::string Fnv1a64Hex(const std::string& text) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char ch : text) {
+        hash ^= static_cast<uint64_t>(ch);
+        hash *= 1099511628211ull;
+    }
+    return HexEncodeUpper(hash);
+}
+
+std::string GetStableFallbackMachineSeed(const HardwareValues& v) {
+    std::vector<std::string> parts;
+
+    const std::string machineGuid = GetRegistryStringValueA(HKEY_LOCAL_MACHINE, "SOFTWARE\\Microsoft\\Cryptography", "MachineGuid");
+    if (!machineGuid.empty()) parts.push_back("MachineGuid=" + machineGuid);
+
+    const std::string sqmcMachineId = GetRegistryStringValueA(HKEY_LOCAL_MACHINE, "SOFTWARE\\Microsoft\\SQMClient", "MachineId");
+    if (!sqmcMachineId.empty()) parts.push_back("SqmMachineId=" + sqmcMachineId);
+
+    if (!v.baseboardSerial.empty()) parts.push_back("BaseBoard=" + v.baseboardSerial);
+    if (!v.biosSerial.empty()) parts.push_back("BiosSerial=" + v.biosSerial);
+
+    char computerName[MAX_COMPUTERNAME_LENGTH + 1] = {0};
+    DWORD computerNameLen = MAX_COMPUTERNAME_LENGTH + 1;
+    if (GetComputerNameA(computerName, &computerNameLen) && computerName[0] != '\0') {
+        parts.push_back(std::string("ComputerName=") + computerName);
+    }
+
+    const std::string mac = NetworkIdentity::GetPrimaryMacAddress();
+    if (!mac.empty()) parts.push_back("Mac=" + mac);
+
+    char windowsDir[MAX_PATH] = {0};
+    if (GetWindowsDirectoryA(windowsDir, MAX_PATH) > 0) {
+        char volumeRoot[MAX_PATH] = {0};
+        strncpy_s(volumeRoot, windowsDir, 3);
+        DWORD volumeSerial = 0;
+        if (GetVolumeInformationA(volumeRoot, nullptr, 0, &volumeSerial, nullptr, nullptr, nullptr, 0)) {
+            parts.push_back("VolumeSerial=" + HexEncodeUpper(volumeSerial));
+        }
+    }
+
+    if (parts.empty()) {
+        parts.push_back("Fallback=HayateKomorebi");
+    }
+
+    std::ostringstream oss;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i) oss << '|';
+        oss << parts[i];
+    }
+    return oss.str();
+}
+
+std::string MachineIdFrom(const HardwareValues& v, const std::string& legacy) {
+    if (!MachineIdentity::IsPlaceholderMachineId(legacy)) {
+        return legacy;
+    }
+
+    const std::string seed = GetStableFallbackMachineSeed(v);
+    const std::string derived = "MID-" + Fnv1a64Hex(seed);
+    DebugLog(std::string("MachineIdentity: using fallback machine id ") + derived + " because CPU/UUID lookup was unavailable.");
+    return derived;
+}
+
+struct Identity {
+    std::string machineId;
+    std::string legacyMachineId;
+};
+
+std::mutex g_mutex;
+std::shared_future<Identity> g_identity;     // valid once a computation has been started
+
+std::once_flag g_wmicIdentityOnce;
+Identity g_wmicIdentity;                     // what builds that only used wmic computed
+
+std::atomic<uint64_t> g_computations{ 0 };
+std::atomic<uint64_t> g_lastComputeMs{ 0 };
+std::atomic<uint64_t> g_totalComputeMs{ 0 };
+std::atomic<uint64_t> g_cacheHits{ 0 };
+std::atomic<uint64_t> g_waits{ 0 };
+std::atomic<uint64_t> g_waitedMs{ 0 };
+
+Identity ComputeIdentity() {
+    const auto started = std::chrono::steady_clock::now();
+    const HardwareValues values = ProbeNative();
+    Identity id;
+    id.legacyMachineId = LegacyMachineIdFrom(values);
+    id.machineId = MachineIdFrom(values, id.legacyMachineId);
+
+    const uint64_t ms = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count());
+    g_computations.fetch_add(1, std::memory_order_relaxed);
+    g_lastComputeMs.store(ms, std::memory_order_relaxed);
+    g_totalComputeMs.fetch_add(ms, std::memory_order_relaxed);
+    DebugLog("MachineIdentity: computed in " + std::to_string(ms) + " ms.");
+    return id;
+}
+
+// Caller holds g_mutex. The worker is detached: the promise keeps the shared state alive, so
+// process exit never waits on a wmic child.
+void LaunchLocked() {
+    auto promise = std::make_shared<std::promise<Identity>>();
+    g_identity = promise->get_future().share();
+    std::thread([promise]() {
+        try {
+            promise->set_value(ComputeIdentity());
+        } catch (...) {
+            DebugLog("MachineIdentity: computation failed.");
+            promise->set_value(Identity{ "UNKNOWNCPU-UNKNOWNUUID", "UNKNOWNCPU-UNKNOWNUUID" });
+        }
+    }).detach();
+}
+
+Identity Current() {
+    std::shared_future<Identity> future;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_identity.valid()) {
+            LaunchLocked();
+        }
+        future = g_identity;
+    }
+
+    if (future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        g_cacheHits.fetch_add(1, std::memory_order_relaxed);
+        return future.get();
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const Identity& id = future.get();
+    g_waits.fetch_add(1, std::memory_order_relaxed);
+    g_waitedMs.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count()), std::memory_order_relaxed);
+    return id;
+}
+
+} // namespace
+
+namespace MachineIdentity
+{
+    bool IsPlaceholderMachineId(const std::string& value)
+    {
+        const std::string trimmed = Trim(value);
+        return trimmed.empty()
+            || trimmed == "UNKNOWNCPU-UNKNOWNUUID"
+            || trimmed == "UNKNOWNCPU"
+            || trimmed == "UNKNOWNUUID";
+    }
+
+    void Prefetch()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_identity.valid()) {
+            LaunchLocked();
+        }
+    }
+
+    std::string GetMachineId()
+    {
+        return Current().machineId;
+    }
+
+    std::string GetLegacyMachineId()
+    {
+        return Current().legacyMachineId;
+    }
+
+    void Invalidate()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        LaunchLocked();
+    }
+
+    std::vector<std::string> GetPreviousMachineIds()
+    {
+        const Identity current = Current();
+
+        // wmic-only identity, computed at most once and only when somebody needs it (a config
+        // that does not decrypt with the current MachineId).
+        std::call_once(g_wmicIdentityOnce, []() {
+            const HardwareValues values = ProbeWmic();
+            g_wmicIdentity.legacyMachineId = LegacyMachineIdFrom(values);
+            g_wmicIdentity.machineId = MachineIdFrom(values, g_wmicIdentity.legacyMachineId);
+        });
+
+        std::vector<std::string> ids;
+        for (const std::string* candidate : { &current.legacyMachineId, &g_wmicIdentity.machineId, &g_wmicIdentity.legacyMachineId }) {
+            if (*candidate == current.machineId) continue;
+            bool duplicate = false;
+            for (const auto& existing : ids) duplicate = duplicate || existing == *candidate;
+            if (!duplicate) ids.push_back(*candidate);
+        }
+        return ids;
+    }
+
+    Stats GetStats()
+    {
+        Stats s;
+        s.computations = g_computations.load(std::memory_order_relaxed);
+        s.lastComputeMs = g_lastComputeMs.load(std::memory_order_relaxed);
+        s.totalComputeMs = g_totalComputeMs.load(std::memory_order_relaxed);
+        s.cacheHits = g_cacheHits.load(std::memory_order_relaxed);
+        s.waits = g_waits.load(std::memory_order_relaxed);
+        s.waitedMs = g_waitedMs.load(std::memory_order_relaxed);
+        return s;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// MachineIdentity
+// - Hardware-derived MachineId used as DPAPI entropy for the Server config and reported at
+//   enrollment. Preferred form is "<ProcessorId>-<SystemUUID>"; when either is unavailable a
+//   stable "MID-<hash>" is derived from registry / firmware / volume identifiers instead.
+// - The hardware values come from in-process CPUID / SMBIOS probes (HardwareIdProbe); wmic is only
+//   used for values those cannot provide.
+// - The result is memoized: Prefetch() starts the
+//   computation on a background thread at startup and every later call returns the cached value.
+//   Callers that arrive before the first computation finishes wait for it (counted in Stats).
+// - Invalidate() drops the cached value; the next call recomputes it in the background.
+namespace MachineIdentity
+{
+    struct Stats {
+        uint64_t computations = 0;      // completed background computations
+        uint64_t lastComputeMs = 0;     // duration of the most recent computation
+        uint64_t totalComputeMs = 0;
+        uint64_t cacheHits = 0;         // calls answered without waiting
+        uint64_t waits = 0;             // calls that had to wait for a computation
+        uint64_t waitedMs = 0;          // total time callers spent waiting
+    };
+
+    // Starts the background computation if nothing is cached or in flight. Never blocks.
+    void Prefetch();
+
+    // Preferred MachineId (DPAPI entropy for new writes).
+    std::string GetMachineId();
+
+    // "<ProcessorId>-<SystemUUID>" exactly as the older builds computed it (may be the
+    // UNKNOWNCPU-UNKNOWNUUID placeholder); still accepted when decrypting the Server config.
+    std::string GetLegacyMachineId();
+
+    // MachineIds older builds may have encrypted the Server config with: the legacy form and what
+    // the wmic-only probes produce (e.g. the MID-... fallback on systems where wmic is missing).
+    // Excludes GetMachineId(). May start wmic the first time it is called.
+    std::vector<std::string> GetPreviousMachineIds();
+
+    // Drops the cached identity and starts recomputing it.
+    void Invalidate();
+
+    Stats GetStats();
+
+    bool IsPlaceholderMachineId(const std::string& value);
+}
@@ -0,0 +1,217 @@
+#include "NetworkIdentity.h"
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#include "DebugLog.h"
+
+#pragma comment(lib, "iphlpapi.lib")
+#pragma comment(lib, "ws2_32.lib")
+
+namespace {
+
+constexpr ULONG kAdapterFlags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER;
+
+struct Values {
+    std::string lanIpv4;
+    std::string primaryMac;
+};
+
+std::mutex g_mutex;
+Values g_values;
+bool g_valid = false;
+std::chrono::steady_clock::time_point g_enumeratedAt;
+std::vector<unsigned char> g_buffer;        // GetAdaptersAddresses output, reused across enumerations
+
+std::atomic<bool> g_stale{ true };
+std::mutex g_watchMutex;
+HANDLE g_interfaceNotify = nullptr;
+HANDLE g_addressNotify = nullptr;
+std::atomic<bool> g_watching{ false };
+
+std::atomic<uint64_t> g_enumerations{ 0 };
+std::atomic<uint64_t> g_cacheHits{ 0 };
+std::atomic<uint64_t> g_notifications{ 0 };
+
+void OnChange() {
+    g_notifications.fetch_add(1, std::memory_order_relaxed);
+    g_stale.store(true, std::memory_order_release);
+}
+
+VOID NETIOAPI_API_ OnInterfaceChange(PVOID, PMIB_IPINTERFACE_ROW, MIB_NOTIFICATION_TYPE) {
+    OnChange();
+}
+
+VOID NETIOAPI_API_ OnAddressChange(PVOID, PMIB_UNICASTIPADDRESS_ROW, MIB_NOTIFICATION_TYPE) {
+    OnChange();
+}
+
+std::string FormatMac(const IP_ADAPTER_ADDRESSES& a) {
+    std::ostringstream oss;
+    for (ULONG i = 0; i < a.PhysicalAddressLength; ++i) {
+        if (i) oss << ':';
+        oss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
+            << static_cast<unsigned int>(a.PhysicalAddress[i]);
+    }
+    return oss.str();
+}
+
+std::string FirstLanIpv4(const IP_ADAPTER_ADDRESSES& a) {
+    for (auto* ua = a.FirstUnicastAddress; ua; ua = ua->Next) {
+        if (!ua->Address.lpSockaddr) continue;
+        if (ua->Address.lpSockaddr->sa_family != AF_INET) continue;
+        SOCKADDR_IN* sin = reinterpret_cast<SOCKADDR_IN*>(ua->Address.lpSockaddr);
+        char ip[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &sin->sin_addr, ip, sizeof(ip));
+        std::string s(ip);
+        if (s.rfind("169.254.", 0) == 0) continue; // skip APIPA
+        if (s == "127.0.0.1") continue;
+        return s;
+    }
+    return "";
+}
+
+// One AF_UNSPEC walk yields both values. Adapters are listed in the same order for every family,
+// so the selection matches the separate AF_INET / AF_UNSPEC walks older builds did (the MAC feeds
+// the MID-... hash and must not change).
+bool EnumerateLocked(Values& out) {
+    ULONG bufLen = static_cast<ULONG>(g_buffer.size());
+    ULONG ret = ERROR_BUFFER_OVERFLOW;
+    // The adapter list can grow between the size query and the fetch; retry a few times.
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        if (bufLen == 0) bufLen = 16 * 1024;
+        if (g_buffer.size() < bufLen) g_buffer.resize(bufLen);
+        bufLen = static_cast<ULONG>(g_buffer.size());
+        ret = GetAdaptersAddresses(AF_UNSPEC, kAdapterFlags, nullptr,
+            reinterpret_cast<IP_ADAPTER_ADDRESSES*>(g_buffer.data()), &bufLen);
+        if (ret != ERROR_BUFFER_OVERFLOW) break;
+    }
+    g_enumerations.fetch_add(1, std::memory_order_relaxed);
+    if (ret == ERROR_NO_DATA) {
+        out = Values{};
+        return true;
+    }
+    if (ret != NO_ERROR) {
+        DebugLog("NetworkIdentity: GetAdaptersAddresses failed. err=" + std::to_string(ret));
+        return false;
+    }
+
+    out = Values{};
+    for (auto* a = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(g_buffer.data()); a; a = a->Next) {
+        if (a->OperStatus != IfOperStatusUp) continue;
+        if (out.lanIpv4.empty()) {
+            out.lanIpv4 = FirstLanIpv4(*a);
+        }
+        if (out.primaryMac.empty() && a->IfType != IF_TYPE_SOFTWARE_LOOPBACK && a->PhysicalAddressLength != 0) {
+            out.primaryMac = FormatMac(*a);
+        }
+        if (!out.lanIpv4.empty() && !out.primaryMac.empty()) break;
+    }
+    return true;
+}
+
+Values Current() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    // Consume the stale flag before enumerating: a change that arrives during the walk leaves it
+    // set again for the next call.
+    const bool stale = g_stale.exchange(false, std::memory_order_acq_rel);
+    const bool expired = !g_watching.load(std::memory_order_acquire) &&
+        now - g_enumeratedAt >= std::chrono::milliseconds(NetworkIdentity::kUnwatchedMaxAgeMs);
+    if (g_valid && !stale && !expired) {
+        g_cacheHits.fetch_add(1, std::memory_order_relaxed);
+        return g_values;
+    }
+
+    Values fresh;
+    if (EnumerateLocked(fresh)) {
+        g_values = std::move(fresh);
+        g_valid = true;
+        g_enumeratedAt = now;
+    } else {
+        // Keep serving the last good values, but try again next time.
+        g_stale.store(true, std::memory_order_release);
+    }
+    return g_values;
+}
+
+} // namespace
+
+namespace NetworkIdentity
+{
+    bool StartWatching()
+    {
+        std::lock_guard<std::mutex> lock(g_watchMutex);
+        if (g_interfaceNotify || g_addressNotify) {
+            return true;
+        }
+
+        // Interface notifications cover adapters going up/down; address notifications cover a
+        // new DHCP lease on an adapter that stays up.
+        DWORD err = NotifyIpInterfaceChange(AF_UNSPEC, &OnInterfaceChange, nullptr, FALSE, &g_interfaceNotify);
+        if (err != NO_ERROR) {
+            g_interfaceNotify = nullptr;
+            DebugLog("NetworkIdentity: NotifyIpInterfaceChange failed. err=" + std::to_string(err));
+        }
+        err = NotifyUnicastIpAddressChange(AF_INET, &OnAddressChange, nullptr, FALSE, &g_addressNotify);
+        if (err != NO_ERROR) {
+            g_addressNotify = nullptr;
+            DebugLog("NetworkIdentity: NotifyUnicastIpAddressChange failed. err=" + std::to_string(err));
+        }
+
+        const bool watching = g_interfaceNotify && g_addressNotify;
+        // Anything that changed before the registration completed is not reported.
+        g_stale.store(true, std::memory_order_release);
+        g_watching.store(watching, std::memory_order_release);
+        return g_interfaceNotify || g_addressNotify;
+    }
+
+    void StopWatching()
+    {
+        std::lock_guard<std::mutex> lock(g_watchMutex);
+        g_watching.store(false, std::memory_order_release);
+        // CancelMibChangeNotify2 waits for callbacks in flight.
+        if (g_interfaceNotify) {
+            CancelMibChangeNotify2(g_interfaceNotify);
+            g_interfaceNotify = nullptr;
+        }
+        if (g_addressNotify) {
+            CancelMibChangeNotify2(g_addressNotify);
+            g_addressNotify = nullptr;
+        }
+    }
+
+    std::string GetLanIpv4()
+    {
+        return Current().lanIpv4;
+    }
+
+    std::string GetPrimaryMacAddress()
+    {
+        return Current().primaryMac;
+    }
+
+    void Invalidate()
+    {
+        g_stale.store(true, std::memory_order_release);
+    }
+
+    Stats GetStats()
+    {
+        Stats s;
+        s.enumerations = g_enumerations.load(std::memory_order_relaxed);
+        s.cacheHits = g_cacheHits.load(std::memory_order_relaxed);
+        s.notifications = g_notifications.load(std::memory_order_relaxed);
+        return s;
+    }
+}
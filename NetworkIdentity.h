@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// NetworkIdentity
+// - LAN IPv4 address (reported to the activation server) and primary MAC address (part of the
+//   MID-... fallback MachineId) from one GetAdaptersAddresses enumeration.
+// - The result is cached. StartWatching() registers NotifyIpInterfaceChange and
+//   NotifyUnicastIpAddressChange; a notification only marks the cache stale and the next call
+//   enumerates again, so nothing runs on the notification thread and bursts of notifications
+//   (an adapter coming up reports several) cost one enumeration.
+// - Without notifications (before StartWatching() or when registering failed) a cached value is
+//   reused for kUnwatchedMaxAgeMs.
+// - Thread-safe.
+namespace NetworkIdentity
+{
+    constexpr uint64_t kUnwatchedMaxAgeMs = 30 * 1000;
+
+    struct Stats {
+        uint64_t enumerations = 0;      // GetAdaptersAddresses walks
+        uint64_t cacheHits = 0;         // calls answered from the cache
+        uint64_t notifications = 0;     // interface / address change notifications received
+    };
+
+    // Registers the change notifications. Returns false when neither could be registered (the
+    // cache then falls back to kUnwatchedMaxAgeMs).
+    bool StartWatching();
+    void StopWatching();
+
+    // First IPv4 unicast address of the first adapter that is up, skipping 169.254.x.x and
+    // 127.0.0.1. Empty when there is none.
+    std::string GetLanIpv4();
+
+    // Physical address of the first adapter that is up and not loopback, as "AA:BB:CC:DD:EE:FF".
+    // Empty when there is none.
+    std::string GetPrimaryMacAddress();
+
+    // Marks the cache stale; the next call enumerates the adapters again.
+    void Invalidate();
+
+    Stats GetStats();
+}
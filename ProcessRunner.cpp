@@ -0,0 +1,347 @@
+#include "ProcessRunner.h"
+
+#include <windows.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "DebugLog.h"
+
+namespace ProcessRunner
+{
+    namespace
+    {
+        // Each child contributes at most two wait handles (read event + process).
+        constexpr size_t kMaxChildrenPerBatch = MAXIMUM_WAIT_OBJECTS / 2;
+        constexpr DWORD kReadChunk = 4096;
+
+        using SteadyClock = std::chrono::steady_clock;
+
+        struct Child {
+            std::wstring cmdLine;
+            std::promise<Result> promise;
+            Result result;
+
+            HANDLE job = nullptr;
+            HANDLE process = nullptr;
+            HANDLE readPipe = nullptr;
+            HANDLE readEvent = nullptr;
+            OVERLAPPED overlapped{};
+            char buffer[kReadChunk];
+
+            SteadyClock::time_point launchedAt;
+            bool readPending = false;
+            bool pipeOpen = false;
+            bool exited = false;
+            bool finished = false;
+        };
+
+        struct Batch {
+            std::vector<std::unique_ptr<Child>> children;
+            SteadyClock::time_point deadline;
+        };
+
+        void CloseIf(HANDLE& h)
+        {
+            if (h) {
+                CloseHandle(h);
+                h = nullptr;
+            }
+        }
+
+        // Anonymous pipes cannot be read overlapped, so the read end is a uniquely named pipe
+        // instance. The write end is inheritable and handed to the child.
+        bool CreateOverlappedPipe(HANDLE& readEnd, HANDLE& writeEnd)
+        {
+            static std::atomic<unsigned long> serial{ 0 };
+            const std::wstring name = L"\\\\.\\pipe\\HayateKomorebi.ProcessRunner." +
+                std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(serial.fetch_add(1));
+
+            readEnd = CreateNamedPipeW(name.c_str(),
+                PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                1, 0, kReadChunk, 0, nullptr);
+            if (readEnd == INVALID_HANDLE_VALUE) {
+                readEnd = nullptr;
+                return false;
+            }
+
+            SECURITY_ATTRIBUTES sa{};
+            sa.nLength = sizeof(sa);
+            sa.bInheritHandle = TRUE;
+            writeEnd = CreateFileW(name.c_str(), GENERIC_WRITE, 0, &sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (writeEnd == INVALID_HANDLE_VALUE) {
+                writeEnd = nullptr;
+                CloseIf(readEnd);
+                return false;
+            }
+            return true;
+        }
+
+        bool Launch(Child& c)
+        {
+            c.readEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            if (!c.readEvent) {
+                DebugLog("ProcessRunner: CreateEventW failed. err=" + std::to_string(GetLastError()));
+                return false;
+            }
+
+            HANDLE writePipe = nullptr;
+            if (!CreateOverlappedPipe(c.readPipe, writePipe)) {
+                DebugLog("ProcessRunner: CreateNamedPipeW failed. err=" + std::to_string(GetLastError()));
+                CloseIf(c.readEvent);
+                return false;
+            }
+
+            SECURITY_ATTRIBUTES sa{};
+            sa.nLength = sizeof(sa);
+            sa.bInheritHandle = TRUE;
+            HANDLE nulInput = CreateFileW(L"NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, nullptr);
+            if (nulInput == INVALID_HANDLE_VALUE) nulInput = nullptr;
+
+            // Restrict inheritance to this child's own handles; other batches may be launching
+            // concurrently with their pipes marked inheritable too.
+            HANDLE inherit[2] = { writePipe, nulInput };
+            const DWORD inheritCount = nulInput ? 2 : 1;
+            SIZE_T attrSize = 0;
+            InitializeProcThreadAttributeList(nullptr, 1, 0, &attrSize);
+            std::vector<unsigned char> attrBuf(attrSize);
+            auto attrs = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attrBuf.data());
+            const bool attrsOk = attrSize != 0 &&
+                InitializeProcThreadAttributeList(attrs, 1, 0, &attrSize) &&
+                UpdateProcThreadAttribute(attrs, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, inherit, inheritCount * sizeof(HANDLE), nullptr, nullptr);
+
+            STARTUPINFOEXW si{};
+            si.StartupInfo.cb = sizeof(si);
+            si.StartupInfo.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
+            si.StartupInfo.wShowWindow = SW_HIDE;
+            si.StartupInfo.hStdInput = nulInput;
+            si.StartupInfo.hStdOutput = writePipe;
+            si.StartupInfo.hStdError = writePipe;
+            si.lpAttributeList = attrsOk ? attrs : nullptr;
+
+            PROCESS_INFORMATION pi{};
+            std::wstring mutableCmd = c.cmdLine;
+            const DWORD flags = CREATE_NO_WINDOW | CREATE_SUSPENDED | (attrsOk ? EXTENDED_STARTUPINFO_PRESENT : 0);
+            const BOOL created = CreateProcessW(nullptr, mutableCmd.data(), nullptr, nullptr, TRUE, flags, nullptr, nullptr,
+                &si.StartupInfo, &pi);
+            const DWORD createErr = GetLastError();
+
+            if (attrsOk) DeleteProcThreadAttributeList(attrs);
+            CloseIf(writePipe);
+            CloseIf(nulInput);
+
+            if (!created) {
+                DebugLog("ProcessRunner: CreateProcessW failed. err=" + std::to_string(createErr));
+                CloseIf(c.readPipe);
+                CloseIf(c.readEvent);
+                return false;
+            }
+
+            // Job first, then resume: anything the child starts is in the job as well, so a
+            // timeout kill also takes down e.g. the wmic.exe behind cmd.exe.
+            c.job = CreateJobObjectW(nullptr, nullptr);
+            if (c.job) {
+                JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+                limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+                if (!SetInformationJobObject(c.job, JobObjectExtendedLimitInformation, &limits, sizeof(limits)) ||
+                    !AssignProcessToJobObject(c.job, pi.hProcess)) {
+                    CloseIf(c.job);
+                }
+            }
+            ResumeThread(pi.hThread);
+            CloseHandle(pi.hThread);
+
+            c.process = pi.hProcess;
+            c.launchedAt = SteadyClock::now();
+            c.pipeOpen = true;
+            c.result.started = true;
+            return true;
+        }
+
+        void AppendOutput(Child& c, DWORD n)
+        {
+            const size_t room = kMaxOutputBytes - c.result.output.size();
+            c.result.output.append(c.buffer, c.buffer + (n < room ? n : room));
+        }
+
+        // Issues reads until one is pending or the pipe is closed.
+        void PumpReads(Child& c)
+        {
+            while (c.pipeOpen && !c.readPending) {
+                c.overlapped = OVERLAPPED{};
+                c.overlapped.hEvent = c.readEvent;
+                DWORD n = 0;
+                if (ReadFile(c.readPipe, c.buffer, kReadChunk, &n, &c.overlapped)) {
+                    if (GetOverlappedResult(c.readPipe, &c.overlapped, &n, FALSE)) {
+                        AppendOutput(c, n);
+                    }
+                    continue;
+                }
+                const DWORD err = GetLastError();
+                if (err == ERROR_IO_PENDING) {
+                    c.readPending = true;
+                } else {
+                    // ERROR_BROKEN_PIPE: every writer (child and grandchildren) has exited.
+                    c.pipeOpen = false;
+                }
+            }
+        }
+
+        void CompleteRead(Child& c)
+        {
+            c.readPending = false;
+            DWORD n = 0;
+            if (GetOverlappedResult(c.readPipe, &c.overlapped, &n, FALSE)) {
+                AppendOutput(c, n);
+                PumpReads(c);
+            } else {
+                c.pipeOpen = false;
+            }
+        }
+
+        void Finish(Child& c)
+        {
+            if (c.readPending) {
+                CancelIoEx(c.readPipe, &c.overlapped);
+                DWORD n = 0;
+                if (GetOverlappedResult(c.readPipe, &c.overlapped, &n, TRUE)) {
+                    AppendOutput(c, n);
+                }
+                c.readPending = false;
+            }
+            if (c.exited && !c.result.timedOut) {
+                DWORD code = 0;
+                if (GetExitCodeProcess(c.process, &code)) c.result.exitCode = code;
+            }
+            c.result.elapsedMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                SteadyClock::now() - c.launchedAt).count());
+
+            CloseIf(c.readEvent);
+            CloseIf(c.readPipe);
+            CloseIf(c.process);
+            CloseIf(c.job);     // kill-on-close: no stray grandchildren survive
+            c.finished = true;
+            c.promise.set_value(std::move(c.result));
+        }
+
+        void KillAtDeadline(Child& c)
+        {
+            c.result.timedOut = true;
+            if (c.job) {
+                TerminateJobObject(c.job, ERROR_TIMEOUT);
+            } else if (!c.exited) {
+                TerminateProcess(c.process, ERROR_TIMEOUT);
+            }
+            DebugLog("ProcessRunner: command timed out and was killed.");
+            Finish(c);
+        }
+
+        void RunBatch(std::shared_ptr<Batch> batch)
+        {
+            for (auto& c : batch->children) {
+                if (!Launch(*c)) {
+                    c->finished = true;
+                    c->promise.set_value(std::move(c->result));
+                    continue;
+                }
+                PumpReads(*c);
+            }
+
+            struct WaitSlot {
+                Child* child;
+                bool isProcess;
+            };
+            std::vector<HANDLE> handles;
+            std::vector<WaitSlot> slots;
+
+            for (;;) {
+                handles.clear();
+                slots.clear();
+                for (auto& c : batch->children) {
+                    if (c->finished) continue;
+                    if (c->exited && !c->pipeOpen) {
+                        Finish(*c);
+                        continue;
+                    }
+                    if (c->readPending) {
+                        handles.push_back(c->readEvent);
+                        slots.push_back({ c.get(), false });
+                    }
+                    if (!c->exited) {
+                        handles.push_back(c->process);
+                        slots.push_back({ c.get(), true });
+                    }
+                }
+                if (handles.empty()) break;
+
+                const auto now = SteadyClock::now();
+                if (now >= batch->deadline) {
+                    for (auto& c : batch->children) {
+                        if (!c->finished) KillAtDeadline(*c);
+                    }
+                    break;
+                }
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(batch->deadline - now).count() + 1;
+
+                const DWORD w = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE,
+                    static_cast<DWORD>(remaining));
+                if (w == WAIT_TIMEOUT) continue;
+                if (w >= WAIT_OBJECT_0 + handles.size()) {
+                    DebugLog("ProcessRunner: WaitForMultipleObjects failed. err=" + std::to_string(GetLastError()));
+                    for (auto& c : batch->children) {
+                        if (!c->finished) KillAtDeadline(*c);
+                    }
+                    break;
+                }
+
+                const WaitSlot& slot = slots[w - WAIT_OBJECT_0];
+                if (slot.isProcess) {
+                    slot.child->exited = true;
+                } else {
+                    CompleteRead(*slot.child);
+                }
+            }
+        }
+    }
+
+    std::vector<std::future<Result>> RunAsync(const std::vector<std::wstring>& cmdLines, std::chrono::milliseconds timeout)
+    {
+        std::vector<std::future<Result>> futures;
+        futures.reserve(cmdLines.size());
+
+        const auto deadline = SteadyClock::now() + timeout;
+        std::shared_ptr<Batch> batch;
+        for (const auto& cmdLine : cmdLines) {
+            if (!batch) {
+                batch = std::make_shared<Batch>();
+                batch->deadline = deadline;
+            }
+            auto c = std::make_unique<Child>();
+            c->cmdLine = cmdLine;
+            futures.push_back(c->promise.get_future());
+            batch->children.push_back(std::move(c));
+
+            if (batch->children.size() == kMaxChildrenPerBatch) {
+                std::thread(RunBatch, std::move(batch)).detach();
+                batch.reset();
+            }
+        }
+        if (batch) {
+            std::thread(RunBatch, std::move(batch)).detach();
+        }
+        return futures;
+    }
+
+    std::future<Result> RunAsync(const std::wstring& cmdLine, std::chrono::milliseconds timeout)
+    {
+        auto futures = RunAsync(std::vector<std::wstring>{ cmdLine }, timeout);
+        return std::move(futures.front());
+    }
+
+    Result Run(const std::wstring& cmdLine, std::chrono::milliseconds timeout)
+    {
+        return RunAsync(cmdLine, timeout).get();
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+// ProcessRunner
+// - Runs hidden console commands (wmic probes and the like) and captures stdout + stderr.
+// - A batch of commands is launched together and serviced by one thread: every child's output
+//   pipe is read with overlapped I/O and the thread waits on all read events and process handles
+//   at once, so the batch takes as long as its slowest command instead of the sum of all of them.
+// - Every batch has a hard deadline. Children still running when it passes are killed together
+//   with anything they started (each child runs in its own kill-on-close job object), and their
+//   result is reported with timedOut=true and whatever output arrived until then.
+// - Children inherit only their own pipe and a NUL stdin, never each other's handles.
+namespace ProcessRunner
+{
+    struct Result {
+        bool started = false;           // CreateProcessW succeeded
+        bool timedOut = false;          // killed at the deadline
+        uint32_t exitCode = 0;          // valid when started && !timedOut
+        std::string output;             // stdout + stderr, capped at kMaxOutputBytes
+        uint64_t elapsedMs = 0;         // launch -> exit + end of output
+    };
+
+    constexpr size_t kMaxOutputBytes = 1024 * 1024;
+
+    // One future per command, in the same order. Futures never throw and are always fulfilled
+    // by the deadline (plus the time it takes to kill the stragglers).
+    std::vector<std::future<Result>> RunAsync(const std::vector<std::wstring>& cmdLines, std::chrono::milliseconds timeout);
+    std::future<Result> RunAsync(const std::wstring& cmdLine, std::chrono::milliseconds timeout);
+
+    // Blocking convenience for a single command.
+    Result Run(const std::wstring& cmdLine, std::chrono::milliseconds timeout);
+}
@@ -0,0 +1,200 @@
+#include "RefreshScheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+bool ReadDigits(const std::string& s, size_t& p, int count, int& out) {
+    if (p + static_cast<size_t>(count) > s.size()) return false;
+    int v = 0;
+    for (int i = 0; i < count; ++i) {
+        const char c = s[p + static_cast<size_t>(i)];
+        if (c < '0' || c > '9') return false;
+        v = v * 10 + (c - '0');
+    }
+    p += static_cast<size_t>(count);
+    out = v;
+    return true;
+}
+
+std::time_t MakeUtcTime(std::tm* tm) {
+#ifdef _WIN32
+    return _mkgmtime(tm);
+#else
+    return timegm(tm);
+#endif
+}
+
+} // namespace
+
+RefreshScheduler::RefreshScheduler()
+    : RefreshScheduler(Policy(), std::random_device{}()) {
+}
+
+RefreshScheduler::RefreshScheduler(const Policy& policy, uint64_t seed)
+    : policy_(policy), rng_(seed) {
+}
+
+void RefreshScheduler::Reset() {
+    hasPlan_ = false;
+    nextDue_ = SteadyClock::time_point{};
+    consecutiveFailures_ = 0;
+}
+
+std::chrono::milliseconds RefreshScheduler::UniformMs(int64_t lo, int64_t hi) {
+    if (hi <= lo) return std::chrono::milliseconds(lo);
+    std::uniform_int_distribution<int64_t> dist(lo, hi);
+    return std::chrono::milliseconds(dist(rng_));
+}
+
+std::chrono::milliseconds RefreshScheduler::RegularInterval(const std::string& expiresAtIso, SystemClock::time_point systemNow) const {
+    using namespace std::chrono;
+    const milliseconds minMs = duration_cast<milliseconds>(policy_.minInterval);
+    const milliseconds maxMs = duration_cast<milliseconds>(licenseVerified_ ? policy_.verifiedMaxInterval : policy_.maxInterval);
+
+    SystemClock::time_point expiresAt;
+    if (!ParseIso8601(expiresAtIso, expiresAt) || expiresAt <= systemNow) {
+        // Unknown or already expired: keep checking at the minimum cadence so a renewal in the
+        // dashboard is picked up promptly.
+        return minMs;
+    }
+    const milliseconds half = duration_cast<milliseconds>(expiresAt - systemNow) / 2;
+    return std::clamp(half, minMs, maxMs);
+}
+
+std::chrono::milliseconds RefreshScheduler::Jittered(std::chrono::milliseconds interval) {
+    const int64_t ms = interval.count();
+    const int64_t spread = static_cast<int64_t>(static_cast<double>(ms) * policy_.jitterFraction);
+    return UniformMs(ms - spread, ms + spread);
+}
+
+std::chrono::milliseconds RefreshScheduler::Backoff() {
+    using namespace std::chrono;
+    const int64_t base = duration_cast<milliseconds>(policy_.backoffBase).count();
+    const int64_t cap = duration_cast<milliseconds>(policy_.backoffMax).count();
+    const int64_t floor = duration_cast<milliseconds>(policy_.backoffFloor).count();
+
+    const int shift = std::min(consecutiveFailures_ - 1, 20);
+    int64_t ceiling = base << std::max(shift, 0);
+    if (ceiling > cap || ceiling <= 0) ceiling = cap;
+    return UniformMs(std::min(floor, ceiling), ceiling);
+}
+
+void RefreshScheduler::PlanFromPersisted(const std::string& lastSuccessIso, const std::string& expiresAtIso,
+    SteadyClock::time_point steadyNow, SystemClock::time_point systemNow) {
+    using namespace std::chrono;
+    consecutiveFailures_ = 0;
+    hasPlan_ = true;
+
+    const milliseconds startup = UniformMs(0, duration_cast<milliseconds>(policy_.startupSpread).count());
+
+    SystemClock::time_point lastSuccess;
+    if (!ParseIso8601(lastSuccessIso, lastSuccess) || lastSuccess > systemNow) {
+        nextDue_ = steadyNow + startup;
+        return;
+    }
+
+    const milliseconds interval = Jittered(RegularInterval(expiresAtIso, lastSuccess));
+    const milliseconds elapsed = duration_cast<milliseconds>(systemNow - lastSuccess);
+    nextDue_ = (elapsed >= interval) ? steadyNow + startup : steadyNow + (interval - elapsed);
+}
+
+void RefreshScheduler::OnOutcome(RefreshOutcome outcome, const std::string& expiresAtIso,
+    SteadyClock::time_point steadyNow, SystemClock::time_point systemNow) {
+    switch (outcome) {
+        case RefreshOutcome::Success:
+            consecutiveFailures_ = 0;
+            hasPlan_ = true;
+            nextDue_ = steadyNow + Jittered(RegularInterval(expiresAtIso, systemNow));
+            break;
+        case RefreshOutcome::Transient:
+            ++consecutiveFailures_;
+            hasPlan_ = true;
+            nextDue_ = steadyNow + Backoff();
+            break;
+        case RefreshOutcome::Rejected:
+            consecutiveFailures_ = 0;
+            hasPlan_ = true;
+            nextDue_ = steadyNow + Jittered(std::chrono::duration_cast<std::chrono::milliseconds>(policy_.minInterval));
+            break;
+        case RefreshOutcome::SessionCleared:
+            Reset();
+            break;
+    }
+}
+
+bool RefreshScheduler::ParseIso8601(const std::string& text, SystemClock::time_point& out) {
+    size_t p = 0;
+    while (p < text.size() && text[p] == ' ') ++p;
+
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    if (!ReadDigits(text, p, 4, year) || p >= text.size() || text[p++] != '-' ||
+        !ReadDigits(text, p, 2, month) || p >= text.size() || text[p++] != '-' ||
+        !ReadDigits(text, p, 2, day)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+
+    if (p < text.size() && (text[p] == 'T' || text[p] == 't' || text[p] == ' ')) {
+        ++p;
+        if (!ReadDigits(text, p, 2, hour) || p >= text.size() || text[p++] != ':' ||
+            !ReadDigits(text, p, 2, minute)) {
+            return false;
+        }
+        if (p < text.size() && text[p] == ':') {
+            ++p;
+            if (!ReadDigits(text, p, 2, second)) return false;
+            if (p < text.size() && (text[p] == '.' || text[p] == ',')) {
+                ++p;
+                while (p < text.size() && text[p] >= '0' && text[p] <= '9') ++p;
+            }
+        }
+    }
+    if (hour > 23 || minute > 59 || second > 60) return false;
+
+    bool hasZone = false;
+    int offsetSeconds = 0;
+    if (p < text.size() && (text[p] == 'Z' || text[p] == 'z')) {
+        hasZone = true;
+        ++p;
+    } else if (p < text.size() && (text[p] == '+' || text[p] == '-')) {
+        const int sign = (text[p] == '-') ? -1 : 1;
+        ++p;
+        int oh = 0, om = 0;
+        if (!ReadDigits(text, p, 2, oh)) return false;
+        if (p < text.size() && text[p] == ':') ++p;
+        if (p < text.size() && !ReadDigits(text, p, 2, om)) return false;
+        hasZone = true;
+        offsetSeconds = sign * (oh * 3600 + om * 60);
+    }
+    while (p < text.size() && text[p] == ' ') ++p;
+    if (p != text.size()) return false;
+
+    std::tm tm{};
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+
+    std::time_t t;
+    if (hasZone) {
+        t = MakeUtcTime(&tm);
+        if (t == static_cast<std::time_t>(-1)) return false;
+        t -= offsetSeconds;
+    } else {
+        tm.tm_isdst = -1;
+        t = std::mktime(&tm);
+        if (t == static_cast<std::time_t>(-1)) return false;
+    }
+    // Saturate far-future values (e.g. 9999-12-31) instead of overflowing system_clock, whose
+    // nanosecond ticks on some platforms only reach 2262.
+    const std::time_t maxT = SystemClock::to_time_t(SystemClock::time_point::max()) - 1;
+    const std::time_t minT = SystemClock::to_time_t(SystemClock::time_point::min()) + 1;
+    t = (std::min)((std::max)(t, minT), maxT);
+    out = SystemClock::from_time_t(t);
+    return true;
+}
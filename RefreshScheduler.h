@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+
+// RefreshScheduler
+// - Decides when the activation poll thread should next run device_nonce -> device_refresh.
+// - After a success the next refresh is planned at half of the remaining entitlement lifetime,
+//   clamped to [minInterval, maxInterval]; without a usable expiry minInterval is used.
+// - While the stored license_blob verifies offline (LicenseBlob), the cap is
+//   verifiedMaxInterval instead: the device already knows its license is good until the signed
+//   expiry, so the server is only asked as that expiry approaches.
+// - Every planned interval gets +/- jitterFraction of random spread so devices that were
+//   enrolled or rebooted together drift apart instead of refreshing in lock-step.
+// - Transient failures (transport errors, HTTP 429/5xx) back off exponentially with full
+//   jitter: uniform(backoffFloor, min(backoffMax, backoffBase * 2^n)).
+// - On startup the plan is rebuilt from the persisted LastSuccessRefreshAt, so restarting the
+//   tray app does not force an immediate refresh; overdue refreshes run after a short random
+//   startup delay.
+// - Pure bookkeeping: no threads, no I/O. The caller supplies the clocks.
+enum class RefreshOutcome
+{
+    Success,        // 2xx, tokens rotated
+    Transient,      // transport error, 429, 5xx: retry with backoff
+    Rejected,       // definitive server answer (license expired, other 4xx): retry on the regular schedule
+    SessionCleared, // device no longer enrolled: nothing to schedule
+};
+
+class RefreshScheduler
+{
+public:
+    using SteadyClock = std::chrono::steady_clock;
+    using SystemClock = std::chrono::system_clock;
+
+    struct Policy {
+        std::chrono::seconds minInterval{ std::chrono::minutes(10) };
+        std::chrono::seconds maxInterval{ std::chrono::hours(1) };
+        std::chrono::seconds verifiedMaxInterval{ std::chrono::hours(24) };
+        double jitterFraction = 0.10;
+        std::chrono::seconds backoffBase{ 30 };
+        std::chrono::seconds backoffFloor{ 5 };
+        std::chrono::seconds backoffMax{ std::chrono::minutes(30) };
+        std::chrono::seconds startupSpread{ 30 };
+    };
+
+    RefreshScheduler();
+    explicit RefreshScheduler(const Policy& policy, uint64_t seed);
+
+    // Forget the current plan (device not enrolled, or a different session was loaded).
+    void Reset();
+
+    bool HasPlan() const { return hasPlan_; }
+    SteadyClock::time_point NextDue() const { return nextDue_; }
+    bool IsDue(SteadyClock::time_point now) const { return hasPlan_ && now >= nextDue_; }
+    int ConsecutiveFailures() const { return consecutiveFailures_; }
+
+    // Whether the stored license verified offline. Applies to plans made after the call.
+    void SetLicenseVerified(bool verified) { licenseVerified_ = verified; }
+    bool LicenseVerified() const { return licenseVerified_; }
+
+    // Initial plan for a freshly loaded session.
+    void PlanFromPersisted(const std::string& lastSuccessIso, const std::string& expiresAtIso,
+        SteadyClock::time_point steadyNow, SystemClock::time_point systemNow);
+
+    // Plan after a refresh attempt finished.
+    void OnOutcome(RefreshOutcome outcome, const std::string& expiresAtIso,
+        SteadyClock::time_point steadyNow, SystemClock::time_point systemNow);
+
+    // Accepts "YYYY-MM-DD", "YYYY-MM-DD[T ]HH:MM[:SS[.fff]]" with an optional "Z" or +/-HH[:MM]
+    // suffix. Values without a zone are interpreted as local time (LastSuccessRefreshAt is written
+    // that way by NowIsoLocal).
+    static bool ParseIso8601(const std::string& text, SystemClock::time_point& out);
+
+private:
+    std::chrono::milliseconds RegularInterval(const std::string& expiresAtIso, SystemClock::time_point systemNow) const;
+    std::chrono::milliseconds Jittered(std::chrono::milliseconds interval);
+    std::chrono::milliseconds Backoff();
+    std::chrono::milliseconds UniformMs(int64_t lo, int64_t hi);
+
+    Policy policy_;
+    std::mt19937_64 rng_;
+    bool hasPlan_ = false;
+    SteadyClock::time_point nextDue_{};
+    int consecutiveFailures_ = 0;
+    bool licenseVerified_ = false;
+};
@@ -1,6 +1,7 @@
 #include "SecureLineCrypto.h"
 
 #include "DebugLog.h"
+#include "SecureRandom.h"
 
 #include <windows.h>
 #include <shlobj.h>
@@ -396,10 +397,7 @@ namespace hk_secureline
     static bool RandomBytes(uint8_t* dst, size_t n)
     {
         if (!dst || n == 0) return false;
-        if (BCryptGenRandom(nullptr, dst, static_cast<ULONG>(n), BCRYPT_USE_SYSTEM_PREFERRED_RNG) != 0) {
-            return false;
-        }
-        return true;
+        return SecureRandom::Fill(dst, n);
     }
 
     static bool AesGcmEncrypt(const std::array<uint8_t, 32>& key,
@@ -0,0 +1,231 @@
+#include "SecureRandom.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#else
+#include <pthread.h>
+#include <sys/random.h>
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+constexpr size_t kKeyBytes = 32;
+constexpr size_t kBlockBytes = 64;
+static_assert(SecureRandom::kBufferBytes % kBlockBytes == 0 && SecureRandom::kBufferBytes > kKeyBytes,
+    "buffer must hold whole blocks and the next key");
+
+// Bumped by ReseedAll() and in a forked child; a thread whose state is from an older epoch
+// reseeds first.
+std::atomic<uint64_t> g_epoch{ 1 };
+
+std::atomic<uint64_t> g_osSeeds{ 0 };
+std::atomic<uint64_t> g_refills{ 0 };
+std::atomic<uint64_t> g_requests{ 0 };
+std::atomic<uint64_t> g_bytes{ 0 };
+
+void Wipe(void* p, size_t n) {
+#ifdef _WIN32
+    SecureZeroMemory(p, n);
+#else
+    static void* (*volatile wipeMemset)(void*, int, size_t) = std::memset;
+    wipeMemset(p, 0, n);
+#endif
+}
+
+bool OsRandom(uint8_t* out, size_t len) {
+    while (len > 0) {
+#ifdef _WIN32
+        const ULONG chunk = static_cast<ULONG>((std::min<size_t>)(len, 0x7fffffff));
+        if (BCryptGenRandom(nullptr, out, chunk, BCRYPT_USE_SYSTEM_PREFERRED_RNG) != 0) {
+            return false;
+        }
+        const size_t got = chunk;
+#else
+        const ssize_t r = getrandom(out, len, 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        const size_t got = static_cast<size_t>(r);
+#endif
+        out += got;
+        len -= got;
+    }
+    return true;
+}
+
+#ifndef _WIN32
+void OnForkChild() {
+    g_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+uint32_t Load32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void Store32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t Rotl(uint32_t v, int c) {
+    return (v << c) | (v >> (32 - c));
+}
+
+void QuarterRound(uint32_t* x, int a, int b, int c, int d) {
+    x[a] += x[b]; x[d] = Rotl(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = Rotl(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = Rotl(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = Rotl(x[b] ^ x[c], 7);
+}
+
+// ChaCha20 block (RFC 8439 layout: 32-bit counter, 96-bit nonce). The generator always uses
+// a zero nonce: every key encrypts at most kBufferBytes / 64 blocks before it is replaced.
+void ChaChaBlock(const uint8_t key[kKeyBytes], uint32_t counter, const uint8_t nonce[12], uint8_t out[kBlockBytes]) {
+    uint32_t in[16], x[16];
+    in[0] = 0x61707865; in[1] = 0x3320646e; in[2] = 0x79622d32; in[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) in[4 + i] = Load32(key + 4 * i);
+    in[12] = counter;
+    for (int i = 0; i < 3; ++i) in[13 + i] = Load32(nonce + 4 * i);
+
+    std::memcpy(x, in, sizeof(x));
+    for (int i = 0; i < 10; ++i) {
+        QuarterRound(x, 0, 4, 8, 12);
+        QuarterRound(x, 1, 5, 9, 13);
+        QuarterRound(x, 2, 6, 10, 14);
+        QuarterRound(x, 3, 7, 11, 15);
+        QuarterRound(x, 0, 5, 10, 15);
+        QuarterRound(x, 1, 6, 11, 12);
+        QuarterRound(x, 2, 7, 8, 13);
+        QuarterRound(x, 3, 4, 9, 14);
+    }
+    for (int i = 0; i < 16; ++i) Store32(out + 4 * i, x[i] + in[i]);
+
+    Wipe(in, sizeof(in));
+    Wipe(x, sizeof(x));
+}
+
+struct ThreadState {
+    uint8_t key[kKeyBytes];
+    uint8_t buf[SecureRandom::kBufferBytes];
+    size_t avail = 0;                   // unread bytes at the end of buf
+    uint64_t epoch = 0;                 // 0: not seeded yet
+    uint64_t sinceSeed = 0;             // bytes returned since the last seed
+    std::chrono::steady_clock::time_point seededAt{};
+
+    ~ThreadState() {
+        Wipe(key, sizeof(key));
+        Wipe(buf, sizeof(buf));
+    }
+
+    bool Reseed() {
+        // Buffered output may be shared with the parent (fork) or predate ReseedAll().
+        Wipe(buf, sizeof(buf));
+        avail = 0;
+        epoch = 0;
+        if (!OsRandom(key, sizeof(key))) {
+            Wipe(key, sizeof(key));
+            return false;
+        }
+        g_osSeeds.fetch_add(1, std::memory_order_relaxed);
+        epoch = g_epoch.load(std::memory_order_relaxed);
+        sinceSeed = 0;
+        seededAt = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void Refill() {
+        static const uint8_t kZeroNonce[12] = {};
+        for (size_t i = 0; i < SecureRandom::kBufferBytes / kBlockBytes; ++i) {
+            ChaChaBlock(key, static_cast<uint32_t>(i), kZeroNonce, buf + i * kBlockBytes);
+        }
+        std::memcpy(key, buf, kKeyBytes);
+        Wipe(buf, kKeyBytes);
+        avail = SecureRandom::kBufferBytes - kKeyBytes;
+        g_refills.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool ReseedDue() const {
+        return sinceSeed >= SecureRandom::kReseedBytes ||
+            std::chrono::steady_clock::now() - seededAt >= std::chrono::milliseconds(SecureRandom::kReseedIntervalMs);
+    }
+};
+
+thread_local ThreadState t_state;
+
+} // namespace
+
+namespace SecureRandom
+{
+    bool Fill(uint8_t* out, size_t len)
+    {
+#ifndef _WIN32
+        static std::once_flag forkHandler;
+        std::call_once(forkHandler, []() { (void)pthread_atfork(nullptr, nullptr, &OnForkChild); });
+#endif
+        g_requests.fetch_add(1, std::memory_order_relaxed);
+        if (len == 0) {
+            return true;
+        }
+
+        ThreadState& s = t_state;
+        if (s.epoch != g_epoch.load(std::memory_order_relaxed) && !s.Reseed()) {
+            Wipe(out, len);
+            return false;
+        }
+
+        size_t done = 0;
+        while (done < len) {
+            if (s.avail == 0) {
+                // Time and volume limits are checked once per buffer, not per request.
+                if (s.ReseedDue() && !s.Reseed()) {
+                    Wipe(out, len);
+                    return false;
+                }
+                s.Refill();
+            }
+            const size_t take = (std::min)(s.avail, len - done);
+            uint8_t* src = s.buf + (kBufferBytes - s.avail);
+            std::memcpy(out + done, src, take);
+            Wipe(src, take);
+            s.avail -= take;
+            s.sinceSeed += take;
+            done += take;
+        }
+        g_bytes.fetch_add(len, std::memory_order_relaxed);
+        return true;
+    }
+
+    void ReseedAll()
+    {
+        g_epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats GetStats()
+    {
+        Stats s;
+        s.osSeeds = g_osSeeds.load(std::memory_order_relaxed);
+        s.refills = g_refills.load(std::memory_order_relaxed);
+        s.requests = g_requests.load(std::memory_order_relaxed);
+        s.bytes = g_bytes.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    namespace Testing
+    {
+        void ChaCha20Block(const uint8_t key[32], uint32_t counter, const uint8_t nonce[12], uint8_t out[64])
+        {
+            ChaChaBlock(key, counter, nonce, out);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SecureRandom
+// - Cryptographic random bytes for keys, nonces and salts (randombytes() for the Ed25519 code,
+//   GCM nonces, handshake nonces, config file salts).
+// - Each thread runs its own ChaCha20 generator seeded with 32 bytes from the OS
+//   (BCryptGenRandom on Windows, getrandom on Linux), so a request is normally served from a
+//   per-thread buffer without a kernel transition or a lock.
+// - Fast key erasure: every refill produces kBufferBytes of keystream, the first 32 bytes of
+//   which replace the key. Bytes are zeroed in the buffer as soon as they are handed out, so a
+//   later compromise of the state does not reveal earlier output.
+// - A thread reseeds from the OS after kReseedBytes of output or kReseedIntervalMs, after
+//   ReseedAll(), and (POSIX) in a forked child before it returns any byte, so parent and child
+//   never share output.
+// - Thread-safe.
+namespace SecureRandom
+{
+    constexpr size_t kBufferBytes = 512;
+    constexpr uint64_t kReseedBytes = 1024 * 1024;
+    constexpr uint64_t kReseedIntervalMs = 5 * 60 * 1000;
+
+    struct Stats {
+        uint64_t osSeeds = 0;           // seeds drawn from the OS generator
+        uint64_t refills = 0;           // keystream buffers generated
+        uint64_t requests = 0;          // Fill() calls
+        uint64_t bytes = 0;             // bytes returned
+    };
+
+    // Writes len random bytes to out. Returns false, with out zeroed, when the OS generator
+    // fails to provide a seed.
+    bool Fill(uint8_t* out, size_t len);
+
+    // Makes every thread reseed from the OS before its next request.
+    void ReseedAll();
+
+    Stats GetStats();
+
+    namespace Testing
+    {
+        // The generator's ChaCha20 block function, for known-answer tests (RFC 8439 2.3.2).
+        void ChaCha20Block(const uint8_t key[32], uint32_t counter, const uint8_t nonce[12], uint8_t out[64]);
+    }
+}
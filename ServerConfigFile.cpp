@@ -0,0 +1,403 @@
+#include "ServerConfigFile.h"
+
+#include <cstring>
+
+#include "DebugLog.h"
+#include "SecureRandom.h"
+#include "ServerConfigStore.h"
+
+#pragma comment(lib, "bcrypt.lib")
+
+namespace {
+
+constexpr char kMagic[4] = { 'H', 'K', 'S', 'C' };
+constexpr size_t kSaltSize = 16;
+constexpr size_t kRecordHeaderSize = 8;     // u16 field | u16 reserved | u32 length
+
+constexpr uint8_t kFlagActivated = 0x01;
+constexpr uint8_t kFlagLicenseBlocked = 0x02;
+
+uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void AppendU16(std::string& out, uint16_t v) {
+    out.push_back(static_cast<char>(v & 0xFF));
+    out.push_back(static_cast<char>((v >> 8) & 0xFF));
+}
+
+void AppendU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+// Associated data of one record: file header, every record header (so no record can be dropped
+// or renamed to a field id readers skip), position of this record.
+std::string RecordAad(const std::string& fileAad, uint16_t position) {
+    std::string aad = fileAad;
+    AppendU16(aad, position);
+    return aad;
+}
+
+void AppendRecordHeader(std::string& out, uint16_t field, uint32_t length) {
+    AppendU16(out, field);
+    AppendU16(out, 0);
+    AppendU32(out, length);
+}
+
+bool RandomBytes(uint8_t* out, size_t len) {
+    return SecureRandom::Fill(out, len);
+}
+
+// Whether the session part (flags and every field but serverName) is stored at all: only a
+// configuration that is activated or still holds any session value keeps it.
+bool HasSession(const ServerActivationConfig& c) {
+    return c.activated ||
+        !c.deviceId.empty() ||
+        !c.refreshToken.empty() ||
+        !c.licenseBlob.empty() ||
+        !c.entitlementExpiresAt.empty() ||
+        !c.lastSuccessRefreshAt.empty() ||
+        !c.machineId.empty() ||
+        !c.lanIp.empty();
+}
+
+} // namespace
+
+namespace ServerConfigFile
+{
+    bool IsBinary(const uint8_t* data, size_t size)
+    {
+        return size >= sizeof(kMagic) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+    }
+
+    std::shared_ptr<DataKey> DataKey::Generate()
+    {
+        std::string raw(kKeyBytes, '\0');
+        if (!RandomBytes(reinterpret_cast<uint8_t*>(&raw[0]), raw.size())) {
+            DebugLog("ServerConfigFile: SecureRandom failed.");
+            return nullptr;
+        }
+        auto key = FromBytes(raw);
+        SecureZeroMemory(&raw[0], raw.size());
+        return key;
+    }
+
+    std::shared_ptr<DataKey> DataKey::FromBytes(const std::string& raw)
+    {
+        if (raw.size() != kKeyBytes) {
+            return nullptr;
+        }
+        std::shared_ptr<DataKey> key(new DataKey());
+        if (!key->Init(raw)) {
+            return nullptr;
+        }
+        return key;
+    }
+
+    bool DataKey::Init(const std::string& raw)
+    {
+        if (BCryptOpenAlgorithmProvider(&alg_, BCRYPT_AES_ALGORITHM, nullptr, 0) != 0) {
+            alg_ = nullptr;
+            DebugLog("ServerConfigFile: BCryptOpenAlgorithmProvider(AES) failed.");
+            return false;
+        }
+        if (BCryptSetProperty(alg_, BCRYPT_CHAINING_MODE, (PUCHAR)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0) != 0) {
+            DebugLog("ServerConfigFile: AES-GCM not available.");
+            return false;
+        }
+        DWORD objLen = 0, cb = 0;
+        if (BCryptGetProperty(alg_, BCRYPT_OBJECT_LENGTH, reinterpret_cast<PUCHAR>(&objLen), sizeof(objLen), &cb, 0) != 0) {
+            return false;
+        }
+        keyObject_.resize(objLen);
+        if (BCryptGenerateSymmetricKey(alg_, &key_, keyObject_.data(), objLen,
+                reinterpret_cast<PUCHAR>(const_cast<char*>(raw.data())), static_cast<ULONG>(raw.size()), 0) != 0) {
+            key_ = nullptr;
+            DebugLog("ServerConfigFile: BCryptGenerateSymmetricKey failed.");
+            return false;
+        }
+        raw_ = raw;
+        return true;
+    }
+
+    DataKey::~DataKey()
+    {
+        if (key_) BCryptDestroyKey(key_);
+        if (alg_) BCryptCloseAlgorithmProvider(alg_, 0);
+        if (!keyObject_.empty()) SecureZeroMemory(keyObject_.data(), keyObject_.size());
+        if (!raw_.empty()) SecureZeroMemory(&raw_[0], raw_.size());
+    }
+
+    bool DataKey::Seal(const std::string& aad, const std::string& plain, uint8_t nonce[kNonceSize], std::string& cipher, uint8_t tag[kTagSize]) const
+    {
+        cipher.clear();
+        if (!RandomBytes(nonce, kNonceSize)) {
+            return false;
+        }
+
+        BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+        BCRYPT_INIT_AUTH_MODE_INFO(info);
+        info.pbNonce = nonce;
+        info.cbNonce = static_cast<ULONG>(kNonceSize);
+        info.pbAuthData = reinterpret_cast<PUCHAR>(const_cast<char*>(aad.data()));
+        info.cbAuthData = static_cast<ULONG>(aad.size());
+        info.pbTag = tag;
+        info.cbTag = static_cast<ULONG>(kTagSize);
+
+        // GCM is a stream mode: ciphertext length == plaintext length.
+        cipher.resize(plain.size());
+        ULONG outLen = 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (BCryptEncrypt(key_,
+                plain.empty() ? nullptr : reinterpret_cast<PUCHAR>(const_cast<char*>(plain.data())),
+                static_cast<ULONG>(plain.size()), &info, nullptr, 0,
+                cipher.empty() ? nullptr : reinterpret_cast<PUCHAR>(&cipher[0]),
+                static_cast<ULONG>(cipher.size()), &outLen, 0) != 0 || outLen != plain.size()) {
+            cipher.clear();
+            return false;
+        }
+        return true;
+    }
+
+    bool DataKey::Open(const std::string& aad, const uint8_t* nonce, const uint8_t* cipher, size_t cipherLen, const uint8_t* tag, std::string& plain) const
+    {
+        plain.clear();
+
+        uint8_t nonceCopy[kNonceSize];
+        uint8_t tagCopy[kTagSize];
+        std::memcpy(nonceCopy, nonce, kNonceSize);
+        std::memcpy(tagCopy, tag, kTagSize);
+
+        BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+        BCRYPT_INIT_AUTH_MODE_INFO(info);
+        info.pbNonce = nonceCopy;
+        info.cbNonce = static_cast<ULONG>(kNonceSize);
+        info.pbAuthData = reinterpret_cast<PUCHAR>(const_cast<char*>(aad.data()));
+        info.cbAuthData = static_cast<ULONG>(aad.size());
+        info.pbTag = tagCopy;
+        info.cbTag = static_cast<ULONG>(kTagSize);
+
+        plain.resize(cipherLen);
+        ULONG outLen = 0;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (BCryptDecrypt(key_,
+                cipherLen == 0 ? nullptr : const_cast<PUCHAR>(cipher), static_cast<ULONG>(cipherLen),
+                &info, nullptr, 0,
+                plain.empty() ? nullptr : reinterpret_cast<PUCHAR>(&plain[0]),
+                static_cast<ULONG>(plain.size()), &outLen, 0) != 0 || outLen != cipherLen) {
+            if (!plain.empty()) SecureZeroMemory(&plain[0], plain.size());
+            plain.clear();
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<const View> View::Parse(const uint8_t* data, size_t size)
+    {
+        if (size < kHeaderSize || !IsBinary(data, size)) {
+            return nullptr;
+        }
+        const uint16_t version = ReadU16(data + 4);
+        const uint16_t headerSize = ReadU16(data + 6);
+        const uint16_t recordCount = ReadU16(data + 8);
+        const uint32_t wrappedLen = ReadU32(data + 12);
+        if (version != kVersion) {
+            DebugLog("ServerConfigFile: unsupported config version " + std::to_string(version) + ".");
+            return nullptr;
+        }
+        if (headerSize < kHeaderSize || headerSize > size || wrappedLen == 0 || wrappedLen > size - headerSize) {
+            return nullptr;
+        }
+
+        std::shared_ptr<View> view(new View());
+        view->aad_.assign(reinterpret_cast<const char*>(data), headerSize);
+        view->wrappedKey_.assign(reinterpret_cast<const char*>(data + headerSize), wrappedLen);
+        const size_t recordsBegin = static_cast<size_t>(headerSize) + wrappedLen;
+        view->records_.assign(data + recordsBegin, data + size);
+
+        const std::vector<uint8_t>& r = view->records_;
+        size_t pos = 0;
+        for (uint16_t i = 0; i < recordCount; ++i) {
+            if (r.size() - pos < kRecordHeaderSize + kNonceSize + kTagSize) {
+                return nullptr;
+            }
+            const uint16_t field = ReadU16(&r[pos]);
+            const uint32_t length = ReadU32(&r[pos + 4]);
+            view->aad_.append(reinterpret_cast<const char*>(&r[pos]), kRecordHeaderSize);
+            const size_t body = pos + kRecordHeaderSize;
+            if (length > r.size() - body - kNonceSize - kTagSize) {
+                return nullptr;
+            }
+            if (field < kFieldSlots) {
+                Entry& e = view->index_[field];
+                if (e.present) {
+                    return nullptr; // duplicate field
+                }
+                e.present = true;
+                e.position = i;
+                e.offset = static_cast<uint32_t>(body);
+                e.length = length;
+            }
+            pos = body + kNonceSize + length + kTagSize;
+        }
+        if (pos != r.size()) {
+            return nullptr; // trailing bytes
+        }
+        return view;
+    }
+
+    bool View::Has(Field field) const
+    {
+        const size_t slot = static_cast<size_t>(field);
+        return slot < kFieldSlots && index_[slot].present;
+    }
+
+    bool View::ReadRecord(const DataKey& key, Field field, std::string& out) const
+    {
+        out.clear();
+        const size_t slot = static_cast<size_t>(field);
+        if (slot >= kFieldSlots || !index_[slot].present) {
+            return true; // absent == empty
+        }
+        const Entry& e = index_[slot];
+        const uint8_t* nonce = records_.data() + e.offset;
+        const uint8_t* cipher = nonce + kNonceSize;
+        const uint8_t* tag = cipher + e.length;
+        if (!key.Open(RecordAad(aad_, e.position), nonce, cipher, e.length, tag, out)) {
+            DebugLog("ServerConfigFile: record " + std::to_string(slot) + " failed authentication.");
+            return false;
+        }
+        return true;
+    }
+
+    bool View::ReadFlags(const DataKey& key, bool& activated, bool& licenseBlocked) const
+    {
+        activated = false;
+        licenseBlocked = false;
+        std::string flags;
+        if (!ReadRecord(key, Field::Flags, flags)) {
+            return false;
+        }
+        if (!flags.empty()) {
+            const uint8_t bits = static_cast<uint8_t>(flags[0]);
+            activated = (bits & kFlagActivated) != 0;
+            licenseBlocked = (bits & kFlagLicenseBlocked) != 0;
+        }
+        return true;
+    }
+
+    bool View::ReadString(const DataKey& key, Field field, std::string& out) const
+    {
+        return ReadRecord(key, field, out);
+    }
+
+    bool View::ReadAll(const DataKey& key, ServerActivationConfig& out) const
+    {
+        out = ServerActivationConfig{};
+        return ReadFlags(key, out.activated, out.licenseBlocked) &&
+            ReadRecord(key, Field::ServerName, out.serverName) &&
+            ReadRecord(key, Field::DeviceId, out.deviceId) &&
+            ReadRecord(key, Field::RefreshToken, out.refreshToken) &&
+            ReadRecord(key, Field::LicenseBlob, out.licenseBlob) &&
+            ReadRecord(key, Field::EntitlementExpiresAt, out.entitlementExpiresAt) &&
+            ReadRecord(key, Field::LastSuccessRefreshAt, out.lastSuccessRefreshAt) &&
+            ReadRecord(key, Field::MachineId, out.machineId) &&
+            ReadRecord(key, Field::LanIp, out.lanIp);
+    }
+
+    ServerActivationConfig Normalize(const ServerActivationConfig& c)
+    {
+        ServerActivationConfig n;
+        n.serverName = c.serverName;
+        if (HasSession(c)) {
+            n.deviceId = c.deviceId;
+            n.refreshToken = c.refreshToken;
+            n.licenseBlob = c.licenseBlob;
+            n.entitlementExpiresAt = c.entitlementExpiresAt;
+            n.lastSuccessRefreshAt = c.lastSuccessRefreshAt;
+            n.machineId = c.machineId;
+            n.lanIp = c.lanIp;
+            n.activated = c.activated;
+            n.licenseBlocked = c.licenseBlocked;
+        }
+        return n;
+    }
+
+    bool SameStoredContent(const ServerActivationConfig& a, const ServerActivationConfig& b)
+    {
+        const ServerActivationConfig x = Normalize(a);
+        const ServerActivationConfig y = Normalize(b);
+        return x.serverName == y.serverName &&
+            x.deviceId == y.deviceId &&
+            x.refreshToken == y.refreshToken &&
+            x.licenseBlob == y.licenseBlob &&
+            x.entitlementExpiresAt == y.entitlementExpiresAt &&
+            x.lastSuccessRefreshAt == y.lastSuccessRefreshAt &&
+            x.machineId == y.machineId &&
+            x.lanIp == y.lanIp &&
+            x.activated == y.activated &&
+            x.licenseBlocked == y.licenseBlocked;
+    }
+
+    bool Write(const ServerActivationConfig& c, const DataKey& key, const std::string& wrappedKey, std::string& out)
+    {
+        out.clear();
+
+        std::vector<std::pair<Field, std::string>> records;
+        if (!c.serverName.empty()) records.emplace_back(Field::ServerName, c.serverName);
+
+        if (HasSession(c)) {
+            const uint8_t bits = (c.activated ? kFlagActivated : 0) | (c.licenseBlocked ? kFlagLicenseBlocked : 0);
+            records.emplace_back(Field::Flags, std::string(1, static_cast<char>(bits)));
+            if (!c.deviceId.empty())             records.emplace_back(Field::DeviceId, c.deviceId);
+            if (!c.refreshToken.empty())         records.emplace_back(Field::RefreshToken, c.refreshToken);
+            if (!c.licenseBlob.empty())          records.emplace_back(Field::LicenseBlob, c.licenseBlob);
+            if (!c.entitlementExpiresAt.empty()) records.emplace_back(Field::EntitlementExpiresAt, c.entitlementExpiresAt);
+            if (!c.lastSuccessRefreshAt.empty()) records.emplace_back(Field::LastSuccessRefreshAt, c.lastSuccessRefreshAt);
+            if (!c.machineId.empty())            records.emplace_back(Field::MachineId, c.machineId);
+            if (!c.lanIp.empty())                records.emplace_back(Field::LanIp, c.lanIp);
+        }
+
+        std::string header(kMagic, sizeof(kMagic));
+        AppendU16(header, kVersion);
+        AppendU16(header, static_cast<uint16_t>(kHeaderSize));
+        AppendU16(header, static_cast<uint16_t>(records.size()));
+        AppendU16(header, 0);
+        AppendU32(header, static_cast<uint32_t>(wrappedKey.size()));
+        uint8_t salt[kSaltSize];
+        if (!RandomBytes(salt, sizeof(salt))) {
+            return false;
+        }
+        header.append(reinterpret_cast<const char*>(salt), sizeof(salt));
+
+        // GCM ciphertext is as long as the plaintext, so the record headers are known up front.
+        std::string fileAad = header;
+        for (const auto& record : records) {
+            AppendRecordHeader(fileAad, static_cast<uint16_t>(record.first), static_cast<uint32_t>(record.second.size()));
+        }
+
+        out = header;
+        out += wrappedKey;
+        std::string cipher;
+        for (size_t i = 0; i < records.size(); ++i) {
+            const uint16_t field = static_cast<uint16_t>(records[i].first);
+            uint8_t nonce[kNonceSize];
+            uint8_t tag[kTagSize];
+            if (!key.Seal(RecordAad(fileAad, static_cast<uint16_t>(i)), records[i].second, nonce, cipher, tag)) {
+                DebugLog("ServerConfigFile: AES-GCM encryption failed.");
+                out.clear();
+                return false;
+            }
+            AppendRecordHeader(out, field, static_cast<uint32_t>(cipher.size()));
+            out.append(reinterpret_cast<const char*>(nonce), kNonceSize);
+            out += cipher;
+            out.append(reinterpret_cast<const char*>(tag), kTagSize);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <windows.h>
+#include <bcrypt.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct ServerActivationConfig;
+
+// ServerConfigFile
+// - Binary layout of the Server config file (version 1). All integers are little-endian.
+//     header   "HKSC" | u16 version | u16 headerSize | u16 recordCount | u16 reserved |
+//              u32 wrappedKeyLength | 16-byte random file salt                     (32 bytes)
+//     key      DPAPI-protected 32-byte data key (entropy: MachineId)
+//     records  u16 field | u16 reserved | u32 length | 12-byte nonce | ciphertext | 16-byte tag
+// - Every record is encrypted on its own with AES-256-GCM under the data key. The file header,
+//   all record headers and the record's position are authenticated with it, so records cannot be
+//   dropped, renamed, reordered or spliced in from another file.
+// - View::Parse() only checks the layout and indexes the records; nothing is decrypted until a
+//   field is read, and reading a field decrypts just that record. activated / licenseBlocked
+//   share one 1-byte record, and presence of a field is known without decrypting it.
+// - Empty strings are not stored. As in the old text format, a config that is not activated and
+//   holds no session state keeps only ServerName.
+namespace ServerConfigFile
+{
+    enum class Field : uint16_t {
+        Flags = 1,                  // bit 0: activated, bit 1: licenseBlocked
+        ServerName = 2,
+        DeviceId = 3,
+        RefreshToken = 4,
+        LicenseBlob = 5,
+        EntitlementExpiresAt = 6,
+        LastSuccessRefreshAt = 7,
+        MachineId = 8,
+        LanIp = 9,
+    };
+    constexpr size_t kFieldSlots = 16;     // field ids above this are skipped (newer writers)
+
+    constexpr uint16_t kVersion = 1;
+    constexpr size_t kHeaderSize = 32;
+    constexpr size_t kNonceSize = 12;
+    constexpr size_t kTagSize = 16;
+
+    // True when data starts with the binary header magic; anything else is the old DPAPI-encrypted
+    // key=value text.
+    bool IsBinary(const uint8_t* data, size_t size);
+
+    // AES-256-GCM data key. The raw bytes are kept only so the key can be re-wrapped with DPAPI.
+    class DataKey
+    {
+    public:
+        static constexpr size_t kKeyBytes = 32;
+
+        static std::shared_ptr<DataKey> Generate();
+        static std::shared_ptr<DataKey> FromBytes(const std::string& raw);
+        ~DataKey();
+
+        DataKey(const DataKey&) = delete;
+        DataKey& operator=(const DataKey&) = delete;
+
+        const std::string& Bytes() const { return raw_; }
+
+        // Encrypts with a fresh random nonce.
+        bool Seal(const std::string& aad, const std::string& plain, uint8_t nonce[kNonceSize], std::string& cipher, uint8_t tag[kTagSize]) const;
+        bool Open(const std::string& aad, const uint8_t* nonce, const uint8_t* cipher, size_t cipherLen, const uint8_t* tag, std::string& plain) const;
+
+    private:
+        DataKey() = default;
+        bool Init(const std::string& raw);
+
+        std::string raw_;
+        BCRYPT_ALG_HANDLE alg_ = nullptr;
+        BCRYPT_KEY_HANDLE key_ = nullptr;
+        std::vector<UCHAR> keyObject_;
+        mutable std::mutex mutex_;      // one operation at a time on key_
+    };
+
+    // Parsed file image: the wrapped key plus an index of the records by field.
+    class View
+    {
+    public:
+        // Copies what it needs out of data (e.g. a mapped view of the file). nullptr when the
+        // layout is invalid.
+        static std::shared_ptr<const View> Parse(const uint8_t* data, size_t size);
+
+        const std::string& WrappedKey() const { return wrappedKey_; }
+        bool Has(Field field) const;
+
+        // Each call decrypts exactly the records it returns. False when authentication fails.
+        bool ReadFlags(const DataKey& key, bool& activated, bool& licenseBlocked) const;
+        bool ReadString(const DataKey& key, Field field, std::string& out) const;
+        bool ReadAll(const DataKey& key, ServerActivationConfig& out) const;
+
+    private:
+        struct Entry {
+            bool present = false;
+            uint16_t position = 0;      // record index in the file (authenticated)
+            uint32_t offset = 0;        // nonce offset in records_
+            uint32_t length = 0;        // ciphertext length
+        };
+
+        View() = default;
+        bool ReadRecord(const DataKey& key, Field field, std::string& out) const;
+
+        std::string aad_;               // file header + all record headers
+        std::string wrappedKey_;
+        std::vector<uint8_t> records_;
+        std::array<Entry, kFieldSlots> index_{};
+    };
+
+    // What a reader gets back after Write(cfg): legacy fields dropped and, for a config that is
+    // neither activated nor holds session state, everything but ServerName cleared.
+    ServerActivationConfig Normalize(const ServerActivationConfig& cfg);
+
+    // True when a and b would be stored as the same records (the bytes always differ: every
+    // write uses a new salt and new nonces).
+    bool SameStoredContent(const ServerActivationConfig& a, const ServerActivationConfig& b);
+
+    // Serializes cfg with a new file salt and fresh nonces. Legacy fields are never written.
+    bool Write(const ServerActivationConfig& cfg, const DataKey& key, const std::string& wrappedKey, std::string& out);
+}
@@ -0,0 +1,718 @@
+#include "ServerConfigStore.h"
+
+#include <wincrypt.h>
+
+#include <cwchar>
+#include <functional>
+#include <sstream>
+#include <vector>
+
+#include "DebugLog.h"
+
+#pragma comment(lib, "crypt32.lib")
+
+namespace {
+
+std::string TrimConfigLine(const std::string& s) {
+    size_t b = 0;
+    while (b < s.size() && (s[b] == ' ' || s[b] == '\t' || s[b] == '\r' || s[b] == '\n')) b++;
+    size_t e = s.size();
+    while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t' || s[e - 1] == '\r' || s[e - 1] == '\n')) e--;
+    return s.substr(b, e - b);
+}
+
+bool DpapiEncrypt(const std::string& plain, const std::string& entropy, std::string& outCipher) {
+    DATA_BLOB inBlob{0};
+    inBlob.pbData = (BYTE*)plain.data();
+    inBlob.cbData = (DWORD)plain.size();
+
+    DATA_BLOB entBlob{0};
+    entBlob.pbData = (BYTE*)entropy.data();
+    entBlob.cbData = (DWORD)entropy.size();
+
+    DATA_BLOB outBlob{0};
+    if (!CryptProtectData(&inBlob, L"HayateKomorebi", &entBlob, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &outBlob)) {
+        return false;
+    }
+    outCipher.assign((char*)outBlob.pbData, (size_t)outBlob.cbData);
+    LocalFree(outBlob.pbData);
+    return true;
+}
+
+bool DpapiDecrypt(const std::string& cipher, const std::string& entropy, std::string& outPlain) {
+    DATA_BLOB inBlob{0};
+    inBlob.pbData = (BYTE*)cipher.data();
+    inBlob.cbData = (DWORD)cipher.size();
+
+    DATA_BLOB entBlob{0};
+    entBlob.pbData = (BYTE*)entropy.data();
+    entBlob.cbData = (DWORD)entropy.size();
+
+    DATA_BLOB outBlob{0};
+    LPWSTR desc = nullptr;
+    if (!CryptUnprotectData(&inBlob, &desc, &entBlob, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &outBlob)) {
+        if (desc) LocalFree(desc);
+        return false;
+    }
+    if (desc) LocalFree(desc);
+    outPlain.assign((char*)outBlob.pbData, (size_t)outBlob.cbData);
+    LocalFree(outBlob.pbData);
+    return true;
+}
+
+enum class ReadStatus { Ok, Missing, Busy };
+
+// Maps the file (full sharing, so a concurrent rename never fails because of us) and hands the
+// mapped bytes to consume(). The view is released before returning: Windows refuses to replace a
+// file that is mapped, which would break Save()'s rename. A mapped file cannot be truncated
+// either, so the bytes stay valid while consume() runs.
+// A sharing violation while another process is writing is reported as Busy.
+ReadStatus MapFile(const std::filesystem::path& path, const std::function<void(const uint8_t*, size_t)>& consume) {
+    for (int attempt = 0; attempt < 5; ++attempt) {
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (h == INVALID_HANDLE_VALUE) {
+            const DWORD err = GetLastError();
+            if (err == ERROR_FILE_NOT_FOUND || err == ERROR_PATH_NOT_FOUND) {
+                return ReadStatus::Missing;
+            }
+            if (err == ERROR_SHARING_VIOLATION || err == ERROR_LOCK_VIOLATION || err == ERROR_ACCESS_DENIED) {
+                Sleep(50);
+                continue;
+            }
+            return ReadStatus::Missing;
+        }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(h, &size) || size.QuadPart <= 0 || size.QuadPart > (64LL << 20)) {
+            CloseHandle(h);
+            return ReadStatus::Missing;
+        }
+        HANDLE mapping = CreateFileMappingW(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view) {
+            if (mapping) CloseHandle(mapping);
+            CloseHandle(h);
+            Sleep(50);
+            continue;
+        }
+        consume(static_cast<const uint8_t*>(view), static_cast<size_t>(size.QuadPart));
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        CloseHandle(h);
+        return ReadStatus::Ok;
+    }
+    return ReadStatus::Busy;
+}
+
+bool WriteWholeFile(const std::filesystem::path& path, const std::string& data) {
+    HANDLE h = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    const bool ok = WriteFile(h, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) &&
+        written == data.size() &&
+        FlushFileBuffers(h);
+    CloseHandle(h);
+    return ok;
+}
+
+// Stands in for a binary file's snapshot until the first Load() decodes it.
+const std::shared_ptr<const ServerActivationConfig>& PendingSnapshot() {
+    static const std::shared_ptr<const ServerActivationConfig> pending = std::make_shared<const ServerActivationConfig>();
+    return pending;
+}
+
+uint32_t PackStatus(const ServerConfigStore::Status& s) {
+    return (s.present ? 0x01u : 0u) | (s.activated ? 0x02u : 0u) | (s.licenseBlocked ? 0x04u : 0u) |
+        (s.hasServerName ? 0x08u : 0u) | (s.hasDeviceId ? 0x10u : 0u) | (s.hasRefreshToken ? 0x20u : 0u);
+}
+
+ServerConfigStore::Status UnpackStatus(uint32_t bits) {
+    ServerConfigStore::Status s;
+    s.present = (bits & 0x01u) != 0;
+    s.activated = (bits & 0x02u) != 0;
+    s.licenseBlocked = (bits & 0x04u) != 0;
+    s.hasServerName = (bits & 0x08u) != 0;
+    s.hasDeviceId = (bits & 0x10u) != 0;
+    s.hasRefreshToken = (bits & 0x20u) != 0;
+    return s;
+}
+
+} // namespace
+
+ServerConfigStore::ServerConfigStore(std::filesystem::path path, EntropyProvider preferredEntropy, FallbackEntropyProvider fallbackEntropies)
+    : path_(std::move(path)),
+      preferredEntropy_(std::move(preferredEntropy)),
+      fallbackEntropies_(std::move(fallbackEntropies)) {
+    stopEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+}
+
+ServerConfigStore::~ServerConfigStore() {
+    StopWatching();
+    if (writerThread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(reloadMutex_);
+            writerStop_ = true;
+        }
+        writerCv_.notify_one();
+        writerThread_.join();
+    }
+    (void)Flush();
+    if (stopEvent_) {
+        CloseHandle(stopEvent_);
+        stopEvent_ = nullptr;
+    }
+}
+
+ServerConfigStore::Status ServerConfigStore::StatusOf(const ServerActivationConfig& c) {
+    Status s;
+    s.present = true;
+    s.activated = c.activated;
+    s.licenseBlocked = c.licenseBlocked;
+    s.hasServerName = !c.serverName.empty();
+    s.hasDeviceId = !c.deviceId.empty();
+    s.hasRefreshToken = !c.refreshToken.empty();
+    return s;
+}
+
+ServerActivationConfig ServerConfigStore::Parse(const std::string& text) {
+    ServerActivationConfig c;
+    std::istringstream iss(text);
+    std::string line;
+    while (std::getline(iss, line)) {
+        line = TrimConfigLine(line);
+        if (line.empty()) continue;
+        auto eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        std::string k = line.substr(0, eq);
+        std::string v = line.substr(eq + 1);
+        if (k == "ServerName") c.serverName = v;
+        else if (k == "DeviceId") c.deviceId = v;
+        else if (k == "RefreshToken") c.refreshToken = v;
+        else if (k == "LicenseBlob") c.licenseBlob = v;
+        else if (k == "EntitlementExpiresAt") c.entitlementExpiresAt = v;
+        else if (k == "LastSuccessRefreshAt") c.lastSuccessRefreshAt = v;
+        else if (k == "MachineId") c.machineId = v;
+        else if (k == "LanIp") c.lanIp = v;
+        else if (k == "LicenseBlocked") c.licenseBlocked = (v == "1");
+        else if (k == "Activated") c.activated = (v == "1");
+        // Legacy (migration)
+        else if (k == "UserEmail") c.userEmail = v;
+        else if (k == "Password") c.password = v;
+        else if (k == "ActivationCode") c.activationCode = v;
+        else if (k == "ActivationExpiresOn") c.activationExpiresOn = v;
+    }
+    return c;
+}
+
+ServerConfigStore::FileStamp ServerConfigStore::StatFile() const {
+    FileStamp stamp;
+    WIN32_FILE_ATTRIBUTE_DATA fad{};
+    if (!GetFileAttributesExW(path_.c_str(), GetFileExInfoStandard, &fad)) {
+        return stamp;
+    }
+    stamp.exists = true;
+    stamp.size = (static_cast<uint64_t>(fad.nFileSizeHigh) << 32) | fad.nFileSizeLow;
+    stamp.lastWrite = (static_cast<uint64_t>(fad.ftLastWriteTime.dwHighDateTime) << 32) | fad.ftLastWriteTime.dwLowDateTime;
+    return stamp;
+}
+
+// Decrypts with the preferred hardware-derived MachineId, but also accepts the MachineIds older
+// builds used (legacy UNKNOWNCPU-UNKNOWNUUID form, wmic-derived values) so existing installs are
+// migrated in place: a file that only opens with a fallback is rewritten right away.
+bool ServerConfigStore::DecryptWithMachineIds(const std::string& cipher, std::string& plain, std::string& machineId, bool& needsMigrationSave) {
+    const std::string preferredMachineId = preferredEntropy_ ? preferredEntropy_() : std::string();
+    decrypts_.fetch_add(1, std::memory_order_relaxed);
+    if (DpapiDecrypt(cipher, preferredMachineId, plain)) {
+        machineId = preferredMachineId;
+        return true;
+    }
+    const std::vector<std::string> fallbacks = fallbackEntropies_ ? fallbackEntropies_() : std::vector<std::string>();
+    for (const auto& candidate : fallbacks) {
+        if (candidate == preferredMachineId) continue;
+        decrypts_.fetch_add(1, std::memory_order_relaxed);
+        if (DpapiDecrypt(cipher, candidate, plain)) {
+            DebugLog("ServerConfigStore: config opened with a previous MachineId; re-encrypting.");
+            machineId = candidate;
+            needsMigrationSave = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<ServerConfigFile::DataKey> ServerConfigStore::UnwrapKeyLocked(const std::string& wrappedKey, bool& needsMigrationSave) {
+    if (dataKey_ && wrappedKey == wrappedKey_) {
+        return dataKey_;
+    }
+    std::string raw;
+    std::string machineId;
+    if (!DecryptWithMachineIds(wrappedKey, raw, machineId, needsMigrationSave)) {
+        return nullptr;
+    }
+    auto key = ServerConfigFile::DataKey::FromBytes(raw);
+    if (!raw.empty()) SecureZeroMemory(&raw[0], raw.size());
+    if (!key) {
+        DebugLog("ServerConfigStore: config data key is invalid.");
+        return nullptr;
+    }
+    dataKey_ = key;
+    wrappedKey_ = wrappedKey;
+    wrappedKeyEntropy_ = machineId;
+    return key;
+}
+
+void ServerConfigStore::SetCurrentLocked(std::shared_ptr<const ServerConfigFile::View> view, Snapshot snapshot, const Status& status) {
+    view_ = std::move(view);
+    status_.store(PackStatus(status));
+    std::atomic_store(&snapshot_, std::move(snapshot));
+}
+
+ServerConfigStore::Snapshot ServerConfigStore::MaterializeLocked() {
+    Snapshot current = std::atomic_load(&snapshot_);
+    if (current != PendingSnapshot()) {
+        return current;
+    }
+    auto cfg = std::make_shared<ServerActivationConfig>();
+    decodes_.fetch_add(1, std::memory_order_relaxed);
+    if (!view_ || !dataKey_ || !view_->ReadAll(*dataKey_, *cfg)) {
+        DebugLog("ServerConfigStore: config records failed to decrypt.");
+        SetCurrentLocked(nullptr, nullptr, Status{});
+        return nullptr;
+    }
+    std::atomic_store(&snapshot_, Snapshot(cfg));
+    return cfg;
+}
+
+bool ServerConfigStore::ReadLegacyLocked(const std::string& cipher, bool& needsMigrationSave) {
+    std::string plain;
+    std::string machineId;
+    if (!DecryptWithMachineIds(cipher, plain, machineId, needsMigrationSave)) {
+        SetCurrentLocked(nullptr, nullptr, Status{});
+        return false;
+    }
+
+    auto cfg = std::make_shared<ServerActivationConfig>(Parse(plain));
+
+    // One-time migration: if legacy activation fields exist, wipe them.
+    // The old activation scheme is no longer supported; user must re-enroll via pairing code.
+    if (!cfg->userEmail.empty() || !cfg->password.empty() || !cfg->activationCode.empty() || !cfg->activationExpiresOn.empty()) {
+        DebugLog("ServerConfigStore: legacy activation fields detected. Clearing and requiring re-enroll.");
+        cfg->userEmail.clear();
+        cfg->password.clear();
+        cfg->activationCode.clear();
+        cfg->activationExpiresOn.clear();
+        cfg->deviceId.clear();
+        cfg->refreshToken.clear();
+        cfg->licenseBlob.clear();
+        cfg->entitlementExpiresAt.clear();
+        cfg->lastSuccessRefreshAt.clear();
+        cfg->licenseBlocked = false;
+        cfg->activated = false;
+    }
+
+    DebugLog("ServerConfigStore: text config found; converting to the binary format.");
+    needsMigrationSave = true;
+    SetCurrentLocked(nullptr, cfg, StatusOf(*cfg));
+    return true;
+}
+
+bool ServerConfigStore::ReadFileLocked(bool& needsMigrationSave, bool& busy) {
+    needsMigrationSave = false;
+    busy = false;
+
+    bool binary = false;
+    std::shared_ptr<const ServerConfigFile::View> view;
+    std::string legacy;
+    const ReadStatus rs = MapFile(path_, [&](const uint8_t* data, size_t size) {
+        binary = ServerConfigFile::IsBinary(data, size);
+        if (binary) {
+            view = ServerConfigFile::View::Parse(data, size);
+        } else {
+            legacy.assign(reinterpret_cast<const char*>(data), size);
+        }
+    });
+    if (rs == ReadStatus::Busy) {
+        busy = true;
+        return false;
+    }
+    if (rs == ReadStatus::Missing) {
+        SetCurrentLocked(nullptr, nullptr, Status{});
+        return true;
+    }
+    if (!binary) {
+        return ReadLegacyLocked(legacy, needsMigrationSave);
+    }
+    if (!view) {
+        DebugLog("ServerConfigStore: config file is malformed.");
+        SetCurrentLocked(nullptr, nullptr, Status{});
+        return false;
+    }
+
+    // Only the key and the flags record are decrypted here; the rest waits for Load().
+    const auto key = UnwrapKeyLocked(view->WrappedKey(), needsMigrationSave);
+    Status status;
+    if (!key || !view->ReadFlags(*key, status.activated, status.licenseBlocked)) {
+        needsMigrationSave = false;
+        SetCurrentLocked(nullptr, nullptr, Status{});
+        return false;
+    }
+    status.present = true;
+    status.hasServerName = view->Has(ServerConfigFile::Field::ServerName);
+    status.hasDeviceId = view->Has(ServerConfigFile::Field::DeviceId);
+    status.hasRefreshToken = view->Has(ServerConfigFile::Field::RefreshToken);
+    SetCurrentLocked(view, PendingSnapshot(), status);
+    return true;
+}
+
+bool ServerConfigStore::ReloadIfChanged(bool fromWatcher) {
+    bool needsMigrationSave = false;
+    Snapshot migrated;
+    Status status;
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex_);
+        const FileStamp stamp = StatFile();
+        if (pending_ && stamp == stamp_) {
+            // The pending coalesced save is newer than the file.
+            cacheValid_.store(true);
+            return false;
+        }
+        if (cacheValid_.load() && stamp == stamp_) {
+            return false;
+        }
+        if (pending_) {
+            DebugLog("ServerConfigStore: config changed by someone else; discarding the pending save.");
+            pending_.reset();
+        }
+        bool busy = false;
+        (void)ReadFileLocked(needsMigrationSave, busy);
+        if (busy) {
+            // Someone else is still writing: keep serving the previous snapshot and retry on the
+            // next Load() / change notification.
+            DebugLog("ServerConfigStore: config file busy; keeping previous snapshot.");
+            cacheValid_.store(false);
+            return false;
+        }
+        stamp_ = stamp;
+        cacheValid_.store(true);
+        if (needsMigrationSave) {
+            migrated = MaterializeLocked();
+        }
+        status = UnpackStatus(status_.load());
+    }
+
+    if (needsMigrationSave && migrated) {
+        // Persist the migrated state best-effort (publishes the cleaned snapshot).
+        (void)Save(*migrated, Durability::Coalesced);
+        return true;
+    }
+    if (fromWatcher) {
+        externalChanges_.fetch_add(1, std::memory_order_relaxed);
+        Publish(status);
+    }
+    return true;
+}
+
+ServerConfigStore::Snapshot ServerConfigStore::Load() {
+    loads_.fetch_add(1, std::memory_order_relaxed);
+    if (watching_.load() && cacheValid_.load()) {
+        cacheHits_.fetch_add(1, std::memory_order_relaxed);
+    } else if (!ReloadIfChanged(false)) {
+        cacheHits_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Snapshot current = std::atomic_load(&snapshot_);
+    if (current != PendingSnapshot()) {
+        return current;
+    }
+    std::lock_guard<std::mutex> lock(reloadMutex_);
+    return MaterializeLocked();
+}
+
+ServerConfigStore::Status ServerConfigStore::LoadStatus() {
+    statusLoads_.fetch_add(1, std::memory_order_relaxed);
+    if (!watching_.load() || !cacheValid_.load()) {
+        (void)ReloadIfChanged(false);
+    }
+    return UnpackStatus(status_.load());
+}
+
+// Encrypts and atomically replaces the file. The data key is wrapped with the hardware MachineId
+// (CPU + motherboard UUID), so the file can omit MachineId when minimized; it is only re-wrapped
+// when that MachineId changes.
+bool ServerConfigStore::WriteLocked(const ServerActivationConfig& stored, const std::string& entropy) {
+    if (!dataKey_ || wrappedKeyEntropy_ != entropy) {
+        auto key = ServerConfigFile::DataKey::Generate();
+        std::string wrapped;
+        if (!key || !DpapiEncrypt(key->Bytes(), entropy, wrapped)) {
+            DebugLog("ServerConfigStore: CryptProtectData failed.");
+            return false;
+        }
+        dataKey_ = key;
+        wrappedKey_ = wrapped;
+        wrappedKeyEntropy_ = entropy;
+    }
+
+    std::string image;
+    if (!ServerConfigFile::Write(stored, *dataKey_, wrappedKey_, image)) {
+        DebugLog("ServerConfigStore: failed to encode config.");
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(path_.parent_path(), ec);
+    (void)ec;
+
+    std::filesystem::path tmp = path_;
+    tmp += L".tmp";
+    if (!WriteWholeFile(tmp, image)) {
+        DebugLog("ServerConfigStore: failed to write temp config file.");
+        DeleteFileW(tmp.c_str());
+        return false;
+    }
+
+    bool moved = false;
+    for (int attempt = 0; attempt < 5 && !moved; ++attempt) {
+        moved = MoveFileExW(tmp.c_str(), path_.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+        if (!moved) Sleep(20);
+    }
+    if (!moved) {
+        DebugLog("ServerConfigStore: MoveFileExW failed (" + std::to_string(GetLastError()) + ").");
+        DeleteFileW(tmp.c_str());
+        return false;
+    }
+
+    stamp_ = StatFile();
+    view_.reset();
+    cacheValid_.store(true);
+    writes_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ServerConfigStore::Save(const ServerActivationConfig& cfg, Durability durability) {
+    // Publish what a reader of the file will see (legacy fields and minimized state dropped).
+    const Snapshot stored = std::make_shared<const ServerActivationConfig>(ServerConfigFile::Normalize(cfg));
+    const std::string entropy = preferredEntropy_ ? preferredEntropy_() : std::string();
+    const Status status = StatusOf(*stored);
+
+    {
+        std::unique_lock<std::mutex> lock(reloadMutex_);
+
+        // Nothing to write when the file (or the pending save) already holds this content under
+        // the current MachineId. An Immediate save still has to flush a pending one.
+        const Snapshot current = cacheValid_.load() ? MaterializeLocked() : nullptr;
+        if (current && ServerConfigFile::SameStoredContent(*current, *stored) &&
+            dataKey_ && wrappedKeyEntropy_ == entropy && StatFile() == stamp_ &&
+            (!pending_ || durability == Durability::Coalesced)) {
+            unchanged_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (durability == Durability::Coalesced) {
+            if (pending_) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                // The deadline is not pushed back by later saves, so a steady stream of changes
+                // is still written every kCoalesceWindow.
+                pendingDue_ = std::chrono::steady_clock::now() + kCoalesceWindow;
+            }
+            pending_ = stored;
+            pendingEntropy_ = entropy;
+            if (!writerThread_.joinable()) {
+                writerStop_ = false;
+                writerThread_ = std::thread(&ServerConfigStore::WriterThreadProc, this);
+            }
+            writerCv_.notify_one();
+        } else {
+            if (pending_) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                pending_.reset();
+            }
+            if (!WriteLocked(*stored, entropy)) {
+                return false;
+            }
+        }
+        SetCurrentLocked(nullptr, stored, status);
+    }
+
+    saves_.fetch_add(1, std::memory_order_relaxed);
+    Publish(status);
+    return true;
+}
+
+bool ServerConfigStore::Flush() {
+    std::lock_guard<std::mutex> lock(reloadMutex_);
+    if (!pending_) {
+        return true;
+    }
+    const Snapshot pending = std::move(pending_);
+    pending_.reset();
+    if (!WriteLocked(*pending, pendingEntropy_)) {
+        // Readers were already handed the pending snapshot; make them re-read the file.
+        cacheValid_.store(false);
+        return false;
+    }
+    return true;
+}
+
+void ServerConfigStore::WriterThreadProc() {
+    std::unique_lock<std::mutex> lock(reloadMutex_);
+    while (!writerStop_) {
+        if (!pending_) {
+            writerCv_.wait(lock);
+            continue;
+        }
+        if (writerCv_.wait_until(lock, pendingDue_) != std::cv_status::timeout) {
+            continue; // re-check: stopped, flushed or replaced
+        }
+        if (!pending_ || std::chrono::steady_clock::now() < pendingDue_) {
+            continue;
+        }
+        const Snapshot pending = std::move(pending_);
+        pending_.reset();
+        if (!WriteLocked(*pending, pendingEntropy_)) {
+            DebugLog("ServerConfigStore: coalesced save failed; dropping it.");
+            cacheValid_.store(false);
+        }
+    }
+}
+
+void ServerConfigStore::Invalidate() {
+    cacheValid_.store(false);
+}
+
+int ServerConfigStore::AddListener(Listener listener) {
+    std::lock_guard<std::mutex> lock(listenerMutex_);
+    const int id = nextListenerId_++;
+    listeners_.emplace(id, std::move(listener));
+    return id;
+}
+
+void ServerConfigStore::RemoveListener(int id) {
+    std::lock_guard<std::mutex> lock(listenerMutex_);
+    listeners_.erase(id);
+}
+
+void ServerConfigStore::Publish(const Status& status) {
+    std::vector<Listener> copy;
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        copy.reserve(listeners_.size());
+        for (const auto& kv : listeners_) copy.push_back(kv.second);
+    }
+    for (const auto& l : copy) {
+        if (l) l(status);
+    }
+}
+
+ServerConfigStore::Stats ServerConfigStore::GetStats() const {
+    Stats s;
+    s.loads = loads_.load(std::memory_order_relaxed);
+    s.cacheHits = cacheHits_.load(std::memory_order_relaxed);
+    s.statusLoads = statusLoads_.load(std::memory_order_relaxed);
+    s.decrypts = decrypts_.load(std::memory_order_relaxed);
+    s.decodes = decodes_.load(std::memory_order_relaxed);
+    s.saves = saves_.load(std::memory_order_relaxed);
+    s.writes = writes_.load(std::memory_order_relaxed);
+    s.unchanged = unchanged_.load(std::memory_order_relaxed);
+    s.coalesced = coalesced_.load(std::memory_order_relaxed);
+    s.externalChanges = externalChanges_.load(std::memory_order_relaxed);
+    return s;
+}
+
+bool ServerConfigStore::StartWatching() {
+    if (watchThread_.joinable() || !stopEvent_) {
+        return watchThread_.joinable();
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(path_.parent_path(), ec);
+    (void)ec;
+
+    ResetEvent(stopEvent_);
+    watchThread_ = std::thread(&ServerConfigStore::WatchThreadProc, this);
+    return true;
+}
+
+void ServerConfigStore::StopWatching() {
+    if (!watchThread_.joinable()) {
+        return;
+    }
+    SetEvent(stopEvent_);
+    watchThread_.join();
+    watching_.store(false);
+}
+
+void ServerConfigStore::WatchThreadProc() {
+    const std::filesystem::path dir = path_.parent_path();
+    const std::wstring fileName = path_.filename().wstring();
+
+    HANDLE hDir = CreateFileW(dir.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (hDir == INVALID_HANDLE_VALUE) {
+        DebugLog("ServerConfigStore: cannot open config directory for watching; falling back to stat checks.");
+        watching_.store(false);
+        return;
+    }
+
+    OVERLAPPED ov{};
+    ov.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    alignas(DWORD) BYTE buffer[4096];
+
+    while (true) {
+        ResetEvent(ov.hEvent);
+        if (!ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), FALSE,
+                FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+                nullptr, &ov, nullptr)) {
+            DebugLog("ServerConfigStore: ReadDirectoryChangesW failed (" + std::to_string(GetLastError()) + "); falling back to stat checks.");
+            break;
+        }
+        if (!watching_.load()) {
+            // Prime the snapshot once the first watch is armed (so no change can slip in between)
+            // and here rather than in StartWatching() so the UI thread never waits for decryption.
+            // Until then Load() keeps doing its own stat check.
+            (void)ReloadIfChanged(false);
+            watching_.store(true);
+        }
+
+        HANDLE handles[2] = { stopEvent_, ov.hEvent };
+        const DWORD w = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+        DWORD bytes = 0;
+        if (w != WAIT_OBJECT_0 + 1) {
+            CancelIoEx(hDir, &ov);
+            GetOverlappedResult(hDir, &ov, &bytes, TRUE);
+            break;
+        }
+        if (!GetOverlappedResult(hDir, &ov, &bytes, FALSE)) {
+            DebugLog("ServerConfigStore: watch GetOverlappedResult failed; falling back to stat checks.");
+            break;
+        }
+
+        // bytes == 0: the notification buffer overflowed, so assume the file changed.
+        bool relevant = (bytes == 0);
+        for (DWORD offset = 0; !relevant && bytes != 0;) {
+            const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+            const size_t len = info->FileNameLength / sizeof(WCHAR);
+            if (len == fileName.size() && _wcsnicmp(info->FileName, fileName.c_str(), len) == 0) {
+                relevant = true;
+            }
+            if (info->NextEntryOffset == 0) break;
+            offset += info->NextEntryOffset;
+        }
+        if (!relevant) {
+            continue;
+        }
+
+        // Let the writer finish (rename + metadata updates arrive as a burst) before reading.
+        if (WaitForSingleObject(stopEvent_, 100) == WAIT_OBJECT_0) {
+            break;
+        }
+        (void)ReloadIfChanged(true);
+    }
+
+    watching_.store(false);
+    CloseHandle(ov.hEvent);
+    CloseHandle(hDir);
+}
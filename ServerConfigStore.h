@@ -0,0 +1,216 @@
+#pragma once
+
+#include <windows.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ServerConfigFile.h"
+
+// ServerActivationConfig (v2)
+//
+// IMPORTANT DESIGN CHANGES
+// - Login / passkey / license updates are handled in the dashboard (website).
+// - The tray app never asks for email/password/activation codes.
+// - Device activation uses a short-lived pairing code created in the dashboard.
+// - The tray app stores only opaque device session state:
+//     device_id / refresh_token / license_blob
+// - The device refresh request is authenticated with an Ed25519 signature.
+//   The private key is stored in %ProgramData% protected by DPAPI (LocalMachine).
+struct ServerActivationConfig {
+    std::string serverName;
+
+    // v2 device session state
+    std::string deviceId;               // device_uuid
+    std::string refreshToken;           // opaque refresh token (rotated)
+    std::string licenseBlob;            // server-signed license blob
+    std::string entitlementExpiresAt;   // ISO8601 (optional)
+    std::string lastSuccessRefreshAt;   // ISO8601 local time (optional)
+    bool activated = false;             // enrolled and usable (tokens present)
+    bool licenseBlocked = false;        // server returned license_expired
+
+    // derived device info
+    std::string machineId;
+    std::string lanIp;
+
+    // Legacy fields (migration only; never written)
+    std::string userEmail;
+    std::string password;
+    std::string activationCode;
+    std::string activationExpiresOn;
+};
+
+// ServerConfigStore
+// - Owns the encrypted Server config file (%APPDATA%\HayateKomorebi\Server\Server), stored in
+//   the binary record format described in ServerConfigFile.h. Files in the old DPAPI-encrypted
+//   key=value text format are read once and rewritten in the binary format.
+// - The file is mapped and indexed on load; records are decrypted only when needed. LoadStatus()
+//   (activated / licenseBlocked / presence of the session fields) decrypts a single 1-byte
+//   record, and the full config is decoded on the first Load() after a change. The DPAPI-wrapped
+//   data key is unwrapped once and reused for as long as the file keeps the same wrapped key.
+// - Readers get an immutable snapshot; the snapshot pointer is swapped atomically, so the service
+//   policy thread, the activation poll job and the control panel can read concurrently without
+//   touching the file.
+// - A watcher thread (ReadDirectoryChangesW) reloads the file when it is changed by someone else
+//   and notifies listeners. Without the watcher, Load() falls back to comparing the file's size /
+//   last-write time before trusting the cache.
+// - All writes go through Save(): encode -> write temp file -> flush -> rename over the old file,
+//   so readers never observe a half-written config. A save whose stored content equals the
+//   current config is skipped.
+// - Save(Durability::Immediate) is on disk when it returns; use it whenever losing the write
+//   would break the session (a rotated refresh token, cleared secrets). Durability::Coalesced
+//   publishes the new snapshot at once but writes it up to kCoalesceWindow later on a writer
+//   thread, merged with any further coalesced saves in that window. An Immediate save or Flush()
+//   writes a pending coalesced save right away; a change made by someone else discards it.
+// - Derived fields (MachineId / LanIp fallback values) are not filled in here; the snapshot
+//   reflects exactly what is stored.
+class ServerConfigStore
+{
+public:
+    using Snapshot = std::shared_ptr<const ServerActivationConfig>;
+
+    enum class Durability { Immediate, Coalesced };
+    static constexpr std::chrono::milliseconds kCoalesceWindow{ 500 };
+
+    // The part of the config most readers need, answered without decoding the whole file.
+    struct Status {
+        bool present = false;           // the file exists and could be decrypted
+        bool activated = false;
+        bool licenseBlocked = false;
+        bool hasServerName = false;
+        bool hasDeviceId = false;
+        bool hasRefreshToken = false;
+    };
+
+    using Listener = std::function<void(const Status&)>;
+    using EntropyProvider = std::function<std::string()>;
+    using FallbackEntropyProvider = std::function<std::vector<std::string>()>;
+
+    struct Stats {
+        uint64_t loads = 0;             // Load() calls
+        uint64_t cacheHits = 0;         // Load() calls answered from the snapshot
+        uint64_t statusLoads = 0;       // LoadStatus() calls
+        uint64_t decrypts = 0;          // CryptUnprotectData attempts
+        uint64_t decodes = 0;           // full decodes of the binary file
+        uint64_t saves = 0;             // successful Save() calls
+        uint64_t writes = 0;            // files written
+        uint64_t unchanged = 0;         // saves skipped because nothing changed
+        uint64_t coalesced = 0;         // coalesced saves replaced before they were written
+        uint64_t externalChanges = 0;   // reloads triggered by the watcher
+    };
+
+    // preferredEntropy supplies the MachineId used to encrypt. fallbackEntropies is only consulted
+    // when that fails to decrypt; a config that opens with one of them is re-encrypted with the
+    // preferred MachineId.
+    ServerConfigStore(std::filesystem::path path, EntropyProvider preferredEntropy, FallbackEntropyProvider fallbackEntropies);
+    ~ServerConfigStore();
+
+    ServerConfigStore(const ServerConfigStore&) = delete;
+    ServerConfigStore& operator=(const ServerConfigStore&) = delete;
+
+    // Current snapshot, or nullptr when the file is missing or cannot be decrypted.
+    Snapshot Load();
+
+    // Flags and field presence of the current file; never decodes the whole config.
+    Status LoadStatus();
+
+    // Persists cfg atomically and publishes it as the new snapshot. Listeners are notified.
+    bool Save(const ServerActivationConfig& cfg, Durability durability = Durability::Immediate);
+
+    // Writes a pending coalesced save now.
+    bool Flush();
+
+    // Drops the snapshot; the next Load() reads the file again.
+    void Invalidate();
+
+    bool StartWatching();
+    void StopWatching();
+
+    // Listeners run on the thread that observed the change (watcher thread or the saving thread)
+    // and must not block.
+    int AddListener(Listener listener);
+    void RemoveListener(int id);
+
+    Stats GetStats() const;
+
+    static Status StatusOf(const ServerActivationConfig& cfg);
+
+    // Old key=value text format (read for migration only).
+    static ServerActivationConfig Parse(const std::string& text);
+
+private:
+    struct FileStamp {
+        bool exists = false;
+        uint64_t size = 0;
+        uint64_t lastWrite = 0;
+        bool operator==(const FileStamp& o) const { return exists == o.exists && size == o.size && lastWrite == o.lastWrite; }
+        bool operator!=(const FileStamp& o) const { return !(*this == o); }
+    };
+
+    FileStamp StatFile() const;
+    bool ReadFileLocked(bool& needsMigrationSave, bool& busy);
+    bool ReadLegacyLocked(const std::string& cipher, bool& needsMigrationSave);
+    std::shared_ptr<ServerConfigFile::DataKey> UnwrapKeyLocked(const std::string& wrappedKey, bool& needsMigrationSave);
+    bool DecryptWithMachineIds(const std::string& cipher, std::string& plain, std::string& machineId, bool& needsMigrationSave);
+    void SetCurrentLocked(std::shared_ptr<const ServerConfigFile::View> view, Snapshot snapshot, const Status& status);
+    Snapshot MaterializeLocked();
+    bool WriteLocked(const ServerActivationConfig& stored, const std::string& entropy);
+    void WriterThreadProc();
+    bool ReloadIfChanged(bool fromWatcher);
+    void Publish(const Status& status);
+    void WatchThreadProc();
+
+    const std::filesystem::path path_;
+    const EntropyProvider preferredEntropy_;
+    const FallbackEntropyProvider fallbackEntropies_;
+
+    // Snapshot: read with std::atomic_load, replaced with std::atomic_store. For a binary file it
+    // is decoded on the first Load() and holds a placeholder until then.
+    Snapshot snapshot_;
+    std::atomic<uint32_t> status_{ 0 };        // packed Status of the current file
+    std::atomic<bool> cacheValid_{ false };
+
+    std::mutex reloadMutex_;    // serializes file reads, saves and everything below
+    FileStamp stamp_;
+    std::shared_ptr<const ServerConfigFile::View> view_;    // current binary file, if any
+    std::shared_ptr<ServerConfigFile::DataKey> dataKey_;
+    std::string wrappedKey_;            // dataKey_ as stored in the file
+    std::string wrappedKeyEntropy_;     // MachineId wrappedKey_ is bound to
+
+    // Coalesced save waiting for the writer thread (guarded by reloadMutex_).
+    Snapshot pending_;
+    std::string pendingEntropy_;
+    std::chrono::steady_clock::time_point pendingDue_{};
+    std::condition_variable writerCv_;
+    std::thread writerThread_;
+    bool writerStop_ = false;
+
+    mutable std::mutex listenerMutex_;
+    std::map<int, Listener> listeners_;
+    int nextListenerId_ = 1;
+
+    std::thread watchThread_;
+    std::atomic<bool> watching_{ false };
+    HANDLE stopEvent_ = nullptr;
+
+    std::atomic<uint64_t> loads_{ 0 };
+    std::atomic<uint64_t> cacheHits_{ 0 };
+    std::atomic<uint64_t> statusLoads_{ 0 };
+    std::atomic<uint64_t> decrypts_{ 0 };
+    std::atomic<uint64_t> decodes_{ 0 };
+    std::atomic<uint64_t> saves_{ 0 };
+    std::atomic<uint64_t> writes_{ 0 };
+    std::atomic<uint64_t> unchanged_{ 0 };
+    std::atomic<uint64_t> coalesced_{ 0 };
+    std::atomic<uint64_t> externalChanges_{ 0 };
+};
@@ -0,0 +1,213 @@
+#include "ServiceStateWatcher.h"
+
+#include "DebugLog.h"
+
+namespace {
+
+// SERVICE_NOTIFY_* bit for a SERVICE_* state (SERVICE_STOPPED = 1 -> SERVICE_NOTIFY_STOPPED = 0x1 ...).
+DWORD NotifyMaskForState(DWORD state) {
+    return (state >= SERVICE_STOPPED && state <= SERVICE_PAUSED) ? (1u << (state - 1)) : 0;
+}
+
+constexpr DWORD kAllStatesMask =
+    SERVICE_NOTIFY_STOPPED | SERVICE_NOTIFY_START_PENDING | SERVICE_NOTIFY_STOP_PENDING |
+    SERVICE_NOTIFY_RUNNING | SERVICE_NOTIFY_CONTINUE_PENDING | SERVICE_NOTIFY_PAUSE_PENDING |
+    SERVICE_NOTIFY_PAUSED;
+
+} // namespace
+
+ServiceStateWatcher::ServiceStateWatcher(std::wstring serviceName)
+    : serviceName_(std::move(serviceName)) {
+    registryEvent_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+}
+
+ServiceStateWatcher::~ServiceStateWatcher() {
+    Disarm();
+    if (registryEvent_) {
+        CloseHandle(registryEvent_);
+        registryEvent_ = nullptr;
+    }
+}
+
+void CALLBACK ServiceStateWatcher::OnStatusChange(void* context) {
+    auto* notify = static_cast<SERVICE_NOTIFYW*>(context);
+    auto* self = static_cast<ServiceStateWatcher*>(notify->pContext);
+    self->statusFired_ = true;
+}
+
+bool ServiceStateWatcher::Arm() {
+    if (IsArmed()) {
+        return true;
+    }
+
+    scm_ = OpenSCManagerW(nullptr, nullptr, SC_MANAGER_CONNECT);
+    if (scm_) {
+        service_ = OpenServiceW(scm_, serviceName_.c_str(), SERVICE_QUERY_STATUS | SERVICE_QUERY_CONFIG);
+    }
+    if (!service_) {
+        if (!armFailureLogged_) {
+            DebugLog("ServiceStateWatcher: service not available (err=" + std::to_string(GetLastError()) + "); will retry.");
+            armFailureLogged_ = true;
+        }
+        Disarm();
+        return false;
+    }
+
+    SERVICE_STATUS_PROCESS ssp{};
+    DWORD bytesNeeded = 0;
+    if (!QueryServiceStatusEx(service_, SC_STATUS_PROCESS_INFO, reinterpret_cast<LPBYTE>(&ssp), sizeof(ssp), &bytesNeeded) ||
+        !ArmStatusNotify(ssp.dwCurrentState)) {
+        DebugLog("ServiceStateWatcher: failed to arm status notification.");
+        Disarm();
+        return false;
+    }
+
+    // Start type lives in the service's registry key ("Start"). Without it only run state
+    // changes are seen; the caller still re-checks on every other wakeup.
+    const std::wstring keyPath = L"SYSTEM\\CurrentControlSet\\Services\\" + serviceName_;
+    if (RegOpenKeyExW(HKEY_LOCAL_MACHINE, keyPath.c_str(), 0, KEY_NOTIFY | KEY_QUERY_VALUE, &serviceKey_) != ERROR_SUCCESS) {
+        serviceKey_ = nullptr;
+        DebugLog("ServiceStateWatcher: cannot watch service registry key; start type changes are not observed.");
+    } else if (!ArmRegistryNotify()) {
+        RegCloseKey(serviceKey_);
+        serviceKey_ = nullptr;
+        DebugLog("ServiceStateWatcher: RegNotifyChangeKeyValue failed; start type changes are not observed.");
+    }
+
+    armFailureLogged_ = false;
+    stats_.rearms++;
+    return true;
+}
+
+bool ServiceStateWatcher::ArmStatusNotify(DWORD lastState) {
+    notify_ = SERVICE_NOTIFYW{};
+    notify_.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+    notify_.pfnNotifyCallback = &ServiceStateWatcher::OnStatusChange;
+    notify_.pContext = this;
+
+    const DWORD mask = (kAllStatesMask & ~NotifyMaskForState(lastState)) | SERVICE_NOTIFY_DELETE_PENDING;
+    const DWORD err = NotifyServiceStatusChangeW(service_, mask, &notify_);
+    if (err != ERROR_SUCCESS) {
+        // ERROR_SERVICE_MARKED_FOR_DELETE, ERROR_SERVICE_NOTIFY_CLIENT_LAGGING: the handle is no
+        // longer usable and has to be reopened.
+        DebugLog("ServiceStateWatcher: NotifyServiceStatusChange failed. err=" + std::to_string(err));
+        return false;
+    }
+    return true;
+}
+
+bool ServiceStateWatcher::ArmRegistryNotify() {
+    ResetEvent(registryEvent_);
+    return RegNotifyChangeKeyValue(serviceKey_, FALSE, REG_NOTIFY_CHANGE_LAST_SET, registryEvent_, TRUE) == ERROR_SUCCESS;
+}
+
+void ServiceStateWatcher::Disarm() {
+    if (serviceKey_) {
+        RegCloseKey(serviceKey_);
+        serviceKey_ = nullptr;
+    }
+    if (service_) {
+        CloseServiceHandle(service_);
+        service_ = nullptr;
+    }
+    if (scm_) {
+        CloseServiceHandle(scm_);
+        scm_ = nullptr;
+    }
+    // Run a status APC that was already queued while this object is still alive.
+    SleepEx(0, TRUE);
+    statusFired_ = false;
+}
+
+bool ServiceStateWatcher::Query(State& out) {
+    out = State{};
+    if (!service_) {
+        return false;
+    }
+    stats_.queries++;
+
+    SERVICE_STATUS_PROCESS ssp{};
+    DWORD bytesNeeded = 0;
+    if (!QueryServiceStatusEx(service_, SC_STATUS_PROCESS_INFO, reinterpret_cast<LPBYTE>(&ssp), sizeof(ssp), &bytesNeeded)) {
+        DebugLog("ServiceStateWatcher: QueryServiceStatusEx failed.");
+        return false;
+    }
+    out.currentState = ssp.dwCurrentState;
+
+    if (configBuf_.size() < sizeof(QUERY_SERVICE_CONFIGW)) {
+        configBuf_.resize(1024);
+    }
+    DWORD cfgBytesNeeded = 0;
+    if (!QueryServiceConfigW(service_, reinterpret_cast<QUERY_SERVICE_CONFIGW*>(configBuf_.data()),
+            static_cast<DWORD>(configBuf_.size()), &cfgBytesNeeded)) {
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+            DebugLog("ServiceStateWatcher: QueryServiceConfig failed.");
+            return false;
+        }
+        configBuf_.resize(cfgBytesNeeded);
+        if (!QueryServiceConfigW(service_, reinterpret_cast<QUERY_SERVICE_CONFIGW*>(configBuf_.data()),
+                static_cast<DWORD>(configBuf_.size()), &cfgBytesNeeded)) {
+            DebugLog("ServiceStateWatcher: QueryServiceConfig failed.");
+            return false;
+        }
+    }
+    out.startType = reinterpret_cast<const QUERY_SERVICE_CONFIGW*>(configBuf_.data())->dwStartType;
+    return true;
+}
+
+ServiceStateWatcher::WakeReason ServiceStateWatcher::Wait(HANDLE wakeEvent, DWORD timeoutMs) {
+    // Unrelated APCs end the wait early; each retry only gets what is left of timeoutMs.
+    const ULONGLONG deadline = GetTickCount64() + timeoutMs;
+    for (;;) {
+        DWORD waitMs = timeoutMs;
+        if (timeoutMs != INFINITE) {
+            const ULONGLONG now = GetTickCount64();
+            waitMs = (now < deadline) ? static_cast<DWORD>(deadline - now) : 0;
+        }
+
+        HANDLE handles[2];
+        DWORD count = 0;
+        if (wakeEvent) handles[count++] = wakeEvent;
+        const DWORD registryIndex = count;
+        if (serviceKey_) handles[count++] = registryEvent_;
+
+        const DWORD w = (count != 0)
+            ? WaitForMultipleObjectsEx(count, handles, FALSE, waitMs, TRUE)
+            : SleepEx(waitMs, TRUE);
+
+        if (statusFired_) {
+            statusFired_ = false;
+            stats_.statusNotifications++;
+            const bool deleted = (notify_.dwNotificationTriggered & SERVICE_NOTIFY_DELETE_PENDING) != 0;
+            if (notify_.dwNotificationStatus != ERROR_SUCCESS || deleted ||
+                !ArmStatusNotify(notify_.ServiceStatus.dwCurrentState)) {
+                DebugLog(deleted ? "ServiceStateWatcher: service marked for deletion." : "ServiceStateWatcher: status notification lost; disarming.");
+                Disarm();
+                return WakeReason::Disarmed;
+            }
+            return WakeReason::ServiceChanged;
+        }
+        if (w == WAIT_IO_COMPLETION) {
+            continue; // some other APC
+        }
+        if (w == WAIT_TIMEOUT || (count == 0 && w == 0)) {
+            return WakeReason::Timeout;
+        }
+        if (wakeEvent && w == WAIT_OBJECT_0) {
+            return WakeReason::WakeEvent;
+        }
+        if (serviceKey_ && w == WAIT_OBJECT_0 + registryIndex) {
+            stats_.configNotifications++;
+            if (!ArmRegistryNotify()) {
+                DebugLog("ServiceStateWatcher: RegNotifyChangeKeyValue re-arm failed; start type changes are not observed.");
+                RegCloseKey(serviceKey_);
+                serviceKey_ = nullptr;
+            }
+            return WakeReason::ServiceChanged;
+        }
+
+        DebugLog("ServiceStateWatcher: wait failed. err=" + std::to_string(GetLastError()));
+        Disarm();
+        return WakeReason::Disarmed;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ServiceStateWatcher
+// - Keeps one SCM connection and one service handle open for the lifetime of the service policy
+//   thread and tells that thread when the service may have drifted from the tray policy:
+//     * run state changes   -> NotifyServiceStatusChangeW (delivered as an APC)
+//     * start type changes  -> RegNotifyChangeKeyValue on the service's registry key
+//   Both notifications are one-shot; Wait() re-arms them after they fire.
+// - Wait() blocks alertably until one of those fires or the caller's wake event is signaled, so
+//   the thread does no work at all while nothing changes.
+// - When the service is not installed (or is deleted) the watcher disarms; the caller retries
+//   Arm() on a timer until it exists again.
+// - Not thread-safe: create, arm, query and wait from the same thread (the APC is queued to the
+//   thread that armed the notification).
+class ServiceStateWatcher
+{
+public:
+    struct State {
+        DWORD currentState = SERVICE_STOPPED;
+        DWORD startType = SERVICE_DEMAND_START;
+    };
+
+    enum class WakeReason {
+        ServiceChanged,     // run state or start type notification
+        WakeEvent,          // caller's event was signaled
+        Timeout,
+        Disarmed,           // service deleted / handle lost; call Arm() again later
+    };
+
+    struct Stats {
+        uint64_t statusNotifications = 0;
+        uint64_t configNotifications = 0;
+        uint64_t rearms = 0;            // successful Arm() calls
+        uint64_t queries = 0;
+    };
+
+    explicit ServiceStateWatcher(std::wstring serviceName);
+    ~ServiceStateWatcher();
+
+    ServiceStateWatcher(const ServiceStateWatcher&) = delete;
+    ServiceStateWatcher& operator=(const ServiceStateWatcher&) = delete;
+
+    // Opens the handles and arms both notifications. Returns false when the service does not
+    // exist or cannot be opened; the watcher stays disarmed.
+    bool Arm();
+    bool IsArmed() const { return service_ != nullptr; }
+
+    // Current state through the cached handle. Fails when disarmed.
+    bool Query(State& out);
+
+    WakeReason Wait(HANDLE wakeEvent, DWORD timeoutMs);
+
+    Stats GetStats() const { return stats_; }
+
+private:
+    static void CALLBACK OnStatusChange(void* context);
+
+    // Arms the status notification for every state except lastState: if the service already
+    // moved on, the notification fires immediately, so no transition is lost between arming and
+    // the previous query.
+    bool ArmStatusNotify(DWORD lastState);
+    bool ArmRegistryNotify();
+    void Disarm();
+
+    const std::wstring serviceName_;
+    SC_HANDLE scm_ = nullptr;
+    SC_HANDLE service_ = nullptr;
+    HKEY serviceKey_ = nullptr;
+    HANDLE registryEvent_ = nullptr;
+
+    SERVICE_NOTIFYW notify_{};
+    bool statusFired_ = false;      // set by the APC, consumed by Wait()
+    bool armFailureLogged_ = false;
+
+    std::vector<BYTE> configBuf_;   // QueryServiceConfigW buffer, reused across queries
+
+    Stats stats_;
+};
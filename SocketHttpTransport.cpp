@@ -0,0 +1,467 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#include "SocketHttpTransport.h"
+#include "DebugLog.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define closesocket close
+#endif
+
+// A peer that resets the connection must not raise SIGPIPE (POSIX).
+#ifdef MSG_NOSIGNAL
+#define HK_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define HK_SEND_FLAGS 0
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    static double ElapsedMs(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    static std::string NarrowAscii(const std::wstring& ws)
+    {
+        std::string s;
+        s.reserve(ws.size());
+        for (wchar_t ch : ws) {
+            s.push_back((ch >= 0x20 && ch < 0x7F) ? static_cast<char>(ch) : '?');
+        }
+        return s;
+    }
+
+    static char AsciiLower(char ch)
+    {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    }
+
+    static bool StartsWithNoCase(const std::string& s, size_t pos, const char* prefix)
+    {
+        const size_t n = std::strlen(prefix);
+        if (s.size() - pos < n) {
+            return false;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (AsciiLower(s[pos + i]) != AsciiLower(prefix[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Accepts "http://host[:port][/prefix]". The optional prefix is prepended to the request path.
+    static bool ParseHttpUrl(const std::string& url, std::string& host, std::string& port, std::string& pathPrefix)
+    {
+        if (!StartsWithNoCase(url, 0, "http://")) {
+            return false;
+        }
+        const size_t hostBegin = 7;
+        size_t hostEnd = url.find('/', hostBegin);
+        if (hostEnd == std::string::npos) {
+            hostEnd = url.size();
+        }
+        std::string authority = url.substr(hostBegin, hostEnd - hostBegin);
+        pathPrefix = url.substr(hostEnd);
+        while (!pathPrefix.empty() && pathPrefix.back() == '/') {
+            pathPrefix.pop_back();
+        }
+
+        port = "80";
+        if (!authority.empty() && authority[0] == '[') {
+            const size_t close = authority.find(']');
+            if (close == std::string::npos) {
+                return false;
+            }
+            host = authority.substr(1, close - 1);
+            if (close + 1 < authority.size() && authority[close + 1] == ':') {
+                port = authority.substr(close + 2);
+            }
+        } else {
+            const size_t colon = authority.rfind(':');
+            if (colon != std::string::npos) {
+                host = authority.substr(0, colon);
+                port = authority.substr(colon + 1);
+            } else {
+                host = authority;
+            }
+        }
+        return !host.empty() && !port.empty();
+    }
+
+    static void SetSocketTimeout(SOCKET sock, int option, int timeoutMs)
+    {
+#ifdef _WIN32
+        DWORD tv = static_cast<DWORD>(timeoutMs);
+#else
+        timeval tv;
+        tv.tv_sec = timeoutMs / 1000;
+        tv.tv_usec = (timeoutMs % 1000) * 1000;
+#endif
+        setsockopt(sock, SOL_SOCKET, option, reinterpret_cast<const char*>(&tv), sizeof(tv));
+    }
+
+    static void SetSocketTimeouts(SOCKET sock, int timeoutMs)
+    {
+        SetSocketTimeout(sock, SO_RCVTIMEO, timeoutMs);
+        SetSocketTimeout(sock, SO_SNDTIMEO, timeoutMs);
+
+        int noDelay = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+    }
+
+    static void SetNonBlocking(SOCKET sock, bool nonBlocking)
+    {
+#ifdef _WIN32
+        u_long mode = nonBlocking ? 1 : 0;
+        ioctlsocket(sock, FIONBIO, &mode);
+#else
+        const int flags = fcntl(sock, F_GETFL, 0);
+        fcntl(sock, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+    }
+
+    // connect() bounded by the request deadline: a blocking connect to an unreachable host waits
+    // for the OS SYN retries (about 20 s on Windows, minutes on Linux), not timeoutMs.
+    static bool ConnectBefore(SOCKET sock, const sockaddr* addr, int addrLen, Clock::time_point deadline)
+    {
+        SetNonBlocking(sock, true);
+        bool connected = (connect(sock, addr, addrLen) == 0);
+#ifdef _WIN32
+        const bool pending = !connected && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        const bool pending = !connected && errno == EINPROGRESS;
+#endif
+        while (pending) {
+            const long long remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (remainingMs <= 0) {
+                break;
+            }
+#ifdef _WIN32
+            // select rather than WSAPoll, which does not report a failed connect on older Windows.
+            fd_set writable;
+            fd_set failed;
+            FD_ZERO(&writable);
+            FD_ZERO(&failed);
+            FD_SET(sock, &writable);
+            FD_SET(sock, &failed);
+            timeval tv;
+            tv.tv_sec = static_cast<long>(remainingMs / 1000);
+            tv.tv_usec = static_cast<long>((remainingMs % 1000) * 1000);
+            const int ready = select(0, nullptr, &writable, &failed, &tv);
+            if (ready == SOCKET_ERROR) {
+                break;
+            }
+            if (ready == 0) {
+                continue;   // timed out: the deadline check above ends the loop
+            }
+            connected = FD_ISSET(sock, &writable) && !FD_ISSET(sock, &failed);
+            break;
+#else
+            pollfd pfd;
+            pfd.fd = sock;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            const int ready = poll(&pfd, 1, static_cast<int>(remainingMs));
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            if (ready == 0) {
+                continue;   // timed out: the deadline check above ends the loop
+            }
+            int error = 0;
+            socklen_t len = sizeof(error);
+            connected = getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+            break;
+#endif
+        }
+        SetNonBlocking(sock, false);
+        return connected;
+    }
+
+    static bool SendAll(SOCKET sock, const char* data, size_t len)
+    {
+        size_t sentTotal = 0;
+        while (sentTotal < len) {
+            const int chunk = static_cast<int>((len - sentTotal) > 0x10000 ? 0x10000 : (len - sentTotal));
+            const int sent = send(sock, data + sentTotal, chunk, HK_SEND_FLAGS);
+            if (sent == SOCKET_ERROR || sent == 0) {
+                return false;
+            }
+            sentTotal += static_cast<size_t>(sent);
+        }
+        return true;
+    }
+
+    // Decodes a chunked body in place. Returns false when the encoding is truncated or malformed.
+    static bool DecodeChunked(const std::string& in, std::string& out)
+    {
+        out.clear();
+        size_t pos = 0;
+        while (pos < in.size()) {
+            const size_t lineEnd = in.find("\r\n", pos);
+            if (lineEnd == std::string::npos) {
+                return false;
+            }
+            char* end = nullptr;
+            const unsigned long size = std::strtoul(in.c_str() + pos, &end, 16);
+            if (end == in.c_str() + pos) {
+                return false;
+            }
+            pos = lineEnd + 2;
+            if (size == 0) {
+                return true;
+            }
+            // size comes from the peer and may be anything up to ULONG_MAX: compare before adding.
+            if (size > in.size() - pos || in.size() - pos - size < 2) {
+                return false;
+            }
+            out.append(in, pos, size);
+            pos += size + 2;
+        }
+        return false;
+    }
+}
+
+SocketHttpTransport::SocketHttpTransport(int timeoutMs, size_t maxResponseBytes)
+    : timeoutMs_(timeoutMs)
+    , maxResponseBytes_(maxResponseBytes)
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    socketsReady_ = (WSAStartup(MAKEWORD(2, 2), &wsaData) == 0);
+    if (!socketsReady_) {
+        DebugLog("SocketHttpTransport: WSAStartup failed.");
+    }
+#else
+    socketsReady_ = true;
+#endif
+}
+
+SocketHttpTransport::~SocketHttpTransport()
+{
+#ifdef _WIN32
+    if (socketsReady_) {
+        WSACleanup();
+    }
+#endif
+}
+
+HttpJsonResult SocketHttpTransport::PostJson(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody)
+{
+    HttpJsonResult r;
+    HttpRequestTiming timing;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point deadline = start + std::chrono::milliseconds(timeoutMs_);
+
+    auto finish = [&](bool ok) {
+        timing.totalMs = ElapsedMs(start, Clock::now());
+        std::lock_guard<std::mutex> lock(statsMutex_);
+        ++stats_.requests;
+        if (ok) ++stats_.newConnections;
+        else ++stats_.failures;
+        stats_.last = timing;
+    };
+
+    std::string host;
+    std::string port;
+    std::string pathPrefix;
+    if (!socketsReady_ || !ParseHttpUrl(NarrowAscii(baseUrl), host, port, pathPrefix)) {
+        DebugLog("SocketHttpTransport: unsupported base URL (only http:// is supported).");
+        finish(false);
+        return r;
+    }
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* addrs = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs) != 0 || !addrs) {
+        DebugLog("SocketHttpTransport: getaddrinfo failed for " + host);
+        finish(false);
+        return r;
+    }
+    const Clock::time_point resolved = Clock::now();
+    timing.dnsMs = ElapsedMs(start, resolved);
+
+    SOCKET sock = INVALID_SOCKET;
+    for (addrinfo* ai = addrs; ai; ai = ai->ai_next) {
+        sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock == INVALID_SOCKET) {
+            continue;
+        }
+        SetSocketTimeouts(sock, timeoutMs_);
+        if (ConnectBefore(sock, ai->ai_addr, static_cast<int>(ai->ai_addrlen), deadline)) {
+            break;
+        }
+        closesocket(sock);
+        sock = INVALID_SOCKET;
+    }
+    freeaddrinfo(addrs);
+
+    if (sock == INVALID_SOCKET) {
+        DebugLog("SocketHttpTransport: connect failed for " + host + ":" + port);
+        finish(false);
+        return r;
+    }
+    const Clock::time_point connected = Clock::now();
+    timing.connectMs = ElapsedMs(resolved, connected);
+
+    std::string request;
+    request.reserve(256 + jsonBody.size());
+    request += "POST ";
+    request += pathPrefix;
+    request += NarrowAscii(path);
+    request += " HTTP/1.1\r\nHost: ";
+    request += host;
+    if (port != "80") {
+        request += ":";
+        request += port;
+    }
+    request += "\r\nUser-Agent: HayateKomorebi/1.0\r\nContent-Type: application/json\r\nAccept: application/json\r\nContent-Length: ";
+    request += std::to_string(jsonBody.size());
+    request += "\r\nConnection: close\r\n\r\n";
+    request += jsonBody;
+
+    if (!SendAll(sock, request.data(), request.size())) {
+        DebugLog("SocketHttpTransport: send failed.");
+        closesocket(sock);
+        finish(false);
+        return r;
+    }
+
+    // timeoutMs_ bounds the whole exchange: each recv only gets what is left of it, so a server
+    // that keeps dribbling bytes cannot hold the caller past the deadline.
+    std::string response;
+    size_t headerEnd = std::string::npos;
+    char buf[4096];
+    for (;;) {
+        const long long remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        if (remainingMs <= 0) {
+            DebugLog("SocketHttpTransport: response not complete within " + std::to_string(timeoutMs_) + " ms.");
+            closesocket(sock);
+            finish(false);
+            return r;
+        }
+        SetSocketTimeout(sock, SO_RCVTIMEO, static_cast<int>(remainingMs));
+
+        const int received = recv(sock, buf, static_cast<int>(sizeof(buf)), 0);
+        if (received == SOCKET_ERROR) {
+            DebugLog("SocketHttpTransport: recv failed or timed out.");
+            closesocket(sock);
+            finish(false);
+            return r;
+        }
+        if (received == 0) {
+            break;
+        }
+        if (response.size() + static_cast<size_t>(received) > maxResponseBytes_) {
+            DebugLog("SocketHttpTransport: response exceeds " + std::to_string(maxResponseBytes_) + " bytes.");
+            closesocket(sock);
+            finish(false);
+            return r;
+        }
+        response.append(buf, static_cast<size_t>(received));
+        if (headerEnd == std::string::npos) {
+            headerEnd = response.find("\r\n\r\n");
+            if (headerEnd != std::string::npos) {
+                timing.ttfbMs = ElapsedMs(connected, Clock::now());
+            }
+        }
+    }
+    closesocket(sock);
+
+    if (headerEnd == std::string::npos || response.compare(0, 5, "HTTP/") != 0) {
+        DebugLog("SocketHttpTransport: malformed HTTP response.");
+        finish(false);
+        return r;
+    }
+
+    const size_t statusPos = response.find(' ');
+    if (statusPos == std::string::npos || statusPos > headerEnd) {
+        DebugLog("SocketHttpTransport: missing status line.");
+        finish(false);
+        return r;
+    }
+    const uint32_t statusCode = static_cast<uint32_t>(std::strtoul(response.c_str() + statusPos + 1, nullptr, 10));
+
+    bool chunked = false;
+    long long contentLength = -1;
+    size_t lineBegin = response.find("\r\n") + 2;
+    while (lineBegin < headerEnd) {
+        size_t lineEnd = response.find("\r\n", lineBegin);
+        if (lineEnd == std::string::npos || lineEnd > headerEnd) {
+            lineEnd = headerEnd;
+        }
+        if (StartsWithNoCase(response, lineBegin, "content-length:")) {
+            contentLength = std::strtoll(response.c_str() + lineBegin + 15, nullptr, 10);
+        } else if (StartsWithNoCase(response, lineBegin, "transfer-encoding:")) {
+            const std::string value = response.substr(lineBegin + 18, lineEnd - lineBegin - 18);
+            for (size_t i = 0; i + 7 <= value.size(); ++i) {
+                if (StartsWithNoCase(value, i, "chunked")) {
+                    chunked = true;
+                    break;
+                }
+            }
+        }
+        lineBegin = lineEnd + 2;
+    }
+
+    const std::string rawBody = response.substr(headerEnd + 4);
+    if (chunked) {
+        if (!DecodeChunked(rawBody, r.body)) {
+            DebugLog("SocketHttpTransport: truncated chunked body.");
+            finish(false);
+            return r;
+        }
+    } else if (contentLength >= 0) {
+        if (rawBody.size() < static_cast<size_t>(contentLength)) {
+            DebugLog("SocketHttpTransport: truncated body.");
+            finish(false);
+            return r;
+        }
+        r.body = rawBody.substr(0, static_cast<size_t>(contentLength));
+    } else {
+        r.body = rawBody;
+    }
+
+    r.transportOk = true;
+    r.statusCode = statusCode;
+    finish(true);
+    return r;
+}
+
+HttpClientStats SocketHttpTransport::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    return stats_;
+}
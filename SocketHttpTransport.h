@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#include "HttpTransport.h"
+
+// SocketHttpTransport
+// - Plain HTTP/1.1 POST over a blocking TCP socket ("Connection: close", one socket per request).
+// - Only http:// URLs are accepted; there is no TLS. Intended for loopback/dev servers and for
+//   running the activation flow off Windows, where WinHTTP is not available.
+// - Understands Content-Length, chunked and read-until-close response bodies.
+// - timeoutMs bounds the whole request, not each socket call, and a response (headers included)
+//   larger than maxResponseBytes fails the request, so a slow or endless server cannot hold a
+//   worker thread or grow memory without limit.
+class SocketHttpTransport : public IHttpTransport
+{
+public:
+    static constexpr size_t kDefaultMaxResponseBytes = 1024 * 1024;
+
+    explicit SocketHttpTransport(int timeoutMs = 15000, size_t maxResponseBytes = kDefaultMaxResponseBytes);
+    ~SocketHttpTransport();
+
+    SocketHttpTransport(const SocketHttpTransport&) = delete;
+    SocketHttpTransport& operator=(const SocketHttpTransport&) = delete;
+
+    HttpJsonResult PostJson(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody) override;
+
+    HttpClientStats GetStats() const override;
+
+private:
+    const int timeoutMs_;
+    const size_t maxResponseBytes_;
+    bool socketsReady_ = false;
+
+    mutable std::mutex statsMutex_;
+    HttpClientStats stats_;
+};
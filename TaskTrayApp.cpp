@@ -20,6 +20,16 @@
 #include "ModeSyncServer.h"
 #include "DeviceKeyCrypto.h"
 #include "DeviceSignKey.h"
+#include "AsyncHttpClient.h"
+#include "JsonReader.h"
+#include "JsonWriter.h"
+#include "LicenseBlob.h"
+#include "RefreshScheduler.h"
+#include "ServerConfigStore.h"
+#include "MachineIdentity.h"
+#include "ServiceStateWatcher.h"
+#include "TimerScheduler.h"
+#include "NetworkIdentity.h"
 #include <fstream>
 #include <ctime>
 #include <iomanip>
@@ -38,6 +48,7 @@
 #include <QtWidgets/QPushButton>
 #include <QtCore/QMetaObject>
 #include <QtCore/QObject>
+#include <QtCore/QPointer>
 #include <QtCore/Qt>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QEvent>
@@ -110,39 +121,6 @@ protected:
     }
 };
 
-// ServerActivationConfig (v2)
-//
-// IMPORTANT DESIGN CHANGES
-// - Login / passkey / license updates are handled in the dashboard (website).
-// - The tray app never asks for email/password/activation codes.
-// - Device activation uses a short-lived pairing code created in the dashboard.
-// - The tray app stores only opaque device session state:
-//     device_id / refresh_token / license_blob
-// - The device refresh request is authenticated with an Ed25519 signature.
-//   The private key is stored in %ProgramData% protected by DPAPI (LocalMachine).
-struct ServerActivationConfig {
-    std::string serverName;
-
-    // v2 device session state
-    std::string deviceId;               // device_uuid
-    std::string refreshToken;           // opaque refresh token (rotated)
-    std::string licenseBlob;            // server-signed license blob
-    std::string entitlementExpiresAt;   // ISO8601 (optional)
-    std::string lastSuccessRefreshAt;   // ISO8601 local time (optional)
-    bool activated = false;             // enrolled and usable (tokens present)
-    bool licenseBlocked = false;        // server returned license_expired
-
-    // derived device info
-    std::string machineId;
-    std::string lanIp;
-
-    // Legacy fields (migration only; never written)
-    std::string userEmail;
-    std::string password;
-    std::string activationCode;
-    std::string activationExpiresOn;
-};
-
 static void EnsureTrayHostWindowHidden(HWND hwnd) {
     if (!hwnd) {
         return;
@@ -244,423 +222,28 @@ static std::string Trim(const std::string& s) {
     return s.substr(b, e - b);
 }
 
-static std::string ExecCmdCaptureHidden(const std::wstring& cmdLine) {
-    std::string out;
-
-    SECURITY_ATTRIBUTES sa{};
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = TRUE;
-    sa.lpSecurityDescriptor = nullptr;
-
-    HANDLE readPipe = nullptr;
-    HANDLE writePipe = nullptr;
-    if (!CreatePipe(&readPipe, &writePipe, &sa, 0)) {
-        DebugLog("ExecCmdCaptureHidden: CreatePipe failed.");
-        return out;
-    }
-
-    if (!SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0)) {
-        DebugLog("ExecCmdCaptureHidden: SetHandleInformation failed.");
-        CloseHandle(readPipe);
-        CloseHandle(writePipe);
-        return out;
-    }
-
-    STARTUPINFOW si{};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
-    si.wShowWindow = SW_HIDE;
-    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
-    si.hStdOutput = writePipe;
-    si.hStdError = writePipe;
-
-    PROCESS_INFORMATION pi{};
-    std::wstring mutableCmd = cmdLine;
-    if (!CreateProcessW(
-            nullptr,
-            mutableCmd.data(),
-            nullptr,
-            nullptr,
-            TRUE,
-            CREATE_NO_WINDOW,
-            nullptr,
-            nullptr,
-            &si,
-            &pi)) {
-        DebugLog("ExecCmdCaptureHidden: CreateProcessW failed.");
-        CloseHandle(readPipe);
-        CloseHandle(writePipe);
-        return out;
-    }
-
-    CloseHandle(writePipe);
-    writePipe = nullptr;
-
-    char buffer[512];
-    DWORD bytesRead = 0;
-    while (ReadFile(readPipe, buffer, static_cast<DWORD>(sizeof(buffer)), &bytesRead, nullptr) && bytesRead > 0) {
-        out.append(buffer, buffer + bytesRead);
-    }
-
-    WaitForSingleObject(pi.hProcess, 5000);
-
-    CloseHandle(readPipe);
-    CloseHandle(pi.hThread);
-    CloseHandle(pi.hProcess);
-    return out;
-}
-
-static std::string ExtractWmicValue(const std::string& text, const std::string& key) {
-    auto pos = text.find(key + "=");
-    if (pos != std::string::npos) {
-        pos += key.size() + 1;
-        auto end = text.find_first_of("\r\n", pos);
-        if (end == std::string::npos) end = text.size();
-        return Trim(text.substr(pos, end - pos));
-    }
-
-    std::istringstream iss(text);
-    std::string line;
-    while (std::getline(iss, line)) {
-        line = Trim(line);
-        if (line.empty()) continue;
-        if (line.find(key) != std::string::npos) continue;
-        return line;
-    }
-    return "";
-}
-
-static std::string GetRegistryStringValueA(HKEY root, const char* subKey, const char* valueName) {
-    char buffer[512] = {0};
-    DWORD cb = sizeof(buffer);
-    DWORD type = 0;
-    if (RegGetValueA(root, subKey, valueName, RRF_RT_REG_SZ, &type, buffer, &cb) != ERROR_SUCCESS) {
-        return "";
-    }
-    if (cb == 0) {
-        return "";
-    }
-    buffer[sizeof(buffer) - 1] = '\0';
-    return Trim(std::string(buffer));
-}
-
-static std::string GetLegacyMachineId() {
-    std::string cpu = ExecCmdCaptureHidden(L"cmd.exe /d /c wmic cpu get ProcessorId /value 2>nul");
-    std::string uuid = ExecCmdCaptureHidden(L"cmd.exe /d /c wmic csproduct get UUID /value 2>nul");
-
-    std::string cpuId = ExtractWmicValue(cpu, "ProcessorId");
-    std::string sysUuid = ExtractWmicValue(uuid, "UUID");
-    if (cpuId.empty()) cpuId = "UNKNOWNCPU";
-    if (sysUuid.empty()) sysUuid = "UNKNOWNUUID";
-    return cpuId + "-" + sysUuid;
-}
-
-static bool IsPlaceholderMachineId(const std::string& value) {
-    const std::string trimmed = Trim(value);
-    return trimmed.empty()
-        || trimmed == "UNKNOWNCPU-UNKNOWNUUID"
-        || trimmed == "UNKNOWNCPU"
-        || trimmed == "UNKNOWNUUID";
-}
-
-static std::string HexEncodeUpper(uint64_t value) {
-    std::ostringstream oss;
-    oss << std::uppercase << std::hex << std::setw(16) << std::setfill('0') << value;
-    return oss.str();
-}
-
-static std::string Fnv1a64Hex(const std::string& text) {
-    uint64_t hash = 1469598103934665603ull;
-    for (unsigned char ch : text) {
-        hash ^= static_cast<uint64_t>(ch);
-        hash *= 1099511628211ull;
-    }
-    return HexEncodeUpper(hash);
-}
-
-static std::string GetPrimaryMacAddress() {
-    ULONG bufLen = 0;
-    GetAdaptersAddresses(AF_UNSPEC, GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER, nullptr, nullptr, &bufLen);
-    if (bufLen == 0) return "";
-    std::vector<unsigned char> buf(bufLen);
-    IP_ADAPTER_ADDRESSES* addrs = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buf.data());
-    if (GetAdaptersAddresses(AF_UNSPEC, GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER, nullptr, addrs, &bufLen) != NO_ERROR) {
-        return "";
-    }
-
-    for (auto* a = addrs; a; a = a->Next) {
-        if (a->OperStatus != IfOperStatusUp) continue;
-        if (a->IfType == IF_TYPE_SOFTWARE_LOOPBACK) continue;
-        if (a->PhysicalAddressLength == 0) continue;
-        std::ostringstream oss;
-        for (ULONG i = 0; i < a->PhysicalAddressLength; ++i) {
-            if (i) oss << ':';
-            oss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<unsigned int>(a->PhysicalAddress[i]);
-        }
-        return oss.str();
-    }
-    return "";
-}
-
-static std::string GetStableFallbackMachineSeed() {
-    std::vector<std::string> parts;
-
-    const std::string machineGuid = GetRegistryStringValueA(HKEY_LOCAL_MACHINE, "SOFTWARE\\Microsoft\\Cryptography", "MachineGuid");
-    if (!machineGuid.empty()) parts.push_back("MachineGuid=" + machineGuid);
-
-    const std::string sqmcMachineId = GetRegistryStringValueA(HKEY_LOCAL_MACHINE, "SOFTWARE\\Microsoft\\SQMClient", "MachineId");
-    if (!sqmcMachineId.empty()) parts.push_back("SqmMachineId=" + sqmcMachineId);
-
-    const std::string baseBoard = ExtractWmicValue(ExecCmdCaptureHidden(L"cmd.exe /d /c wmic baseboard get SerialNumber /value 2>nul"), "SerialNumber");
-    if (!baseBoard.empty()) parts.push_back("BaseBoard=" + baseBoard);
-
-    const std::string biosSerial = ExtractWmicValue(ExecCmdCaptureHidden(L"cmd.exe /d /c wmic bios get SerialNumber /value 2>nul"), "SerialNumber");
-    if (!biosSerial.empty()) parts.push_back("BiosSerial=" + biosSerial);
-
-    char computerName[MAX_COMPUTERNAME_LENGTH + 1] = {0};
-    DWORD computerNameLen = MAX_COMPUTERNAME_LENGTH + 1;
-    if (GetComputerNameA(computerName, &computerNameLen) && computerName[0] != '\0') {
-        parts.push_back(std::string("ComputerName=") + computerName);
-    }
-
-    const std::string mac = GetPrimaryMacAddress();
-    if (!mac.empty()) parts.push_back("Mac=" + mac);
-
-    char windowsDir[MAX_PATH] = {0};
-    if (GetWindowsDirectoryA(windowsDir, MAX_PATH) > 0) {
-        char volumeRoot[MAX_PATH] = {0};
-        strncpy_s(volumeRoot, windowsDir, 3);
-        DWORD volumeSerial = 0;
-        if (GetVolumeInformationA(volumeRoot, nullptr, 0, &volumeSerial, nullptr, nullptr, nullptr, 0)) {
-            parts.push_back("VolumeSerial=" + HexEncodeUpper(volumeSerial));
-        }
-    }
-
-    if (parts.empty()) {
-        parts.push_back("Fallback=HayateKomorebi");
-    }
-
-    std::ostringstream oss;
-    for (size_t i = 0; i < parts.size(); ++i) {
-        if (i) oss << '|';
-        oss << parts[i];
-    }
-    return oss.str();
-}
-
-static std::string GetMachineId() {
-    const std::string legacy = GetLegacyMachineId();
-    if (!IsPlaceholderMachineId(legacy)) {
-        return legacy;
-    }
-
-    const std::string seed = GetStableFallbackMachineSeed();
-    const std::string derived = "MID-" + Fnv1a64Hex(seed);
-    DebugLog(std::string("GetMachineId: using fallback machine id ") + derived + " because CPU/UUID lookup was unavailable.");
-    return derived;
-}
-
-static std::string GetLanIpv4() {
-    ULONG bufLen = 0;
-    GetAdaptersAddresses(AF_INET, GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER, nullptr, nullptr, &bufLen);
-    if (bufLen == 0) return "";
-    std::vector<unsigned char> buf(bufLen);
-    IP_ADAPTER_ADDRESSES* addrs = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buf.data());
-    DWORD ret = GetAdaptersAddresses(AF_INET, GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER, nullptr, addrs, &bufLen);
-    if (ret != NO_ERROR) return "";
-    for (auto* a = addrs; a; a = a->Next) {
-        if (a->OperStatus != IfOperStatusUp) continue;
-        for (auto* ua = a->FirstUnicastAddress; ua; ua = ua->Next) {
-            if (!ua->Address.lpSockaddr) continue;
-            if (ua->Address.lpSockaddr->sa_family != AF_INET) continue;
-            SOCKADDR_IN* sin = reinterpret_cast<SOCKADDR_IN*>(ua->Address.lpSockaddr);
-            char ip[INET_ADDRSTRLEN] = {0};
-            inet_ntop(AF_INET, &sin->sin_addr, ip, sizeof(ip));
-            std::string s(ip);
-            if (s.rfind("169.254.", 0) == 0) continue; // skip APIPA
-            if (s == "127.0.0.1") continue;
-            return s;
-        }
-    }
-    return "";
-}
-
-static bool DpapiEncrypt(const std::string& plain, const std::string& entropy, std::string& outCipher) {
-    DATA_BLOB inBlob{0};
-    inBlob.pbData = (BYTE*)plain.data();
-    inBlob.cbData = (DWORD)plain.size();
-
-    DATA_BLOB entBlob{0};
-    entBlob.pbData = (BYTE*)entropy.data();
-    entBlob.cbData = (DWORD)entropy.size();
-
-    DATA_BLOB outBlob{0};
-    if (!CryptProtectData(&inBlob, L"HayateKomorebi", &entBlob, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &outBlob)) {
-        return false;
-    }
-    outCipher.assign((char*)outBlob.pbData, (size_t)outBlob.cbData);
-    LocalFree(outBlob.pbData);
-    return true;
-}
-
-static bool DpapiDecrypt(const std::string& cipher, const std::string& entropy, std::string& outPlain) {
-    DATA_BLOB inBlob{0};
-    inBlob.pbData = (BYTE*)cipher.data();
-    inBlob.cbData = (DWORD)cipher.size();
-
-    DATA_BLOB entBlob{0};
-    entBlob.pbData = (BYTE*)entropy.data();
-    entBlob.cbData = (DWORD)entropy.size();
-
-    DATA_BLOB outBlob{0};
-    LPWSTR desc = nullptr;
-    if (!CryptUnprotectData(&inBlob, &desc, &entBlob, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &outBlob)) {
-        if (desc) LocalFree(desc);
-        return false;
-    }
-    if (desc) LocalFree(desc);
-    outPlain.assign((char*)outBlob.pbData, (size_t)outBlob.cbData);
-    LocalFree(outBlob.pbData);
-    return true;
-}
-
-static std::string SerializeConfig(const ServerActivationConfig& c) {
-    std::ostringstream oss;
-
-    // Always persist ServerName (required before activation is allowed).
-    oss << "ServerName=" << c.serverName << "\n";
-
-    // File minimization:
-    // If NOT activated and all v2 secrets are cleared, keep only ServerName in the file.
-    const bool secretsEmpty =
-        c.deviceId.empty() &&
-        c.refreshToken.empty() &&
-        c.licenseBlob.empty() &&
-        c.entitlementExpiresAt.empty() &&
-        c.lastSuccessRefreshAt.empty() &&
-        c.machineId.empty() &&
-        c.lanIp.empty();
-
-    if (!c.activated && secretsEmpty) {
-        return oss.str();
-    }
-
-    if (!c.deviceId.empty())             oss << "DeviceId=" << c.deviceId << "\n";
-    if (!c.refreshToken.empty())         oss << "RefreshToken=" << c.refreshToken << "\n";
-    if (!c.licenseBlob.empty())          oss << "LicenseBlob=" << c.licenseBlob << "\n";
-    if (!c.entitlementExpiresAt.empty()) oss << "EntitlementExpiresAt=" << c.entitlementExpiresAt << "\n";
-    if (!c.lastSuccessRefreshAt.empty()) oss << "LastSuccessRefreshAt=" << c.lastSuccessRefreshAt << "\n";
-    if (!c.machineId.empty())            oss << "MachineId=" << c.machineId << "\n";
-    if (!c.lanIp.empty())                oss << "LanIp=" << c.lanIp << "\n";
-    oss << "LicenseBlocked=" << (c.licenseBlocked ? "1" : "0") << "\n";
-
-    // Keep an explicit Activated field when secrets exist (or activated).
-    oss << "Activated=" << (c.activated ? "1" : "0") << "\n";
-    return oss.str();
-}
-
-static ServerActivationConfig ParseConfig(const std::string& text) {
-    ServerActivationConfig c;
-    std::istringstream iss(text);
-    std::string line;
-    while (std::getline(iss, line)) {
-        line = Trim(line);
-        if (line.empty()) continue;
-        auto eq = line.find('=');
-        if (eq == std::string::npos) continue;
-        std::string k = line.substr(0, eq);
-        std::string v = line.substr(eq + 1);
-        if (k == "ServerName") c.serverName = v;
-        else if (k == "DeviceId") c.deviceId = v;
-        else if (k == "RefreshToken") c.refreshToken = v;
-        else if (k == "LicenseBlob") c.licenseBlob = v;
-        else if (k == "EntitlementExpiresAt") c.entitlementExpiresAt = v;
-        else if (k == "LastSuccessRefreshAt") c.lastSuccessRefreshAt = v;
-        else if (k == "MachineId") c.machineId = v;
-        else if (k == "LanIp") c.lanIp = v;
-        else if (k == "LicenseBlocked") c.licenseBlocked = (v == "1");
-        else if (k == "Activated") c.activated = (v == "1");
-        // Legacy (migration)
-        else if (k == "UserEmail") c.userEmail = v;
-        else if (k == "Password") c.password = v;
-        else if (k == "ActivationCode") c.activationCode = v;
-        else if (k == "ActivationExpiresOn") c.activationExpiresOn = v;
-    }
-    return c;
+// One store per process; the watcher is started in Initialize() and stopped in Cleanup().
+static ServerConfigStore& GetServerConfigStore() {
+    static ServerConfigStore store(GetServerConfigPath(), &MachineIdentity::GetMachineId, &MachineIdentity::GetPreviousMachineIds);
+    return store;
 }
 
-static bool SaveServerConfig(const ServerActivationConfig& cfg); // forward declaration
-
 static bool LoadServerConfig(ServerActivationConfig& out) {
-    auto path = GetServerConfigPath();
-    if (!std::filesystem::exists(path)) {
+    const ServerConfigStore::Snapshot snapshot = GetServerConfigStore().Load();
+    if (!snapshot) {
         return false;
     }
-    std::ifstream ifs(path, std::ios::binary);
-    if (!ifs) return false;
-    std::string cipher((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-    if (cipher.empty()) return false;
-
-    // Decrypt using the preferred hardware-derived MachineId, but also accept the legacy
-    // UNKNOWNCPU-UNKNOWNUUID-based entropy so existing installs can be migrated in place.
-    const std::string preferredMachineId = GetMachineId();
-    const std::string legacyMachineId = GetLegacyMachineId();
-    std::string plain;
-    if (!DpapiDecrypt(cipher, preferredMachineId, plain)) {
-        if (legacyMachineId == preferredMachineId || !DpapiDecrypt(cipher, legacyMachineId, plain)) {
-            return false;
-        }
-    }
-
-    out = ParseConfig(plain);
-
-    // One-time migration: if legacy activation fields exist, wipe them.
-    // The old activation scheme is no longer supported; user must re-enroll via pairing code.
-    if (!out.userEmail.empty() || !out.password.empty() || !out.activationCode.empty() || !out.activationExpiresOn.empty()) {
-        DebugLog("LoadServerConfig: legacy activation fields detected. Clearing and requiring re-enroll.");
-        out.userEmail.clear();
-        out.password.clear();
-        out.activationCode.clear();
-        out.activationExpiresOn.clear();
-        out.deviceId.clear();
-        out.refreshToken.clear();
-        out.licenseBlob.clear();
-        out.entitlementExpiresAt.clear();
-        out.lastSuccessRefreshAt.clear();
-        out.licenseBlocked = false;
-        out.activated = false;
-        // Persist the migrated state best-effort.
-        (void)SaveServerConfig(out);
-    }
+    out = *snapshot;
 
     // Ensure derived fields exist even when config file is minimized.
-    if (out.machineId.empty() || IsPlaceholderMachineId(out.machineId)) out.machineId = preferredMachineId;
-    if (out.lanIp.empty()) out.lanIp = GetLanIpv4();
+    if (out.machineId.empty() || MachineIdentity::IsPlaceholderMachineId(out.machineId)) out.machineId = MachineIdentity::GetMachineId();
+    if (out.lanIp.empty()) out.lanIp = NetworkIdentity::GetLanIpv4();
     return true;
 }
 
-static bool SaveServerConfig(const ServerActivationConfig& cfg) {
-    auto dir = GetRoamingDir(L"Server");
-    std::error_code ec;
-    std::filesystem::create_directories(dir, ec);
-    (void)ec;
-    auto path = GetServerConfigPath();
-
-    std::string plain = SerializeConfig(cfg);
-    std::string cipher;
-
-    // Encryption entropy is derived from hardware MachineId (CPU + motherboard UUID).
-    // This allows the config file to omit MachineId when minimized.
-    const std::string entropy = GetMachineId();
-    if (!DpapiEncrypt(plain, entropy, cipher)) {
-        return false;
-    }
-
-    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
-    if (!ofs) return false;
-    ofs.write(cipher.data(), (std::streamsize)cipher.size());
-    return ofs.good();
+static bool SaveServerConfig(const ServerActivationConfig& cfg,
+    ServerConfigStore::Durability durability = ServerConfigStore::Durability::Immediate) {
+    return GetServerConfigStore().Save(cfg, durability);
 }
 
 static std::wstring GetEnvW(const wchar_t* name, const std::wstring& def) {
@@ -952,278 +535,115 @@ static bool EnforceManagedServicePolicy(const std::wstring& serviceName, Managed
     return ok;
 }
 
-static ManagedServicePolicy DetermineManagedServicePolicy(const ServerActivationConfig& cfg) {
-    const bool usable =
-        cfg.activated &&
-        !cfg.licenseBlocked &&
-        !cfg.serverName.empty() &&
-        !cfg.deviceId.empty() &&
-        !cfg.refreshToken.empty();
-
-    return usable ? ManagedServicePolicy::StandbyState : ManagedServicePolicy::InstallState;
+// Enrolled, not blocked and holding the session state a refresh needs. licenseBlocked is set by
+// the server's license_expired answer or, offline, by the poll job once the verified license_blob
+// has run out.
+static bool IsConfigUsable(const ServerConfigStore::Status& status) {
+    return status.activated &&
+        !status.licenseBlocked &&
+        status.hasServerName &&
+        status.hasDeviceId &&
+        status.hasRefreshToken;
 }
 
-static std::string Win32ErrorToString(DWORD err) {
-    LPSTR msg = nullptr;
-    const DWORD flags = FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS;
-    const DWORD n = FormatMessageA(flags, nullptr, err, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&msg, 0, nullptr);
-    std::string s;
-    if (n && msg) {
-        s.assign(msg, n);
-        while (!s.empty() && (s.back() == '\r' || s.back() == '\n' || s.back() == ' ' || s.back() == '\t')) {
-            s.pop_back();
-        }
-    } else {
-        s = "Unknown error";
-    }
-    if (msg) LocalFree(msg);
-    return s;
+static ManagedServicePolicy DetermineManagedServicePolicy(const ServerConfigStore::Status& status) {
+    return IsConfigUsable(status) ? ManagedServicePolicy::StandbyState : ManagedServicePolicy::InstallState;
 }
 
-static void DebugLogWinHttpFailure(const char* stage) {
-    const DWORD err = GetLastError();
-    DebugLog(std::string(stage) + " failed. GetLastError=" + std::to_string(err) + " (" + Win32ErrorToString(err) + ")");
-}
-
-static bool WinHttpPostJson(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody, std::string& outResponse) {
-    outResponse.clear();
-
-    URL_COMPONENTS uc;
-    ZeroMemory(&uc, sizeof(uc));
-    uc.dwStructSize = sizeof(uc);
-    uc.dwSchemeLength = (DWORD)-1;
-    uc.dwHostNameLength = (DWORD)-1;
-    uc.dwUrlPathLength = (DWORD)-1;
-    uc.dwExtraInfoLength = (DWORD)-1;
-
-    std::wstring url = baseUrl;
-    if (!WinHttpCrackUrl(url.c_str(), (DWORD)url.size(), 0, &uc)) {
-        DebugLogWinHttpFailure("WinHttpCrackUrl");
-        return false;
-    }
-
-    std::wstring host(uc.lpszHostName, uc.dwHostNameLength);
-    INTERNET_PORT port = uc.nPort;
-    bool isHttps = (uc.nScheme == INTERNET_SCHEME_HTTPS);
-
-    HINTERNET hSession = WinHttpOpen(L"HayateKomorebi/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-    if (!hSession) {
-        DebugLogWinHttpFailure("WinHttpOpen");
+// True when the observed service state already satisfies the policy. Pending transitions towards
+// the desired state count as satisfied; the watcher reports the final state when it is reached.
+static bool ServiceStateSatisfiesPolicy(const ServiceStateWatcher::State& state, ManagedServicePolicy policy) {
+    const DWORD desiredStartType = (policy == ManagedServicePolicy::InstallState) ? SERVICE_DEMAND_START : SERVICE_AUTO_START;
+    if (state.startType != desiredStartType) {
         return false;
     }
-
-    const int timeoutMs = 15000;
-    if (!WinHttpSetTimeouts(hSession, timeoutMs, timeoutMs, timeoutMs, timeoutMs)) {
-        DebugLogWinHttpFailure("WinHttpSetTimeouts");
-    }
-
-    HINTERNET hConnect = WinHttpConnect(hSession, host.c_str(), port, 0);
-    if (!hConnect) {
-        DebugLogWinHttpFailure("WinHttpConnect");
-        WinHttpCloseHandle(hSession);
-        return false;
+    if (policy == ManagedServicePolicy::StandbyState) {
+        return state.currentState == SERVICE_RUNNING || state.currentState == SERVICE_START_PENDING;
     }
+    return state.currentState == SERVICE_STOPPED || state.currentState == SERVICE_STOP_PENDING;
+}
 
-    DWORD flags = WINHTTP_FLAG_REFRESH;
-    if (isHttps) flags |= WINHTTP_FLAG_SECURE;
-
-    HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"POST", path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-    if (!hRequest) {
-        DebugLogWinHttpFailure("WinHttpOpenRequest");
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
-    }
+static std::string NowIsoLocal() {
+    const auto now = std::chrono::system_clock::now();
+    const std::time_t t = std::chrono::system_clock::to_time_t(now);
+    std::tm tm{};
+    localtime_s(&tm, &t);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S");
+    return oss.str();
+}
 
-    const wchar_t* hdrs = L"Content-Type: application/json\r\nAccept: application/json\r\n";
-    BOOL b = WinHttpSendRequest(hRequest, hdrs, (DWORD)-1L, (LPVOID)jsonBody.data(), (DWORD)jsonBody.size(), (DWORD)jsonBody.size(), 0);
-    if (!b) {
-        DebugLogWinHttpFailure("WinHttpSendRequest");
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
-    }
+// Nonce obtained ahead of a refresh, used once for the next refresh of the same device.
+struct PrefetchedNonce {
+    std::string deviceId;
+    std::string nonceId;
+    std::string nonce;
+    std::chrono::steady_clock::time_point expiresAt{};
 
-    b = WinHttpReceiveResponse(hRequest, nullptr);
-    if (!b) {
-        DebugLogWinHttpFailure("WinHttpReceiveResponse");
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return false;
+    void Clear() {
+        deviceId.clear();
+        nonceId.clear();
+        nonce.clear();
+        expiresAt = std::chrono::steady_clock::time_point{};
     }
 
-    DWORD statusCode = 0;
-    DWORD statusCodeSize = sizeof(statusCode);
-    if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &statusCodeSize, WINHTTP_NO_HEADER_INDEX)) {
-        DebugLogWinHttpFailure("WinHttpQueryHeaders(STATUS_CODE)");
-        statusCode = 0;
+    // True if the nonce belongs to forDevice and still has a few seconds of life left at `at`.
+    bool UsableAt(const std::string& forDevice, std::chrono::steady_clock::time_point at) const {
+        return !nonceId.empty() && !nonce.empty() && deviceId == forDevice &&
+            at + std::chrono::seconds(5) < expiresAt;
     }
 
-    DWORD avail = 0;
-    bool readOk = true;
-    do {
-        avail = 0;
-        if (!WinHttpQueryDataAvailable(hRequest, &avail)) {
-            DebugLogWinHttpFailure("WinHttpQueryDataAvailable");
-            readOk = false;
-            break;
-        }
-        if (!avail) break;
-        std::string chunk(avail, '\0');
-        DWORD read = 0;
-        if (!WinHttpReadData(hRequest, chunk.data(), avail, &read)) {
-            DebugLogWinHttpFailure("WinHttpReadData");
-            readOk = false;
-            break;
+    // Hands out the nonce if it is usable now; it is consumed either way.
+    bool Take(const std::string& forDevice, std::chrono::steady_clock::time_point now, std::string& outId, std::string& outNonce) {
+        const bool usable = UsableAt(forDevice, now);
+        if (usable) {
+            outId = nonceId;
+            outNonce = nonce;
         }
-        chunk.resize(read);
-        outResponse += chunk;
-    } while (avail > 0);
-
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
-
-    if (!readOk) {
-        return false;
+        Clear();
+        return usable;
     }
-    if (statusCode < 200 || statusCode >= 300) {
-        DebugLog(std::string("WinHttpPostJson: HTTP status ") + std::to_string(statusCode) + ", response=" + outResponse);
-        return false;
-    }
-    if (outResponse.empty()) {
-        DebugLog("WinHttpPostJson: HTTP response body was empty.");
-        return false;
-    }
-
-    return true;
-}
-
-struct HttpJsonResult {
-    bool transportOk = false;   // WinHTTP succeeded enough to get a status/body
-    DWORD statusCode = 0;
-    std::string body;
 };
 
-// Returns status code + body even on non-2xx responses.
-static HttpJsonResult WinHttpPostJsonEx(const std::wstring& baseUrl, const std::wstring& path, const std::string& jsonBody) {
-    HttpJsonResult r;
-    r.body.clear();
-
-    URL_COMPONENTS uc;
-    ZeroMemory(&uc, sizeof(uc));
-    uc.dwStructSize = sizeof(uc);
-    uc.dwSchemeLength = (DWORD)-1;
-    uc.dwHostNameLength = (DWORD)-1;
-    uc.dwUrlPathLength = (DWORD)-1;
-    uc.dwExtraInfoLength = (DWORD)-1;
-
-    std::wstring url = baseUrl;
-    if (!WinHttpCrackUrl(url.c_str(), (DWORD)url.size(), 0, &uc)) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpCrackUrl");
-        return r;
-    }
-
-    std::wstring host(uc.lpszHostName, uc.dwHostNameLength);
-    INTERNET_PORT port = uc.nPort;
-    bool isHttps = (uc.nScheme == INTERNET_SCHEME_HTTPS);
-
-    HINTERNET hSession = WinHttpOpen(L"HayateKomorebi/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
-    if (!hSession) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpOpen");
-        return r;
-    }
-
-    const int timeoutMs = 15000;
-    (void)WinHttpSetTimeouts(hSession, timeoutMs, timeoutMs, timeoutMs, timeoutMs);
-
-    HINTERNET hConnect = WinHttpConnect(hSession, host.c_str(), port, 0);
-    if (!hConnect) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpConnect");
-        WinHttpCloseHandle(hSession);
-        return r;
-    }
-
-    DWORD flags = WINHTTP_FLAG_REFRESH;
-    if (isHttps) flags |= WINHTTP_FLAG_SECURE;
-
-    HINTERNET hRequest = WinHttpOpenRequest(hConnect, L"POST", path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, flags);
-    if (!hRequest) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpOpenRequest");
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return r;
-    }
-
-    const wchar_t* hdrs = L"Content-Type: application/json\r\nAccept: application/json\r\n";
-    BOOL b = WinHttpSendRequest(hRequest, hdrs, (DWORD)-1L, (LPVOID)jsonBody.data(), (DWORD)jsonBody.size(), (DWORD)jsonBody.size(), 0);
-    if (!b) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpSendRequest");
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return r;
-    }
-
-    b = WinHttpReceiveResponse(hRequest, nullptr);
-    if (!b) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpReceiveResponse");
-        WinHttpCloseHandle(hRequest);
-        WinHttpCloseHandle(hConnect);
-        WinHttpCloseHandle(hSession);
-        return r;
-    }
-
-    DWORD statusCode = 0;
-    DWORD statusCodeSize = sizeof(statusCode);
-    if (!WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &statusCode, &statusCodeSize, WINHTTP_NO_HEADER_INDEX)) {
-        DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpQueryHeaders(STATUS_CODE)");
-        statusCode = 0;
-    }
-
-    DWORD avail = 0;
-    bool readOk = true;
-    do {
-        avail = 0;
-        if (!WinHttpQueryDataAvailable(hRequest, &avail)) {
-            DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpQueryDataAvailable");
-            readOk = false;
-            break;
-        }
-        if (!avail) break;
-        std::string chunk(avail, '\0');
-        DWORD read = 0;
-        if (!WinHttpReadData(hRequest, chunk.data(), avail, &read)) {
-            DebugLogWinHttpFailure("WinHttpPostJsonEx: WinHttpReadData");
-            readOk = false;
-            break;
-        }
-        chunk.resize(read);
-        r.body += chunk;
-    } while (avail > 0);
+// What the activation poll job keeps between runs. Only touched from that job; the timer
+// scheduler never runs a timer concurrently with itself.
+struct ActivationPollState {
+    // Request bodies are built into one buffer and reused across refreshes.
+    JsonWriter body{ 1024 };
+
+    // Nonce for the next refresh, so that the refresh itself is a single round trip. Refreshes are
+    // minutes to hours apart and nonces live about a minute, so the job fetches one from
+    // device_nonce shortly before the planned refresh (TTL from its expires_in). A nonce bundled
+    // with a device_refresh response (want_next_nonce -> next_nonce_id / next_nonce /
+    // next_nonce_expires_in) is kept too, but only survives until a quick retry.
+    PrefetchedNonce prefetched;
+    // NextDue() of the plan a nonce was last fetched ahead for: one attempt per planned refresh.
+    std::chrono::steady_clock::time_point prefetchedFor{};
+
+    RefreshScheduler scheduler;
+    std::string plannedDeviceId;
+
+    // Last offline license_blob verdict, for logging changes only.
+    LicenseBlob::Verdict licenseVerdict = LicenseBlob::Verdict::NoPinnedKey;
+};
 
-    WinHttpCloseHandle(hRequest);
-    WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
+// Progress and result of a control panel enrollment. Produced on worker threads, applied on the
+// Qt GUI thread.
+struct EnrollmentUpdate {
+    enum class Kind { Progress, Succeeded, Failed, Cancelled };
+    Kind kind = Kind::Progress;
+    std::string message;                // Progress: status line; Failed: message box text
+    ServerActivationConfig cfg;         // Succeeded: the enrolled config as saved
+    bool licenseExpired = false;        // Failed with reason "license_expired"
+    std::string entitlementExpiresAt;   // with licenseExpired, when the server sent it
+};
 
-    if (!readOk) {
-        return r;
+// 429 and 5xx are worth retrying soon; other non-2xx answers are definitive for this attempt.
+static RefreshOutcome OutcomeForHttpStatus(uint32_t statusCode) {
+    if (statusCode == 429 || statusCode >= 500) {
+        return RefreshOutcome::Transient;
     }
-    r.transportOk = true;
-    r.statusCode = statusCode;
-    return r;
-}
-
-static std::string NowIsoLocal() {
-    const auto now = std::chrono::system_clock::now();
-    const std::time_t t = std::chrono::system_clock::to_time_t(now);
-    std::tm tm{};
-    localtime_s(&tm, &t);
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S");
-    return oss.str();
+    return RefreshOutcome::Rejected;
 }
 
 static bool ShouldClearSessionForReason(const std::string& reason) {
@@ -1235,61 +655,6 @@ static bool ShouldClearSessionForReason(const std::string& reason) {
            reason == "user_not_found";
 }
 
-static std::string JsonEscape(const std::string& s) {
-    std::ostringstream oss;
-    for (char ch : s) {
-        switch (ch) {
-            case '\\': oss << "\\\\"; break;
-            case '"': oss << "\\\""; break;
-            case '\n': oss << "\\n"; break;
-            case '\r': oss << "\\r"; break;
-            case '\t': oss << "\\t"; break;
-            default:
-                if ((unsigned char)ch < 0x20) {
-                    oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)(unsigned char)ch;
-                } else {
-                    oss << ch;
-                }
-        }
-    }
-    return oss.str();
-}
-
-static bool JsonExtractString(const std::string& json, const std::string& key, std::string& out) {
-    out.clear();
-    std::string pat = "\"" + key + "\"";
-    auto p = json.find(pat);
-    if (p == std::string::npos) return false;
-    p = json.find(':', p + pat.size());
-    if (p == std::string::npos) return false;
-    p++;
-    while (p < json.size() && (json[p] == ' ' || json[p] == '\n' || json[p] == '\r' || json[p] == '\t')) p++;
-    if (p >= json.size() || json[p] != '"') return false;
-    p++;
-    std::ostringstream oss;
-    while (p < json.size()) {
-        char c = json[p++];
-        if (c == '"') {
-            out = oss.str();
-            return true;
-        }
-        if (c == '\\' && p < json.size()) {
-            char e = json[p++];
-            switch (e) {
-                case '"': oss << '"'; break;
-                case '\\': oss << '\\'; break;
-                case 'n': oss << '\n'; break;
-                case 'r': oss << '\r'; break;
-                case 't': oss << '\t'; break;
-                default: oss << e; break;
-            }
-        } else {
-            oss << c;
-        }
-    }
-    return false;
-}
-
 static bool OpenUrlInDefaultBrowser(const std::wstring& rawUrl) {
     std::wstring url = rawUrl;
     // trim whitespace
@@ -1370,17 +735,6 @@ static void ShowActivationMessageBox(QWidget* parent, QMessageBox::Icon icon, co
     box.exec();
 }
 
-static bool JsonContainsTrue(const std::string& json, const std::string& key) {
-    const std::string pat = "\"" + key + "\"";
-    auto p = json.find(pat);
-    if (p == std::string::npos) return false;
-    p = json.find(':', p + pat.size());
-    if (p == std::string::npos) return false;
-    ++p;
-    while (p < json.size() && (json[p] == ' ' || json[p] == '\n' || json[p] == '\r' || json[p] == '\t')) ++p;
-    return json.compare(p, 4, "true") == 0;
-}
-
 static bool IsPrintableAscii(char ch) {
     const unsigned char uch = static_cast<unsigned char>(ch);
     return uch >= 0x21 && uch <= 0x7E;
@@ -1430,9 +784,12 @@ TaskTrayApp::TaskTrayApp(HINSTANCE hInst)
     , hwnd(NULL)
     , displaySyncServer(nullptr)
     , modeSyncServer(nullptr)
+    , httpClient(new AsyncHttpClient(CreateDefaultHttpTransport()))
     , optimizedPlan(1)
     , running(true)
     , cleaned(false)
+    , timerScheduler(new TimerScheduler())
+    , servicePolicyWakeEvent(CreateEventW(nullptr, FALSE, FALSE, nullptr))
 {
     ZeroMemory(&nid, sizeof(nid));
     g_taskTrayAppInstance.store(this);
@@ -1486,6 +843,13 @@ bool TaskTrayApp::Initialize() {
         }
     }
 
+    // LAN IP / MAC are served from a cache that adapter and address change notifications keep current.
+    NetworkIdentity::StartWatching();
+
+    // The hardware MachineId (config encryption entropy) needs wmic child processes; start computing
+    // it now so it is ready by the time the config store and the control panel need it.
+    MachineIdentity::Prefetch();
+
     // ここから既存�EコーチE
     WNDCLASS wc = { 0 };
     wc.lpfnWndProc = WindowProc;
@@ -1541,8 +905,27 @@ bool TaskTrayApp::Initialize() {
         }
     }
 
+    // Keep the decrypted Server config in memory and follow changes to the file. Any save (control
+    // panel, poll thread or another process) wakes the poll thread so it re-plans the next refresh,
+    // and the service policy thread so it re-evaluates the policy.
+    GetServerConfigStore().StartWatching();
+    if (configListenerId == 0) {
+        configListenerId = GetServerConfigStore().AddListener([this](const ServerConfigStore::Status&) {
+            NotifyActivationConfigChanged();
+            if (servicePolicyWakeEvent) SetEvent(servicePolicyWakeEvent);
+        });
+    }
+
     // Start activation polling in background (must run even when the Qt control panel is closed).
-    StartActivationPollThread();
+    StartActivationPolling();
+
+    // Close pooled keep-alive connections that went idle between refreshes. Slack lets this share
+    // a wakeup with other timers.
+    if (httpEvictTimer == 0) {
+        httpEvictTimer = timerScheduler->SchedulePeriodic(std::chrono::seconds(60), [this]() {
+            httpClient->EvictIdle();
+        }, std::chrono::seconds(30));
+    }
 
     // While the tray app is running, keep the service under tray policy control.
     StartServicePolicyThread();
@@ -1563,21 +946,28 @@ void TaskTrayApp::CreateTrayIcon() {
     Shell_NotifyIcon(NIM_ADD, &nid);
 }
 
-void TaskTrayApp::StartActivationPollThread() {
-    if (activationPollRunning.exchange(true)) {
+void TaskTrayApp::StartActivationPolling() {
+    if (activationPollTimer.load() != 0) {
         return;
     }
-    activationPollThread = std::thread(&TaskTrayApp::ActivationPollThreadProc, this);
+    activationPoll = new ActivationPollState();
+    // The job re-arms itself through activationPollTimer, so the id is stored before it can run.
+    const TimerScheduler::TimerId id = timerScheduler->ScheduleAt(TimerScheduler::TimePoint::max(), [this]() {
+        ActivationPollTick();
+    });
+    activationPollTimer.store(id);
+    timerScheduler->Reschedule(id, timerScheduler->Now());
 }
 
-void TaskTrayApp::StopActivationPollThread() {
-    if (!activationPollRunning.exchange(false)) {
+void TaskTrayApp::StopActivationPolling() {
+    const TimerScheduler::TimerId id = activationPollTimer.exchange(0);
+    if (id == 0) {
         return;
     }
-    activationPollCv.notify_all();
-    if (activationPollThread.joinable()) {
-        activationPollThread.join();
-    }
+    // Waits for a refresh that is in flight.
+    timerScheduler->Cancel(id);
+    delete activationPoll;
+    activationPoll = nullptr;
 }
 
 void TaskTrayApp::StartServicePolicyThread() {
@@ -1591,49 +981,65 @@ void TaskTrayApp::StopServicePolicyThread() {
     if (!servicePolicyRunning.exchange(false)) {
         return;
     }
-    servicePolicyCv.notify_all();
+    if (servicePolicyWakeEvent) SetEvent(servicePolicyWakeEvent);
     if (servicePolicyThread.joinable()) {
         servicePolicyThread.join();
     }
 }
 
-void TaskTrayApp::ActivationPollThreadProc() {
-    // Poll every 60 seconds.
+void TaskTrayApp::ActivationPollTick() {
+    // Refresh on the schedule planned by RefreshScheduler. Runs as a one-shot timer job that
+    // re-arms itself for the planned time.
     // - Uses v2 refresh protocol:
     //     device_nonce -> sign -> device_refresh
     // - If refresh token invalid/reused or device revoked => clear local session and require re-enroll.
     // - If license expired => keep session but block service until license is renewed in the dashboard.
 
-    auto refreshOnce = [](ServerActivationConfig& cfg) {
+    // How long before a planned refresh its nonce is fetched, and the lifetime assumed for a nonce
+    // when device_nonce does not report one.
+    constexpr std::chrono::seconds kNoncePrefetchLead(20);
+    constexpr std::chrono::seconds kAssumedNonceTtl(60);
+
+    JsonWriter& body = activationPoll->body;
+    PrefetchedNonce& prefetched = activationPoll->prefetched;
+
+    // 1) Get nonce (skipped when a prefetched one is still valid). On false, failure says how the
+    // attempt ended; ttl is the nonce lifetime the server reported (zero when it did not say).
+    auto fetchNonce = [this, &body](ServerActivationConfig& cfg, std::string& nonceId, std::string& nonce,
+        std::chrono::seconds& ttl, RefreshOutcome& failure) -> bool {
         const std::wstring baseUrl = GetAppBaseUrlW();
 
-        // 1) Get nonce
-        const std::string nonceBody = std::string("{")
-            + "\"device_id\":\"" + JsonEscape(cfg.deviceId) + "\","
-            + "\"refresh_token\":\"" + JsonEscape(cfg.refreshToken) + "\""
-            + "}";
+        body.Reset();
+        body.BeginObject()
+            .String("device_id", cfg.deviceId)
+            .String("refresh_token", cfg.refreshToken)
+            .EndObject();
 
-        const HttpJsonResult nonceResp = WinHttpPostJsonEx(baseUrl, L"/api/device_nonce.php", nonceBody);
+        const HttpJsonResult nonceResp = httpClient->PostJson(baseUrl, L"/api/device_nonce.php", body.str());
         if (!nonceResp.transportOk || nonceResp.body.empty()) {
             DebugLog("ActivationPoll(v2): device_nonce transport failed.");
-            return; // offline / transient
+            failure = RefreshOutcome::Transient; // offline / transient
+            return false;
         }
+        const JsonReader nonceJson(nonceResp.body);
 
         if (nonceResp.statusCode < 200 || nonceResp.statusCode >= 300) {
             std::string reason;
-            (void)JsonExtractString(nonceResp.body, "reason", reason);
+            (void)nonceJson.GetString("reason", reason);
             std::string err;
-            (void)JsonExtractString(nonceResp.body, "error", err);
+            (void)nonceJson.GetString("error", err);
 
             if (reason == "license_expired") {
                 cfg.licenseBlocked = true;
                 std::string exp;
-                if (JsonExtractString(nonceResp.body, "entitlement_expires_at", exp)) {
+                if (nonceJson.GetString("entitlement_expires_at", exp)) {
                     cfg.entitlementExpiresAt = exp;
                 }
-                (void)SaveServerConfig(cfg);
+                // Losing this write only means the next poll sees license_expired again.
+                (void)SaveServerConfig(cfg, ServerConfigStore::Durability::Coalesced);
                 DebugLog("ActivationPoll(v2): license_expired at nonce stage.");
-                return;
+                failure = RefreshOutcome::Rejected;
+                return false;
             }
 
             if (ShouldClearSessionForReason(reason)) {
@@ -1642,20 +1048,31 @@ void TaskTrayApp::ActivationPollThreadProc() {
                 (void)SaveServerConfig(cfg);
                 const std::wstring svcName = GetServiceNameW();
                 (void)EnforceManagedServicePolicy(svcName, ManagedServicePolicy::InstallState, false);
-                return;
+                failure = RefreshOutcome::SessionCleared;
+                return false;
             }
 
             DebugLog(std::string("ActivationPoll(v2): nonce HTTP ") + std::to_string(nonceResp.statusCode) + " error=" + err);
-            return;
+            failure = OutcomeForHttpStatus(nonceResp.statusCode);
+            return false;
         }
 
-        std::string nonceId;
-        std::string nonce;
-        if (!JsonExtractString(nonceResp.body, "nonce_id", nonceId) || nonceId.empty() ||
-            !JsonExtractString(nonceResp.body, "nonce", nonce) || nonce.empty()) {
+        if (!nonceJson.GetString("nonce_id", nonceId) || nonceId.empty() ||
+            !nonceJson.GetString("nonce", nonce) || nonce.empty()) {
             DebugLog("ActivationPoll(v2): nonce response parse failed.");
-            return;
+            failure = RefreshOutcome::Transient;
+            return false;
         }
+        int64_t ttlSeconds = 0;
+        ttl = (nonceJson.GetInt64("expires_in", ttlSeconds) && ttlSeconds > 0)
+            ? std::chrono::seconds(ttlSeconds) : std::chrono::seconds(0);
+        return true;
+    };
+
+    // 2) + 3) Sign and refresh. prefetchedRejected is set when a prefetched nonce was refused.
+    auto refreshWithNonce = [this, &body, &prefetched](ServerActivationConfig& cfg, const std::string& nonceId, const std::string& nonce,
+        bool usingPrefetched, bool* prefetchedRejected) -> RefreshOutcome {
+        const std::wstring baseUrl = GetAppBaseUrlW();
 
         // 2) Sign message
         const std::string signMsg = std::string("myapp:refresh:v1|") + cfg.deviceId + "|" + nonceId + "|" + nonce;
@@ -1663,39 +1080,51 @@ void TaskTrayApp::ActivationPollThreadProc() {
         std::string signErr;
         if (!DeviceSignKey::SignDetachedBase64(signMsg, sigB64, &signErr)) {
             DebugLog(std::string("ActivationPoll(v2): SignDetachedBase64 failed: ") + signErr);
-            return;
+            return RefreshOutcome::Rejected;
         }
 
         // 3) Refresh
-        const std::string refreshBody = std::string("{")
-            + "\"device_id\":\"" + JsonEscape(cfg.deviceId) + "\","
-            + "\"refresh_token\":\"" + JsonEscape(cfg.refreshToken) + "\","
-            + "\"nonce_id\":\"" + JsonEscape(nonceId) + "\","
-            + "\"nonce\":\"" + JsonEscape(nonce) + "\","
-            + "\"device_sig_b64\":\"" + JsonEscape(sigB64) + "\""
-            + "}";
-
-        const HttpJsonResult refreshResp = WinHttpPostJsonEx(baseUrl, L"/api/device_refresh.php", refreshBody);
+        body.Reset();
+        body.BeginObject()
+            .String("device_id", cfg.deviceId)
+            .String("refresh_token", cfg.refreshToken)
+            .String("nonce_id", nonceId)
+            .String("nonce", nonce)
+            .String("device_sig_b64", sigB64)
+            .Bool("want_next_nonce", true)
+            .EndObject();
+
+        const HttpJsonResult refreshResp = httpClient->PostJson(baseUrl, L"/api/device_refresh.php", body.str());
         if (!refreshResp.transportOk || refreshResp.body.empty()) {
             DebugLog("ActivationPoll(v2): device_refresh transport failed.");
-            return;
+            return RefreshOutcome::Transient;
         }
+        const JsonReader refreshJson(refreshResp.body);
 
         if (refreshResp.statusCode < 200 || refreshResp.statusCode >= 300) {
             std::string reason;
-            (void)JsonExtractString(refreshResp.body, "reason", reason);
+            (void)refreshJson.GetString("reason", reason);
             std::string err;
-            (void)JsonExtractString(refreshResp.body, "error", err);
+            (void)refreshJson.GetString("error", err);
+
+            if (usingPrefetched && reason.compare(0, 6, "nonce_") == 0) {
+                // The bundled nonce was not accepted (expired, consumed, server restarted...).
+                // Nothing else about the session is wrong: let the caller fetch a fresh one.
+                DebugLog(std::string("ActivationPoll(v2): prefetched nonce rejected reason=") + reason);
+                *prefetchedRejected = true;
+                return OutcomeForHttpStatus(refreshResp.statusCode);
+            }
 
             if (reason == "license_expired") {
                 cfg.licenseBlocked = true;
                 std::string exp;
-                if (JsonExtractString(refreshResp.body, "entitlement_expires_at", exp)) {
+                if (refreshJson.GetString("entitlement_expires_at", exp)) {
                     cfg.entitlementExpiresAt = exp;
                 }
-                (void)SaveServerConfig(cfg);
+                // Losing this write only means the next poll sees license_expired again.
+                (void)SaveServerConfig(cfg, ServerConfigStore::Durability::Coalesced);
                 DebugLog("ActivationPoll(v2): license_expired at refresh stage.");
-                return;
+                return RefreshOutcome::Rejected;
             }
 
             if (ShouldClearSessionForReason(reason)) {
@@ -1704,91 +1133,385 @@ void TaskTrayApp::ActivationPollThreadProc() {
                 (void)SaveServerConfig(cfg);
                 const std::wstring svcName = GetServiceNameW();
                 (void)EnforceManagedServicePolicy(svcName, ManagedServicePolicy::InstallState, false);
-                return;
+                return RefreshOutcome::SessionCleared;
             }
 
             DebugLog(std::string("ActivationPoll(v2): refresh HTTP ") + std::to_string(refreshResp.statusCode) + " error=" + err);
-            return;
+            return OutcomeForHttpStatus(refreshResp.statusCode);
         }
 
         // Success: rotate refresh token and update license blob
         std::string newRefresh;
         std::string newLicense;
         std::string exp;
-        if (JsonExtractString(refreshResp.body, "refresh_token", newRefresh) && !newRefresh.empty()) {
+        if (refreshJson.GetString("refresh_token", newRefresh) && !newRefresh.empty()) {
             cfg.refreshToken = newRefresh;
         }
-        if (JsonExtractString(refreshResp.body, "license_blob", newLicense) && !newLicense.empty()) {
+        if (refreshJson.GetString("license_blob", newLicense) && !newLicense.empty()) {
             cfg.licenseBlob = newLicense;
         }
-        if (JsonExtractString(refreshResp.body, "entitlement_expires_at", exp)) {
+        if (refreshJson.GetString("entitlement_expires_at", exp)) {
             cfg.entitlementExpiresAt = exp;
         }
+        prefetched.Clear();
+        int64_t nextNonceTtl = 0;
+        if (refreshJson.GetString("next_nonce_id", prefetched.nonceId) && !prefetched.nonceId.empty() &&
+            refreshJson.GetString("next_nonce", prefetched.nonce) && !prefetched.nonce.empty() &&
+            refreshJson.GetInt64("next_nonce_expires_in", nextNonceTtl) && nextNonceTtl > 0) {
+            prefetched.deviceId = cfg.deviceId;
+            prefetched.expiresAt = std::chrono::steady_clock::now() + std::chrono::seconds(nextNonceTtl);
+        } else {
+            prefetched.Clear();
+        }
         cfg.lastSuccessRefreshAt = NowIsoLocal();
         cfg.licenseBlocked = false;
         cfg.activated = true;
-        const std::string currentIp = GetLanIpv4();
+        const std::string currentIp = NetworkIdentity::GetLanIpv4();
         if (!currentIp.empty()) {
             cfg.lanIp = currentIp;
         }
         (void)SaveServerConfig(cfg);
         const std::wstring svcName = GetServiceNameW();
-        (void)EnforceManagedServicePolicy(svcName, DetermineManagedServicePolicy(cfg), false);
+        (void)EnforceManagedServicePolicy(svcName, DetermineManagedServicePolicy(ServerConfigStore::StatusOf(cfg)), false);
+        return RefreshOutcome::Success;
     };
 
-    // Refresh schedule: attempt at most every 10 minutes when activated.
-    auto lastAttempt = std::chrono::steady_clock::now() - std::chrono::hours(24);
+    auto refreshOnce = [&](ServerActivationConfig& cfg) -> RefreshOutcome {
+        std::string nonceId;
+        std::string nonce;
+        if (prefetched.Take(cfg.deviceId, std::chrono::steady_clock::now(), nonceId, nonce)) {
+            bool rejected = false;
+            const RefreshOutcome outcome = refreshWithNonce(cfg, nonceId, nonce, true, &rejected);
+            if (!rejected) {
+                return outcome;
+            }
+        }
 
-    while (activationPollRunning.load()) {
-        ServerActivationConfig cfg;
-        if (LoadServerConfig(cfg)) {
-            // Only run refresh if enrolled.
-            if (cfg.activated && !cfg.deviceId.empty() && !cfg.refreshToken.empty()) {
-                auto now = std::chrono::steady_clock::now();
-                if (now - lastAttempt > std::chrono::minutes(10)) {
-                    lastAttempt = now;
-                    refreshOnce(cfg);
+        std::chrono::seconds ttl(0);
+        RefreshOutcome failure = RefreshOutcome::Transient;
+        if (!fetchNonce(cfg, nonceId, nonce, ttl, failure)) {
+            return failure;
+        }
+        return refreshWithNonce(cfg, nonceId, nonce, false, nullptr);
+    };
+
+    // Fetches the nonce for the planned refresh ahead of time and keeps it in prefetched.
+    auto prefetchNonce = [&](ServerActivationConfig& cfg, RefreshOutcome& failure) -> bool {
+        std::string nonceId;
+        std::string nonce;
+        std::chrono::seconds ttl(0);
+        if (!fetchNonce(cfg, nonceId, nonce, ttl, failure)) {
+            return false;
+        }
+        prefetched.Clear();
+        prefetched.deviceId = cfg.deviceId;
+        prefetched.nonceId = nonceId;
+        prefetched.nonce = nonce;
+        prefetched.expiresAt = std::chrono::steady_clock::now() + (ttl.count() > 0 ? ttl : kAssumedNonceTtl);
+        return true;
+    };
+
+    // Refresh schedule: planned from the entitlement expiry and the last success, with jitter and
+    // exponential backoff (see RefreshScheduler).
+    RefreshScheduler& scheduler = activationPoll->scheduler;
+    std::string& plannedDeviceId = activationPoll->plannedDeviceId;
+
+    std::chrono::steady_clock::time_point licenseExpiryDue = std::chrono::steady_clock::time_point::max();
+
+    ServerActivationConfig cfg;
+    const bool enrolled = LoadServerConfig(cfg) &&
+        cfg.activated && !cfg.deviceId.empty() && !cfg.refreshToken.empty();
+
+    if (!enrolled) {
+        scheduler.Reset();
+        plannedDeviceId.clear();
+    } else {
+        // Offline license check: while the stored license_blob verifies against the pinned key the
+        // refresh cadence is relaxed, and once it verifiably runs out the device is blocked without
+        // waiting for the server. The server stays authoritative: a blocked device is never
+        // unblocked here.
+        const std::chrono::system_clock::time_point systemNow = std::chrono::system_clock::now();
+        LicenseBlob::Claims claims;
+        const LicenseBlob::Verdict verdict = LicenseBlob::Check(cfg.licenseBlob, cfg.deviceId, cfg.machineId,
+            cfg.entitlementExpiresAt, systemNow, &claims);
+        if (verdict != activationPoll->licenseVerdict) {
+            activationPoll->licenseVerdict = verdict;
+            DebugLog(std::string("ActivationPoll(v2): license_blob ") + LicenseBlob::VerdictToString(verdict));
+        }
+        if (verdict == LicenseBlob::Verdict::Expired && !cfg.licenseBlocked) {
+            cfg.licenseBlocked = true;
+            // The store listener wakes the service policy thread.
+            (void)SaveServerConfig(cfg, ServerConfigStore::Durability::Coalesced);
+            DebugLog("ActivationPoll(v2): license expired (verified offline).");
+        }
+        const bool verified = (verdict == LicenseBlob::Verdict::Valid) && !cfg.licenseBlocked;
+        if (verified) {
+            // Wake up when the license runs out even if no refresh is planned before then. The
+            // expiry is server-supplied and may be centuries away, which does not fit a nanosecond
+            // steady_clock: look at most one verified interval ahead, the next tick looks again.
+            const std::chrono::system_clock::duration untilExpiry = (std::min)(claims.expiresAt - systemNow,
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(RefreshScheduler::Policy{}.verifiedMaxInterval));
+            licenseExpiryDue = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(untilExpiry);
+        }
+        const bool verifiedChanged = (verified != scheduler.LicenseVerified());
+        scheduler.SetLicenseVerified(verified);
+
+        if (!scheduler.HasPlan() || plannedDeviceId != cfg.deviceId ||
+            (verifiedChanged && scheduler.ConsecutiveFailures() == 0)) {
+            plannedDeviceId = cfg.deviceId;
+            scheduler.PlanFromPersisted(cfg.lastSuccessRefreshAt, cfg.entitlementExpiresAt,
+                std::chrono::steady_clock::now(), std::chrono::system_clock::now());
+        }
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (!scheduler.IsDue(now) && scheduler.ConsecutiveFailures() == 0 &&
+            now >= scheduler.NextDue() - kNoncePrefetchLead &&
+            activationPoll->prefetchedFor != scheduler.NextDue() &&
+            !prefetched.UsableAt(cfg.deviceId, scheduler.NextDue())) {
+            // A transient failure is left to the refresh, which fetches its own nonce. Anything else
+            // (session cleared, license expired, rejected) is the answer the refresh would get.
+            activationPoll->prefetchedFor = scheduler.NextDue();
+            RefreshOutcome failure = RefreshOutcome::Transient;
+            if (!prefetchNonce(cfg, failure) && failure != RefreshOutcome::Transient) {
+                scheduler.OnOutcome(failure, cfg.entitlementExpiresAt,
+                    std::chrono::steady_clock::now(), std::chrono::system_clock::now());
+                if (failure == RefreshOutcome::SessionCleared) {
+                    plannedDeviceId.clear();
                 }
             }
+        } else if (scheduler.IsDue(now)) {
+            const RefreshOutcome outcome = refreshOnce(cfg);
+            scheduler.OnOutcome(outcome, cfg.entitlementExpiresAt,
+                std::chrono::steady_clock::now(), std::chrono::system_clock::now());
+            if (outcome == RefreshOutcome::SessionCleared) {
+                plannedDeviceId.clear();
+            } else if (outcome == RefreshOutcome::Transient) {
+                DebugLog(std::string("ActivationPoll(v2): retry #") + std::to_string(scheduler.ConsecutiveFailures()) + " in " +
+                    std::to_string(std::chrono::duration_cast<std::chrono::seconds>(scheduler.NextDue() - std::chrono::steady_clock::now()).count()) + "s");
+            }
         }
-
-        // Wait for next tick or stop.
-        std::unique_lock<std::mutex> lk(activationPollMutex);
-        activationPollCv.wait_for(lk, std::chrono::seconds(60), [this]() {
-            return !activationPollRunning.load();
-        });
     }
+
+    // Run again at the planned refresh, or shortly before it to fetch its nonce. Without a plan
+    // (not enrolled) only a config change (NotifyActivationConfigChanged) re-arms the job.
+    if (scheduler.HasPlan()) {
+        std::chrono::steady_clock::time_point wake = (std::min)(scheduler.NextDue(), licenseExpiryDue);
+        const std::chrono::steady_clock::time_point prefetchAt = scheduler.NextDue() - kNoncePrefetchLead;
+        if (scheduler.ConsecutiveFailures() == 0 && activationPoll->prefetchedFor != scheduler.NextDue() &&
+            prefetchAt > std::chrono::steady_clock::now()) {
+            wake = (std::min)(wake, prefetchAt);
+        }
+        timerScheduler->Reschedule(activationPollTimer.load(), wake);
+    }
+}
+
+void TaskTrayApp::NotifyActivationConfigChanged() {
+    const TimerScheduler::TimerId id = activationPollTimer.load();
+    if (id != 0) {
+        timerScheduler->Reschedule(id, timerScheduler->Now());
+    }
+}
+
+void TaskTrayApp::StartEnrollment(ServerActivationConfig cfg, std::string pairingCode,
+    std::shared_ptr<std::atomic<bool>> cancelled, std::function<void(const EnrollmentUpdate&)> report) {
+    // Machine id, the signing key (file I/O + DPAPI), the request and the config save all stay off
+    // the GUI thread: the preparation runs on a scheduler worker and the POST completes on the HTTP
+    // client's worker.
+    timerScheduler->Post([this, cfg = std::move(cfg), pairingCode = std::move(pairingCode), cancelled, report]() mutable {
+        auto fail = [&report](std::string message) {
+            EnrollmentUpdate update;
+            update.kind = EnrollmentUpdate::Kind::Failed;
+            update.message = std::move(message);
+            report(update);
+        };
+        auto progress = [&report](std::string message) {
+            EnrollmentUpdate update;
+            update.message = std::move(message);
+            report(update);
+        };
+
+        progress("Preparing device key...");
+        cfg.machineId = MachineIdentity::GetMachineId();
+        cfg.lanIp = NetworkIdentity::GetLanIpv4();
+        cfg.entitlementExpiresAt.clear();
+        cfg.lastSuccessRefreshAt.clear();
+
+        std::string pubKeyB64;
+        std::string pubErr;
+        if (!DeviceSignKey::GetOrCreatePublicKeyBase64(pubKeyB64, &pubErr) || pubKeyB64.empty()) {
+            DebugLog(std::string("Enrollment: GetOrCreatePublicKeyBase64 failed: ") + pubErr);
+            fail("Failed to generate device signing key. Run as administrator once, or check ProgramData permissions.");
+            return;
+        }
+        if (cancelled->load()) {
+            EnrollmentUpdate update;
+            update.kind = EnrollmentUpdate::Kind::Cancelled;
+            report(update);
+            return;
+        }
+        if (!httpClient) {
+            fail("Could not contact the server. Check network connectivity and try again.");
+            return;
+        }
+
+        JsonWriter body(512);
+        body.BeginObject()
+            .String("pairing_code", pairingCode)
+            .String("role", "server")
+            .String("machine_id", cfg.machineId)
+            .String("device_name", cfg.serverName)
+            .String("lan_ip", cfg.lanIp)
+            .String("device_pubkey_b64", pubKeyB64)
+            .EndObject();
+
+        progress("Contacting server...");
+        httpClient->PostJsonAsync(GetAppBaseUrlW(), L"/api/device_enroll.php", body.str(),
+            [cfg, cancelled, report](const HttpJsonResult& enr) mutable {
+                EnrollmentUpdate update;
+                update.kind = EnrollmentUpdate::Kind::Failed;
+                if (!enr.transportOk || enr.body.empty()) {
+                    DebugLog("Enrollment: device_enroll transport failed.");
+                    update.message = "Could not contact the server. Check network connectivity and try again.";
+                    if (cancelled->load()) update.kind = EnrollmentUpdate::Kind::Cancelled;
+                    report(update);
+                    return;
+                }
+                const JsonReader enrJson(enr.body);
+
+                if (enr.statusCode < 200 || enr.statusCode >= 300) {
+                    std::string err;
+                    std::string reason;
+                    (void)enrJson.GetString("error", err);
+                    (void)enrJson.GetString("reason", reason);
+                    if (reason == "license_expired") {
+                        update.licenseExpired = true;
+                        (void)enrJson.GetString("entitlement_expires_at", update.entitlementExpiresAt);
+                    }
+                    update.message = err.empty() ? "Enrollment failed." : err;
+                    if (cancelled->load()) update.kind = EnrollmentUpdate::Kind::Cancelled;
+                    report(update);
+                    return;
+                }
+
+                std::string deviceId;
+                std::string refreshToken;
+                std::string licenseBlob;
+                std::string exp;
+
+                if (!enrJson.GetString("device_id", deviceId) || deviceId.empty() ||
+                    !enrJson.GetString("refresh_token", refreshToken) || refreshToken.empty() ||
+                    !enrJson.GetString("license_blob", licenseBlob) || licenseBlob.empty()) {
+                    DebugLog("Enrollment: device_enroll parse failed.");
+                    update.message = "Enrollment succeeded but the response was invalid. Please try again.";
+                    if (cancelled->load()) update.kind = EnrollmentUpdate::Kind::Cancelled;
+                    report(update);
+                    return;
+                }
+                (void)enrJson.GetString("entitlement_expires_at", exp);
+
+                // Saved even when the user cancelled meanwhile: the server has already consumed the
+                // pairing code and registered this device, so dropping the session would orphan it.
+                cfg.deviceId = deviceId;
+                cfg.refreshToken = refreshToken;
+                cfg.licenseBlob = licenseBlob;
+                cfg.entitlementExpiresAt = exp;
+                cfg.lastSuccessRefreshAt = NowIsoLocal();
+                cfg.licenseBlocked = false;
+                cfg.activated = true;
+                if (!SaveServerConfig(cfg)) {
+                    DebugLog("Enrollment: Failed to save encrypted Server config after enrollment.");
+                }
+                if (cancelled->load()) {
+                    DebugLog("Enrollment: completed after cancel; enrolled config kept.");
+                }
+
+                update.kind = EnrollmentUpdate::Kind::Succeeded;
+                update.cfg = std::move(cfg);
+                report(update);
+            });
+    });
 }
 
 void TaskTrayApp::ServicePolicyThreadProc() {
-    // Poll more aggressively than activation validation so manual SCM changes are reverted quickly
-    // while the tray app is alive.
+    // Event-driven: the thread sleeps until the service's run state or start type changes (SCM /
+    // registry notifications), the Server config changes (store listener) or the thread is stopped.
+    // Manual SCM changes are therefore reverted as soon as they happen (with backoff when the same
+    // change keeps coming back), and nothing runs while the service already matches the policy.
+    const std::wstring svcName = GetServiceNameW();
+    ServiceStateWatcher watcher(svcName);
+
+    // Retry interval while the service is not installed (nothing to be notified about yet).
+    constexpr DWORD kServiceMissingRetryMs = 30000;
+
+    // When the same mismatch comes back right after it was corrected (a service that exits as
+    // soon as it starts, another tool resetting the start type), it is enforced again after
+    // 1 s, then 2 s, 4 s ... up to 5 minutes, instead of on every notification. The backoff ends
+    // when the policy changes, the mismatch is a different one, or it stayed corrected for longer
+    // than the current interval.
+    constexpr std::chrono::milliseconds kReenforceMinInterval(1000);
+    constexpr std::chrono::milliseconds kReenforceMaxInterval(5 * 60 * 1000);
+
     ManagedServicePolicy lastPolicy = ManagedServicePolicy::InstallState;
     bool hasLastPolicy = false;
 
+    bool hasLastMismatch = false;
+    ServiceStateWatcher::State lastMismatch;
+    std::chrono::milliseconds reenforceInterval(0);
+    std::chrono::steady_clock::time_point nextEnforceAt{};
+    bool backoffLogged = false;
+
     while (servicePolicyRunning.load()) {
-        ServerActivationConfig cfg;
-        if (LoadServerConfig(cfg)) {
-            const ManagedServicePolicy policy = DetermineManagedServicePolicy(cfg);
-            const bool policyChanged = !hasLastPolicy || policy != lastPolicy;
-            const std::wstring svcName = GetServiceNameW();
-            (void)EnforceManagedServicePolicy(svcName, policy, !policyChanged);
-            lastPolicy = policy;
-            hasLastPolicy = true;
-        } else {
-            const ManagedServicePolicy policy = ManagedServicePolicy::InstallState;
-            const bool policyChanged = !hasLastPolicy || policy != lastPolicy;
-            const std::wstring svcName = GetServiceNameW();
-            (void)EnforceManagedServicePolicy(svcName, policy, !policyChanged);
-            lastPolicy = policy;
-            hasLastPolicy = true;
+        (void)watcher.Arm();
+        DWORD waitMs = watcher.IsArmed() ? INFINITE : kServiceMissingRetryMs;
+
+        // Flags and field presence only; the config is not decoded.
+        const ManagedServicePolicy policy = DetermineManagedServicePolicy(GetServerConfigStore().LoadStatus());
+        const bool policyChanged = !hasLastPolicy || policy != lastPolicy;
+
+        ServiceStateWatcher::State state;
+        const bool queried = watcher.Query(state);
+        const bool satisfied = queried && ServiceStateSatisfiesPolicy(state, policy);
+        if (policyChanged) {
+            hasLastMismatch = false;
+        }
+        if (policyChanged || !satisfied) {
+            const auto now = std::chrono::steady_clock::now();
+            const bool sameMismatch = hasLastMismatch && queried &&
+                state.currentState == lastMismatch.currentState && state.startType == lastMismatch.startType;
+            if (sameMismatch && now < nextEnforceAt) {
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(nextEnforceAt - now);
+                if (!backoffLogged) {
+                    DebugLog("ServicePolicy: service drifted again to currentState=" + std::to_string(state.currentState)
+                        + ", startType=" + std::to_string(state.startType)
+                        + " right after enforcement; re-enforcing with backoff (next in "
+                        + std::to_string(remaining.count()) + " ms).");
+                    backoffLogged = true;
+                }
+                waitMs = (std::min)(waitMs, static_cast<DWORD>(remaining.count()) + 1);
+            } else {
+                (void)EnforceManagedServicePolicy(svcName, policy, !policyChanged);
+                if (sameMismatch && now < nextEnforceAt + reenforceInterval) {
+                    reenforceInterval = (std::min)(reenforceInterval * 2, kReenforceMaxInterval);
+                } else {
+                    reenforceInterval = kReenforceMinInterval;
+                    backoffLogged = false;
+                }
+                nextEnforceAt = now + reenforceInterval;
+                lastMismatch = state;
+                hasLastMismatch = queried;
+            }
         }
+        lastPolicy = policy;
+        hasLastPolicy = true;
 
-        std::unique_lock<std::mutex> lk(servicePolicyMutex);
-        servicePolicyCv.wait_for(lk, std::chrono::seconds(2), [this]() {
-            return !servicePolicyRunning.load();
-        });
+        (void)watcher.Wait(servicePolicyWakeEvent, waitMs);
     }
+
+    const ServiceStateWatcher::Stats stats = watcher.GetStats();
+    DebugLog("ServicePolicy: statusNotifications=" + std::to_string(stats.statusNotifications)
+        + " configNotifications=" + std::to_string(stats.configNotifications)
+        + " queries=" + std::to_string(stats.queries)
+        + " rearms=" + std::to_string(stats.rearms));
 }
 
 bool TaskTrayApp::Cleanup() {
@@ -1799,7 +1522,76 @@ bool TaskTrayApp::Cleanup() {
 
     // Stop background workers first.
     StopServicePolicyThread();
-    StopActivationPollThread();
+    StopActivationPolling();
+    if (httpEvictTimer != 0) {
+        timerScheduler->Cancel(httpEvictTimer);
+        httpEvictTimer = 0;
+    }
+
+    if (configListenerId != 0) {
+        GetServerConfigStore().RemoveListener(configListenerId);
+        configListenerId = 0;
+    }
+    if (servicePolicyWakeEvent) {
+        CloseHandle(servicePolicyWakeEvent);
+        servicePolicyWakeEvent = nullptr;
+    }
+    if (!GetServerConfigStore().Flush()) {
+        DebugLog("TaskTrayApp::Cleanup: pending Server config save failed.");
+    }
+    GetServerConfigStore().StopWatching();
+    {
+        const ServerConfigStore::Stats cfgStats = GetServerConfigStore().GetStats();
+        DebugLog("TaskTrayApp::Cleanup: ServerConfigStore loads=" + std::to_string(cfgStats.loads)
+            + " cacheHits=" + std::to_string(cfgStats.cacheHits)
+            + " statusLoads=" + std::to_string(cfgStats.statusLoads)
+            + " decrypts=" + std::to_string(cfgStats.decrypts)
+            + " decodes=" + std::to_string(cfgStats.decodes)
+            + " saves=" + std::to_string(cfgStats.saves)
+            + " writes=" + std::to_string(cfgStats.writes)
+            + " unchanged=" + std::to_string(cfgStats.unchanged)
+            + " coalesced=" + std::to_string(cfgStats.coalesced)
+            + " externalChanges=" + std::to_string(cfgStats.externalChanges));
+    }
+    NetworkIdentity::StopWatching();
+    {
+        const NetworkIdentity::Stats netStats = NetworkIdentity::GetStats();
+        DebugLog("TaskTrayApp::Cleanup: NetworkIdentity enumerations=" + std::to_string(netStats.enumerations)
+            + " cacheHits=" + std::to_string(netStats.cacheHits)
+            + " notifications=" + std::to_string(netStats.notifications));
+    }
+    {
+        const MachineIdentity::Stats idStats = MachineIdentity::GetStats();
+        DebugLog("TaskTrayApp::Cleanup: MachineIdentity computations=" + std::to_string(idStats.computations)
+            + " lastComputeMs=" + std::to_string(idStats.lastComputeMs)
+            + " cacheHits=" + std::to_string(idStats.cacheHits)
+            + " waits=" + std::to_string(idStats.waits)
+            + " waitedMs=" + std::to_string(idStats.waitedMs));
+    }
+
+    if (timerScheduler) {
+        timerScheduler->Shutdown();
+        const TimerScheduler::Stats timerStats = timerScheduler->GetStats();
+        DebugLog("TaskTrayApp::Cleanup: TimerScheduler wakeups=" + std::to_string(timerStats.wakeups)
+            + " wakeupsLastMinute=" + std::to_string(timerStats.wakeupsLastMinute)
+            + " jobsRun=" + std::to_string(timerStats.jobsRun)
+            + " aligned=" + std::to_string(timerStats.aligned)
+            + " cascades=" + std::to_string(timerStats.cascades));
+        delete timerScheduler;
+        timerScheduler = nullptr;
+    }
+
+    if (httpClient) {
+        const HttpClientStats httpStats = httpClient->GetStats();
+        DebugLog("TaskTrayApp::Cleanup: HttpClient requests=" + std::to_string(httpStats.requests)
+            + " newConnections=" + std::to_string(httpStats.newConnections)
+            + " reusedConnections=" + std::to_string(httpStats.reusedConnections)
+            + " idleEvictions=" + std::to_string(httpStats.idleEvictions)
+            + " failures=" + std::to_string(httpStats.failures));
+        httpClient->Shutdown();
+        delete httpClient;
+        httpClient = nullptr;
+    }
 
     // タスクトレイアイコンを削除
     Shell_NotifyIcon(NIM_DELETE, &nid);
@@ -2153,20 +1945,8 @@ int TaskTrayApp::GetOptimizedPlanForSync() const {
 
 bool TaskTrayApp::IsActivatedForSync() const {
     // Read-only activation check used by sync servers.
-    // Activation state is maintained by ActivationPollThreadProc.
-    ServerActivationConfig cfg;
-    if (!LoadServerConfig(cfg)) {
-        return false;
-    }
-
-    const bool activated =
-        cfg.activated &&
-        !cfg.licenseBlocked &&
-        !cfg.serverName.empty() &&
-        !cfg.deviceId.empty() &&
-        !cfg.refreshToken.empty();
-
-    return activated;
+    // Activation state is maintained by ActivationPollTick.
+    return IsConfigUsable(GetServerConfigStore().LoadStatus());
 }
 
 void TaskTrayApp::ApplyOptimizedPlanToUi(int plan) {
@@ -2253,6 +2033,10 @@ void TaskTrayApp::ShowControlPanel() {
         ServerActivationConfig cfg;
         bool highlightServerNameError = false;
         bool autoMovedToSettingsTab = false;
+        // Set while an enrollment is in flight; the Activate button cancels it.
+        std::shared_ptr<std::atomic<bool>> enrollCancel;
+        QString enrollStatus;
+        QString activateButtonText;
     };
 
     auto state = std::make_shared<ControlPanelState>();
@@ -2286,8 +2070,8 @@ void TaskTrayApp::ShowControlPanel() {
     if (state->ui.label_04) state->ui.label_04->setVisible(false);
 
     // -------- Activation / ServerName persistence --------
-    state->cfg.machineId = GetMachineId();
-    state->cfg.lanIp = GetLanIpv4();
+    state->cfg.machineId = MachineIdentity::GetMachineId();
+    state->cfg.lanIp = NetworkIdentity::GetLanIpv4();
     LoadServerConfig(state->cfg); // best-effort (if decryption fails, keeps defaults)
 
     auto setLineStyle = [](QWidget* w, const QString& style) {
@@ -2349,6 +2133,7 @@ void TaskTrayApp::ShowControlPanel() {
             uiName = Trim(state->ui.textEdit_0->text().toUtf8().toStdString());
             uiMatchesSaved = (uiName == Trim(state->cfg.serverName));
         }
+        const bool enrolling = state->enrollCancel != nullptr;
         const bool canActivate =
             !state->cfg.activated &&
             hasSavedServerName &&
@@ -2371,10 +2156,19 @@ void TaskTrayApp::ShowControlPanel() {
             }
         }
 
-        if (state->ui.pushButton_1) state->ui.pushButton_1->setEnabled(canActivate);
+        if (state->ui.pushButton_1) {
+            state->ui.pushButton_1->setEnabled(canActivate || enrolling);
+            state->ui.pushButton_1->setText(enrolling ? QString("Cancel") : state->activateButtonText);
+        }
 
+        if (state->ui.textEdit_0) {
+            state->ui.textEdit_0->setEnabled(!enrolling);
+        }
         if (state->ui.textEdit_1) {
-            state->ui.textEdit_1->setEnabled(!state->cfg.activated);
+            state->ui.textEdit_1->setEnabled(!state->cfg.activated && !enrolling);
+        }
+        if (state->ui.pushButton_0) {
+            state->ui.pushButton_0->setEnabled(!enrolling);
         }
 
         if (state->ui.pushButton_0) {
@@ -2454,6 +2248,8 @@ void TaskTrayApp::ShowControlPanel() {
                     if (!msg.isEmpty()) msg += " | ";
                     msg += QString("Device: %1").arg(QString::fromUtf8(state->cfg.deviceId.c_str()).left(12));
                 }
+            } else if (enrolling) {
+                msg = state->enrollStatus;
             }
             state->ui.label_07->setText(msg);
         }
@@ -2463,6 +2259,9 @@ void TaskTrayApp::ShowControlPanel() {
         }
     };
 
+    if (state->ui.pushButton_1) {
+        state->activateButtonText = state->ui.pushButton_1->text();
+    }
     syncActivationEditorsFromConfig(true);
     refreshActivationUi();
 
@@ -2521,8 +2320,8 @@ void TaskTrayApp::ShowControlPanel() {
             }
             (void)(newName != state->cfg.serverName);
             state->cfg.serverName = newName;
-            state->cfg.machineId = GetMachineId();
-            state->cfg.lanIp = GetLanIpv4();
+            state->cfg.machineId = MachineIdentity::GetMachineId();
+            state->cfg.lanIp = NetworkIdentity::GetLanIpv4();
 
             // If not activated yet, keep secrets empty.
             if (!state->cfg.activated) {
@@ -2541,8 +2340,18 @@ void TaskTrayApp::ShowControlPanel() {
 
     // Activate button
     if (state->ui.pushButton_1) {
-        QObject::connect(state->ui.pushButton_1, &QPushButton::clicked, rawWindow, [state, rawWindow, refreshActivationUi]() {
+        QObject::connect(state->ui.pushButton_1, &QPushButton::clicked, rawWindow, [this, state, rawWindow, refreshActivationUi]() {
             if (!state->ui.textEdit_0 || !state->ui.textEdit_1) return;
+            if (state->enrollCancel) {
+                // Stop waiting. A request that is already on the wire cannot be recalled; its result
+                // is ignored here (a successful enrollment is still saved by the job).
+                state->enrollCancel->store(true);
+                state->enrollCancel.reset();
+                state->enrollStatus.clear();
+                DebugLog("ControlPanel(System): Enrollment cancelled.");
+                refreshActivationUi();
+                return;
+            }
             if (state->cfg.activated) {
                 ShowActivationMessageBox(rawWindow, QMessageBox::Information,
                     "TaskTray Activation",
@@ -2564,10 +2373,6 @@ void TaskTrayApp::ShowControlPanel() {
             }
             state->highlightServerNameError = false;
             const std::string pairingCode = Trim(state->ui.textEdit_1->text().toUtf8().toStdString());
-            state->cfg.machineId = GetMachineId();
-            state->cfg.lanIp = GetLanIpv4();
-            state->cfg.entitlementExpiresAt.clear();
-            state->cfg.lastSuccessRefreshAt.clear();
 
             if (state->cfg.serverName.empty() || pairingCode.empty()) {
                 DebugLog("ControlPanel(System): Missing fields for enrollment.");
@@ -2577,116 +2382,97 @@ void TaskTrayApp::ShowControlPanel() {
                 return;
             }
 
-            std::string pubKeyB64;
-            std::string pubErr;
-            if (!DeviceSignKey::GetOrCreatePublicKeyBase64(pubKeyB64, &pubErr) || pubKeyB64.empty()) {
-                DebugLog(std::string("ControlPanel(System): GetOrCreatePublicKeyBase64 failed: ") + pubErr);
-                ShowActivationMessageBox(rawWindow, QMessageBox::Warning,
-                    "TaskTray Activation",
-                    "Failed to generate device signing key. Run as administrator once, or check ProgramData permissions.");
-                return;
-            }
-
-            std::wstring baseUrl = GetAppBaseUrlW();
-            std::string body = std::string("{")
-                + "\"pairing_code\":\"" + JsonEscape(pairingCode) + "\","
-                + "\"role\":\"server\","
-                + "\"machine_id\":\"" + JsonEscape(state->cfg.machineId) + "\","
-                + "\"device_name\":\"" + JsonEscape(state->cfg.serverName) + "\","
-                + "\"lan_ip\":\"" + JsonEscape(state->cfg.lanIp) + "\","
-                + "\"device_pubkey_b64\":\"" + JsonEscape(pubKeyB64) + "\""
-                + "}";
-
-            const HttpJsonResult enr = WinHttpPostJsonEx(baseUrl, L"/api/device_enroll.php", body);
-            if (!enr.transportOk || enr.body.empty()) {
-                DebugLog("ControlPanel(System): device_enroll transport failed.");
-                ShowActivationMessageBox(rawWindow, QMessageBox::Warning,
-                    "TaskTray Activation",
-                    "Could not contact the server. Check network connectivity and try again.");
-                return;
-            }
-
-            if (enr.statusCode < 200 || enr.statusCode >= 300) {
-                std::string err;
-                std::string reason;
-                (void)JsonExtractString(enr.body, "error", err);
-                (void)JsonExtractString(enr.body, "reason", reason);
-                if (reason == "license_expired") {
-                    std::string exp;
-                    if (JsonExtractString(enr.body, "entitlement_expires_at", exp)) {
-                        state->cfg.entitlementExpiresAt = exp;
-                    }
-                    state->cfg.licenseBlocked = true;
-                }
-                ShowActivationMessageBox(rawWindow, QMessageBox::Warning,
-                    "TaskTray Activation",
-                    err.empty() ? "Enrollment failed." : QString::fromUtf8(err.c_str()));
-                refreshActivationUi();
-                return;
-            }
-
-            std::string deviceId;
-            std::string refreshToken;
-            std::string licenseBlob;
-            std::string exp;
-
-            if (!JsonExtractString(enr.body, "device_id", deviceId) || deviceId.empty() ||
-                !JsonExtractString(enr.body, "refresh_token", refreshToken) || refreshToken.empty() ||
-                !JsonExtractString(enr.body, "license_blob", licenseBlob) || licenseBlob.empty()) {
-                DebugLog("ControlPanel(System): device_enroll parse failed.");
-                ShowActivationMessageBox(rawWindow, QMessageBox::Warning,
-                    "TaskTray Activation",
-                    "Enrollment succeeded but the response was invalid. Please try again.");
-                return;
-            }
-            (void)JsonExtractString(enr.body, "entitlement_expires_at", exp);
-
-            state->cfg.deviceId = deviceId;
-            state->cfg.refreshToken = refreshToken;
-            state->cfg.licenseBlob = licenseBlob;
-            state->cfg.entitlementExpiresAt = exp;
-            state->cfg.lastSuccessRefreshAt = NowIsoLocal();
-            state->cfg.licenseBlocked = false;
-            state->cfg.activated = true;
-
-            if (state->ui.textEdit_1) {
-                state->ui.textEdit_1->setText("");
-                state->ui.textEdit_1->setModified(false);
-            }
-            if (!SaveServerConfig(state->cfg)) {
-                DebugLog("ControlPanel(System): Failed to save encrypted Server config after enrollment.");
-            }
-
-            ShowActivationMessageBox(rawWindow, QMessageBox::Information,
-                "TaskTray Activation",
-                "Enrollment completed. You can now open Settings.");
+            auto cancel = std::make_shared<std::atomic<bool>>(false);
+            state->enrollCancel = cancel;
+            state->enrollStatus = "Starting enrollment...";
             refreshActivationUi();
+
+            // Updates arrive from worker threads and are applied on the GUI thread. They are
+            // dropped once the window is gone or this enrollment was cancelled / superseded.
+            QPointer<QMainWindow> guard(rawWindow);
+            StartEnrollment(state->cfg, pairingCode, cancel,
+                [guard, state, cancel, refreshActivationUi](const EnrollmentUpdate& update) {
+                    QCoreApplication* app = QCoreApplication::instance();
+                    if (!app) return;
+                    QMetaObject::invokeMethod(app, [guard, state, cancel, refreshActivationUi, update]() {
+                        if (!guard || state->enrollCancel != cancel) return;
+                        QMainWindow* window = guard.data();
+
+                        if (update.kind == EnrollmentUpdate::Kind::Progress) {
+                            state->enrollStatus = QString::fromUtf8(update.message.c_str());
+                            refreshActivationUi();
+                            return;
+                        }
+
+                        state->enrollCancel.reset();
+                        state->enrollStatus.clear();
+                        switch (update.kind) {
+                        case EnrollmentUpdate::Kind::Succeeded:
+                            state->cfg = update.cfg;
+                            if (state->ui.textEdit_1) {
+                                state->ui.textEdit_1->setText("");
+                                state->ui.textEdit_1->setModified(false);
+                            }
+                            ShowActivationMessageBox(window, QMessageBox::Information,
+                                "TaskTray Activation",
+                                "Enrollment completed. You can now open Settings.");
+                            break;
+                        case EnrollmentUpdate::Kind::Failed:
+                            if (update.licenseExpired) {
+                                if (!update.entitlementExpiresAt.empty()) {
+                                    state->cfg.entitlementExpiresAt = update.entitlementExpiresAt;
+                                }
+                                state->cfg.licenseBlocked = true;
+                            }
+                            ShowActivationMessageBox(window, QMessageBox::Warning,
+                                "TaskTray Activation",
+                                QString::fromUtf8(update.message.c_str()));
+                            break;
+                        default:
+                            break;
+                        }
+                        refreshActivationUi();
+                    }, Qt::QueuedConnection);
+                });
         });
     }
 
     // NOTE: Activation validity polling is handled by TaskTrayApp's background thread.
-    auto* activationUiTimer = new QTimer(rawWindow);
-    activationUiTimer->setInterval(2000);
-    QObject::connect(activationUiTimer, &QTimer::timeout, rawWindow, [state, refreshActivationUi, syncActivationEditorsFromConfig]() {
-        ServerActivationConfig latest;
-        latest.machineId = GetMachineId();
-        latest.lanIp = GetLanIpv4();
-        if (LoadServerConfig(latest)) {
-            const bool activatedChanged = (latest.activated != state->cfg.activated);
-            const bool expiryChanged = (latest.entitlementExpiresAt != state->cfg.entitlementExpiresAt);
-            const bool licenseBlockChanged = (latest.licenseBlocked != state->cfg.licenseBlocked);
-            const bool lastCheckChanged = (latest.lastSuccessRefreshAt != state->cfg.lastSuccessRefreshAt);
-            const bool savedNameChanged = (latest.serverName != state->cfg.serverName);
-            if (activatedChanged || expiryChanged || licenseBlockChanged || lastCheckChanged || savedNameChanged) {
+    // The panel follows the persisted config through a store listener, which fires only when the
+    // stored content changes: saves from this process and, through the store's watcher, external
+    // writes. The snapshot is taken on the notifying thread, so the GUI thread only compares fields.
+    QPointer<QMainWindow> configGuard(rawWindow);
+    const int panelConfigListenerId = GetServerConfigStore().AddListener(
+        [configGuard, state, refreshActivationUi, syncActivationEditorsFromConfig](const ServerConfigStore::Status&) {
+            const ServerConfigStore::Snapshot snapshot = GetServerConfigStore().Load();
+            QCoreApplication* app = QCoreApplication::instance();
+            if (!snapshot || !app) return;
+            QMetaObject::invokeMethod(app, [configGuard, state, refreshActivationUi, syncActivationEditorsFromConfig, snapshot]() {
+                if (!configGuard) return;
+                const ServerActivationConfig& latest = *snapshot;
+                const bool activatedChanged = (latest.activated != state->cfg.activated);
+                const bool expiryChanged = (latest.entitlementExpiresAt != state->cfg.entitlementExpiresAt);
+                const bool licenseBlockChanged = (latest.licenseBlocked != state->cfg.licenseBlocked);
+                const bool lastCheckChanged = (latest.lastSuccessRefreshAt != state->cfg.lastSuccessRefreshAt);
+                const bool savedNameChanged = (latest.serverName != state->cfg.serverName);
+                if (!(activatedChanged || expiryChanged || licenseBlockChanged || lastCheckChanged || savedNameChanged)) {
+                    return;
+                }
+                // Derived fields are not always stored; keep the ones the panel already resolved.
+                const std::string machineId = state->cfg.machineId;
+                const std::string lanIp = state->cfg.lanIp;
                 state->cfg = latest;
+                if (state->cfg.machineId.empty() || MachineIdentity::IsPlaceholderMachineId(state->cfg.machineId)) {
+                    state->cfg.machineId = machineId;
+                }
+                if (state->cfg.lanIp.empty()) state->cfg.lanIp = lanIp;
                 syncActivationEditorsFromConfig(true);
                 refreshActivationUi();
-            }
-        } else if (!state->cfg.activated) {
-            refreshActivationUi();
-        }
+            }, Qt::QueuedConnection);
+        });
+    QObject::connect(rawWindow, &QObject::destroyed, [panelConfigListenerId]() {
+        GetServerConfigStore().RemoveListener(panelConfigListenerId);
     });
-    activationUiTimer->start();
 
     // Checkbox exclusive: only one can be selected at a time
     QCheckBox* cb1 = state->ui.checkBox_1;
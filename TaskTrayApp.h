@@ -1,4 +1,4 @@
-#ifndef TASKTRAYAPP_H
+﻿#ifndef TASKTRAYAPP_H
 #define TASKTRAYAPP_H
 
 #include <windows.h>
@@ -8,10 +8,17 @@
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 #include "Globals.h"
 
 class DisplaySyncServer;
 class ModeSyncServer;
+class AsyncHttpClient;
+class TimerScheduler;
+struct ActivationPollState;
+struct EnrollmentUpdate;
+struct ServerActivationConfig;
 class TaskTrayApp {
 public:
     friend LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
@@ -39,9 +46,16 @@ private:
     void UpdateTrayTooltip(const std::wstring& text);
     void ApplyOptimizedPlanToUi(int plan);
 
-    void StartActivationPollThread();
-    void StopActivationPollThread();
-    void ActivationPollThreadProc();
+    void StartActivationPolling();
+    void StopActivationPolling();
+    void ActivationPollTick();
+    // Runs the activation poll job now so it re-reads the config and re-plans the next refresh.
+    void NotifyActivationConfigChanged();
+
+    // Enrolls this device with a pairing code on worker threads; report() is called from those
+    // threads with progress and exactly one final update.
+    void StartEnrollment(ServerActivationConfig cfg, std::string pairingCode,
+        std::shared_ptr<std::atomic<bool>> cancelled, std::function<void(const EnrollmentUpdate&)> report);
 
     void StartServicePolicyThread();
     void StopServicePolicyThread();
@@ -52,20 +66,25 @@ private:
     NOTIFYICONDATA nid;
     DisplaySyncServer* displaySyncServer;
     ModeSyncServer* modeSyncServer;
+    // Activation traffic: async front end over the pooled WinHTTP (or socket) transport.
+    AsyncHttpClient* httpClient;
     std::atomic<int> optimizedPlan{ 1 };
     std::atomic<bool> running = true;
     std::atomic<bool> cleaned = false;
 
+    // Timed background work (activation refresh, HTTP pool eviction): one timer thread plus a
+    // small worker pool.
+    TimerScheduler* timerScheduler;
+    uint64_t httpEvictTimer = 0;
+
     // Background activation / validity polling must run even when the Qt control panel is closed.
-    std::thread activationPollThread;
-    std::atomic<bool> activationPollRunning{ false };
-    std::mutex activationPollMutex;
-    std::condition_variable activationPollCv;
+    ActivationPollState* activationPoll = nullptr;
+    std::atomic<uint64_t> activationPollTimer{ 0 };
+    int configListenerId = 0;              // ServerConfigStore listener that wakes the poll job / policy thread
 
     std::thread servicePolicyThread;
     std::atomic<bool> servicePolicyRunning{ false };
-    std::mutex servicePolicyMutex;
-    std::condition_variable servicePolicyCv;
+    HANDLE servicePolicyWakeEvent;         // auto-reset; signaled on config change and on stop
 };
 
 #endif // TASKTRAYAPP_H
@@ -0,0 +1,427 @@
+#include "TimerScheduler.h"
+
+#include "DebugLog.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr unsigned kSlotBits = 6;   // 64 slots per level
+constexpr uint64_t kSlotMask = (1ull << kSlotBits) - 1;
+
+unsigned LowestSetBit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, v);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+} // namespace
+
+TimerScheduler::TimerScheduler()
+    : TimerScheduler(Options()) {
+}
+
+TimerScheduler::TimerScheduler(Options options)
+    : tick_(options.tick.count() > 0 ? options.tick : Duration(1)),
+      now_(options.now ? std::move(options.now) : std::function<TimePoint()>([]() { return Clock::now(); })),
+      epoch_(now_()) {
+    if (options.startThreads) {
+        const size_t workerCount = options.workerCount == 0 ? 1 : options.workerCount;
+        workers_.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i) {
+            workers_.emplace_back(&TimerScheduler::WorkerProc, this);
+        }
+        timerThread_ = std::thread(&TimerScheduler::TimerThreadProc, this);
+    }
+}
+
+TimerScheduler::~TimerScheduler() {
+    Shutdown();
+}
+
+uint64_t TimerScheduler::TickFor(TimePoint t, bool roundUp) const {
+    if (t <= epoch_) return 0;
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t - epoch_).count();
+    const int64_t tickNs = std::chrono::duration_cast<std::chrono::nanoseconds>(tick_).count();
+    return static_cast<uint64_t>(roundUp ? (ns + tickNs - 1) / tickNs : ns / tickNs);
+}
+
+TimerScheduler::TimePoint TimerScheduler::TimeForTick(uint64_t tick) const {
+    return epoch_ + tick_ * static_cast<int64_t>(tick);
+}
+
+uint64_t TimerScheduler::AlignedExpiryLocked(TimePoint due, Duration slack) {
+    uint64_t earliest = TickFor(due, true);
+    if (earliest < currentTick_) earliest = currentTick_;
+    if (slack.count() <= 0) return earliest;
+
+    const uint64_t latest = TickFor(due + slack, false);
+    if (latest <= earliest) return earliest;
+
+    // Largest power-of-two boundary inside [earliest, latest].
+    for (int shift = 62; shift > 0; --shift) {
+        const uint64_t g = 1ull << shift;
+        if (g > latest) continue;
+        const uint64_t candidate = ((earliest + g - 1) / g) * g;
+        if (candidate <= latest) {
+            if (candidate != earliest) aligned_++;
+            return candidate;
+        }
+    }
+    return earliest;
+}
+
+TimerScheduler::TimerId TimerScheduler::AddLocked(Job job, Duration period, Duration slack, TimePoint due) {
+    auto t = std::make_shared<Timer>();
+    t->id = nextId_++;
+    t->job = std::move(job);
+    t->period = period;
+    t->slack = slack;
+    timers_.emplace(t->id, t);
+    ArmLocked(*t, due);
+    return t->id;
+}
+
+void TimerScheduler::ArmLocked(Timer& t, TimePoint due) {
+    UnplaceLocked(t);
+    t.due = due;
+    if (due == TimePoint::max()) return;    // idle until Reschedule()
+    t.expiryTick = AlignedExpiryLocked(due, t.slack);
+    PlaceLocked(t);
+    t.armed = true;
+    if (t.expiryTick < plannedWakeTick_) {
+        timerCv_.notify_one();
+    }
+}
+
+void TimerScheduler::PlaceLocked(Timer& t) {
+    // Level i holds expiries that share every bit above level i with the current tick; the
+    // slot is the expiry's digit at that level.
+    const uint64_t e = t.expiryTick;
+    for (size_t level = 0; level < kLevels; ++level) {
+        const unsigned highShift = kSlotBits * static_cast<unsigned>(level + 1);
+        if ((e >> highShift) == (currentTick_ >> highShift)) {
+            const size_t slot = static_cast<size_t>((e >> (kSlotBits * level)) & kSlotMask);
+            wheel_[level][slot].push_back(&t);
+            occupied_[level] |= 1ull << slot;
+            t.level = level;
+            t.slot = slot;
+            return;
+        }
+    }
+    beyond_.push_back(&t);
+    t.level = kLevels;
+    t.slot = 0;
+}
+
+void TimerScheduler::UnplaceLocked(Timer& t) {
+    if (!t.armed) return;
+    t.armed = false;
+    Slot& slot = (t.level < kLevels) ? wheel_[t.level][t.slot] : beyond_;
+    for (size_t i = 0; i < slot.size(); ++i) {
+        if (slot[i] == &t) {
+            slot[i] = slot.back();
+            slot.pop_back();
+            break;
+        }
+    }
+    if (t.level < kLevels && slot.empty()) {
+        occupied_[t.level] &= ~(1ull << t.slot);
+    }
+}
+
+bool TimerScheduler::NextEventTickLocked(uint64_t& out) const {
+    const uint64_t c = currentTick_;
+    bool found = false;
+    uint64_t best = UINT64_MAX;
+
+    // Level 0: expiries in the current 64-tick block.
+    const uint64_t bits0 = occupied_[0] & (~0ull << (c & kSlotMask));
+    if (bits0) {
+        best = (c & ~kSlotMask) | LowestSetBit(bits0);
+        found = true;
+    }
+
+    // Higher levels: the tick at which the next occupied slot has to be cascaded down. When the
+    // current tick sits exactly on a boundary that has not been processed yet, its own slot is
+    // still pending.
+    for (size_t level = 1; level < kLevels; ++level) {
+        const unsigned shift = kSlotBits * static_cast<unsigned>(level);
+        const uint64_t index = (c >> shift) & kSlotMask;
+        const uint64_t first = ((c & ((1ull << shift) - 1)) == 0) ? index : index + 1;
+        const uint64_t bits = (first > kSlotMask) ? 0 : (occupied_[level] & (~0ull << first));
+        if (!bits) continue;
+        const uint64_t tick = ((c >> (shift + kSlotBits)) << (shift + kSlotBits)) | (static_cast<uint64_t>(LowestSetBit(bits)) << shift);
+        if (tick < best) best = tick;
+        found = true;
+    }
+
+    if (!beyond_.empty()) {
+        const unsigned topShift = kSlotBits * static_cast<unsigned>(kLevels);
+        const uint64_t topMask = (1ull << topShift) - 1;
+        const uint64_t tick = ((c + topMask) >> topShift) << topShift;
+        if (tick < best) best = tick;
+        found = true;
+    }
+
+    out = best;
+    return found;
+}
+
+void TimerScheduler::AdvanceLocked(uint64_t targetTick, std::vector<std::shared_ptr<Timer>>& expired) {
+    for (;;) {
+        uint64_t next = 0;
+        if (!NextEventTickLocked(next) || next > targetTick) {
+            if (currentTick_ <= targetTick) currentTick_ = targetTick + 1;
+            return;
+        }
+        currentTick_ = next;
+
+        const unsigned topShift = kSlotBits * static_cast<unsigned>(kLevels);
+        if (!beyond_.empty() && (next & ((1ull << topShift) - 1)) == 0) {
+            Slot moved;
+            moved.swap(beyond_);
+            for (Timer* t : moved) PlaceLocked(*t);
+        }
+
+        // Cascade from the top so a timer can drop several levels at one boundary.
+        for (size_t level = kLevels - 1; level >= 1; --level) {
+            const unsigned shift = kSlotBits * static_cast<unsigned>(level);
+            if ((next & ((1ull << shift) - 1)) != 0) continue;
+            const size_t slot = static_cast<size_t>((next >> shift) & kSlotMask);
+            if (!(occupied_[level] & (1ull << slot))) continue;
+            Slot moved;
+            moved.swap(wheel_[level][slot]);
+            occupied_[level] &= ~(1ull << slot);
+            cascades_ += moved.size();
+            for (Timer* t : moved) PlaceLocked(*t);
+        }
+
+        const size_t slot0 = static_cast<size_t>(next & kSlotMask);
+        Slot fired;
+        fired.swap(wheel_[0][slot0]);
+        occupied_[0] &= ~(1ull << slot0);
+        for (Timer* t : fired) {
+            t->armed = false;
+            t->running = true;
+            auto it = timers_.find(t->id);
+            if (it != timers_.end()) expired.push_back(it->second);
+        }
+
+        currentTick_ = next + 1;
+    }
+}
+
+void TimerScheduler::RecordWakeupLocked(TimePoint now) {
+    wakeups_++;
+    recentWakeups_.push_back(now);
+    while (!recentWakeups_.empty() && now - recentWakeups_.front() > std::chrono::minutes(1)) {
+        recentWakeups_.pop_front();
+    }
+}
+
+TimerScheduler::TimerId TimerScheduler::ScheduleAt(TimePoint due, Job job, Duration slack) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return AddLocked(std::move(job), Duration::zero(), slack, due);
+}
+
+TimerScheduler::TimerId TimerScheduler::ScheduleAfter(Duration delay, Job job, Duration slack) {
+    return ScheduleAt(now_() + delay, std::move(job), slack);
+}
+
+TimerScheduler::TimerId TimerScheduler::SchedulePeriodic(Duration period, Job job, Duration slack, bool runImmediately) {
+    if (period < tick_) period = tick_;
+    const TimePoint due = runImmediately ? now_() : now_() + period;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return AddLocked(std::move(job), period, slack, due);
+}
+
+bool TimerScheduler::Reschedule(TimerId id, TimePoint due) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = timers_.find(id);
+    if (it == timers_.end()) return false;
+    Timer& t = *it->second;
+    if (t.running) {
+        if (!t.rearmWhileRunning || due < t.rearmDue) {
+            t.rearmDue = due;
+            t.rearmWhileRunning = true;
+        }
+        return true;
+    }
+    ArmLocked(t, due);
+    return true;
+}
+
+bool TimerScheduler::Cancel(TimerId id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = timers_.find(id);
+    if (it == timers_.end()) return false;
+    std::shared_ptr<Timer> t = it->second;
+    timers_.erase(it);
+    UnplaceLocked(*t);
+    t->cancelled = true;
+    t->rearmWhileRunning = false;
+    if (t->running && t->runner != std::this_thread::get_id()) {
+        doneCv_.wait(lock, [&t]() { return !t->running; });
+    }
+    return true;
+}
+
+void TimerScheduler::Post(Job job) {
+    auto t = std::make_shared<Timer>();
+    t->job = std::move(job);
+    t->running = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        ready_.push_back(std::move(t));
+    }
+    workCv_.notify_one();
+}
+
+void TimerScheduler::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stopping_) {
+            stopping_ = true;
+            for (auto& t : ready_) t->running = false;
+            ready_.clear();
+        }
+    }
+    timerCv_.notify_all();
+    workCv_.notify_all();
+    doneCv_.notify_all();
+
+    auto joinOrDetach = [](std::thread& th) {
+        if (!th.joinable()) return;
+        if (th.get_id() == std::this_thread::get_id()) {
+            th.detach();    // Shutdown() called from a job
+        } else {
+            th.join();
+        }
+    };
+    joinOrDetach(timerThread_);
+    for (auto& w : workers_) joinOrDetach(w);
+    workers_.clear();
+}
+
+size_t TimerScheduler::RunDue() {
+    std::vector<std::shared_ptr<Timer>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const TimePoint now = now_();
+        const uint64_t target = TickFor(now, false);
+        if (workers_.empty()) {
+            // Posted jobs wait in ready_ when there is no worker pool.
+            for (auto& t : ready_) expired.push_back(std::move(t));
+            ready_.clear();
+        }
+        if (target >= currentTick_) AdvanceLocked(target, expired);
+        if (!expired.empty()) RecordWakeupLocked(now);
+    }
+    for (const auto& t : expired) {
+        Execute(t);
+    }
+    return expired.size();
+}
+
+TimerScheduler::Stats TimerScheduler::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.wakeups = wakeups_;
+    s.jobsRun = jobsRun_;
+    s.aligned = aligned_;
+    s.cascades = cascades_;
+    s.timers = timers_.size();
+    const TimePoint now = now_();
+    for (auto it = recentWakeups_.rbegin(); it != recentWakeups_.rend() && now - *it <= std::chrono::minutes(1); ++it) {
+        s.wakeupsLastMinute++;
+    }
+    return s;
+}
+
+void TimerScheduler::Execute(const std::shared_ptr<Timer>& t) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (t->cancelled) {
+            t->running = false;
+            doneCv_.notify_all();
+            return;
+        }
+        t->runner = std::this_thread::get_id();
+    }
+
+    try {
+        t->job();
+    }
+    catch (...) {
+        DebugLog("TimerScheduler: job threw an exception; ignored.");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobsRun_++;
+    t->running = false;
+    t->runner = std::thread::id();
+    if (!t->cancelled) {
+        if (t->rearmWhileRunning) {
+            t->rearmWhileRunning = false;
+            ArmLocked(*t, t->rearmDue);
+        } else if (t->period.count() > 0) {
+            TimePoint next = t->due + t->period;
+            const TimePoint now = now_();
+            if (next <= now) {
+                const auto missed = (now - t->due) / t->period;
+                next = t->due + t->period * (missed + 1);
+            }
+            ArmLocked(*t, next);
+        }
+    }
+    doneCv_.notify_all();
+}
+
+void TimerScheduler::TimerThreadProc() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        uint64_t next = 0;
+        if (NextEventTickLocked(next)) {
+            plannedWakeTick_ = next;
+            timerCv_.wait_until(lock, TimeForTick(next));
+        } else {
+            plannedWakeTick_ = UINT64_MAX;
+            timerCv_.wait(lock);
+        }
+        plannedWakeTick_ = 0;   // awake: arms must not notify
+        if (stopping_) break;
+
+        const TimePoint now = now_();
+        RecordWakeupLocked(now);
+        const uint64_t target = TickFor(now, false);
+        if (target < currentTick_) continue;
+
+        std::vector<std::shared_ptr<Timer>> expired;
+        AdvanceLocked(target, expired);
+        for (auto& t : expired) {
+            ready_.push_back(std::move(t));
+        }
+        if (!ready_.empty()) workCv_.notify_all();
+    }
+}
+
+void TimerScheduler::WorkerProc() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        workCv_.wait(lock, [this]() { return stopping_ || !ready_.empty(); });
+        if (stopping_) return;
+        std::shared_ptr<Timer> t = std::move(ready_.front());
+        ready_.pop_front();
+        lock.unlock();
+        Execute(t);
+        lock.lock();
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// TimerScheduler
+// - One timer thread for the tray's timed background work; jobs run on a small worker pool so
+//   a slow job (an activation refresh waiting on the network) never delays the others.
+// - Timers live in a hierarchical timing wheel (kLevels x 64 slots of `tick` each): inserting,
+//   re-arming and cancelling are O(1), and the timer thread sleeps until the next occupied slot
+//   instead of ticking.
+// - Every timer may specify slack: it fires somewhere in [due, due + slack], at the tick in that
+//   window that is aligned to the largest power-of-two boundary. Timers with similar slack land
+//   on the same boundaries, so their wakeups coalesce.
+// - A timer never runs concurrently with itself. Periodic timers are re-armed from their previous
+//   due time (missed periods are skipped, not queued). One-shot timers stay registered after they
+//   fire so they can be re-armed with Reschedule() until they are cancelled.
+// - The clock is injectable. With Options::startThreads = false nothing runs by itself: the
+//   caller advances a ManualClock and calls RunDue(), which executes due jobs on the calling
+//   thread. That makes schedules reproducible on any platform.
+class TimerScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using Duration = std::chrono::milliseconds;
+    using Job = std::function<void()>;
+    using TimerId = uint64_t;
+
+    static constexpr size_t kLevels = 5;
+    static constexpr size_t kSlotsPerLevel = 64;
+
+    struct Options {
+        Duration tick{ 10 };
+        size_t workerCount = 2;
+        bool startThreads = true;
+        std::function<TimePoint()> now;     // defaults to Clock::now
+    };
+
+    struct Stats {
+        uint64_t wakeups = 0;               // timer thread wakeups (or RunDue calls with work)
+        uint64_t wakeupsLastMinute = 0;
+        uint64_t jobsRun = 0;
+        uint64_t aligned = 0;               // arms that were moved later within their slack
+        uint64_t cascades = 0;              // timers moved down a wheel level
+        size_t timers = 0;                  // registered timers
+    };
+
+    TimerScheduler();
+    explicit TimerScheduler(Options options);
+    ~TimerScheduler();
+
+    TimerScheduler(const TimerScheduler&) = delete;
+    TimerScheduler& operator=(const TimerScheduler&) = delete;
+
+    // A timer scheduled at TimePoint::max() is registered but idle until Reschedule(): the way to
+    // hand a job its own id before it can run.
+    TimerId ScheduleAt(TimePoint due, Job job, Duration slack = Duration::zero());
+    TimerId ScheduleAfter(Duration delay, Job job, Duration slack = Duration::zero());
+    TimerId SchedulePeriodic(Duration period, Job job, Duration slack = Duration::zero(), bool runImmediately = false);
+
+    // Re-arms a timer for `due`. While the job is running, the earliest time requested before it
+    // returns wins, so "run again as soon as possible" from another thread is never lost to the
+    // job re-arming itself for later.
+    bool Reschedule(TimerId id, TimePoint due);
+
+    // Removes the timer. If its job is running, waits for it to return unless called from that
+    // job itself.
+    bool Cancel(TimerId id);
+
+    // Runs job once on the worker pool as soon as a worker is free. The job is not a timer: it has
+    // no id and cannot be cancelled. Dropped after Shutdown().
+    void Post(Job job);
+
+    // Stops the timer thread and the workers. Queued jobs that have not started are dropped;
+    // running jobs finish first.
+    void Shutdown();
+
+    // Executes every job due at now() on the calling thread. For startThreads = false.
+    size_t RunDue();
+
+    TimePoint Now() const { return now_(); }
+    Stats GetStats() const;
+
+private:
+    struct Timer {
+        TimerId id = 0;
+        Job job;
+        Duration period{ 0 };           // zero: one-shot
+        Duration slack{ 0 };
+        TimePoint due{};                // requested time of the next run
+        uint64_t expiryTick = 0;
+        size_t level = kLevels;         // wheel position while armed; kLevels = beyond_
+        size_t slot = 0;
+        bool armed = false;
+        bool running = false;           // queued or executing
+        bool cancelled = false;
+        bool rearmWhileRunning = false;
+        TimePoint rearmDue{};
+        std::thread::id runner;
+    };
+
+    using Slot = std::vector<Timer*>;
+
+    uint64_t TickFor(TimePoint t, bool roundUp) const;
+    TimePoint TimeForTick(uint64_t tick) const;
+    uint64_t AlignedExpiryLocked(TimePoint due, Duration slack);
+
+    TimerId AddLocked(Job job, Duration period, Duration slack, TimePoint due);
+    void ArmLocked(Timer& t, TimePoint due);
+    void PlaceLocked(Timer& t);
+    void UnplaceLocked(Timer& t);
+    bool NextEventTickLocked(uint64_t& out) const;
+    void AdvanceLocked(uint64_t targetTick, std::vector<std::shared_ptr<Timer>>& expired);
+    void RecordWakeupLocked(TimePoint now);
+
+    void Execute(const std::shared_ptr<Timer>& t);
+    void TimerThreadProc();
+    void WorkerProc();
+
+    const Duration tick_;
+    const std::function<TimePoint()> now_;
+    const TimePoint epoch_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable timerCv_;
+    std::condition_variable workCv_;
+    std::condition_variable doneCv_;
+    bool stopping_ = false;
+
+    std::array<std::array<Slot, kSlotsPerLevel>, kLevels> wheel_;
+    std::array<uint64_t, kLevels> occupied_{};     // bit per non-empty slot
+    Slot beyond_;                                   // expiries past the top level's range
+    uint64_t currentTick_ = 0;                      // next tick to process
+    uint64_t plannedWakeTick_ = UINT64_MAX;         // tick the timer thread sleeps towards
+
+    std::unordered_map<TimerId, std::shared_ptr<Timer>> timers_;
+    TimerId nextId_ = 1;
+
+    std::deque<std::shared_ptr<Timer>> ready_;
+    std::thread timerThread_;
+    std::vector<std::thread> workers_;
+
+    uint64_t wakeups_ = 0;
+    uint64_t jobsRun_ = 0;
+    uint64_t aligned_ = 0;
+    uint64_t cascades_ = 0;
+    std::deque<TimePoint> recentWakeups_;           // last minute, for wakeupsLastMinute
+};
+
+// Test clock for TimerScheduler::Options::now.
+class ManualClock
+{
+public:
+    explicit ManualClock(TimerScheduler::TimePoint start = TimerScheduler::TimePoint{}) : now_(start) {}
+
+    TimerScheduler::TimePoint Now() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return now_;
+    }
+
+    void Advance(TimerScheduler::Duration d)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        now_ += d;
+    }
+
+    std::function<TimerScheduler::TimePoint()> AsFunction() const
+    {
+        return [this]() { return Now(); };
+    }
+
+private:
+    mutable std::mutex mutex_;
+    TimerScheduler::TimePoint now_;
+};
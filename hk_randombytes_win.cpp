@@ -1,11 +1,9 @@
 #include "hk_tweetnacl_sign.h"
 
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h>
-#include <bcrypt.h>
+#include <algorithm>
+#include <cstring>
 
-#pragma comment(lib, "bcrypt.lib")
+#include "SecureRandom.h"
 
 extern "C" void randombytes(uint8_t* out, uint64_t outlen)
 {
@@ -17,10 +15,10 @@ extern "C" void randombytes(uint8_t* out, uint64_t outlen)
     uint64_t remaining = outlen;
 
     while (remaining > 0) {
-        ULONG chunk = (remaining > 0x7fffffffULL) ? 0x7fffffffUL : (ULONG)remaining;
-        NTSTATUS st = BCryptGenRandom(nullptr, p, chunk, BCRYPT_USE_SYSTEM_PREFERRED_RNG);
-        if (st < 0) {
-            SecureZeroMemory(p, (SIZE_T)chunk);
+        const size_t chunk = static_cast<size_t>((std::min<uint64_t>)(remaining, 0x7fffffffULL));
+        if (!SecureRandom::Fill(p, chunk)) {
+            // Fill() zeroed this chunk; zero the rest as well.
+            std::memset(p, 0, static_cast<size_t>(remaining));
             return;
         }
         p += chunk;
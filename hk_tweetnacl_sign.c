@@ -9,12 +9,23 @@
 // We only implement:
 //   - crypto_sign_keypair
 //   - crypto_sign  (produces sig||msg)
+//   - hk_sign_ctx_* / hk_sign_detached (expanded key, detached signature)
+//   - crypto_sign_open / hk_sign_verify_detached
+//   - hk_sign_verify_batch (random linear combination + multi-scalar multiplication)
 //
 // The implementation includes:
-//   - SHA-512 (crypto_hash)
-//   - Curve25519 field ops and Edwards group ops needed for scalarbase + point pack
+//   - SHA-512 (crypto_hash and the incremental hk_sha512_*, so messages are hashed in place),
+//     with an unrolled scalar and an AVX2 compression function chosen at run time
+//   - Curve25519 field ops in radix 2^51 (5 x 64-bit limbs, 64x64->128-bit products)
+//   - Edwards group ops in extended / completed / precomputed (Niels) coordinates
+//   - Fixed-base scalar multiplication with signed 4-bit windows over a precomputed
+//     table of multiples of 256^i * B (hk_ed25519_base.h), as in ref10 / ed25519-donna
 //   - Scalar reduction mod L (group order)
 //
+// Signatures are deterministic (RFC 8032), so the output is byte-identical to the
+// original TweetNaCl field code; only the arithmetic changed. Table lookups and
+// conditional moves are constant time.
+//
 // NOTE:
 //   This module expects a secure random generator provided by:
 //       void randombytes(uint8_t* out, uint64_t outlen);
@@ -24,6 +35,11 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if !defined(HK_ED25519_PORTABLE_MUL) && !defined(__SIZEOF_INT128__) && \
+    defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
 #define FOR(i,n) for ((i) = 0; (i) < (n); ++(i))
 #define sv static void
 
@@ -32,40 +48,6 @@ typedef uint32_t u32;
 typedef uint64_t u64;
 typedef int64_t i64;
 
-typedef i64 gf[16];
-
-static const u8 _0[16];
-static const u8 _9[32] = {9};
-
-static const gf gf0;
-static const gf gf1 = {1};
-static const gf _121665 = {0xDB41, 1};
-
-static const gf D = {0x78a3, 0x1359, 0x4dca, 0x75eb,
-                     0xd8ab, 0x4141, 0x0a4d, 0x0070,
-                     0xe898, 0x7779, 0x4079, 0x8cc7,
-                     0xfe73, 0x2b6f, 0x6cee, 0x5203};
-
-static const gf D2 = {0xf159, 0x26b2, 0x9b94, 0xebd6,
-                      0xb156, 0x8283, 0x149a, 0x00e0,
-                      0xd130, 0xeef3, 0x80f2, 0x198e,
-                      0xfce7, 0x56df, 0xd9dc, 0x2406};
-
-static const gf X = {0xd51a, 0x8f25, 0x2d60, 0xc956,
-                     0xa7b2, 0x9525, 0xc760, 0x692c,
-                     0xdc5c, 0xfdd6, 0xe231, 0xc0a4,
-                     0x53fe, 0xcd6e, 0x36d3, 0x2169};
-
-static const gf Y = {0x6658, 0x6666, 0x6666, 0x6666,
-                     0x6666, 0x6666, 0x6666, 0x6666,
-                     0x6666, 0x6666, 0x6666, 0x6666,
-                     0x6666, 0x6666, 0x6666, 0x6666};
-
-static const gf I = {0xa0b0, 0x4a0e, 0x1b27, 0xc4ee,
-                     0xe478, 0xad2f, 0x1806, 0x2f43,
-                     0xd7a7, 0x3dfb, 0x0099, 0x2b4d,
-                     0xdf0b, 0x4fc1, 0x2480, 0x2b83};
-
 // Group order L in little-endian bytes.
 static const u8 L[32] = {
     0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
@@ -74,16 +56,6 @@ static const u8 L[32] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
 };
 
-static u32 L32(u32 x, int c) { return (x << c) | ((x & 0xffffffffu) >> (32 - c)); }
-
-static u32 ld32(const u8* x)
-{
-    u32 u = x[3];
-    u = (u << 8) | x[2];
-    u = (u << 8) | x[1];
-    return (u << 8) | x[0];
-}
-
 static u64 dl64(const u8* x)
 {
     u64 i, u = 0;
@@ -91,237 +63,674 @@ static u64 dl64(const u8* x)
     return u;
 }
 
-sv st32(u8* x, u32 u)
+sv ts64(u8* x, u64 u)
 {
     int i;
-    FOR(i, 4) { x[i] = (u8)u; u >>= 8; }
+    for (i = 7; i >= 0; --i) { x[i] = (u8)u; u >>= 8; }
 }
 
-sv ts64(u8* x, u64 u)
+// memset() that the compiler may not drop for dead stores: the call goes through a
+// volatile pointer, so it cannot be proven to be memset and elided.
+static void* (*volatile wipe_memset)(void*, int, size_t) = memset;
+
+sv wipe(void* p, size_t n)
 {
+    wipe_memset(p, 0, n);
+}
+
+static u64 ld64(const u8* x)
+{
+    u64 u = 0;
     int i;
-    for (i = 7; i >= 0; --i) { x[i] = (u8)u; u >>= 8; }
+    for (i = 7; i >= 0; --i) u = (u << 8) | x[i];
+    return u;
+}
+
+sv st64(u8* x, u64 u)
+{
+    int i;
+    FOR(i, 8) { x[i] = (u8)u; u >>= 8; }
+}
+
+// -----------------------------------------------------------------------------
+// 64x64 -> 128-bit products
+// -----------------------------------------------------------------------------
+//
+// Field products are accumulated in 128 bits: native __int128 where the compiler
+// has it (GCC / Clang), the high-half multiply intrinsic on MSVC x64 / ARM64, and
+// 32-bit partial products otherwise (HK_ED25519_PORTABLE_MUL forces that path).
+
+#if !defined(HK_ED25519_PORTABLE_MUL) && defined(__SIZEOF_INT128__)
+
+typedef unsigned __int128 u128;
+
+static inline u128 mul64(u64 a, u64 b) { return (u128)a * b; }
+static inline void mac64(u128* r, u64 a, u64 b) { *r += (u128)a * b; }
+static inline void add128_64(u128* r, u64 a) { *r += a; }
+static inline u64 lo128(u128 r) { return (u64)r; }
+static inline u64 shr128(u128 r, int s) { return (u64)(r >> s); }
+
+#else
+
+typedef struct { u64 lo, hi; } u128;
+
+static inline u128 mul64(u64 a, u64 b)
+{
+    u128 r;
+#if !defined(HK_ED25519_PORTABLE_MUL) && defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    r.lo = a * b;
+    r.hi = __umulh(a, b);
+#else
+    const u64 a0 = (u32)a, a1 = a >> 32, b0 = (u32)b, b1 = b >> 32;
+    const u64 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    const u64 mid = (p00 >> 32) + (u32)p01 + (u32)p10;
+    r.lo = (mid << 32) | (u32)p00;
+    r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+    return r;
 }
 
-static int vn(const u8* x, const u8* y, int n)
+static inline void mac64(u128* r, u64 a, u64 b)
 {
-    u32 i, d = 0;
-    FOR(i, (u32)n) d |= x[i] ^ y[i];
-    return (1 & ((d - 1) >> 8)) - 1;
+    const u128 p = mul64(a, b);
+    r->lo += p.lo;
+    r->hi += p.hi + (r->lo < p.lo);
 }
 
-static int crypto_verify_32(const u8* x, const u8* y) { return vn(x, y, 32); }
+static inline void add128_64(u128* r, u64 a)
+{
+    r->lo += a;
+    r->hi += (r->lo < a);
+}
+
+static inline u64 lo128(u128 r) { return r.lo; }
+static inline u64 shr128(u128 r, int s) { return (r.lo >> s) | (r.hi << (64 - s)); }
+
+#endif
 
 // -----------------------------------------------------------------------------
-// Field ops
+// Field ops (GF(2^255 - 19), radix 2^51)
 // -----------------------------------------------------------------------------
+//
+// Limbs are kept below 2^51 + 2^13 after every operation: add / sub carry right
+// away, so any result can feed a multiplication without overflowing its 128-bit
+// accumulators.
 
-sv set25519(gf r, const gf a)
+typedef u64 fe[5];
+
+#define MASK51 ((u64)0x7ffffffffffffULL)
+
+static const fe fe_d = { 0x34dca135978a3ULL, 0x1a8283b156ebdULL, 0x5e7a26001c029ULL, 0x739c663a03cbbULL, 0x52036cee2b6ffULL };
+static const fe fe_d2 = { 0x69b9426b2f159ULL, 0x35050762add7aULL, 0x3cf44c0038052ULL, 0x6738cc7407977ULL, 0x2406d9dc56dffULL };
+static const fe fe_sqrtm1 = { 0x61b274a0ea0b0ULL, 0x0d5a5fc8f189dULL, 0x7ef5e9cbd0c60ULL, 0x78595a6804c9eULL, 0x2b8324804fc1dULL };
+
+sv fe_0(fe h)
 {
-    int i;
-    FOR(i, 16) r[i] = a[i];
+    h[0] = h[1] = h[2] = h[3] = h[4] = 0;
 }
 
-sv car25519(gf o)
+sv fe_1(fe h)
 {
-    int i;
-    i64 c;
-    FOR(i, 16) {
-        o[i] += (1LL << 16);
-        c = o[i] >> 16;
-        o[(i + 1) * (i < 15)] += c - 1 + 37 * (c - 1) * (i == 15);
-        o[i] -= c << 16;
-    }
+    h[0] = 1;
+    h[1] = h[2] = h[3] = h[4] = 0;
 }
 
-sv sel25519(gf p, gf q, int b)
+sv fe_copy(fe h, const fe f)
 {
-    i64 t, i, c = ~(b - 1);
-    FOR(i, 16) {
-        t = c & (p[i] ^ q[i]);
-        p[i] ^= t;
-        q[i] ^= t;
-    }
+    h[0] = f[0]; h[1] = f[1]; h[2] = f[2]; h[3] = f[3]; h[4] = f[4];
 }
 
-sv pack25519(u8* o, const gf n)
+sv fe_carry(fe h)
 {
-    int i, j, b;
-    gf m, t;
+    u64 c;
+    c = h[0] >> 51; h[0] &= MASK51; h[1] += c;
+    c = h[1] >> 51; h[1] &= MASK51; h[2] += c;
+    c = h[2] >> 51; h[2] &= MASK51; h[3] += c;
+    c = h[3] >> 51; h[3] &= MASK51; h[4] += c;
+    c = h[4] >> 51; h[4] &= MASK51; h[0] += c * 19;
+}
 
-    FOR(i, 16) t[i] = n[i];
-    car25519(t);
-    car25519(t);
-    car25519(t);
+sv fe_add(fe h, const fe f, const fe g)
+{
+    h[0] = f[0] + g[0];
+    h[1] = f[1] + g[1];
+    h[2] = f[2] + g[2];
+    h[3] = f[3] + g[3];
+    h[4] = f[4] + g[4];
+    fe_carry(h);
+}
 
-    FOR(j, 2) {
-        m[0] = t[0] - 0xffed;
-        for (i = 1; i < 15; i++) {
-            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
-            m[i - 1] &= 0xffff;
-        }
-        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
-        b = (int)((m[15] >> 16) & 1);
-        m[14] &= 0xffff;
-        sel25519(t, m, 1 - b);
-    }
+// f - g computed as f + 2p - g so no limb goes negative.
+sv fe_sub(fe h, const fe f, const fe g)
+{
+    h[0] = (f[0] + 0xfffffffffffdaULL) - g[0];
+    h[1] = (f[1] + 0xffffffffffffeULL) - g[1];
+    h[2] = (f[2] + 0xffffffffffffeULL) - g[2];
+    h[3] = (f[3] + 0xffffffffffffeULL) - g[3];
+    h[4] = (f[4] + 0xffffffffffffeULL) - g[4];
+    fe_carry(h);
+}
 
-    FOR(i, 16) {
-        o[2 * i] = (u8)(t[i] & 0xff);
-        o[2 * i + 1] = (u8)((u64)t[i] >> 8);
-    }
+sv fe_neg(fe h, const fe f)
+{
+    fe zero;
+    fe_0(zero);
+    fe_sub(h, zero, f);
 }
 
-static int neq25519(const gf a, const gf b)
+// Carries the five 128-bit column sums into h.
+sv fe_reduce128(fe h, u128 r0, u128 r1, u128 r2, u128 r3, u128 r4)
 {
-    u8 c[32], d[32];
-    pack25519(c, a);
-    pack25519(d, b);
-    return crypto_verify_32(c, d);
+    u64 c;
+    c = shr128(r0, 51); h[0] = lo128(r0) & MASK51; add128_64(&r1, c);
+    c = shr128(r1, 51); h[1] = lo128(r1) & MASK51; add128_64(&r2, c);
+    c = shr128(r2, 51); h[2] = lo128(r2) & MASK51; add128_64(&r3, c);
+    c = shr128(r3, 51); h[3] = lo128(r3) & MASK51; add128_64(&r4, c);
+    c = shr128(r4, 51); h[4] = lo128(r4) & MASK51;
+    h[0] += c * 19;
+    c = h[0] >> 51; h[0] &= MASK51; h[1] += c;
 }
 
-static u8 par25519(const gf a)
+sv fe_mul(fe h, const fe f, const fe g)
 {
-    u8 d[32];
-    pack25519(d, a);
-    return d[0] & 1;
+    const u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    const u64 g0 = g[0], g1 = g[1], g2 = g[2], g3 = g[3], g4 = g[4];
+    const u64 g1_19 = g1 * 19, g2_19 = g2 * 19, g3_19 = g3 * 19, g4_19 = g4 * 19;
+    u128 r0, r1, r2, r3, r4;
+
+    r0 = mul64(f0, g0); mac64(&r0, f1, g4_19); mac64(&r0, f2, g3_19); mac64(&r0, f3, g2_19); mac64(&r0, f4, g1_19);
+    r1 = mul64(f0, g1); mac64(&r1, f1, g0);    mac64(&r1, f2, g4_19); mac64(&r1, f3, g3_19); mac64(&r1, f4, g2_19);
+    r2 = mul64(f0, g2); mac64(&r2, f1, g1);    mac64(&r2, f2, g0);    mac64(&r2, f3, g4_19); mac64(&r2, f4, g3_19);
+    r3 = mul64(f0, g3); mac64(&r3, f1, g2);    mac64(&r3, f2, g1);    mac64(&r3, f3, g0);    mac64(&r3, f4, g4_19);
+    r4 = mul64(f0, g4); mac64(&r4, f1, g3);    mac64(&r4, f2, g2);    mac64(&r4, f3, g1);    mac64(&r4, f4, g0);
+
+    fe_reduce128(h, r0, r1, r2, r3, r4);
 }
 
-sv unpack25519(gf o, const u8* n)
+sv fe_sq(fe h, const fe f)
 {
-    int i;
-    FOR(i, 16) o[i] = (i64)n[2 * i] + ((i64)n[2 * i + 1] << 8);
-    o[15] &= 0x7fff;
+    const u64 f0 = f[0], f1 = f[1], f2 = f[2], f3 = f[3], f4 = f[4];
+    const u64 f0_2 = f0 * 2, f1_2 = f1 * 2;
+    const u64 f2_38 = f2 * 38, f3_19 = f3 * 19, f4_19 = f4 * 19, f4_38 = f4 * 38;
+    u128 r0, r1, r2, r3, r4;
+
+    r0 = mul64(f0, f0);   mac64(&r0, f1, f4_38); mac64(&r0, f2_38, f3);
+    r1 = mul64(f0_2, f1); mac64(&r1, f2, f4_38); mac64(&r1, f3, f3_19);
+    r2 = mul64(f0_2, f2); mac64(&r2, f1, f1);    mac64(&r2, f3, f4_38);
+    r3 = mul64(f0_2, f3); mac64(&r3, f1_2, f2);  mac64(&r3, f4, f4_19);
+    r4 = mul64(f0_2, f4); mac64(&r4, f1_2, f3);  mac64(&r4, f2, f2);
+
+    fe_reduce128(h, r0, r1, r2, r3, r4);
 }
 
-sv A(gf o, const gf a, const gf b)
+// h = f^(2^n), n >= 1.
+sv fe_sqn(fe h, const fe f, int n)
 {
-    int i;
-    FOR(i, 16) o[i] = a[i] + b[i];
+    fe_sq(h, f);
+    while (--n > 0) fe_sq(h, h);
 }
 
-sv Z(gf o, const gf a, const gf b)
+// h = f^(p - 2) = 1/f.
+sv fe_invert(fe h, const fe f)
 {
-    int i;
-    FOR(i, 16) o[i] = a[i] - b[i];
+    fe z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+    fe_sq(z2, f);
+    fe_sqn(t, z2, 2);
+    fe_mul(z9, t, f);
+    fe_mul(z11, z9, z2);
+    fe_sq(t, z11);
+    fe_mul(z2_5_0, t, z9);
+    fe_sqn(t, z2_5_0, 5);
+    fe_mul(z2_10_0, t, z2_5_0);
+    fe_sqn(t, z2_10_0, 10);
+    fe_mul(z2_20_0, t, z2_10_0);
+    fe_sqn(t, z2_20_0, 20);
+    fe_mul(t, t, z2_20_0);
+    fe_sqn(t, t, 10);
+    fe_mul(z2_50_0, t, z2_10_0);
+    fe_sqn(t, z2_50_0, 50);
+    fe_mul(z2_100_0, t, z2_50_0);
+    fe_sqn(t, z2_100_0, 100);
+    fe_mul(t, t, z2_100_0);
+    fe_sqn(t, t, 50);
+    fe_mul(t, t, z2_50_0);
+    fe_sqn(t, t, 5);
+    fe_mul(h, t, z11);
 }
 
-sv M(gf o, const gf a, const gf b)
+// Canonical little-endian encoding (fully reduced mod p).
+sv fe_tobytes(u8* s, const fe f)
 {
-    i64 t[31];
-    int i, j;
+    fe h;
+    u64 q;
+
+    fe_copy(h, f);
+    fe_carry(h);
+
+    // q = 1 iff h >= p.
+    q = (h[0] + 19) >> 51;
+    q = (h[1] + q) >> 51;
+    q = (h[2] + q) >> 51;
+    q = (h[3] + q) >> 51;
+    q = (h[4] + q) >> 51;
+
+    h[0] += 19 * q;
+    h[1] += h[0] >> 51; h[0] &= MASK51;
+    h[2] += h[1] >> 51; h[1] &= MASK51;
+    h[3] += h[2] >> 51; h[2] &= MASK51;
+    h[4] += h[3] >> 51; h[3] &= MASK51;
+    h[4] &= MASK51;
+
+    st64(s + 0, h[0] | (h[1] << 51));
+    st64(s + 8, (h[1] >> 13) | (h[2] << 38));
+    st64(s + 16, (h[2] >> 26) | (h[3] << 25));
+    st64(s + 24, (h[3] >> 39) | (h[4] << 12));
+}
 
-    FOR(i, 31) t[i] = 0;
-    FOR(i, 16) FOR(j, 16) t[i + j] += a[i] * b[j];
-    FOR(i, 15) t[i] += 38 * t[i + 16];
-    FOR(i, 16) o[i] = t[i];
-    car25519(o);
-    car25519(o);
+// Loads 255 bits (the top bit of s[31] is ignored).
+sv fe_frombytes(fe h, const u8* s)
+{
+    h[0] = ld64(s) & MASK51;
+    h[1] = (ld64(s + 6) >> 3) & MASK51;
+    h[2] = (ld64(s + 12) >> 6) & MASK51;
+    h[3] = (ld64(s + 19) >> 1) & MASK51;
+    h[4] = (ld64(s + 24) >> 12) & MASK51;
 }
 
-sv S(gf o, const gf a) { M(o, a, a); }
+// h = f^((p - 5) / 8), for square roots.
+sv fe_pow22523(fe h, const fe f)
+{
+    fe z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+    fe_sq(z2, f);
+    fe_sqn(t, z2, 2);
+    fe_mul(z9, t, f);
+    fe_mul(z11, z9, z2);
+    fe_sq(t, z11);
+    fe_mul(z2_5_0, t, z9);
+    fe_sqn(t, z2_5_0, 5);
+    fe_mul(z2_10_0, t, z2_5_0);
+    fe_sqn(t, z2_10_0, 10);
+    fe_mul(z2_20_0, t, z2_10_0);
+    fe_sqn(t, z2_20_0, 20);
+    fe_mul(t, t, z2_20_0);
+    fe_sqn(t, t, 10);
+    fe_mul(z2_50_0, t, z2_10_0);
+    fe_sqn(t, z2_50_0, 50);
+    fe_mul(z2_100_0, t, z2_50_0);
+    fe_sqn(t, z2_100_0, 100);
+    fe_mul(t, t, z2_100_0);
+    fe_sqn(t, t, 50);
+    fe_mul(t, t, z2_50_0);
+    fe_sqn(t, t, 2);
+    fe_mul(h, t, f);
+}
 
-sv inv25519(gf o, const gf i)
+static int fe_iszero(const fe f)
 {
-    gf c;
-    int a;
-    FOR(a, 16) c[a] = i[a];
-    for (a = 253; a >= 0; a--) {
-        S(c, c);
-        if (a != 2 && a != 4) M(c, c, i);
-    }
-    FOR(a, 16) o[a] = c[a];
+    u8 s[32];
+    u8 d = 0;
+    int i;
+    fe_tobytes(s, f);
+    FOR(i, 32) d |= s[i];
+    return d == 0;
 }
 
-sv pow2523(gf o, const gf i)
+static u8 fe_isnegative(const fe f)
 {
-    gf c;
-    int a;
-    FOR(a, 16) c[a] = i[a];
-    for (a = 250; a >= 0; a--) {
-        S(c, c);
-        if (a != 1) M(c, c, i);
-    }
-    FOR(a, 16) o[a] = c[a];
+    u8 s[32];
+    fe_tobytes(s, f);
+    return s[0] & 1;
+}
+
+// f = g if b == 1, unchanged if b == 0; constant time.
+sv fe_cmov(fe f, const fe g, u64 b)
+{
+    const u64 mask = (u64)0 - b;
+    f[0] ^= mask & (f[0] ^ g[0]);
+    f[1] ^= mask & (f[1] ^ g[1]);
+    f[2] ^= mask & (f[2] ^ g[2]);
+    f[3] ^= mask & (f[3] ^ g[3]);
+    f[4] ^= mask & (f[4] ^ g[4]);
 }
 
 // -----------------------------------------------------------------------------
 // Edwards helpers used by scalarbase/pack
 // -----------------------------------------------------------------------------
+//
+//   ge_p2     (X:Y:Z)      x = X/Z, y = Y/Z
+//   ge_p3     (X:Y:Z:T)    extended, XY = ZT
+//   ge_p1p1   ((X:Z),(Y:T)) completed, x = X/Z, y = Y/T
+//   ge_precomp (y+x, y-x, 2dxy) affine Niels form, for table entries
+//   ge_cached (Y+X, Y-X, Z, 2dT) projective Niels form, for variable points
+
+typedef struct { fe X, Y, Z; } ge_p2;
+typedef struct { fe X, Y, Z, T; } ge_p3;
+typedef struct { fe X, Y, Z, T; } ge_p1p1;
+typedef struct { fe yplusx, yminusx, xy2d; } ge_precomp;
+typedef struct { fe YplusX, YminusX, Z, T2d; } ge_cached;
+
+#include "hk_ed25519_base.h"
+
+sv ge_p3_0(ge_p3* h)
+{
+    fe_0(h->X);
+    fe_1(h->Y);
+    fe_1(h->Z);
+    fe_0(h->T);
+}
+
+sv ge_precomp_0(ge_precomp* h)
+{
+    fe_1(h->yplusx);
+    fe_1(h->yminusx);
+    fe_0(h->xy2d);
+}
 
-sv add(gf p[4], gf q[4])
+sv ge_p1p1_to_p2(ge_p2* r, const ge_p1p1* p)
 {
-    gf a, b, c, d, t, e, f, g, h;
+    fe_mul(r->X, p->X, p->T);
+    fe_mul(r->Y, p->Y, p->Z);
+    fe_mul(r->Z, p->Z, p->T);
+}
 
-    Z(a, p[1], p[0]);
-    Z(t, q[1], q[0]);
-    M(a, a, t);
-    A(b, p[0], p[1]);
-    A(t, q[0], q[1]);
-    M(b, b, t);
-    M(c, p[3], q[3]);
-    M(c, c, D2);
-    M(d, p[2], q[2]);
-    A(d, d, d);
-    Z(e, b, a);
-    Z(f, d, c);
-    A(g, d, c);
-    A(h, b, a);
+sv ge_p1p1_to_p3(ge_p3* r, const ge_p1p1* p)
+{
+    fe_mul(r->X, p->X, p->T);
+    fe_mul(r->Y, p->Y, p->Z);
+    fe_mul(r->Z, p->Z, p->T);
+    fe_mul(r->T, p->X, p->Y);
+}
 
-    M(p[0], e, f);
-    M(p[1], h, g);
-    M(p[2], g, f);
-    M(p[3], e, h);
+sv ge_p3_to_p2(ge_p2* r, const ge_p3* p)
+{
+    fe_copy(r->X, p->X);
+    fe_copy(r->Y, p->Y);
+    fe_copy(r->Z, p->Z);
 }
 
-sv cswap(gf p[4], gf q[4], u8 b)
+// r = 2p (dbl-2008-hwcd).
+sv ge_p2_dbl(ge_p1p1* r, const ge_p2* p)
 {
-    int i;
-    FOR(i, 4) sel25519(p[i], q[i], b);
+    fe t0;
+
+    fe_sq(r->X, p->X);
+    fe_sq(r->Z, p->Y);
+    fe_sq(r->T, p->Z);
+    fe_add(r->T, r->T, r->T);
+    fe_add(r->Y, p->X, p->Y);
+    fe_sq(t0, r->Y);
+    fe_add(r->Y, r->Z, r->X);
+    fe_sub(r->Z, r->Z, r->X);
+    fe_sub(r->X, t0, r->Y);
+    fe_sub(r->T, r->T, r->Z);
 }
 
-sv pack(u8* r, gf p[4])
+sv ge_p3_dbl(ge_p1p1* r, const ge_p3* p)
 {
-    gf tx, ty, zi;
+    ge_p2 q;
+    ge_p3_to_p2(&q, p);
+    ge_p2_dbl(r, &q);
+}
+
+// r = p + q for an affine precomputed q (madd-2008-hwcd-3).
+sv ge_madd(ge_p1p1* r, const ge_p3* p, const ge_precomp* q)
+{
+    fe t0;
+
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->yplusx);
+    fe_mul(r->Y, r->Y, q->yminusx);
+    fe_mul(r->T, q->xy2d, p->T);
+    fe_add(t0, p->Z, p->Z);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_add(r->Z, t0, r->T);
+    fe_sub(r->T, t0, r->T);
+}
+
+// r = p - q for an affine precomputed q.
+sv ge_msub(ge_p1p1* r, const ge_p3* p, const ge_precomp* q)
+{
+    fe t0;
+
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->yminusx);
+    fe_mul(r->Y, r->Y, q->yplusx);
+    fe_mul(r->T, q->xy2d, p->T);
+    fe_add(t0, p->Z, p->Z);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_sub(r->Z, t0, r->T);
+    fe_add(r->T, t0, r->T);
+}
 
-    inv25519(zi, p[2]);
-    M(tx, p[0], zi);
-    M(ty, p[1], zi);
+sv ge_p3_to_cached(ge_cached* r, const ge_p3* p)
+{
+    fe_add(r->YplusX, p->Y, p->X);
+    fe_sub(r->YminusX, p->Y, p->X);
+    fe_copy(r->Z, p->Z);
+    fe_mul(r->T2d, p->T, fe_d2);
+}
 
-    pack25519(r, ty);
-    r[31] ^= (u8)(par25519(tx) << 7);
+// r = p + q (add-2008-hwcd-3).
+sv ge_add(ge_p1p1* r, const ge_p3* p, const ge_cached* q)
+{
+    fe t0;
+
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->YplusX);
+    fe_mul(r->Y, r->Y, q->YminusX);
+    fe_mul(r->T, q->T2d, p->T);
+    fe_mul(r->X, p->Z, q->Z);
+    fe_add(t0, r->X, r->X);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_add(r->Z, t0, r->T);
+    fe_sub(r->T, t0, r->T);
 }
 
-sv scalarmult(gf p[4], gf q[4], const u8* s)
+// r = p - q.
+sv ge_sub(ge_p1p1* r, const ge_p3* p, const ge_cached* q)
 {
+    fe t0;
+
+    fe_add(r->X, p->Y, p->X);
+    fe_sub(r->Y, p->Y, p->X);
+    fe_mul(r->Z, r->X, q->YminusX);
+    fe_mul(r->Y, r->Y, q->YplusX);
+    fe_mul(r->T, q->T2d, p->T);
+    fe_mul(r->X, p->Z, q->Z);
+    fe_add(t0, r->X, r->X);
+    fe_sub(r->X, r->Z, r->Y);
+    fe_add(r->Y, r->Z, r->Y);
+    fe_sub(r->Z, t0, r->T);
+    fe_add(r->T, t0, r->T);
+}
+
+sv ge_p3_neg(ge_p3* r, const ge_p3* p)
+{
+    fe_neg(r->X, p->X);
+    fe_copy(r->Y, p->Y);
+    fe_copy(r->Z, p->Z);
+    fe_neg(r->T, p->T);
+}
+
+// Decodes a point (RFC 8032 5.1.3). Rejects non-canonical y, x = 0 with the sign
+// bit set, and y values with no point on the curve. Variable time.
+static int ge_frombytes_vartime(ge_p3* h, const u8* s)
+{
+    fe u, v, v3, vxx, check;
+    u8 enc[32];
     int i;
-    set25519(p[0], gf0);
-    set25519(p[1], gf1);
-    set25519(p[2], gf1);
-    set25519(p[3], gf0);
 
-    for (i = 255; i >= 0; --i) {
-        u8 b = (u8)((s[i / 8] >> (i & 7)) & 1);
-        cswap(p, q, b);
-        add(q, p);
-        add(p, p);
-        cswap(p, q, b);
+    fe_frombytes(h->Y, s);
+    fe_tobytes(enc, h->Y);
+    enc[31] |= (u8)(s[31] & 0x80);
+    FOR(i, 32) if (enc[i] != s[i]) return -1;
+
+    fe_1(h->Z);
+    fe_sq(u, h->Y);
+    fe_mul(v, u, fe_d);
+    fe_sub(u, u, h->Z);         // u = y^2 - 1
+    fe_add(v, v, h->Z);         // v = d y^2 + 1
+
+    fe_sq(v3, v);
+    fe_mul(v3, v3, v);          // v^3
+    fe_sq(h->X, v3);
+    fe_mul(h->X, h->X, v);
+    fe_mul(h->X, h->X, u);      // u v^7
+    fe_pow22523(h->X, h->X);
+    fe_mul(h->X, h->X, v3);
+    fe_mul(h->X, h->X, u);      // x = u v^3 (u v^7)^((p-5)/8)
+
+    fe_sq(vxx, h->X);
+    fe_mul(vxx, vxx, v);
+    fe_sub(check, vxx, u);
+    if (!fe_iszero(check)) {
+        fe_add(check, vxx, u);
+        if (!fe_iszero(check)) return -1;
+        fe_mul(h->X, h->X, fe_sqrtm1);
     }
+
+    if (fe_iszero(h->X) && (s[31] >> 7)) return -1;
+    if (fe_isnegative(h->X) != (s[31] >> 7)) fe_neg(h->X, h->X);
+
+    fe_mul(h->T, h->X, h->Y);
+    return 0;
+}
+
+// True when p is the neutral element (X = 0, Y = Z).
+static int ge_p3_is_identity(const ge_p3* p)
+{
+    fe t;
+    if (!fe_iszero(p->X)) return 0;
+    fe_sub(t, p->Y, p->Z);
+    return fe_iszero(t);
+}
+
+sv ge_precomp_cmov(ge_precomp* t, const ge_precomp* u, u64 b)
+{
+    fe_cmov(t->yplusx, u->yplusx, b);
+    fe_cmov(t->yminusx, u->yminusx, b);
+    fe_cmov(t->xy2d, u->xy2d, b);
+}
+
+static u64 eq8(signed char b, signed char c)
+{
+    const u32 x = (u32)(u8)b ^ (u32)(u8)c;
+    return (u64)((x - 1) >> 31);
 }
 
-sv scalarbase(gf p[4], const u8* s)
+// t = b * kBase[pos] for b in [-8, 8], reading every entry of the row.
+sv ge_select(ge_precomp* t, int pos, signed char b)
 {
-    gf q[4];
-    set25519(q[0], X);
-    set25519(q[1], Y);
-    set25519(q[2], gf1);
-    M(q[3], X, Y);
-    scalarmult(p, q, s);
+    ge_precomp minus;
+    const u64 bnegative = (u64)((u8)b >> 7);
+    const signed char babs = (signed char)(b - ((0 - (int)bnegative) & b) * 2);
+    int j;
+
+    ge_precomp_0(t);
+    FOR(j, 8) ge_precomp_cmov(t, &kBase[pos][j], eq8(babs, (signed char)(j + 1)));
+
+    fe_copy(minus.yplusx, t->yminusx);
+    fe_copy(minus.yminusx, t->yplusx);
+    fe_neg(minus.xy2d, t->xy2d);
+    ge_precomp_cmov(t, &minus, bnegative);
+}
+
+sv pack(u8* r, const ge_p3* p)
+{
+    fe tx, ty, zi;
+
+    fe_invert(zi, p->Z);
+    fe_mul(tx, p->X, zi);
+    fe_mul(ty, p->Y, zi);
+
+    fe_tobytes(r, ty);
+    r[31] ^= (u8)(fe_isnegative(tx) << 7);
+}
+
+// p = s * B for a 256-bit little-endian scalar with s[31] <= 127.
+//
+// s = sum e[i] * 16^i with signed digits e[i] in [-8, 8]. The odd digits are added
+// first (one table row per 256^i), the sum is multiplied by 16, then the even
+// digits are added: 64 mixed additions and 4 doublings instead of 256 doublings
+// and 256 full additions.
+sv scalarbase(ge_p3* p, const u8* s)
+{
+    signed char e[64];
+    signed char carry;
+    ge_p1p1 r;
+    ge_p2 q;
+    ge_precomp t;
+    int i;
+
+    FOR(i, 32) {
+        e[2 * i + 0] = (signed char)(s[i] & 15);
+        e[2 * i + 1] = (signed char)((s[i] >> 4) & 15);
+    }
+
+    carry = 0;
+    FOR(i, 63) {
+        e[i] = (signed char)(e[i] + carry);
+        carry = (signed char)((e[i] + 8) >> 4);
+        e[i] = (signed char)(e[i] - (carry << 4));
+    }
+    e[63] = (signed char)(e[63] + carry);
+
+    ge_p3_0(p);
+    for (i = 1; i < 64; i += 2) {
+        ge_select(&t, i / 2, e[i]);
+        ge_madd(&r, p, &t);
+        ge_p1p1_to_p3(p, &r);
+    }
+
+    ge_p3_dbl(&r, p);
+    ge_p1p1_to_p2(&q, &r);
+    ge_p2_dbl(&r, &q);
+    ge_p1p1_to_p2(&q, &r);
+    ge_p2_dbl(&r, &q);
+    ge_p1p1_to_p2(&q, &r);
+    ge_p2_dbl(&r, &q);
+    ge_p1p1_to_p3(p, &r);
+
+    for (i = 0; i < 64; i += 2) {
+        ge_select(&t, i / 2, e[i]);
+        ge_madd(&r, p, &t);
+        ge_p1p1_to_p3(p, &r);
+    }
+
+    wipe(e, sizeof(e));
 }
 
 // -----------------------------------------------------------------------------
 // SHA-512
 // -----------------------------------------------------------------------------
+//
+// The compression function has two backends, picked once at run time:
+//   - scalar: rounds unrolled eight at a time with the working variables renamed
+//     instead of shifted, message schedule kept in a 16-word ring;
+//   - AVX2 (x86-64): the whole 80-word schedule, plus the round constants, computed
+//     four words at a time up front, leaving only the dependent round chain in scalar.
+// Define HK_SHA512_PORTABLE to build the scalar backend only.
+
+#if !defined(HK_SHA512_PORTABLE) && (defined(_M_X64) || defined(__x86_64__))
+#define HK_SHA512_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define HK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define HK_TARGET_AVX2
+#endif
+#endif
 
 static u64 R(u64 x, int c) { return (x >> c) | (x << (64 - c)); }
 static u64 Ch(u64 x, u64 y, u64 z) { return (x & y) ^ (~x & z); }
@@ -354,71 +763,258 @@ static const u64 K[80] = {
     0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
 };
 
-static const u8 iv[64] = {
-    0x6a,0x09,0xe6,0x67,0xf3,0xbc,0xc9,0x08,0xbb,0x67,0xae,0x85,0x84,0xca,0xa7,0x3b,
-    0x3c,0x6e,0xf3,0x72,0xfe,0x94,0xf8,0x2b,0xa5,0x4f,0xf5,0x3a,0x5f,0x1d,0x36,0xf1,
-    0x51,0x0e,0x52,0x7f,0xad,0xe6,0x82,0xd1,0x9b,0x05,0x68,0x8c,0x2b,0x3e,0x6c,0x1f,
-    0x1f,0x83,0xd9,0xab,0xfb,0x41,0xbd,0x6b,0x5b,0xe0,0xcd,0x19,0x13,0x7e,0x21,0x79
+static const u64 iv[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
 };
 
-static u64 crypto_hashblocks(u8* x, const u8* m, u64 n)
+// One round; the caller rotates the roles of a..h instead of moving the values.
+#define SHA512_RND(a, b, c, d, e, f, g, h, wk) \
+    do { \
+        u64 t_ = (h) + Sigma1(e) + Ch(e, f, g) + (wk); \
+        (d) += t_; \
+        (h) = t_ + Sigma0(a) + Maj(a, b, c); \
+    } while (0)
+
+#define SHA512_RND8(wk) \
+    do { \
+        SHA512_RND(a, b, c, d, e, f, g, h, (wk)[0]); \
+        SHA512_RND(h, a, b, c, d, e, f, g, (wk)[1]); \
+        SHA512_RND(g, h, a, b, c, d, e, f, (wk)[2]); \
+        SHA512_RND(f, g, h, a, b, c, d, e, (wk)[3]); \
+        SHA512_RND(e, f, g, h, a, b, c, d, (wk)[4]); \
+        SHA512_RND(d, e, f, g, h, a, b, c, (wk)[5]); \
+        SHA512_RND(c, d, e, f, g, h, a, b, (wk)[6]); \
+        SHA512_RND(b, c, d, e, f, g, h, a, (wk)[7]); \
+    } while (0)
+
+// Compresses `blocks` 128-byte blocks of m into st.
+typedef void (*sha512_blocks_fn)(u64* st, const u8* m, size_t blocks);
+
+sv sha512_blocks_scalar(u64* st, const u8* m, size_t blocks)
 {
-    u64 z[8], b[8], a[8], w[16], t;
+    u64 a, b, c, d, e, f, g, h, w[16], wk[16];
     int i, j;
 
-    FOR(i, 8) z[i] = a[i] = dl64(x + 8 * i);
-
-    while (n >= 128) {
-        FOR(i, 16) w[i] = dl64(m + 8 * i);
+    while (blocks--) {
+        FOR(j, 16) w[j] = dl64(m + 8 * j);
 
-        FOR(i, 80) {
-            FOR(j, 8) b[j] = a[j];
-            t = a[7] + Sigma1(a[4]) + Ch(a[4], a[5], a[6]) + K[i] + w[i % 16];
-            b[7] = t + Sigma0(a[0]) + Maj(a[0], a[1], a[2]);
-            b[3] += t;
-            FOR(j, 8) a[(j + 1) % 8] = b[j];
+        a = st[0]; b = st[1]; c = st[2]; d = st[3];
+        e = st[4]; f = st[5]; g = st[6]; h = st[7];
 
-            if (i % 16 == 15) {
-                FOR(j, 16) w[j] += w[(j + 9) % 16] + sigma0(w[(j + 1) % 16]) + sigma1(w[(j + 14) % 16]);
+        for (i = 0; i < 80; i += 16) {
+            if (i) {
+                FOR(j, 16) w[j] += sigma1(w[(j + 14) & 15]) + w[(j + 9) & 15] + sigma0(w[(j + 1) & 15]);
             }
+            FOR(j, 16) wk[j] = w[j] + K[i + j];
+            SHA512_RND8(wk);
+            SHA512_RND8(wk + 8);
         }
 
-        FOR(i, 8) {
-            a[i] += z[i];
-            z[i] = a[i];
+        st[0] += a; st[1] += b; st[2] += c; st[3] += d;
+        st[4] += e; st[5] += f; st[6] += g; st[7] += h;
+        m += 128;
+    }
+
+    wipe(w, sizeof(w));
+    wipe(wk, sizeof(wk));
+}
+
+#ifdef HK_SHA512_AVX2
+
+// 64-bit rotates by shift / or: AVX2 has no vector rotate.
+#define SHA512_ROR256(x, c) _mm256_or_si256(_mm256_srli_epi64((x), (c)), _mm256_slli_epi64((x), 64 - (c)))
+#define SHA512_ROR128(x, c) _mm_or_si128(_mm_srli_epi64((x), (c)), _mm_slli_epi64((x), 64 - (c)))
+
+HK_TARGET_AVX2
+sv sha512_blocks_avx2(u64* st, const u8* m, size_t blocks)
+{
+    const __m256i bswap = _mm256_setr_epi8(
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+        7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    u64 a, b, c, d, e, f, g, h, w[80], wk[80];
+    __m256i x, s0;
+    __m128i lo, hi, y;
+    int i;
+
+    while (blocks--) {
+        for (i = 0; i < 16; i += 4) {
+            x = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(m + 8 * i)), bswap);
+            _mm256_storeu_si256((__m256i*)(w + i), x);
         }
 
+        // w[i..i+3]: sigma0 and the additions are four-wide; sigma1 needs w[i+1] for
+        // w[i+3], so it runs as two two-wide halves.
+        for (i = 16; i < 80; i += 4) {
+            x = _mm256_loadu_si256((const __m256i*)(w + i - 15));
+            s0 = _mm256_xor_si256(_mm256_xor_si256(SHA512_ROR256(x, 1), SHA512_ROR256(x, 8)), _mm256_srli_epi64(x, 7));
+            x = _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(w + i - 16)), s0);
+            x = _mm256_add_epi64(x, _mm256_loadu_si256((const __m256i*)(w + i - 7)));
+
+            y = _mm_loadu_si128((const __m128i*)(w + i - 2));
+            y = _mm_xor_si128(_mm_xor_si128(SHA512_ROR128(y, 19), SHA512_ROR128(y, 61)), _mm_srli_epi64(y, 6));
+            lo = _mm_add_epi64(_mm256_castsi256_si128(x), y);
+            y = _mm_xor_si128(_mm_xor_si128(SHA512_ROR128(lo, 19), SHA512_ROR128(lo, 61)), _mm_srli_epi64(lo, 6));
+            hi = _mm_add_epi64(_mm256_extracti128_si256(x, 1), y);
+
+            _mm_storeu_si128((__m128i*)(w + i), lo);
+            _mm_storeu_si128((__m128i*)(w + i + 2), hi);
+        }
+
+        for (i = 0; i < 80; i += 4) {
+            x = _mm256_add_epi64(_mm256_loadu_si256((const __m256i*)(w + i)), _mm256_loadu_si256((const __m256i*)(K + i)));
+            _mm256_storeu_si256((__m256i*)(wk + i), x);
+        }
+
+        a = st[0]; b = st[1]; c = st[2]; d = st[3];
+        e = st[4]; f = st[5]; g = st[6]; h = st[7];
+
+        for (i = 0; i < 80; i += 8) SHA512_RND8(wk + i);
+
+        st[0] += a; st[1] += b; st[2] += c; st[3] += d;
+        st[4] += e; st[5] += f; st[6] += g; st[7] += h;
         m += 128;
-        n -= 128;
     }
 
-    FOR(i, 8) ts64(x + 8 * i, z[i]);
-    return n;
+    wipe(w, sizeof(w));
+    wipe(wk, sizeof(wk));
+}
+
+static int cpu_has_avx2(void)
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] < 7) return 0;
+    __cpuid(r, 1);
+    // OSXSAVE and AVX, and the OS saves the YMM state.
+    if ((r[2] & (1 << 27)) == 0 || (r[2] & (1 << 28)) == 0) return 0;
+    if ((_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // HK_SHA512_AVX2
+
+// Resolved on first use. Concurrent first calls all store the same pointer.
+static sha512_blocks_fn volatile sha512_blocks_impl;
+
+static sha512_blocks_fn sha512_select(void)
+{
+#ifdef HK_SHA512_AVX2
+    if (cpu_has_avx2()) return sha512_blocks_avx2;
+#endif
+    return sha512_blocks_scalar;
+}
+
+sv sha512_blocks(u64* st, const u8* m, size_t blocks)
+{
+    sha512_blocks_fn fn = sha512_blocks_impl;
+    if (!fn) {
+        fn = sha512_select();
+        sha512_blocks_impl = fn;
+    }
+    fn(st, m, blocks);
+}
+
+int hk_sha512_set_backend(int backend)
+{
+    switch (backend) {
+    case HK_SHA512_BACKEND_AUTO:
+        sha512_blocks_impl = sha512_select();
+        return 0;
+    case HK_SHA512_BACKEND_SCALAR:
+        sha512_blocks_impl = sha512_blocks_scalar;
+        return 0;
+#ifdef HK_SHA512_AVX2
+    case HK_SHA512_BACKEND_AVX2:
+        if (!cpu_has_avx2()) return -1;
+        sha512_blocks_impl = sha512_blocks_avx2;
+        return 0;
+#endif
+    default:
+        return -1;
+    }
 }
 
-static int crypto_hash(u8* out, const u8* m, u64 n)
+int hk_sha512_backend(void)
 {
-    u8 h[64], x[256];
-    u64 i, b = n;
+    sha512_blocks_fn fn = sha512_blocks_impl;
+    if (!fn) fn = sha512_blocks_impl = sha512_select();
+#ifdef HK_SHA512_AVX2
+    if (fn == sha512_blocks_avx2) return HK_SHA512_BACKEND_AVX2;
+#endif
+    return HK_SHA512_BACKEND_SCALAR;
+}
 
-    FOR(i, 64) h[i] = iv[i];
+// Incremental SHA-512 (public API, see the header).
+void hk_sha512_init(hk_sha512_state* s)
+{
+    memcpy(s->h, iv, sizeof(iv));
+    s->buflen = 0;
+    s->total = 0;
+}
 
-    crypto_hashblocks(h, m, n);
-    m += n;
-    n &= 127;
-    m -= n;
+void hk_sha512_update(hk_sha512_state* s, const u8* m, u64 n)
+{
+    u64 take;
+
+    if (n == 0) return;
+    s->total += n;
+
+    if (s->buflen) {
+        take = 128 - s->buflen;
+        if (take > n) take = n;
+        memcpy(s->buf + s->buflen, m, (size_t)take);
+        s->buflen += take;
+        m += take;
+        n -= take;
+        if (s->buflen < 128) return;
+        sha512_blocks(s->h, s->buf, 1);
+        s->buflen = 0;
+    }
 
-    FOR(i, 256) x[i] = 0;
-    FOR(i, n) x[i] = m[i];
-    x[n] = 128;
+    if (n >= 128) {
+        sha512_blocks(s->h, m, (size_t)(n / 128));
+        m += n & ~(u64)127;
+        n &= 127;
+    }
+    if (n) {
+        memcpy(s->buf, m, (size_t)n);
+        s->buflen = n;
+    }
+}
+
+void hk_sha512_final(hk_sha512_state* s, u8* out)
+{
+    u64 n = s->buflen;
+    int i;
 
-    n = 256 - 128 * (n < 112);
-    x[n - 9] = (u8)(b >> 61);
-    ts64(x + n - 8, b << 3);
+    // Padding goes into the block buffer: 0x80, zeros, 128-bit big-endian bit length.
+    s->buf[n++] = 128;
+    if (n > 112) {
+        memset(s->buf + n, 0, (size_t)(128 - n));
+        sha512_blocks(s->h, s->buf, 1);
+        n = 0;
+    }
+    memset(s->buf + n, 0, (size_t)(112 - n));
+    ts64(s->buf + 112, s->total >> 61);
+    ts64(s->buf + 120, s->total << 3);
+    sha512_blocks(s->h, s->buf, 1);
 
-    crypto_hashblocks(h, x, n);
+    FOR(i, 8) ts64(out + 8 * i, s->h[i]);
+    wipe(s, sizeof(*s));
+}
 
-    FOR(i, 64) out[i] = h[i];
+int crypto_hash(u8* out, const u8* m, u64 n)
+{
+    hk_sha512_state s;
+    hk_sha512_init(&s);
+    hk_sha512_update(&s, m, n);
+    hk_sha512_final(&s, out);
     return 0;
 }
 
@@ -473,7 +1069,7 @@ static void reduce(u8 r[64])
 int crypto_sign_keypair(u8* pk, u8* sk)
 {
     u8 d[64];
-    gf p[4];
+    ge_p3 p;
 
     randombytes(sk, 32);
     crypto_hash(d, sk, 32);
@@ -481,73 +1077,461 @@ int crypto_sign_keypair(u8* pk, u8* sk)
     d[31] &= 127;
     d[31] |= 64;
 
-    scalarbase(p, d);
-    pack(pk, p);
+    scalarbase(&p, d);
+    pack(pk, &p);
     memcpy(sk + 32, pk, 32);
+    wipe(d, sizeof(d));
     return 0;
 }
 
-int crypto_sign(u8* sm, u64* smlen, const u8* m, u64 n, const u8* sk)
+int hk_sign_ctx_init(hk_sign_ctx* ctx, const u8* sk)
 {
-    u8 d[64], h[64], r[64];
-    i64 x[64];
-    gf p[4];
-    u64 i, j;
+    u8 d[64];
 
-    // d = H(sk[0..31])
     crypto_hash(d, sk, 32);
     d[0] &= 248;
     d[31] &= 127;
     d[31] |= 64;
 
-    // sm = R || S || m (m will be copied now)
-    for (i = 0; i < n; ++i) sm[64 + i] = m[i];
+    memcpy(ctx->scalar, d, 32);
+    memcpy(ctx->prefix, d + 32, 32);
+    memcpy(ctx->pk, sk + 32, 32);
+    wipe(d, sizeof(d));
+    return 0;
+}
 
-    // sm[32..63] = d[32..63]  (prefix)
-    for (i = 0; i < 32; ++i) sm[32 + i] = d[32 + i];
+void hk_sign_ctx_wipe(hk_sign_ctx* ctx)
+{
+    wipe(ctx, sizeof(*ctx));
+}
+
+int hk_sign_detached(u8* sig, const u8* m, u64 n, const hk_sign_ctx* ctx)
+{
+    hk_sha512_state hs;
+    u8 h[64], r[64];
+    i64 x[64];
+    ge_p3 p;
+    int i, j;
 
     // r = H(prefix || m)
-    {
-        u64 blen = n + 32;
-        u8* buf = 0;
-        if (blen <= 4096) {
-            u8 tmp[4096];
-            memcpy(tmp, sm + 32, 32);
-            if (n) memcpy(tmp + 32, sm + 64, (size_t)n);
-            crypto_hash(r, tmp, blen);
-        } else {
-            buf = (u8*)malloc((size_t)blen);
-            if (!buf) return -1;
-            memcpy(buf, sm + 32, 32);
-            if (n) memcpy(buf + 32, sm + 64, (size_t)n);
-            crypto_hash(r, buf, blen);
-            free(buf);
-        }
-    }
+    hk_sha512_init(&hs);
+    hk_sha512_update(&hs, ctx->prefix, 32);
+    hk_sha512_update(&hs, m, n);
+    hk_sha512_final(&hs, r);
     reduce(r);
 
     // R = [r]B
-    scalarbase(p, r);
-    pack(sm, p);
-
-    // sm[32..63] = pk (sk already includes pk at sk[32..63])
-    for (i = 32; i < 64; ++i) sm[i] = sk[i];
+    scalarbase(&p, r);
+    pack(sig, &p);
 
     // h = H(R || pk || m)
-    crypto_hash(h, sm, n + 64);
+    hk_sha512_init(&hs);
+    hk_sha512_update(&hs, sig, 32);
+    hk_sha512_update(&hs, ctx->pk, 32);
+    hk_sha512_update(&hs, m, n);
+    hk_sha512_final(&hs, h);
     reduce(h);
 
-    // x = r + h * d (mod L)
-    for (i = 0; i < 64; ++i) x[i] = 0;
-    for (i = 0; i < 32; ++i) x[i] = r[i];
-    for (i = 0; i < 32; ++i) {
-        for (j = 0; j < 32; ++j) {
-            x[i + j] += (i64)h[i] * (i64)d[j];
+    // S = r + h * a (mod L)
+    FOR(i, 64) x[i] = 0;
+    FOR(i, 32) x[i] = r[i];
+    FOR(i, 32) {
+        FOR(j, 32) {
+            x[i + j] += (i64)h[i] * (i64)ctx->scalar[j];
         }
     }
+    modL(sig + 32, x);
+
+    wipe(r, sizeof(r));
+    wipe(x, sizeof(x));
+    wipe(&p, sizeof(p));
+    return 0;
+}
+
+int crypto_sign(u8* sm, u64* smlen, const u8* m, u64 n, const u8* sk)
+{
+    hk_sign_ctx ctx;
+    u8 sig[64];
+
+    hk_sign_ctx_init(&ctx, sk);
+    hk_sign_detached(sig, m, n, &ctx);
+    hk_sign_ctx_wipe(&ctx);
 
-    modL(sm + 32, x);
+    // sm = sig || m (m may already sit at sm + 64)
+    if (n) memmove(sm + 64, m, (size_t)n);
+    memcpy(sm, sig, 64);
 
     *smlen = n + 64;
     return 0;
 }
+
+// -----------------------------------------------------------------------------
+// Verification (variable time: only public data is involved)
+// -----------------------------------------------------------------------------
+
+// Base point encoding (y = 4/5, x positive).
+static const u8 kBasePointBytes[32] = {
+    0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
+};
+
+static const u8 kZero32[32];
+
+// True when the little-endian scalar s is below L (canonical S, RFC 8032 5.1.7).
+static int sc_is_canonical(const u8* s)
+{
+    int i;
+    for (i = 31; i >= 0; --i) {
+        if (s[i] < L[i]) return 1;
+        if (s[i] > L[i]) return 0;
+    }
+    return 0;
+}
+
+// r = a * b + c (mod L).
+sv sc_muladd(u8* r, const u8* a, const u8* b, const u8* c)
+{
+    i64 x[64];
+    int i, j;
+
+    FOR(i, 64) x[i] = 0;
+    FOR(i, 32) x[i] = c[i];
+    FOR(i, 32) {
+        FOR(j, 32) {
+            x[i + j] += (i64)a[i] * (i64)b[j];
+        }
+    }
+    modL(r, x);
+}
+
+// r = L - a for a reduced a (so r = -a mod L; a = 0 gives L, which is also 0 * B).
+sv sc_neg(u8* r, const u8* a)
+{
+    int i, borrow = 0, t;
+    FOR(i, 32) {
+        t = (int)L[i] - (int)a[i] - borrow;
+        borrow = t < 0;
+        r[i] = (u8)(t + (borrow << 8));
+    }
+}
+
+// Width-w sliding window recoding: odd digits with |digit| <= limit, mostly zeros.
+sv slide(signed char* r, const u8* a, int limit)
+{
+    int i, b, k;
+
+    FOR(i, 256) r[i] = (signed char)(1 & (a[i >> 3] >> (i & 7)));
+
+    FOR(i, 256) {
+        if (!r[i]) continue;
+        for (b = 1; b <= 6 && i + b < 256; ++b) {
+            if (!r[i + b]) continue;
+            if (r[i] + (r[i + b] << b) <= limit) {
+                r[i] = (signed char)(r[i] + (r[i + b] << b));
+                r[i + b] = 0;
+            } else if (r[i] - (r[i + b] << b) >= -limit) {
+                r[i] = (signed char)(r[i] - (r[i + b] << b));
+                for (k = i + b; k < 256; ++k) {
+                    if (!r[k]) {
+                        r[k] = 1;
+                        break;
+                    }
+                    r[k] = 0;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+}
+
+// r = a * A + b * B. A uses 8 odd multiples (digits up to 15); B reuses the odd
+// entries 1B, 3B, 5B, 7B of the first comb row (digits up to 7).
+sv ge_double_scalarmult_vartime(ge_p2* r, const u8* a, const ge_p3* A, const u8* b)
+{
+    signed char aslide[256], bslide[256];
+    ge_cached Ai[8];
+    ge_p1p1 t;
+    ge_p3 u, A2;
+    int i;
+
+    slide(aslide, a, 15);
+    slide(bslide, b, 7);
+
+    ge_p3_to_cached(&Ai[0], A);
+    ge_p3_dbl(&t, A);
+    ge_p1p1_to_p3(&A2, &t);
+    for (i = 1; i < 8; ++i) {
+        ge_add(&t, &A2, &Ai[i - 1]);
+        ge_p1p1_to_p3(&u, &t);
+        ge_p3_to_cached(&Ai[i], &u);
+    }
+
+    fe_0(r->X);
+    fe_1(r->Y);
+    fe_1(r->Z);
+
+    for (i = 255; i >= 0; --i) {
+        if (aslide[i] || bslide[i]) break;
+    }
+
+    for (; i >= 0; --i) {
+        ge_p2_dbl(&t, r);
+
+        if (aslide[i] > 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_add(&t, &u, &Ai[aslide[i] / 2]);
+        } else if (aslide[i] < 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_sub(&t, &u, &Ai[(-aslide[i]) / 2]);
+        }
+
+        if (bslide[i] > 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_madd(&t, &u, &kBase[0][bslide[i] - 1]);
+        } else if (bslide[i] < 0) {
+            ge_p1p1_to_p3(&u, &t);
+            ge_msub(&t, &u, &kBase[0][-bslide[i] - 1]);
+        }
+
+        ge_p1p1_to_p2(r, &t);
+    }
+}
+
+// k = H(R || A || m) mod L.
+sv challenge(u8* k, const u8* R, const u8* pk, const u8* m, u64 n)
+{
+    hk_sha512_state hs;
+    u8 h[64];
+
+    hk_sha512_init(&hs);
+    hk_sha512_update(&hs, R, 32);
+    hk_sha512_update(&hs, pk, 32);
+    hk_sha512_update(&hs, m, n);
+    hk_sha512_final(&hs, h);
+    reduce(h);
+    memcpy(k, h, 32);
+}
+
+int hk_sign_verify_detached(const u8* sig, const u8* m, u64 n, const u8* pk)
+{
+    ge_p3 A, R, r8;
+    ge_p2 r;
+    ge_p1p1 t;
+    ge_cached c;
+    u8 k[32];
+    int i;
+
+    if (!sc_is_canonical(sig + 32)) return -1;
+    if (ge_frombytes_vartime(&A, pk) != 0) return -1;
+    if (ge_frombytes_vartime(&R, sig) != 0) return -1;
+    ge_p3_neg(&A, &A);
+
+    challenge(k, sig, pk, m, n);
+
+    // Cofactored, the same equation as verify_chunk: 8 * (S * B - k * A) == 8 * R.
+    ge_double_scalarmult_vartime(&r, k, &A, sig + 32);
+    FOR(i, 2) {
+        ge_p2_dbl(&t, &r);
+        ge_p1p1_to_p2(&r, &t);
+    }
+    ge_p2_dbl(&t, &r);
+    ge_p1p1_to_p3(&r8, &t);
+    FOR(i, 3) {
+        ge_p3_dbl(&t, &R);
+        ge_p1p1_to_p3(&R, &t);
+    }
+    ge_p3_to_cached(&c, &R);
+    ge_sub(&t, &r8, &c);
+    ge_p1p1_to_p3(&r8, &t);
+    return ge_p3_is_identity(&r8) ? 0 : -1;
+}
+
+int crypto_sign_open(u8* m, u64* mlen, const u8* sm, u64 n, const u8* pk)
+{
+    *mlen = (u64)-1;
+    if (n < 64) return -1;
+    if (hk_sign_verify_detached(sm, sm + 64, n - 64, pk) != 0) {
+        if (n > 64) memset(m, 0, (size_t)(n - 64));
+        return -1;
+    }
+    if (n > 64) memmove(m, sm + 64, (size_t)(n - 64));
+    *mlen = n - 64;
+    return 0;
+}
+
+// Multi-scalar multiplication r = sum s[i] * P[i] (Pippenger, signed c-bit digits).
+// Each window costs one addition per point plus ~2^c bucket additions, so the
+// per-point cost keeps falling as the number of points grows.
+static int msm_vartime(ge_p3* r, const u8 (*s)[32], const ge_p3* P, const ge_cached* Pc, size_t count)
+{
+    const int c = count < 16 ? 4 : count < 64 ? 5 : count < 256 ? 6 : count < 1024 ? 7 : 8;
+    const int windows = (256 + c - 1) / c + 1;     // +1 for the final carry of the recoding
+    const int nbuckets = 1 << (c - 1);
+    signed char* digits;
+    ge_p3* buckets;
+    u8* used;
+    ge_p3 sum, running;
+    ge_p1p1 t;
+    ge_cached q;
+    size_t i;
+    int w, j, k;
+
+    digits = (signed char*)malloc(count * (size_t)windows);
+    buckets = (ge_p3*)malloc(sizeof(ge_p3) * (size_t)nbuckets);
+    used = (u8*)malloc((size_t)nbuckets);
+    if (!digits || !buckets || !used) {
+        free(digits);
+        free(buckets);
+        free(used);
+        return -1;
+    }
+
+    // Signed radix-2^c digits in [-2^(c-1), 2^(c-1)).
+    for (i = 0; i < count; ++i) {
+        signed char* e = digits + i * (size_t)windows;
+        int carry = 0;
+        for (w = 0; w < windows; ++w) {
+            int bit = w * c, v = 0;
+            for (k = 0; k < c && bit + k < 256; ++k) {
+                v |= ((s[i][(bit + k) >> 3] >> ((bit + k) & 7)) & 1) << k;
+            }
+            v += carry;
+            carry = v >= nbuckets;
+            e[w] = (signed char)(v - (carry << c));
+        }
+    }
+
+    ge_p3_0(r);
+    for (w = windows - 1; w >= 0; --w) {
+        if (w != windows - 1) {
+            for (k = 0; k < c; ++k) {
+                ge_p3_dbl(&t, r);
+                ge_p1p1_to_p3(r, &t);
+            }
+        }
+
+        memset(used, 0, (size_t)nbuckets);
+        for (i = 0; i < count; ++i) {
+            const int e = digits[i * (size_t)windows + (size_t)w];
+            if (e == 0) continue;
+            j = (e > 0 ? e : -e) - 1;
+            if (!used[j]) {
+                if (e > 0) buckets[j] = P[i];
+                else ge_p3_neg(&buckets[j], &P[i]);
+                used[j] = 1;
+            } else if (e > 0) {
+                ge_add(&t, &buckets[j], &Pc[i]);
+                ge_p1p1_to_p3(&buckets[j], &t);
+            } else {
+                ge_sub(&t, &buckets[j], &Pc[i]);
+                ge_p1p1_to_p3(&buckets[j], &t);
+            }
+        }
+
+        // sum_j (j + 1) * bucket[j] as running sums from the top.
+        ge_p3_0(&running);
+        ge_p3_0(&sum);
+        for (j = nbuckets - 1; j >= 0; --j) {
+            if (used[j]) {
+                ge_p3_to_cached(&q, &buckets[j]);
+                ge_add(&t, &running, &q);
+                ge_p1p1_to_p3(&running, &t);
+            }
+            ge_p3_to_cached(&q, &running);
+            ge_add(&t, &sum, &q);
+            ge_p1p1_to_p3(&sum, &t);
+        }
+
+        ge_p3_to_cached(&q, &sum);
+        ge_add(&t, r, &q);
+        ge_p1p1_to_p3(r, &t);
+    }
+
+    free(digits);
+    free(buckets);
+    free(used);
+    return 0;
+}
+
+// Checks one chunk at once:
+//   8 * ( (-sum z_i S_i) B + sum z_i R_i + sum (z_i k_i) A_i ) == 0
+// with random 128-bit z_i. 0 when the whole chunk verifies, -1 otherwise (or when
+// the chunk could not be checked as a batch).
+static int verify_chunk(const hk_sign_batch_item* items, size_t count)
+{
+    const size_t npoints = 2 * count + 1;
+    u8 (*s)[32];
+    ge_p3* P;
+    ge_cached* Pc;
+    u8 z[32], k[32], sumzs[32];
+    ge_p3 r;
+    ge_p1p1 t;
+    size_t i;
+    int j, ret = -1;
+
+    s = (u8 (*)[32])malloc(sizeof(*s) * npoints);
+    P = (ge_p3*)malloc(sizeof(ge_p3) * npoints);
+    Pc = (ge_cached*)malloc(sizeof(ge_cached) * npoints);
+    if (!s || !P || !Pc) goto done;
+
+    memset(sumzs, 0, sizeof(sumzs));
+    for (i = 0; i < count; ++i) {
+        const hk_sign_batch_item* it = &items[i];
+        if (!sc_is_canonical(it->sig + 32)) goto done;
+        if (ge_frombytes_vartime(&P[1 + i], it->sig) != 0) goto done;
+        if (ge_frombytes_vartime(&P[1 + count + i], it->pk) != 0) goto done;
+
+        memset(z, 0, sizeof(z));
+        randombytes(z, 16);
+        challenge(k, it->sig, it->pk, it->m, it->n);
+
+        memcpy(s[1 + i], z, 32);                        // z_i for R_i
+        sc_muladd(s[1 + count + i], z, k, kZero32);     // z_i k_i for A_i
+        sc_muladd(sumzs, z, it->sig + 32, sumzs);       // sum z_i S_i
+    }
+    sc_neg(s[0], sumzs);
+    if (ge_frombytes_vartime(&P[0], kBasePointBytes) != 0) goto done;
+
+    for (i = 0; i < npoints; ++i) ge_p3_to_cached(&Pc[i], &P[i]);
+    if (msm_vartime(&r, (const u8 (*)[32])s, P, Pc, npoints) != 0) goto done;
+
+    FOR(j, 3) {
+        ge_p3_dbl(&t, &r);
+        ge_p1p1_to_p3(&r, &t);
+    }
+    ret = ge_p3_is_identity(&r) ? 0 : -1;
+
+done:
+    free(s);
+    free(P);
+    free(Pc);
+    return ret;
+}
+
+int hk_sign_verify_batch(const hk_sign_batch_item* items, size_t count, int* valid)
+{
+    size_t off, i, len;
+    int all = 0;
+
+    for (off = 0; off < count; off += len) {
+        len = count - off;
+        if (len > HK_SIGN_BATCH_CHUNK) len = HK_SIGN_BATCH_CHUNK;
+
+        if (len > 1 && verify_chunk(items + off, len) == 0) {
+            if (valid) for (i = 0; i < len; ++i) valid[off + i] = 1;
+            continue;
+        }
+
+        // Single item, or the chunk failed: find out which signatures are bad.
+        for (i = 0; i < len; ++i) {
+            const hk_sign_batch_item* it = &items[off + i];
+            const int ok = hk_sign_verify_detached(it->sig, it->m, it->n, it->pk) == 0;
+            if (valid) valid[off + i] = ok;
+            if (!ok) all = -1;
+        }
+    }
+    return all;
+}
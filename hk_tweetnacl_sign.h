@@ -5,6 +5,7 @@
 //
 // Public domain algorithms (TweetNaCl lineage).
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -14,6 +15,39 @@ extern "C" {
 // Random bytes provider (must be implemented by the embedding application).
 void randombytes(uint8_t* out, uint64_t outlen);
 
+#define crypto_hash_BYTES 64
+
+// SHA-512 of m (64-byte digest).
+int crypto_hash(uint8_t* out, const uint8_t* m, uint64_t n);
+
+// Incremental SHA-512: init, any number of updates, final. Uses a fixed amount of
+// memory whatever the total length, so large messages can be hashed in pieces
+// without being assembled first. final wipes the state (it holds message data);
+// init it again before reuse.
+typedef struct hk_sha512_state {
+    uint64_t h[8];
+    uint8_t buf[128];
+    uint64_t buflen;      // bytes pending in buf
+    uint64_t total;       // bytes hashed so far
+} hk_sha512_state;
+
+void hk_sha512_init(hk_sha512_state* s);
+void hk_sha512_update(hk_sha512_state* s, const uint8_t* m, uint64_t n);
+void hk_sha512_final(hk_sha512_state* s, uint8_t* out);
+
+// SHA-512 block function. AUTO (the default) uses AVX2 when the CPU supports it,
+// the portable code otherwise. Forcing a backend is for tests and benchmarks; it
+// returns -1 and changes nothing when the backend is not compiled in or the CPU
+// lacks it. Not to be called while other threads are hashing.
+#define HK_SHA512_BACKEND_AUTO 0
+#define HK_SHA512_BACKEND_SCALAR 1
+#define HK_SHA512_BACKEND_AVX2 2
+
+int hk_sha512_set_backend(int backend);
+
+// Backend in use (SCALAR or AVX2).
+int hk_sha512_backend(void);
+
 #define crypto_sign_PUBLICKEYBYTES 32
 #define crypto_sign_SECRETKEYBYTES 64
 #define crypto_sign_BYTES 64
@@ -27,6 +61,53 @@ int crypto_sign_keypair(uint8_t* pk, uint8_t* sk);
 // - sm must have space for n + 64 bytes.
 int crypto_sign(uint8_t* sm, uint64_t* smlen, const uint8_t* m, uint64_t n, const uint8_t* sk);
 
+// Expanded signing key. Hashing the seed once here saves a SHA-512 per signature.
+// Holds secret material: wipe with hk_sign_ctx_wipe() when done.
+typedef struct hk_sign_ctx {
+    uint8_t scalar[32];   // clamped secret scalar (H(seed)[0..31])
+    uint8_t prefix[32];   // nonce prefix (H(seed)[32..63])
+    uint8_t pk[32];
+} hk_sign_ctx;
+
+// Expands sk (seed[32] || pk[32]) into ctx.
+int hk_sign_ctx_init(hk_sign_ctx* ctx, const uint8_t* sk);
+
+// Writes the 64-byte detached signature of m to sig. m is hashed in place (not copied).
+// Same signature as the first 64 bytes of crypto_sign().
+int hk_sign_detached(uint8_t* sig, const uint8_t* m, uint64_t n, const hk_sign_ctx* ctx);
+
+// Zeroes ctx.
+void hk_sign_ctx_wipe(hk_sign_ctx* ctx);
+
+// Verifies a 64-byte detached signature of m under pk (RFC 8032: canonical S and
+// point encodings required). 0 when valid, -1 otherwise.
+//
+// The check is cofactored (8 S B == 8 R + 8 k A), as RFC 8032 5.1.7 recommends: R or
+// A may differ from an honest signature by a small-order component (which only the
+// key holder can produce). hk_sign_verify_batch uses the same equation, so both
+// give the same answer for every signature.
+int hk_sign_verify_detached(const uint8_t* sig, const uint8_t* m, uint64_t n, const uint8_t* pk);
+
+// Verifies sm = sig(64) || m and copies m out (m needs n - 64 bytes). 0 when valid.
+int crypto_sign_open(uint8_t* m, uint64_t* mlen, const uint8_t* sm, uint64_t n, const uint8_t* pk);
+
+typedef struct hk_sign_batch_item {
+    const uint8_t* m;
+    uint64_t n;
+    const uint8_t* pk;    // 32 bytes
+    const uint8_t* sig;   // 64 bytes
+} hk_sign_batch_item;
+
+// Signatures checked per multi-scalar multiplication.
+#define HK_SIGN_BATCH_CHUNK 256
+
+// Verifies many signatures at once (random linear combination, one multi-scalar
+// multiplication per chunk). valid (optional, count entries) receives 1 / 0 per item;
+// a chunk that fails as a whole is re-checked one signature at a time.
+// Returns 0 when every signature is valid, -1 otherwise. An item is valid exactly when
+// hk_sign_verify_detached accepts it.
+int hk_sign_verify_batch(const hk_sign_batch_item* items, size_t count, int* valid);
+
 #ifdef __cplusplus
 }
 #endif
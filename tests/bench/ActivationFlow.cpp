@@ -0,0 +1,106 @@
+#include "ActivationFlow.h"
+
+#include <cstdio>
+
+#include "JsonReader.h"
+#include "JsonWriter.h"
+
+namespace {
+
+std::string Hex(const uint8_t* p, size_t n) {
+    static const char kDigits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(n * 2);
+    for (size_t i = 0; i < n; ++i) {
+        out.push_back(kDigits[p[i] >> 4]);
+        out.push_back(kDigits[p[i] & 15]);
+    }
+    return out;
+}
+
+} // namespace
+
+bool BenchEnroll(AsyncHttpClient& client, const std::wstring& baseUrl, BenchDevice& device) {
+    uint8_t pk[crypto_sign_PUBLICKEYBYTES];
+    uint8_t sk[crypto_sign_SECRETKEYBYTES];
+    crypto_sign_keypair(pk, sk);
+    hk_sign_ctx_init(&device.key, sk);
+
+    JsonWriter w;
+    w.BeginObject()
+        .String("pairing_code", "000000")
+        .String("role", "server")
+        .String("machine_id", "bench-machine")
+        .String("device_name", "bench")
+        .String("lan_ip", "127.0.0.1")
+        .String("device_pubkey_b64", Hex(pk, sizeof(pk)))
+        .EndObject();
+    const HttpJsonResult r = client.PostJson(baseUrl, L"/api/device_enroll.php", w.str());
+    if (!r.transportOk || r.statusCode != 200) {
+        return false;
+    }
+    const JsonReader json(r.body);
+    return json.GetString("device_id", device.deviceId) && json.GetString("refresh_token", device.refreshToken);
+}
+
+bool BenchFetchNonce(AsyncHttpClient& client, const std::wstring& baseUrl, BenchDevice& device) {
+    JsonWriter w;
+    w.BeginObject().String("device_id", device.deviceId).String("refresh_token", device.refreshToken).EndObject();
+    const HttpJsonResult r = client.PostJson(baseUrl, L"/api/device_nonce.php", w.str());
+    if (!r.transportOk || r.statusCode != 200) {
+        return false;
+    }
+    const JsonReader json(r.body);
+    if (!json.GetString("nonce_id", device.nextNonceId) || !json.GetString("nonce", device.nextNonce)) {
+        device.nextNonceId.clear();
+        device.nextNonce.clear();
+        return false;
+    }
+    return true;
+}
+
+bool BenchRefresh(AsyncHttpClient& client, const std::wstring& baseUrl, BenchDevice& device, bool usePrefetched) {
+    const bool prefetched = usePrefetched && !device.nextNonceId.empty();
+    if (!prefetched && !BenchFetchNonce(client, baseUrl, device)) {
+        return false;
+    }
+    std::string nonceId;
+    std::string nonce;
+    nonceId.swap(device.nextNonceId);
+    nonce.swap(device.nextNonce);
+
+    const std::string signMsg = "myapp:refresh:v1|" + device.deviceId + "|" + nonceId + "|" + nonce;
+    uint8_t sig[crypto_sign_BYTES];
+    hk_sign_detached(sig, reinterpret_cast<const uint8_t*>(signMsg.data()), signMsg.size(), &device.key);
+
+    JsonWriter w(1024);
+    w.BeginObject()
+        .String("device_id", device.deviceId)
+        .String("refresh_token", device.refreshToken)
+        .String("nonce_id", nonceId)
+        .String("nonce", nonce)
+        .String("device_sig_b64", Hex(sig, sizeof(sig)))
+        .Bool("want_next_nonce", true)
+        .EndObject();
+    const HttpJsonResult refreshResp = client.PostJson(baseUrl, L"/api/device_refresh.php", w.str());
+    if (!refreshResp.transportOk) {
+        return false;
+    }
+    const JsonReader refreshJson(refreshResp.body);
+    if (refreshResp.statusCode != 200) {
+        // A spent or expired prefetched nonce: start over with a fresh one, like refreshOnce.
+        if (prefetched && refreshJson.StringOr("reason").compare(0, 6, "nonce_") == 0) {
+            return BenchRefresh(client, baseUrl, device, false);
+        }
+        return false;
+    }
+    if (!refreshJson.GetString("refresh_token", device.refreshToken)) {
+        return false;
+    }
+    if (!refreshJson.GetString("next_nonce_id", device.nextNonceId) ||
+        !refreshJson.GetString("next_nonce", device.nextNonce)) {
+        device.nextNonceId.clear();
+        device.nextNonce.clear();
+    }
+    return true;
+}
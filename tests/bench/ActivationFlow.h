@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "AsyncHttpClient.h"
+#include "hk_tweetnacl_sign.h"
+
+// ActivationFlow
+// - Client side of the activation protocol the way ActivationPollThreadProc drives it (enroll
+//   once, then device_nonce + signed device_refresh per refresh), for the benchmarks. Runs
+//   against StubActivationServer; bodies are built with JsonWriter like the app's.
+// - With usePrefetched, a refresh spends the nonce in device.nextNonce* and skips device_nonce,
+//   falling back to device_nonce when there is none or the server rejects it. The nonce comes
+//   from BenchFetchNonce ahead of time (as the app does shortly before a planned refresh) or is
+//   bundled with the previous refresh response.
+struct BenchDevice {
+    std::string deviceId;
+    std::string refreshToken;
+    hk_sign_ctx key;
+    std::string nextNonceId;        // fetched ahead or bundled with the last refresh; may be empty
+    std::string nextNonce;
+};
+
+// Enrolls a new device with a fresh key. False on any transport or protocol error.
+bool BenchEnroll(AsyncHttpClient& client, const std::wstring& baseUrl, BenchDevice& device);
+
+// device_nonce only, storing the nonce in device.nextNonce* for the next refresh.
+bool BenchFetchNonce(AsyncHttpClient& client, const std::wstring& baseUrl, BenchDevice& device);
+
+// One refresh: device_nonce (unless a prefetched nonce is used), sign, device_refresh. Rotates
+// device.refreshToken and stores the next nonce.
+bool BenchRefresh(AsyncHttpClient& client, const std::wstring& baseUrl, BenchDevice& device, bool usePrefetched = false);
@@ -0,0 +1,36 @@
+#pragma once
+// Bench.h
+// - Shared helpers for hk_bench (tests/bench). Each suite is a function registered in
+//   bench_main.cpp; quick != 0 shrinks iteration counts so ctest can smoke-run every suite.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline double BenchNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Keeps the compiler from discarding a computed result.
+static inline void BenchSink(const void* p)
+{
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+}
+
+void BenchEd25519(int quick);
+void BenchVerify(int quick);
+void BenchSha512(int quick);
+void BenchActivation(int quick);
+void BenchPrefetch(int quick);
+void BenchJson(int quick);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+// bench_activation.cpp
+//
+// Refresh throughput and latency through AsyncHttpClient + SocketHttpTransport against the
+// loopback stub server, with an injected per-request delay standing in for network RTT.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ActivationFlow.h"
+#include "Bench.h"
+#include "SocketHttpTransport.h"
+#include "support/StubActivationServer.h"
+
+namespace {
+
+double Percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[(std::min)(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+} // namespace
+
+extern "C" void BenchActivation(int quick) {
+    StubActivationServer server;
+    if (!server.Start()) {
+        std::printf("cannot listen on loopback\n");
+        return;
+    }
+    const std::wstring base = server.BaseUrl();
+    const std::vector<int> delays = quick ? std::vector<int>{ 0 } : std::vector<int>{ 0, 5, 20 };
+    const std::vector<int> clientCounts = quick ? std::vector<int>{ 2 } : std::vector<int>{ 1, 8, 32 };
+    const double seconds = quick ? 0.05 : 1.0;
+
+    std::printf("%8s %8s %12s %10s %10s %8s\n", "delay ms", "clients", "refreshes/s", "p50 ms", "p99 ms", "errors");
+    for (int delay : delays) {
+        for (int clients : clientCounts) {
+            server.SetDelayMs(0);
+            AsyncHttpClient client(std::make_unique<SocketHttpTransport>(5000), static_cast<size_t>(clients));
+            std::vector<BenchDevice> devices(static_cast<size_t>(clients));
+            bool enrolled = true;
+            for (BenchDevice& d : devices) enrolled = BenchEnroll(client, base, d) && enrolled;
+            if (!enrolled) {
+                std::printf("enroll failed\n");
+                return;
+            }
+            server.SetDelayMs(delay);
+
+            std::vector<std::vector<double>> latencies(static_cast<size_t>(clients));
+            std::atomic<int> errors{ 0 };
+            const double start = BenchNow();
+            std::vector<std::thread> threads;
+            for (int c = 0; c < clients; ++c) {
+                threads.emplace_back([&, c]() {
+                    while (BenchNow() - start < seconds) {
+                        const double t = BenchNow();
+                        if (BenchRefresh(client, base, devices[static_cast<size_t>(c)])) {
+                            latencies[static_cast<size_t>(c)].push_back((BenchNow() - t) * 1e3);
+                        } else {
+                            ++errors;
+                        }
+                    }
+                });
+            }
+            for (std::thread& t : threads) t.join();
+            const double elapsed = BenchNow() - start;
+
+            std::vector<double> all;
+            for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+            const double rate = static_cast<double>(all.size()) / elapsed;
+            std::printf("%8d %8d %12.0f %10.2f %10.2f %8d\n", delay, clients, rate,
+                Percentile(all, 0.50), Percentile(all, 0.99), errors.load());
+            for (BenchDevice& d : devices) hk_sign_ctx_wipe(&d.key);
+        }
+    }
+    server.Stop();
+}
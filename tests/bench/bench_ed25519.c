@@ -0,0 +1,48 @@
+// bench_ed25519.c
+//
+// Ed25519 keypair / sign cost, current engine vs the original TweetNaCl code.
+
+#include "Bench.h"
+
+#include "hk_tweetnacl_sign.h"
+#include "reference/tweetnacl_ref.h"
+
+#include <string.h>
+
+void BenchEd25519(int quick)
+{
+    const int n = quick ? 20 : 5000;
+    const int nRef = quick ? 2 : 100;
+    uint8_t pk[32], sk[64], m[64] = { 0 }, sm[128], sig[64];
+    uint64_t smlen;
+    hk_sign_ctx ctx;
+    double t, keypair, sign, signCtx, refKeypair, refSign;
+    int i;
+
+    t = BenchNow();
+    for (i = 0; i < n; ++i) crypto_sign_keypair(pk, sk);
+    keypair = (BenchNow() - t) / n;
+
+    t = BenchNow();
+    for (i = 0; i < n; ++i) { m[0] = (uint8_t)i; crypto_sign(sm, &smlen, m, sizeof(m), sk); BenchSink(sm); }
+    sign = (BenchNow() - t) / n;
+
+    hk_sign_ctx_init(&ctx, sk);
+    t = BenchNow();
+    for (i = 0; i < n; ++i) { m[0] = (uint8_t)i; hk_sign_detached(sig, m, sizeof(m), &ctx); BenchSink(sig); }
+    signCtx = (BenchNow() - t) / n;
+    hk_sign_ctx_wipe(&ctx);
+
+    t = BenchNow();
+    for (i = 0; i < nRef; ++i) ref_crypto_sign_keypair(pk, sk);
+    refKeypair = (BenchNow() - t) / nRef;
+
+    t = BenchNow();
+    for (i = 0; i < nRef; ++i) { m[0] = (uint8_t)i; ref_crypto_sign(sm, &smlen, m, sizeof(m), sk); BenchSink(sm); }
+    refSign = (BenchNow() - t) / nRef;
+
+    printf("%-28s %10s %10s %8s\n", "operation (64-byte msg)", "hk us", "ref us", "speedup");
+    printf("%-28s %10.1f %10.1f %7.1fx\n", "crypto_sign_keypair", keypair * 1e6, refKeypair * 1e6, refKeypair / keypair);
+    printf("%-28s %10.1f %10.1f %7.1fx\n", "crypto_sign", sign * 1e6, refSign * 1e6, refSign / sign);
+    printf("%-28s %10.1f %10s %7.1fx\n", "hk_sign_detached (ctx)", signCtx * 1e6, "-", refSign / signCtx);
+}
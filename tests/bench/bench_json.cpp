@@ -0,0 +1,148 @@
+// bench_json.cpp
+//
+// Building the device_refresh request body: JsonWriter (fresh, and reused like the poll thread's
+// writer) against the string concatenation and ostringstream escaping it replaced, for refresh
+// tokens from the usual 43 characters up to 64 KB; then AppendEscaped on license blob JSON
+// (quoted claims followed by a long base64 signature). Timing only: json_writer_test checks that
+// the output matches the legacy code byte for byte.
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "JsonWriter.h"
+
+namespace {
+
+// The escaping used before JsonWriter.
+std::string LegacyJsonEscape(const std::string& s) {
+    std::ostringstream oss;
+    for (char ch : s) {
+        switch (ch) {
+            case '\\': oss << "\\\\"; break;
+            case '"': oss << "\\\""; break;
+            case '\n': oss << "\\n"; break;
+            case '\r': oss << "\\r"; break;
+            case '\t': oss << "\\t"; break;
+            default:
+                if ((unsigned char)ch < 0x20) {
+                    oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)(unsigned char)ch;
+                } else {
+                    oss << ch;
+                }
+        }
+    }
+    return oss.str();
+}
+
+struct RefreshFields {
+    std::string deviceId;
+    std::string refreshToken;
+    std::string nonceId;
+    std::string nonce;
+    std::string sigB64;
+};
+
+std::string LegacyRefreshBody(const RefreshFields& f) {
+    return std::string("{")
+        + "\"device_id\":\"" + LegacyJsonEscape(f.deviceId) + "\","
+        + "\"refresh_token\":\"" + LegacyJsonEscape(f.refreshToken) + "\","
+        + "\"nonce_id\":\"" + LegacyJsonEscape(f.nonceId) + "\","
+        + "\"nonce\":\"" + LegacyJsonEscape(f.nonce) + "\","
+        + "\"device_sig_b64\":\"" + LegacyJsonEscape(f.sigB64) + "\""
+        + "}";
+}
+
+void WriteRefreshBody(JsonWriter& w, const RefreshFields& f) {
+    w.BeginObject()
+        .String("device_id", f.deviceId)
+        .String("refresh_token", f.refreshToken)
+        .String("nonce_id", f.nonceId)
+        .String("nonce", f.nonce)
+        .String("device_sig_b64", f.sigB64)
+        .EndObject();
+}
+
+std::string Base64Like(size_t n, unsigned seed) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string s(n, 'A');
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        s[i] = kAlphabet[(seed >> 16) & 63];
+    }
+    return s;
+}
+
+// Seconds per call of fn, repeated for at least minSeconds.
+template <typename Fn>
+double TimePerCall(Fn&& fn, double minSeconds) {
+    const double start = BenchNow();
+    long reps = 0;
+    do {
+        fn();
+        ++reps;
+    } while (BenchNow() - start < minSeconds);
+    return (BenchNow() - start) / static_cast<double>(reps);
+}
+
+} // namespace
+
+extern "C" void BenchJson(int quick) {
+    const double minSeconds = quick ? 0.0 : 0.2;
+
+    std::printf("refresh body, by refresh_token length (us per body)\n");
+    std::printf("%10s %10s %10s %10s %10s\n", "token", "legacy", "writer", "reused", "speedup");
+    const std::vector<size_t> tokenSizes = quick ? std::vector<size_t>{ 43, 4096 }
+                                                 : std::vector<size_t>{ 43, 256, 1024, 4096, 16384, 65536 };
+    for (size_t tokenSize : tokenSizes) {
+        RefreshFields f;
+        f.deviceId = "dev-8c1f0f4e-51a7-4c4e-9e8b-2f6f4f9d1a3b";
+        f.refreshToken = Base64Like(tokenSize, 7);
+        f.nonceId = "n-1234567890";
+        f.nonce = Base64Like(64, 11);
+        f.sigB64 = Base64Like(88, 13);
+
+        const double legacy = TimePerCall([&]() {
+            const std::string body = LegacyRefreshBody(f);
+            BenchSink(body.data());
+        }, minSeconds);
+        const double fresh = TimePerCall([&]() {
+            JsonWriter w;
+            WriteRefreshBody(w, f);
+            BenchSink(w.str().data());
+        }, minSeconds);
+        JsonWriter reused;
+        const double again = TimePerCall([&]() {
+            reused.Reset();
+            WriteRefreshBody(reused, f);
+            BenchSink(reused.str().data());
+        }, minSeconds);
+        std::printf("%10zu %10.2f %10.2f %10.2f %9.1fx\n", tokenSize, legacy * 1e6, fresh * 1e6, again * 1e6, legacy / again);
+    }
+
+    std::printf("escaping license blob JSON (MB/s of input)\n");
+    std::printf("%10s %10s %14s\n", "blob", "legacy", "AppendEscaped");
+    const std::vector<size_t> blobSizes = quick ? std::vector<size_t>{ 512 }
+                                                : std::vector<size_t>{ 512, 4096, 65536 };
+    for (size_t blobSize : blobSizes) {
+        // Claims with quotes to escape, then base64 padding the blob out to blobSize.
+        std::string blob = "{\"v\":1,\"device_id\":\"dev-1\",\"machine_id\":\"m-1\",\"expires_at\":\"2030-01-01T00:00:00Z\",\"sig\":\"";
+        blob += Base64Like(blobSize > blob.size() + 2 ? blobSize - blob.size() - 2 : 0, 17);
+        blob += "\"}";
+
+        const double legacy = TimePerCall([&]() {
+            const std::string out = LegacyJsonEscape(blob);
+            BenchSink(out.data());
+        }, minSeconds);
+        std::string out;
+        const double writer = TimePerCall([&]() {
+            out.clear();
+            JsonWriter::AppendEscaped(out, blob.data(), blob.size());
+            BenchSink(out.data());
+        }, minSeconds);
+        std::printf("%10zu %10.1f %14.1f\n", blob.size(), blob.size() / legacy / 1e6, blob.size() / writer / 1e6);
+    }
+}
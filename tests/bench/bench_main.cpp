@@ -0,0 +1,58 @@
+// hk_bench
+// - Linux benchmarks for the portable modules. `hk_bench` runs every suite, `hk_bench <suite>...`
+//   only the named ones. --quick shrinks the iteration counts (used by the bench_smoke test).
+
+#include <cstdio>
+#include <cstring>
+
+#include "Bench.h"
+
+namespace {
+
+struct Suite {
+    const char* name;
+    void (*run)(int quick);
+};
+
+const Suite kSuites[] = {
+    { "ed25519", &BenchEd25519 },
+    { "verify", &BenchVerify },
+    { "sha512", &BenchSha512 },
+    { "refresh", &BenchActivation },
+    { "prefetch", &BenchPrefetch },
+    { "json", &BenchJson },
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int quick = 0;
+    const char* selected[16];
+    int selectedCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else if (selectedCount < 16) {
+            selected[selectedCount++] = argv[i];
+        }
+    }
+
+    int ran = 0;
+    for (const Suite& suite : kSuites) {
+        bool wanted = (selectedCount == 0);
+        for (int i = 0; i < selectedCount && !wanted; ++i) {
+            wanted = std::strcmp(selected[i], suite.name) == 0;
+        }
+        if (!wanted) continue;
+        std::printf("== %s\n", suite.name);
+        suite.run(quick);
+        ++ran;
+    }
+    if (ran == 0) {
+        std::fprintf(stderr, "unknown suite; available:");
+        for (const Suite& suite : kSuites) std::fprintf(stderr, " %s", suite.name);
+        std::fprintf(stderr, "\n");
+        return 1;
+    }
+    return 0;
+}
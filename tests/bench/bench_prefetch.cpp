@@ -0,0 +1,115 @@
+// bench_prefetch.cpp
+//
+// Latency of a due refresh with and without a nonce fetched ahead: device_nonce + device_refresh
+// (two round trips when the refresh is due) against device_refresh with a nonce the app fetched
+// shortly before (one). Fetching ahead does not save requests, it moves device_nonce off the
+// due-time path; the untimed fetch is still counted in "requests". One client against the
+// loopback stub server; the stub's per-request delay stands in for the round-trip time, and
+// HK_BENCH_RTT_MS overrides the list (e.g. HK_BENCH_RTT_MS=10,80,200).
+// Refreshes here are back to back, so the next_nonce bundled with each reply would also still be
+// valid; in the app refreshes are minutes to hours apart and it is not, so it is discarded.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ActivationFlow.h"
+#include "Bench.h"
+#include "SocketHttpTransport.h"
+#include "support/StubActivationServer.h"
+
+namespace {
+
+std::vector<int> RttList(bool quick) {
+    std::vector<int> out;
+    if (const char* env = std::getenv("HK_BENCH_RTT_MS")) {
+        const std::string list(env);
+        size_t pos = 0;
+        while (pos <= list.size()) {
+            const size_t comma = (std::min)(list.find(',', pos), list.size());
+            const int ms = std::atoi(list.substr(pos, comma - pos).c_str());
+            if (ms >= 0) out.push_back(ms);
+            pos = comma + 1;
+        }
+    }
+    if (out.empty()) out = quick ? std::vector<int>{ 0 } : std::vector<int>{ 0, 5, 20, 50 };
+    return out;
+}
+
+struct RunResult {
+    double p50Ms = 0.0;
+    double meanMs = 0.0;
+    double requestsPerRefresh = 0.0;
+    int errors = 0;
+};
+
+RunResult Run(StubActivationServer& server, AsyncHttpClient& client, BenchDevice& device, bool fetchAhead, int refreshes) {
+    const std::wstring base = server.BaseUrl();
+    (void)BenchRefresh(client, base, device, false);
+
+    const StubActivationServer::Counters before = server.GetCounters();
+    std::vector<double> latencies;
+    RunResult r;
+    for (int i = 0; i < refreshes; ++i) {
+        device.nextNonceId.clear();
+        device.nextNonce.clear();
+        if (fetchAhead && !BenchFetchNonce(client, base, device)) {
+            r.errors++;
+            continue;
+        }
+        const double t = BenchNow();
+        if (BenchRefresh(client, base, device, fetchAhead)) {
+            latencies.push_back((BenchNow() - t) * 1e3);
+        } else {
+            r.errors++;
+        }
+    }
+    const StubActivationServer::Counters after = server.GetCounters();
+    if (!latencies.empty()) {
+        double sum = 0.0;
+        for (double l : latencies) sum += l;
+        r.meanMs = sum / static_cast<double>(latencies.size());
+        std::sort(latencies.begin(), latencies.end());
+        r.p50Ms = latencies[latencies.size() / 2];
+    }
+    r.requestsPerRefresh = static_cast<double>((after.nonce - before.nonce) + (after.refresh - before.refresh)) / refreshes;
+    return r;
+}
+
+void PrintRow(const char* mode, int rtt, const RunResult& r, double baselineP50) {
+    std::printf("%-22s %6d %10.2f %10.2f %12.2f %9.2fx %6d\n", mode, rtt, r.p50Ms, r.meanMs,
+        r.requestsPerRefresh, r.p50Ms > 0.0 ? baselineP50 / r.p50Ms : 0.0, r.errors);
+}
+
+} // namespace
+
+extern "C" void BenchPrefetch(int quick) {
+    StubActivationServer server;
+    if (!server.Start()) {
+        std::printf("cannot listen on loopback\n");
+        return;
+    }
+    const int refreshes = quick ? 5 : 50;
+    AsyncHttpClient client(std::make_unique<SocketHttpTransport>(5000), 1);
+    BenchDevice device;
+    if (!BenchEnroll(client, server.BaseUrl(), device)) {
+        std::printf("enroll failed\n");
+        server.Stop();
+        return;
+    }
+
+    std::printf("%-22s %6s %10s %10s %12s %10s %6s\n", "mode", "rtt ms", "p50 ms", "mean ms", "requests", "vs nonce", "errors");
+    for (int rtt : RttList(quick != 0)) {
+        server.SetDelayMs(rtt);
+        const RunResult twoTrips = Run(server, client, device, false, refreshes);
+        const RunResult oneTrip = Run(server, client, device, true, refreshes);
+        PrintRow("nonce + refresh", rtt, twoTrips, twoTrips.p50Ms);
+        PrintRow("nonce fetched ahead", rtt, oneTrip, twoTrips.p50Ms);
+    }
+
+    hk_sign_ctx_wipe(&device.key);
+    server.Stop();
+}
@@ -0,0 +1,58 @@
+// bench_sha512.c
+//
+// SHA-512 throughput per block backend (forced through hk_sha512_set_backend)
+// against the original TweetNaCl code, over message sizes from a signature's
+// R || A || M up to a large license blob.
+
+#include "Bench.h"
+
+#include "hk_tweetnacl_sign.h"
+#include "reference/tweetnacl_ref.h"
+
+#include <stdlib.h>
+
+typedef int (*BenchHashFn)(uint8_t* out, const uint8_t* m, uint64_t n);
+
+static double BenchHashSeconds(BenchHashFn fn, const uint8_t* m, size_t n, double minSeconds)
+{
+    uint8_t out[64];
+    const double t = BenchNow();
+    long reps = 0;
+    do {
+        fn(out, m, n);
+        BenchSink(out);
+        ++reps;
+    } while (BenchNow() - t < minSeconds);
+    return (BenchNow() - t) / (double)reps;
+}
+
+void BenchSha512(int quick)
+{
+    static const size_t kSizes[] = { 64, 128, 256, 1024, 4096, 65536 };
+    const double minSeconds = quick ? 0.0 : 0.2;
+    const size_t maxSize = kSizes[sizeof(kSizes) / sizeof(kSizes[0]) - 1];
+    uint8_t* m = (uint8_t*)malloc(maxSize);
+    const int haveAvx2 = hk_sha512_set_backend(HK_SHA512_BACKEND_AVX2) == 0;
+    size_t k;
+
+    if (!m) return;
+    randombytes(m, maxSize);
+
+    printf("%8s %12s %12s %12s   (MB/s)\n", "bytes", "scalar", haveAvx2 ? "avx2" : "avx2 (n/a)", "ref");
+    for (k = 0; k < sizeof(kSizes) / sizeof(kSizes[0]); ++k) {
+        const size_t n = kSizes[k];
+        double scalar, avx2 = 0.0, ref;
+
+        hk_sha512_set_backend(HK_SHA512_BACKEND_SCALAR);
+        scalar = BenchHashSeconds(crypto_hash, m, n, minSeconds);
+        if (haveAvx2) {
+            hk_sha512_set_backend(HK_SHA512_BACKEND_AVX2);
+            avx2 = BenchHashSeconds(crypto_hash, m, n, minSeconds);
+        }
+        ref = BenchHashSeconds(ref_crypto_hash, m, n, minSeconds);
+
+        printf("%8zu %12.1f %12.1f %12.1f\n", n, n / scalar / 1e6, haveAvx2 ? n / avx2 / 1e6 : 0.0, n / ref / 1e6);
+    }
+    hk_sha512_set_backend(HK_SHA512_BACKEND_AUTO);
+    free(m);
+}
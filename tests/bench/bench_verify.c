@@ -0,0 +1,82 @@
+// bench_verify.c
+//
+// Ed25519 verification: single signatures, then a batch-size sweep showing the
+// per-signature cost of hk_sign_verify_batch against hk_sign_verify_detached.
+
+#include "Bench.h"
+
+#include "hk_tweetnacl_sign.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct BenchSigned {
+    uint8_t pk[32];
+    uint8_t sig[64];
+    uint8_t m[64];
+} BenchSigned;
+
+void BenchVerify(int quick)
+{
+    static const size_t kSizes[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
+    const size_t maxCount = quick ? 8 : 1024;
+    const double minSeconds = quick ? 0.0 : 0.2;
+    BenchSigned* msgs = (BenchSigned*)malloc(sizeof(BenchSigned) * maxCount);
+    hk_sign_batch_item* items = (hk_sign_batch_item*)malloc(sizeof(hk_sign_batch_item) * maxCount);
+    double single, t;
+    size_t i, k;
+    int reps;
+
+    if (!msgs || !items) {
+        free(msgs);
+        free(items);
+        return;
+    }
+    for (i = 0; i < maxCount; ++i) {
+        uint8_t sk[64];
+        hk_sign_ctx ctx;
+        crypto_sign_keypair(msgs[i].pk, sk);
+        randombytes(msgs[i].m, sizeof(msgs[i].m));
+        hk_sign_ctx_init(&ctx, sk);
+        hk_sign_detached(msgs[i].sig, msgs[i].m, sizeof(msgs[i].m), &ctx);
+        hk_sign_ctx_wipe(&ctx);
+        items[i].m = msgs[i].m;
+        items[i].n = sizeof(msgs[i].m);
+        items[i].pk = msgs[i].pk;
+        items[i].sig = msgs[i].sig;
+    }
+
+    t = BenchNow();
+    reps = 0;
+    do {
+        for (i = 0; i < maxCount; ++i) {
+            if (hk_sign_verify_detached(msgs[i].sig, msgs[i].m, sizeof(msgs[i].m), msgs[i].pk) != 0) {
+                printf("unexpected verification failure\n");
+            }
+        }
+        ++reps;
+    } while (BenchNow() - t < minSeconds);
+    single = (BenchNow() - t) / ((double)reps * maxCount);
+
+    printf("hk_sign_verify_detached: %.1f us/signature\n", single * 1e6);
+    printf("%8s %14s %10s\n", "batch", "us/signature", "vs single");
+    for (k = 0; k < sizeof(kSizes) / sizeof(kSizes[0]) && kSizes[k] <= maxCount; ++k) {
+        const size_t n = kSizes[k];
+        double perSig;
+        t = BenchNow();
+        reps = 0;
+        do {
+            for (i = 0; i + n <= maxCount; i += n) {
+                if (hk_sign_verify_batch(items + i, n, NULL) != 0) {
+                    printf("unexpected batch failure\n");
+                }
+            }
+            ++reps;
+        } while (BenchNow() - t < minSeconds);
+        perSig = (BenchNow() - t) / ((double)reps * (maxCount / n) * n);
+        printf("%8zu %14.1f %9.2fx\n", n, perSig * 1e6, single / perSig);
+    }
+
+    free(msgs);
+    free(items);
+}
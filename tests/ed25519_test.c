@@ -0,0 +1,454 @@
+// ed25519_test.c
+//
+// Ed25519 (hk_tweetnacl_sign.c):
+// - RFC 8032 section 7.1 test vectors, signing and verification.
+// - Byte-for-byte cross-check of keypair / sign against the original TweetNaCl
+//   code (reference/tweetnacl_ref.c) over random seeds and message lengths.
+// - Verification: tampered signatures, non-canonical S, non-canonical and
+//   small-order R / A, the cofactored equation shared by single and batch
+//   verification, crypto_sign_open, and batches with one bad signature.
+
+#include "hk_tweetnacl_sign.h"
+#include "reference/tweetnacl_ref.h"
+#include "support/TestCheck.h"
+
+#include <stdlib.h>
+
+// Deterministic randombytes: queued bytes first (RFC seeds), then xorshift64*.
+static uint8_t g_queued[64];
+static size_t g_queuedLen = 0;
+static uint64_t g_rng = 88172645463325252ULL;
+
+static void QueueRandom(const uint8_t* p, size_t n)
+{
+    memcpy(g_queued, p, n);
+    g_queuedLen = n;
+}
+
+static uint64_t NextRandom(void)
+{
+    g_rng ^= g_rng >> 12;
+    g_rng ^= g_rng << 25;
+    g_rng ^= g_rng >> 27;
+    return g_rng * 2685821657736338717ULL;
+}
+
+void randombytes(uint8_t* out, uint64_t outlen)
+{
+    uint64_t i;
+    for (i = 0; i < outlen; ++i) {
+        if (g_queuedLen > 0) {
+            out[i] = g_queued[0];
+            memmove(g_queued, g_queued + 1, --g_queuedLen);
+        } else {
+            out[i] = (uint8_t)NextRandom();
+        }
+    }
+}
+
+typedef struct RfcVector {
+    const char* seed;
+    const char* pk;
+    const char* msg;
+    const char* sig;
+} RfcVector;
+
+static const RfcVector kRfcVectors[] = {
+    // TEST 1
+    { "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+      "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+      "",
+      "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b" },
+    // TEST 2
+    { "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+      "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+      "72",
+      "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00" },
+    // TEST 3
+    { "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+      "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+      "af82",
+      "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a" },
+    // TEST SHA(abc)
+    { "833fe62409237b9d62ec77587520911e9a759cec1d19755b7da901b96dca3d42",
+      "ec172b93ad5e563bf4932c70e1245034c35467ef2efd4d64ebf819683467e2bf",
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+      "dc2a4459e7369633a52b1bf277839a00201009a3efbf3ecb69bea2186c26b58909351fc9ac90b3ecfdfbc7c66431e0303dca179c138ac17ad9bef1177331a704" },
+};
+
+static void TestRfc8032Vectors(void)
+{
+    size_t k;
+    for (k = 0; k < sizeof(kRfcVectors) / sizeof(kRfcVectors[0]); ++k) {
+        const RfcVector* v = &kRfcVectors[k];
+        uint8_t seed[32], pk[32], sk[64], expectPk[32], msg[64], expectSig[64], sm[64 + 64], sig[64];
+        uint64_t smlen = 0;
+        size_t mlen;
+        hk_sign_ctx ctx;
+
+        TestHex(v->seed, seed);
+        TestHex(v->pk, expectPk);
+        TestHex(v->sig, expectSig);
+        mlen = TestHex(v->msg, msg);
+
+        QueueRandom(seed, sizeof(seed));
+        CHECK(crypto_sign_keypair(pk, sk) == 0);
+        CHECK_MEM(pk, expectPk, 32);
+        CHECK_MEM(sk, seed, 32);
+        CHECK_MEM(sk + 32, expectPk, 32);
+
+        CHECK(crypto_sign(sm, &smlen, msg, mlen, sk) == 0);
+        CHECK(smlen == mlen + 64);
+        CHECK_MEM(sm, expectSig, 64);
+        CHECK_MEM(sm + 64, msg, mlen);
+
+        CHECK(hk_sign_ctx_init(&ctx, sk) == 0);
+        CHECK(hk_sign_detached(sig, msg, mlen, &ctx) == 0);
+        CHECK_MEM(sig, expectSig, 64);
+        hk_sign_ctx_wipe(&ctx);
+
+        CHECK(hk_sign_verify_detached(expectSig, msg, mlen, expectPk) == 0);
+    }
+}
+
+// The old crypto_sign switches from a stack buffer to malloc above 4064 message
+// bytes; lengths on both sides of that are covered.
+static void TestCrossCheckAgainstTweetNaCl(void)
+{
+    enum { kIterations = 200, kMaxMessage = 5000 };
+    static uint8_t m[kMaxMessage], sm1[kMaxMessage + 64], sm2[kMaxMessage + 64];
+    const int failuresBefore = g_testFailures;
+    int it;
+    for (it = 0; it < kIterations; ++it) {
+        uint8_t pk1[32], sk1[64], pk2[32], sk2[64], seed[32], sig[64];
+        uint64_t l1 = 0, l2 = 0;
+        size_t n, i;
+        hk_sign_ctx ctx;
+
+        for (i = 0; i < sizeof(seed); ++i) seed[i] = (uint8_t)NextRandom();
+        n = (it < 70) ? (size_t)it : (size_t)(NextRandom() % kMaxMessage);
+        for (i = 0; i < n; ++i) m[i] = (uint8_t)NextRandom();
+
+        QueueRandom(seed, sizeof(seed));
+        crypto_sign_keypair(pk1, sk1);
+        QueueRandom(seed, sizeof(seed));
+        ref_crypto_sign_keypair(pk2, sk2);
+        CHECK_MEM(pk1, pk2, 32);
+        CHECK_MEM(sk1, sk2, 64);
+
+        crypto_sign(sm1, &l1, m, n, sk1);
+        ref_crypto_sign(sm2, &l2, m, n, sk2);
+        CHECK(l1 == l2);
+        CHECK_MEM(sm1, sm2, (size_t)l1);
+
+        hk_sign_ctx_init(&ctx, sk1);
+        hk_sign_detached(sig, m, n, &ctx);
+        CHECK_MEM(sig, sm2, 64);
+        hk_sign_ctx_wipe(&ctx);
+
+        if (g_testFailures != failuresBefore) {
+            fprintf(stderr, "cross-check mismatch at iteration %d (message length %zu)\n", it, n);
+            break;
+        }
+    }
+}
+
+// L = 2^252 + 27742317777372353535851937790883648493, little-endian.
+static const uint8_t kL[32] = {
+    0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x10,
+};
+
+// Identity point (x = 0, y = 1): small order (1).
+static const uint8_t kIdentity[32] = { 1 };
+// The same point with y encoded as p + 1 (non-canonical).
+static const uint8_t kIdentityNonCanonical[32] = {
+    0xee, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f,
+};
+// x = 0 with the sign bit set ("negative zero").
+static const uint8_t kIdentityNegativeZero[32] = {
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x80,
+};
+// (0, -1), the point of order 2.
+static const uint8_t kOrder2[32] = {
+    0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f,
+};
+// y = 2 is not the y coordinate of any curve point.
+static const uint8_t kNotOnCurve[32] = { 2 };
+
+// out = a + b over 256 bits (no reduction).
+static void Add256(uint8_t* out, const uint8_t* a, const uint8_t* b)
+{
+    unsigned carry = 0;
+    int i;
+    for (i = 0; i < 32; ++i) {
+        carry += (unsigned)a[i] + b[i];
+        out[i] = (uint8_t)carry;
+        carry >>= 8;
+    }
+}
+
+typedef struct SignedMessage {
+    uint8_t pk[32];
+    uint8_t sig[64];
+    uint8_t m[48];
+} SignedMessage;
+
+static void MakeSigned(SignedMessage* s)
+{
+    uint8_t sk[64];
+    hk_sign_ctx ctx;
+    size_t i;
+    crypto_sign_keypair(s->pk, sk);
+    for (i = 0; i < sizeof(s->m); ++i) s->m[i] = (uint8_t)NextRandom();
+    hk_sign_ctx_init(&ctx, sk);
+    hk_sign_detached(s->sig, s->m, sizeof(s->m), &ctx);
+    hk_sign_ctx_wipe(&ctx);
+}
+
+static void TestVerifyRejectsTampering(void)
+{
+    SignedMessage s, t;
+    uint8_t otherPk[32], otherSk[64];
+    int bit;
+
+    MakeSigned(&s);
+    CHECK(hk_sign_verify_detached(s.sig, s.m, sizeof(s.m), s.pk) == 0);
+
+    // Any single flipped bit in R, S or the message.
+    for (bit = 0; bit < 64 * 8; bit += 7) {
+        t = s;
+        t.sig[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+    }
+    for (bit = 0; bit < (int)sizeof(s.m) * 8; bit += 5) {
+        t = s;
+        t.m[bit / 8] ^= (uint8_t)(1u << (bit % 8));
+        CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+    }
+    CHECK(hk_sign_verify_detached(s.sig, s.m, sizeof(s.m) - 1, s.pk) != 0);
+
+    crypto_sign_keypair(otherPk, otherSk);
+    CHECK(hk_sign_verify_detached(s.sig, s.m, sizeof(s.m), otherPk) != 0);
+}
+
+// RFC 8032 5.1.7: S must be below L. S + L satisfies the verification equation
+// (the group has order L) and must still be rejected.
+static void TestVerifyRejectsNonCanonicalS(void)
+{
+    SignedMessage s, t;
+    hk_sign_batch_item items[2];
+    int valid[2];
+
+    MakeSigned(&s);
+    t = s;
+    Add256(t.sig + 32, s.sig + 32, kL);
+    CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+
+    // S = L (the canonical encoding of 0 plus L).
+    memcpy(t.sig + 32, kL, 32);
+    CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+
+    // Top bits set.
+    t = s;
+    t.sig[63] |= 0xe0;
+    CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+
+    Add256(t.sig + 32, s.sig + 32, kL);
+    items[0].m = s.m; items[0].n = sizeof(s.m); items[0].pk = s.pk; items[0].sig = s.sig;
+    items[1].m = t.m; items[1].n = sizeof(t.m); items[1].pk = t.pk; items[1].sig = t.sig;
+    CHECK(hk_sign_verify_batch(items, 2, valid) != 0);
+    CHECK(valid[0] == 1 && valid[1] == 0);
+}
+
+static void TestVerifyPointEncodings(void)
+{
+    SignedMessage s, t;
+    uint8_t sig[64];
+
+    // Small-order key: with A = identity, R = identity and S = 0 satisfy the
+    // verification equation for any message. RFC 8032 does not exclude such keys
+    // (verification keys here are pinned or enrolled, never attacker-chosen), so
+    // both verifiers accept it; what must fail is every other encoding of the
+    // same points.
+    memset(sig, 0, sizeof(sig));
+    memcpy(sig, kIdentity, 32);
+    CHECK(hk_sign_verify_detached(sig, (const uint8_t*)"any", 3, kIdentity) == 0);
+
+    // Non-canonical A, R, or both.
+    CHECK(hk_sign_verify_detached(sig, (const uint8_t*)"any", 3, kIdentityNonCanonical) != 0);
+    memcpy(sig, kIdentityNonCanonical, 32);
+    CHECK(hk_sign_verify_detached(sig, (const uint8_t*)"any", 3, kIdentity) != 0);
+    CHECK(hk_sign_verify_detached(sig, (const uint8_t*)"any", 3, kIdentityNonCanonical) != 0);
+
+    // Negative zero and off-curve encodings of A.
+    memcpy(sig, kIdentity, 32);
+    CHECK(hk_sign_verify_detached(sig, (const uint8_t*)"any", 3, kIdentityNegativeZero) != 0);
+    CHECK(hk_sign_verify_detached(sig, (const uint8_t*)"any", 3, kNotOnCurve) != 0);
+
+    // A real signature whose R is replaced by a small-order or malformed point.
+    MakeSigned(&s);
+    t = s;
+    memcpy(t.sig, kIdentity, 32);
+    CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+    memcpy(t.sig, kIdentityNonCanonical, 32);
+    CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+    memcpy(t.sig, kNotOnCurve, 32);
+    CHECK(hk_sign_verify_detached(t.sig, t.m, sizeof(t.m), t.pk) != 0);
+}
+
+// Both verifiers use the cofactored equation. With A of order 2, R = identity and
+// S = 0, S B = R + k A holds only for even k, but 8 S B = 8 R + 8 k A for every k: the
+// single check must accept these for every message, like the batch.
+static void TestSingleAndBatchAgree(void)
+{
+    SignedMessage s;
+    uint8_t sig[64];
+    uint8_t msgs[16][1];
+    hk_sign_batch_item items[17];
+    int valid[17];
+    size_t i;
+
+    memset(sig, 0, sizeof(sig));
+    memcpy(sig, kIdentity, 32);
+    for (i = 0; i < 16; ++i) {
+        msgs[i][0] = (uint8_t)i;
+        CHECK(hk_sign_verify_detached(sig, msgs[i], 1, kOrder2) == 0);
+        items[i].m = msgs[i]; items[i].n = 1; items[i].pk = kOrder2; items[i].sig = sig;
+    }
+    MakeSigned(&s);
+    items[16].m = s.m; items[16].n = sizeof(s.m); items[16].pk = s.pk; items[16].sig = s.sig;
+    CHECK(hk_sign_verify_batch(items, 17, valid) == 0);
+    for (i = 0; i < 17; ++i) CHECK(valid[i] == 1);
+
+    // Only the small-order parts may differ: R with its sign bit flipped fails both.
+    s.sig[31] ^= 0x80;
+    CHECK(hk_sign_verify_detached(s.sig, s.m, sizeof(s.m), s.pk) != 0);
+    CHECK(hk_sign_verify_batch(items, 17, valid) != 0);
+    for (i = 0; i < 17; ++i) CHECK(valid[i] == (i < 16 ? 1 : 0));
+}
+
+static void TestSignOpen(void)
+{
+    SignedMessage s;
+    uint8_t sm[64 + sizeof(s.m)], out[sizeof(s.m)];
+    uint64_t mlen = 0;
+
+    MakeSigned(&s);
+    memcpy(sm, s.sig, 64);
+    memcpy(sm + 64, s.m, sizeof(s.m));
+
+    CHECK(crypto_sign_open(out, &mlen, sm, sizeof(sm), s.pk) == 0);
+    CHECK(mlen == sizeof(s.m));
+    CHECK_MEM(out, s.m, sizeof(s.m));
+
+    // In place, as crypto_sign_open is commonly called.
+    {
+        uint8_t inPlace[sizeof(sm)];
+        memcpy(inPlace, sm, sizeof(sm));
+        CHECK(crypto_sign_open(inPlace, &mlen, inPlace, sizeof(inPlace), s.pk) == 0);
+        CHECK_MEM(inPlace, s.m, sizeof(s.m));
+    }
+
+    sm[64] ^= 1;
+    memset(out, 0xaa, sizeof(out));
+    CHECK(crypto_sign_open(out, &mlen, sm, sizeof(sm), s.pk) != 0);
+    CHECK(mlen == (uint64_t)-1);
+    {
+        static const uint8_t zero[sizeof(s.m)];
+        CHECK_MEM(out, zero, sizeof(out));
+    }
+
+    CHECK(crypto_sign_open(out, &mlen, sm, 63, s.pk) != 0);
+}
+
+// One bad signature at several positions in batches of 1, 2, one full chunk and
+// one chunk plus one; the valid flags must single it out.
+static void TestBatchFindsBadSignature(void)
+{
+    static const size_t kSizes[] = { 1, 2, HK_SIGN_BATCH_CHUNK, HK_SIGN_BATCH_CHUNK + 1 };
+    enum { kMax = HK_SIGN_BATCH_CHUNK + 1 };
+    static SignedMessage msgs[kMax];
+    static hk_sign_batch_item items[kMax];
+    static int valid[kMax];
+    size_t k, i, j;
+
+    for (i = 0; i < kMax; ++i) {
+        MakeSigned(&msgs[i]);
+        items[i].m = msgs[i].m;
+        items[i].n = sizeof(msgs[i].m);
+        items[i].pk = msgs[i].pk;
+        items[i].sig = msgs[i].sig;
+    }
+
+    for (k = 0; k < sizeof(kSizes) / sizeof(kSizes[0]); ++k) {
+        const size_t n = kSizes[k];
+        const size_t positions[3] = { 0, n / 2, n - 1 };
+
+        for (i = 0; i < n; ++i) valid[i] = -1;
+        CHECK(hk_sign_verify_batch(items, n, valid) == 0);
+        for (i = 0; i < n; ++i) CHECK(valid[i] == 1);
+        CHECK(hk_sign_verify_batch(items, n, NULL) == 0);
+
+        for (j = 0; j < 3; ++j) {
+            const size_t bad = positions[j];
+            msgs[bad].m[0] ^= 1;
+            for (i = 0; i < n; ++i) valid[i] = -1;
+            CHECK(hk_sign_verify_batch(items, n, valid) != 0);
+            for (i = 0; i < n; ++i) CHECK(valid[i] == (i == bad ? 0 : 1));
+            CHECK(hk_sign_verify_batch(items, n, NULL) != 0);
+            msgs[bad].m[0] ^= 1;
+        }
+    }
+
+    CHECK(hk_sign_verify_batch(items, 0, valid) == 0);
+}
+
+// Items the batch equation cannot take (bad encodings) fall back to single
+// verification instead of failing the whole chunk.
+static void TestBatchRejectsMalformedItems(void)
+{
+    enum { kCount = 5 };
+    SignedMessage msgs[kCount];
+    hk_sign_batch_item items[kCount];
+    uint8_t smallOrderSig[64];
+    int valid[kCount];
+    size_t i;
+
+    for (i = 0; i < kCount; ++i) {
+        MakeSigned(&msgs[i]);
+        items[i].m = msgs[i].m;
+        items[i].n = sizeof(msgs[i].m);
+        items[i].pk = msgs[i].pk;
+        items[i].sig = msgs[i].sig;
+    }
+    items[1].pk = kNotOnCurve;
+    items[3].pk = kIdentityNonCanonical;
+    CHECK(hk_sign_verify_batch(items, kCount, valid) != 0);
+    CHECK(valid[0] == 1 && valid[1] == 0 && valid[2] == 1 && valid[3] == 0 && valid[4] == 1);
+
+    // The small-order case above gets the same answer from the batch.
+    memset(smallOrderSig, 0, sizeof(smallOrderSig));
+    memcpy(smallOrderSig, kIdentity, 32);
+    items[1].pk = msgs[1].pk;
+    items[3].pk = kIdentity;
+    items[3].sig = smallOrderSig;
+    CHECK(hk_sign_verify_batch(items, kCount, valid) == 0);
+    CHECK(valid[3] == 1);
+}
+
+int main(void)
+{
+    TestRfc8032Vectors();
+    TestCrossCheckAgainstTweetNaCl();
+    TestVerifyRejectsTampering();
+    TestVerifyRejectsNonCanonicalS();
+    TestVerifyPointEncodings();
+    TestSingleAndBatchAgree();
+    TestSignOpen();
+    TestBatchFindsBadSignature();
+    TestBatchRejectsMalformedItems();
+    return TEST_EXIT_CODE();
+}
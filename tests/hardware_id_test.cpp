@@ -0,0 +1,126 @@
+// hardware_id_test
+// - HardwareIdProbe::ParseRawSmbiosData on RSMB blobs (tests/data/smbios), checked against the
+//   strings wmic reports for the same fields:
+//     rsmb_2_4_padded.bin  SMBIOS 2.4: UUID fields in wire order, serials padded with blanks
+//     rsmb_2_6.bin         SMBIOS 2.6: little-endian UUID fields, type 2 ahead of type 1
+//     rsmb_3_2_blank.bin   SMBIOS 3.2: no type 1 serial string, an all-blank baseboard serial
+//   The blobs are built in the GetSystemFirmwareTable('RSMB') layout with vendor-style
+//   strings; they share one UUID so the byte-order gate shows directly in the expectations.
+// - The version gate at 2.5/2.6 and 3.0, truncated and malformed tables, and the EDX:EAX
+//   order of ProcessorId.
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "HardwareIdProbe.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+using HardwareIdProbe::SmbiosInfo;
+
+const char* const kUuidWireOrder = "44454C4C-4200-1035-8052-B4C04F563132";
+const char* const kUuidLittleEndian = "4C4C4544-0042-3510-8052-B4C04F563132";
+
+std::vector<uint8_t> LoadBlob(const char* name) {
+    const std::string path = std::string(HK_TEST_DATA_DIR) + "/smbios/" + name;
+    std::ifstream ifs(path, std::ios::binary);
+    std::vector<uint8_t> out((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (out.empty()) std::fprintf(stderr, "cannot read %s\n", path.c_str());
+    return out;
+}
+
+struct Expected {
+    const char* blob;
+    const char* uuid;
+    const char* systemSerial;
+    const char* baseboardSerial;
+};
+
+const Expected kRecorded[] = {
+    { "rsmb_2_4_padded.bin", kUuidWireOrder, "5J2VQ1S", "..CN1374098R00TD." },
+    { "rsmb_2_6.bin", kUuidLittleEndian, "System Serial Number", "MT7017K20002345" },
+    { "rsmb_3_2_blank.bin", kUuidLittleEndian, "", "" },
+};
+
+void TestRecordedBlobs() {
+    for (const Expected& e : kRecorded) {
+        const std::vector<uint8_t> blob = LoadBlob(e.blob);
+        SmbiosInfo info;
+        CHECK(HardwareIdProbe::ParseRawSmbiosData(blob.data(), blob.size(), info));
+        CHECK(info.valid);
+        CHECK(info.systemUuid == e.uuid);
+        CHECK(info.systemSerial == e.systemSerial);
+        CHECK(info.baseboardSerial == e.baseboardSerial);
+    }
+}
+
+// Same table under different header versions: only 2.6 and later swap the first three fields.
+void TestUuidVersionGate() {
+    std::vector<uint8_t> blob = LoadBlob("rsmb_2_6.bin");
+    if (blob.size() < 8) {
+        CHECK(blob.size() >= 8);
+        return;
+    }
+    const struct { uint8_t major, minor; const char* uuid; } cases[] = {
+        { 2, 0, kUuidWireOrder },
+        { 2, 5, kUuidWireOrder },
+        { 2, 6, kUuidLittleEndian },
+        { 2, 8, kUuidLittleEndian },
+        { 3, 0, kUuidLittleEndian },
+        { 3, 4, kUuidLittleEndian },
+    };
+    for (const auto& c : cases) {
+        blob[1] = c.major;
+        blob[2] = c.minor;
+        SmbiosInfo info;
+        CHECK(HardwareIdProbe::ParseRawSmbiosData(blob.data(), blob.size(), info));
+        CHECK(info.systemUuid == c.uuid);
+    }
+
+    const uint8_t u[16] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                            0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    CHECK(HardwareIdProbe::FormatSmbiosUuid(u, false) == "00112233-4455-6677-8899-AABBCCDDEEFF");
+    CHECK(HardwareIdProbe::FormatSmbiosUuid(u, true) == "33221100-5544-7766-8899-AABBCCDDEEFF");
+}
+
+void TestMalformed() {
+    const std::vector<uint8_t> blob = LoadBlob("rsmb_2_4_padded.bin");
+    SmbiosInfo info;
+
+    CHECK(!HardwareIdProbe::ParseRawSmbiosData(nullptr, 0, info));
+    CHECK(!HardwareIdProbe::ParseRawSmbiosData(blob.data(), 7, info));
+    // Declared length longer than the data.
+    CHECK(!HardwareIdProbe::ParseRawSmbiosData(blob.data(), blob.size() - 1, info));
+    CHECK(!info.valid && info.systemUuid.empty());
+
+    // Table cut inside the type 0 strings: type 1 is never reached.
+    std::vector<uint8_t> cut(blob.begin(), blob.begin() + 8 + 0x12 + 4);
+    const uint32_t length = static_cast<uint32_t>(cut.size() - 8);
+    for (int i = 0; i < 4; ++i) cut[4 + i] = static_cast<uint8_t>(length >> (8 * i));
+    CHECK(!HardwareIdProbe::ParseRawSmbiosData(cut.data(), cut.size(), info));
+
+    // A structure whose length byte is below the 4-byte header stops the walk.
+    std::vector<uint8_t> bad = blob;
+    bad[8 + 1] = 2;
+    CHECK(!HardwareIdProbe::ParseRawSmbiosData(bad.data(), bad.size(), info));
+}
+
+void TestProcessorId() {
+    // wmic cpu get ProcessorId on a Core i7-8700: EDX BFEBFBFF, EAX 000906EA.
+    CHECK(HardwareIdProbe::FormatProcessorId(0x000906EA, 0xBFEBFBFF) == "BFEBFBFF000906EA");
+    CHECK(HardwareIdProbe::FormatProcessorId(0x00000F4A, 0x0000000B) == "0000000B00000F4A");
+    CHECK(HardwareIdProbe::ProcessorId().size() == 16 || HardwareIdProbe::ProcessorId().empty());
+}
+
+} // namespace
+
+int main() {
+    TestRecordedBlobs();
+    TestUuidVersionGate();
+    TestMalformed();
+    TestProcessorId();
+    return TEST_EXIT_CODE();
+}
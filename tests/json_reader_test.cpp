@@ -0,0 +1,173 @@
+// json_reader_test
+// - JsonReader: \uXXXX escapes, surrogate pairs and lone surrogates, escaped keys, the
+//   shallowest-match rule, keys that only appear inside string values, malformed documents
+//   (trailing garbage, trailing commas, raw control characters), the nesting limit, and
+//   GetInt64 at the int64_t limits.
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "JsonReader.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+bool Parses(const std::string& text) {
+    JsonReader r;
+    return r.Parse(text);
+}
+
+void TestUnicodeEscapes() {
+    const std::string text =
+        "{\"ascii\":\"\\u0041\\u0062\","
+        "\"two\":\"\\u00e9\","
+        "\"three\":\"\\u65E5\\u672c\","
+        "\"pair\":\"\\ud83d\\ude00\","
+        "\"lone_high\":\"a\\ud83dz\","
+        "\"lone_low\":\"\\ude00\","
+        "\"high_high\":\"\\ud83d\\ud83d\\ude00\","
+        "\"simple\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"}";
+    const JsonReader r(text);
+    CHECK(r.IsValid());
+    CHECK(r.StringOr("ascii") == "Ab");
+    CHECK(r.StringOr("two") == "\xC3\xA9");
+    CHECK(r.StringOr("three") == "\xE6\x97\xA5\xE6\x9C\xAC");
+    CHECK(r.StringOr("pair") == "\xF0\x9F\x98\x80");
+    // Lone surrogates decode to U+FFFD; a high surrogate followed by a pair keeps the pair.
+    CHECK(r.StringOr("lone_high") == "a\xEF\xBF\xBDz");
+    CHECK(r.StringOr("lone_low") == "\xEF\xBF\xBD");
+    CHECK(r.StringOr("high_high") == "\xEF\xBF\xBD\xF0\x9F\x98\x80");
+    CHECK(r.StringOr("simple") == "\"\\/\b\f\n\r\t");
+
+    CHECK(!Parses("{\"a\":\"\\u12\"}"));
+    CHECK(!Parses("{\"a\":\"\\u12G4\"}"));
+    CHECK(!Parses("{\"a\":\"\\x41\"}"));
+}
+
+void TestEscapedKey() {
+    const std::string text = "{\"re\\u0061son\":\"escaped\",\"n\\\"q\":1}";
+    const JsonReader r(text);
+    CHECK(r.StringOr("reason") == "escaped");
+    int64_t v = 0;
+    CHECK(r.GetInt64("n\"q", v) && v == 1);
+    CHECK(!r.Has("re\\u0061son"));
+}
+
+// The top-level reason wins over one nested earlier in the document.
+void TestShallowestMatch() {
+    const std::string text =
+        "{\"detail\":{\"reason\":\"inner\",\"deeper\":{\"reason\":\"deepest\"}},"
+        "\"reason\":\"outer\","
+        "\"list\":[{\"only_nested\":\"in array\"}],"
+        "\"a\":{\"b\":{\"code\":3}},\"x\":{\"code\":2}}";
+    const JsonReader r(text);
+    CHECK(r.StringOr("reason") == "outer");
+    CHECK(r.StringOr("only_nested") == "in array");
+    int64_t code = 0;
+    CHECK(r.GetInt64("code", code) && code == 2);
+}
+
+void TestKeyInsideStringValue() {
+    const std::string text = "{\"error\":\"bad \\\"reason\\\":\\\"x\\\" here\",\"msg\":\"\\\"nonce\\\":1\"}";
+    const JsonReader r(text);
+    CHECK(r.IsValid());
+    CHECK(!r.Has("reason"));
+    CHECK(!r.Has("nonce"));
+    std::string out = "stale";
+    CHECK(!r.GetString("reason", out) && out.empty());
+    CHECK(r.StringOr("reason", "none") == "none");
+}
+
+void TestMalformed() {
+    CHECK(Parses("{\"a\":1}"));
+    CHECK(Parses(" \r\n\t{\"a\":1} \n"));
+    CHECK(Parses("[]"));
+    CHECK(Parses("\"bare\""));
+
+    // Trailing garbage after the value.
+    CHECK(!Parses("{\"a\":1}x"));
+    CHECK(!Parses("{\"a\":1}{\"b\":2}"));
+    CHECK(!Parses("{\"a\":1}}"));
+    // Trailing commas.
+    CHECK(!Parses("{\"a\":1,}"));
+    CHECK(!Parses("[1,2,]"));
+    CHECK(!Parses("{\"a\":[1,],\"b\":2}"));
+    // Raw control characters inside strings, in keys and values.
+    CHECK(!Parses("{\"a\":\"line\nbreak\"}"));
+    CHECK(!Parses("{\"a\":\"tab\there\"}"));
+    CHECK(!Parses(std::string("{\"a\":\"nul\0\"}", 11)));
+    CHECK(!Parses("{\"k\x01\":1}"));
+    // Truncated, unquoted, misspelled literals, bad numbers.
+    CHECK(!Parses(""));
+    CHECK(!Parses("{\"a\":"));
+    CHECK(!Parses("{\"a\":\"open}"));
+    CHECK(!Parses("{a:1}"));
+    CHECK(!Parses("{\"a\":tru}"));
+    CHECK(!Parses("{\"a\":01}"));
+    CHECK(!Parses("{\"a\":1.}"));
+    CHECK(!Parses("{\"a\":-}"));
+
+    // A failed parse leaves nothing to look up.
+    const std::string bad = "{\"reason\":\"x\",}";
+    const JsonReader r(bad);
+    CHECK(!r.IsValid());
+    CHECK(!r.Has("reason"));
+}
+
+std::string Nested(int objects, int arrays) {
+    std::string s;
+    for (int i = 0; i < objects; ++i) s += "{\"k\":";
+    for (int i = 0; i < arrays; ++i) s += "[";
+    s += "1";
+    for (int i = 0; i < arrays; ++i) s += "]";
+    for (int i = 0; i < objects; ++i) s += "}";
+    return s;
+}
+
+// 64 levels of objects and arrays (kMaxDepth) parse; one more does not.
+void TestDepthLimit() {
+    CHECK(Parses(Nested(64, 0)));
+    CHECK(!Parses(Nested(65, 0)));
+    CHECK(Parses(Nested(1, 63)));
+    CHECK(!Parses(Nested(1, 64)));
+    CHECK(Parses(Nested(32, 32)));
+    CHECK(!Parses(Nested(32, 33)));
+    CHECK(!Parses(Nested(100000, 0)));
+}
+
+void TestGetInt64() {
+    const std::string text =
+        "{\"max\":9223372036854775807,\"min\":-9223372036854775808,"
+        "\"over\":9223372036854775808,\"under\":-9223372036854775809,\"huge\":123456789012345678901234,"
+        "\"zero\":0,\"neg\":-42,\"frac\":1.5,\"whole_frac\":2.0,\"exp\":1e3,"
+        "\"str\":\"5\",\"bool\":true,\"null\":null}";
+    const JsonReader r(text);
+    CHECK(r.IsValid());
+
+    int64_t v = 0;
+    CHECK(r.GetInt64("max", v) && v == std::numeric_limits<int64_t>::max());
+    CHECK(r.GetInt64("min", v) && v == std::numeric_limits<int64_t>::min());
+    CHECK(r.GetInt64("zero", v) && v == 0);
+    CHECK(r.GetInt64("neg", v) && v == -42);
+
+    // Rejected without touching out.
+    v = 7;
+    for (const char* key : { "over", "under", "huge", "frac", "whole_frac", "exp", "str", "bool", "null", "missing" }) {
+        CHECK(!r.GetInt64(key, v));
+    }
+    CHECK(v == 7);
+}
+
+} // namespace
+
+int main() {
+    TestUnicodeEscapes();
+    TestEscapedKey();
+    TestShallowestMatch();
+    TestKeyInsideStringValue();
+    TestMalformed();
+    TestDepthLimit();
+    TestGetInt64();
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,124 @@
+// json_writer_test
+// - JsonWriter output byte for byte against the JsonEscape / string concatenation it replaced:
+//   AppendEscaped for every byte value (alone, inside unescaped runs, and all 256 in one string),
+//   and complete device_refresh bodies, including a reused writer after Reset().
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#include "JsonWriter.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+// The escaping used before JsonWriter.
+std::string LegacyJsonEscape(const std::string& s) {
+    std::ostringstream oss;
+    for (char ch : s) {
+        switch (ch) {
+            case '\\': oss << "\\\\"; break;
+            case '"': oss << "\\\""; break;
+            case '\n': oss << "\\n"; break;
+            case '\r': oss << "\\r"; break;
+            case '\t': oss << "\\t"; break;
+            default:
+                if ((unsigned char)ch < 0x20) {
+                    oss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)(unsigned char)ch;
+                } else {
+                    oss << ch;
+                }
+        }
+    }
+    return oss.str();
+}
+
+std::string Escaped(const std::string& s) {
+    std::string out;
+    JsonWriter::AppendEscaped(out, s.data(), s.size());
+    return out;
+}
+
+void TestEveryByte() {
+    std::string all;
+    for (int b = 0; b < 256; ++b) {
+        const std::string one(1, static_cast<char>(b));
+        if (Escaped(one) != LegacyJsonEscape(one)) std::fprintf(stderr, "  byte 0x%02x\n", b);
+        CHECK(Escaped(one) == LegacyJsonEscape(one));
+        // Between unescaped runs, which are copied in bulk.
+        const std::string framed = "abcdefghijklmnop" + one + "qrstuvwxyz012345";
+        CHECK(Escaped(framed) == LegacyJsonEscape(framed));
+        all += one;
+    }
+    CHECK(Escaped(all) == LegacyJsonEscape(all));
+    const std::string reversed(all.rbegin(), all.rend());
+    CHECK(Escaped(reversed) == LegacyJsonEscape(reversed));
+
+    // AppendEscaped appends.
+    std::string out = "prefix:";
+    JsonWriter::AppendEscaped(out, "a\"b", 3);
+    CHECK(out == "prefix:a\\\"b");
+}
+
+struct RefreshFields {
+    std::string deviceId;
+    std::string refreshToken;
+    std::string nonceId;
+    std::string nonce;
+    std::string sigB64;
+};
+
+std::string LegacyRefreshBody(const RefreshFields& f) {
+    return std::string("{")
+        + "\"device_id\":\"" + LegacyJsonEscape(f.deviceId) + "\","
+        + "\"refresh_token\":\"" + LegacyJsonEscape(f.refreshToken) + "\","
+        + "\"nonce_id\":\"" + LegacyJsonEscape(f.nonceId) + "\","
+        + "\"nonce\":\"" + LegacyJsonEscape(f.nonce) + "\","
+        + "\"device_sig_b64\":\"" + LegacyJsonEscape(f.sigB64) + "\""
+        + "}";
+}
+
+void WriteRefreshBody(JsonWriter& w, const RefreshFields& f) {
+    w.BeginObject()
+        .String("device_id", f.deviceId)
+        .String("refresh_token", f.refreshToken)
+        .String("nonce_id", f.nonceId)
+        .String("nonce", f.nonce)
+        .String("device_sig_b64", f.sigB64)
+        .EndObject();
+}
+
+void TestRefreshBody() {
+    RefreshFields typical;
+    typical.deviceId = "dev-8c1f0f4e-51a7-4c4e-9e8b-2f6f4f9d1a3b";
+    typical.refreshToken = "Qm9vdHN0cmFwUmVmcmVzaFRva2VuLTQzLWNoYXJhY3Q";
+    typical.nonceId = "n-1234567890";
+    typical.nonce = "8Jc0pT+u1r/6Q3oXy9Lw2dVb5nHkZsA4eFgRiMjKqOtYlNx7CzUvWb3aE1G0fD2h";
+    typical.sigB64 = "d2F0ZXJtZWxvbi1zaWduYXR1cmUtYnl0ZXMtZm9yLXRoZS1yZWZyZXNoLXJlcXVlc3QtYm9keS0wMTIzNDU2Nzg5YWJj";
+
+    RefreshFields hostile;
+    hostile.deviceId = "dev\"1\\";
+    hostile.refreshToken = std::string("tok\n\r\t\x01\x1f\x7f\0", 10) + "\xE6\x97\xA5";
+    hostile.nonceId = "";
+    hostile.nonce = "</script>\b\f";
+    hostile.sigB64 = std::string(4096, '+') + "\"";
+
+    JsonWriter reused(16);
+    for (const RefreshFields* f : { &typical, &hostile, &typical }) {
+        JsonWriter fresh;
+        WriteRefreshBody(fresh, *f);
+        CHECK(fresh.str() == LegacyRefreshBody(*f));
+
+        reused.Reset();
+        WriteRefreshBody(reused, *f);
+        CHECK(reused.str() == LegacyRefreshBody(*f));
+    }
+}
+
+} // namespace
+
+int main() {
+    TestEveryByte();
+    TestRefreshBody();
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,268 @@
+// license_blob_test
+// - LicenseBlob::Check with a fixed signing key (RFC 8032 TEST 1) pinned at build time: blob
+//   parsing, both base64 alphabets with and without padding, and every verdict.
+// - Built a second time without a pinned key (LICENSE_BLOB_TEST_NO_PINNED_KEY) for NoPinnedKey.
+
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "LicenseBlob.h"
+#include "RefreshScheduler.h"
+#include "hk_tweetnacl_sign.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+// Seed handed to the next crypto_sign_keypair call.
+uint8_t g_seed[32];
+
+} // namespace
+
+extern "C" void randombytes(uint8_t* out, uint64_t outlen) {
+    for (uint64_t i = 0; i < outlen; ++i) out[i] = g_seed[i % sizeof(g_seed)];
+}
+
+namespace {
+
+using Verdict = LicenseBlob::Verdict;
+using SystemClock = std::chrono::system_clock;
+
+const char* const kDevice = "dev-1";
+const char* const kMachine = "machine-1";
+const char* const kExpiry = "2030-01-01T00:00:00Z";
+
+std::string Base64(const std::string& in, bool urlSafe, bool pad) {
+    const char* alphabet = urlSafe
+        ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"
+        : "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned char ch : in) {
+        acc = (acc << 8) | ch;
+        bits += 8;
+        while (bits >= 6) {
+            bits -= 6;
+            out.push_back(alphabet[(acc >> bits) & 63]);
+        }
+    }
+    if (bits > 0) out.push_back(alphabet[(acc << (6 - bits)) & 63]);
+    while (pad && out.size() % 4 != 0) out.push_back('=');
+    return out;
+}
+
+struct Signer {
+    hk_sign_ctx ctx;
+
+    explicit Signer(const char* seedHex) {
+        uint8_t pk[32];
+        uint8_t sk[64];
+        TestHex(seedHex, g_seed);
+        crypto_sign_keypair(pk, sk);
+        hk_sign_ctx_init(&ctx, sk);
+    }
+    ~Signer() { hk_sign_ctx_wipe(&ctx); }
+
+    std::string Sign(const std::string& text) const {
+        uint8_t sig[64];
+        hk_sign_detached(sig, reinterpret_cast<const uint8_t*>(text.data()), text.size(), &ctx);
+        return std::string(reinterpret_cast<const char*>(sig), sizeof(sig));
+    }
+};
+
+std::string Payload(const std::string& deviceId, const std::string& expiry, const char* machineId = nullptr,
+    const char* extra = nullptr) {
+    std::string p = "{\"device_id\":\"" + deviceId + "\",\"entitlement_expires_at\":\"" + expiry + "\"";
+    if (machineId) p += std::string(",\"machine_id\":\"") + machineId + "\"";
+    if (extra) p += extra;
+    return p + "}";
+}
+
+// Blob whose first segment is exactly payloadSegment (already encoded), signed by signer.
+std::string BlobFromSegment(const Signer& signer, const std::string& payloadSegment, bool urlSafe = true, bool pad = false) {
+    return payloadSegment + "." + Base64(signer.Sign(payloadSegment), urlSafe, pad);
+}
+
+std::string Blob(const Signer& signer, const std::string& payload, bool urlSafe = true, bool pad = false) {
+    return BlobFromSegment(signer, Base64(payload, urlSafe, pad), urlSafe, pad);
+}
+
+SystemClock::time_point At(const char* iso) {
+    SystemClock::time_point t;
+    RefreshScheduler::ParseIso8601(iso, t);
+    return t;
+}
+
+Verdict Check(const std::string& blob, const char* stored = kExpiry, const char* now = "2029-06-01T00:00:00Z",
+    LicenseBlob::Claims* claims = nullptr) {
+    return LicenseBlob::Check(blob, kDevice, kMachine, stored, At(now), claims);
+}
+
+#ifndef LICENSE_BLOB_TEST_NO_PINNED_KEY
+
+// RFC 8032 section 7.1 TEST 1; its public key is pinned for this test (tests/CMakeLists.txt).
+const char* const kPinnedSeed = "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60";
+const char* const kOtherSeed = "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb";
+
+void TestValid() {
+    const Signer signer(kPinnedSeed);
+    CHECK(LicenseBlob::HasPinnedKey());
+
+    LicenseBlob::Claims claims;
+    CHECK(Check(Blob(signer, Payload(kDevice, kExpiry, kMachine)), kExpiry, "2029-06-01T00:00:00Z", &claims) == Verdict::Valid);
+    CHECK(claims.deviceId == kDevice);
+    CHECK(claims.machineId == kMachine);
+    CHECK(claims.entitlementExpiresAt == kExpiry);
+    CHECK(claims.expiresAt == At(kExpiry));
+
+    // machine_id is optional.
+    CHECK(Check(Blob(signer, Payload(kDevice, kExpiry)), kExpiry, "2029-06-01T00:00:00Z", &claims) == Verdict::Valid);
+    CHECK(claims.machineId.empty());
+
+    // The stored expiry only has to denote the same instant.
+    CHECK(Check(Blob(signer, Payload(kDevice, kExpiry)), "2030-01-01T09:00:00+09:00") == Verdict::Valid);
+
+    // A far-future expiry (beyond a nanosecond system_clock) still verifies as valid.
+    CHECK(Check(Blob(signer, Payload(kDevice, "9999-12-31T23:59:59Z")), "9999-12-31T23:59:59Z") == Verdict::Valid);
+}
+
+// "ab?~~~" encodes to "YWI/fn5+" / "YWI_fn5-": both alphabet-specific characters appear.
+// Payload lengths 0, 1 and 2 mod 3 exercise every padding length.
+void TestBase64Variants() {
+    const Signer signer(kPinnedSeed);
+    const char* extras[] = { ",\"x\":\"ab?~~~\"", ",\"x\":\"ab?~~~a\"", ",\"x\":\"ab?~~~ab\"" };
+    for (const char* extra : extras) {
+        const std::string payload = Payload(kDevice, kExpiry, kMachine, extra);
+        for (int urlSafe = 0; urlSafe < 2; ++urlSafe) {
+            for (int pad = 0; pad < 2; ++pad) {
+                CHECK(Check(Blob(signer, payload, urlSafe != 0, pad != 0)) == Verdict::Valid);
+            }
+        }
+        // Mixed alphabets across the two segments.
+        CHECK(Check(BlobFromSegment(signer, Base64(payload, false, true), true, false)) == Verdict::Valid);
+    }
+    CHECK(Base64("ab?~~~", false, false) == "YWI/fn5+");
+    CHECK(Base64("ab?~~~", true, false) == "YWI_fn5-");
+
+    // The signature covers the segment text: re-encoding the same payload in the other alphabet
+    // without re-signing is a different message.
+    const std::string payload = Payload(kDevice, kExpiry, kMachine, extras[0]);
+    const std::string urlBlob = Blob(signer, payload, true, false);
+    const std::string sig = urlBlob.substr(urlBlob.find('.'));
+    CHECK(Check(Base64(payload, false, false) + sig) == Verdict::BadSignature);
+}
+
+void TestMalformed() {
+    const Signer signer(kPinnedSeed);
+    const std::string good = Blob(signer, Payload(kDevice, kExpiry));
+    const size_t dot = good.find('.');
+    const std::string segment = good.substr(0, dot);
+    const std::string sig = good.substr(dot + 1);
+
+    CHECK(Check("") == Verdict::Malformed);
+    CHECK(Check(segment) == Verdict::Malformed);                    // no dot
+    CHECK(Check("." + sig) == Verdict::Malformed);                  // empty payload segment
+    CHECK(Check(segment + ".") == Verdict::Malformed);              // empty signature
+    CHECK(Check(good + ".") == Verdict::Malformed);                 // two dots
+    CHECK(Check(good + "." + sig) == Verdict::Malformed);
+    CHECK(Check(segment + "." + sig.substr(0, sig.size() - 4)) == Verdict::Malformed);   // short signature
+    CHECK(Check(segment + "." + sig + "AAAA") == Verdict::Malformed);                      // long signature
+    CHECK(Check(segment + "." + sig.substr(0, sig.size() - 1) + "*") == Verdict::Malformed);
+    CHECK(Check(segment + ". " + sig) == Verdict::Malformed);        // whitespace
+    CHECK(Check(segment + "." + sig + "A") == Verdict::Malformed);  // length 1 mod 4
+
+    // Signature fine, payload segment not base64 / not the expected JSON.
+    CHECK(Check(BlobFromSegment(signer, segment + "*")) == Verdict::Malformed);
+    CHECK(Check(BlobFromSegment(signer, segment + "A")) == Verdict::Malformed);
+    CHECK(Check(Blob(signer, "not json")) == Verdict::Malformed);
+    CHECK(Check(Blob(signer, "{\"entitlement_expires_at\":\"2030-01-01T00:00:00Z\"}")) == Verdict::Malformed);
+    CHECK(Check(Blob(signer, Payload("", kExpiry))) == Verdict::Malformed);
+    CHECK(Check(Blob(signer, "{\"device_id\":\"dev-1\"}")) == Verdict::Malformed);
+    CHECK(Check(Blob(signer, Payload(kDevice, "someday"))) == Verdict::Malformed);
+    CHECK(Check(Blob(signer, "{\"device_id\":1,\"entitlement_expires_at\":\"2030-01-01T00:00:00Z\"}")) == Verdict::Malformed);
+}
+
+void TestBadSignature() {
+    const Signer signer(kPinnedSeed);
+    const Signer other(kOtherSeed);
+    const std::string payload = Payload(kDevice, kExpiry);
+
+    CHECK(Check(Blob(other, payload)) == Verdict::BadSignature);
+
+    // Tampered payload segment that still decodes: sign one, present another.
+    const std::string good = Blob(signer, payload);
+    const std::string otherPayload = Base64(Payload("dev-2", kExpiry), true, false);
+    CHECK(Check(otherPayload + good.substr(good.find('.'))) == Verdict::BadSignature);
+
+    // Flipped signature bit.
+    std::string rawSig = signer.Sign(Base64(payload, true, false));
+    rawSig[10] ^= 0x01;
+    CHECK(Check(Base64(payload, true, false) + "." + Base64(rawSig, true, false)) == Verdict::BadSignature);
+}
+
+void TestWrongDevice() {
+    const Signer signer(kPinnedSeed);
+    LicenseBlob::Claims claims;
+    CHECK(Check(Blob(signer, Payload("dev-2", kExpiry)), kExpiry, "2029-06-01T00:00:00Z", &claims) == Verdict::WrongDevice);
+    CHECK(claims.deviceId == "dev-2");      // claims are reported whenever the signature is good
+    CHECK(Check(Blob(signer, Payload(kDevice, kExpiry, "machine-2"))) == Verdict::WrongDevice);
+}
+
+void TestMismatchAndExpired() {
+    const Signer signer(kPinnedSeed);
+    const std::string blob = Blob(signer, Payload(kDevice, kExpiry));
+
+    CHECK(Check(blob, "2031-01-01T00:00:00Z") == Verdict::Mismatch);
+    CHECK(Check(blob, "") == Verdict::Mismatch);
+    CHECK(Check(blob, "garbage") == Verdict::Mismatch);
+
+    CHECK(Check(blob, kExpiry, "2029-12-31T23:59:59Z") == Verdict::Valid);
+    CHECK(Check(blob, kExpiry, kExpiry) == Verdict::Expired);
+    CHECK(Check(blob, kExpiry, "2030-01-02T00:00:00Z") == Verdict::Expired);
+}
+
+// The decoded result is memoized for the last blob; switching blobs must not serve stale data.
+void TestAlternatingBlobs() {
+    const Signer signer(kPinnedSeed);
+    const Signer other(kOtherSeed);
+    const std::string a = Blob(signer, Payload(kDevice, kExpiry));
+    const std::string b = Blob(other, Payload(kDevice, kExpiry));
+    for (int i = 0; i < 3; ++i) {
+        CHECK(Check(a) == Verdict::Valid);
+        CHECK(Check(b) == Verdict::BadSignature);
+    }
+}
+
+void TestVerdictStrings() {
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::Valid), "valid") == 0);
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::Expired), "expired") == 0);
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::NoPinnedKey), "no_pinned_key") == 0);
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::Malformed), "malformed") == 0);
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::BadSignature), "bad_signature") == 0);
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::WrongDevice), "wrong_device") == 0);
+    CHECK(std::strcmp(LicenseBlob::VerdictToString(Verdict::Mismatch), "mismatch") == 0);
+}
+
+#endif
+
+} // namespace
+
+int main() {
+#ifdef LICENSE_BLOB_TEST_NO_PINNED_KEY
+    const Signer signer("9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60");
+    CHECK(!LicenseBlob::HasPinnedKey());
+    CHECK(Check(Blob(signer, Payload(kDevice, kExpiry))) == Verdict::NoPinnedKey);
+    CHECK(Check("") == Verdict::NoPinnedKey);
+#else
+    TestValid();
+    TestBase64Variants();
+    TestMalformed();
+    TestBadSignature();
+    TestWrongDevice();
+    TestMismatchAndExpired();
+    TestAlternatingBlobs();
+    TestVerdictStrings();
+#endif
+    return TEST_EXIT_CODE();
+}
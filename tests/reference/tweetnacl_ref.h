@@ -0,0 +1,23 @@
+#pragma once
+// tweetnacl_ref.h
+//
+// Original TweetNaCl SHA-512 and Ed25519 signing, kept for cross-checking hk_tweetnacl_sign.c.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared with hk_tweetnacl_sign.c (the test provides it).
+void randombytes(uint8_t* out, uint64_t outlen);
+
+// Original byte-at-a-time SHA-512.
+int ref_crypto_hash(uint8_t* out, const uint8_t* m, uint64_t n);
+
+int ref_crypto_sign_keypair(uint8_t* pk, uint8_t* sk);
+int ref_crypto_sign(uint8_t* sm, uint64_t* smlen, const uint8_t* m, uint64_t n, const uint8_t* sk);
+
+#ifdef __cplusplus
+}
+#endif
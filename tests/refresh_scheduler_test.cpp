@@ -0,0 +1,191 @@
+// refresh_scheduler_test
+// - RefreshScheduler with a fixed seed and explicit clocks: the half-lifetime interval clamped
+//   to [minInterval, maxInterval] (verifiedMaxInterval while the license verifies), the
+//   +/- jitterFraction spread, backoff ceilings after repeated Transient outcomes and their reset,
+//   and PlanFromPersisted for overdue, not yet due, future and unparsable last successes.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <string>
+
+#include "RefreshScheduler.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+using std::chrono::hours;
+using std::chrono::milliseconds;
+using std::chrono::minutes;
+using SteadyPoint = RefreshScheduler::SteadyClock::time_point;
+using SystemPoint = RefreshScheduler::SystemClock::time_point;
+
+// 2030-01-01T00:00:00Z
+const SystemPoint kSystemNow = RefreshScheduler::SystemClock::from_time_t(1893456000);
+const SteadyPoint kSteadyNow = SteadyPoint(hours(100));
+
+std::string IsoUtc(SystemPoint t) {
+    const std::time_t tt = RefreshScheduler::SystemClock::to_time_t(t);
+    std::tm tm{};
+    gmtime_r(&tt, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    return buf;
+}
+
+// The format NowIsoLocal writes: local time, no zone.
+std::string IsoLocal(SystemPoint t) {
+    const std::time_t tt = RefreshScheduler::SystemClock::to_time_t(t);
+    std::tm tm{};
+    localtime_r(&tt, &tm);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    return buf;
+}
+
+RefreshScheduler::Policy NoJitter() {
+    RefreshScheduler::Policy policy;
+    policy.jitterFraction = 0.0;
+    return policy;
+}
+
+// Interval planned by a Success outcome at kSystemNow.
+milliseconds AfterSuccess(RefreshScheduler& s, const std::string& expiresAtIso) {
+    s.OnOutcome(RefreshOutcome::Success, expiresAtIso, kSteadyNow, kSystemNow);
+    return std::chrono::duration_cast<milliseconds>(s.NextDue() - kSteadyNow);
+}
+
+void TestHalfLifetimeClamp() {
+    RefreshScheduler s(NoJitter(), 1);
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow + hours(4))) == hours(1));
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow + minutes(30))) == minutes(15));
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow + minutes(10))) == minutes(10));
+    // Expired, missing or unparsable: minInterval.
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow - hours(1))) == minutes(10));
+    CHECK(AfterSuccess(s, "") == minutes(10));
+    CHECK(AfterSuccess(s, "next tuesday") == minutes(10));
+    CHECK(s.HasPlan() && s.ConsecutiveFailures() == 0);
+
+    // A verified license lifts the cap to verifiedMaxInterval; the floor stays.
+    s.SetLicenseVerified(true);
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow + hours(24 * 30))) == hours(24));
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow + hours(10))) == hours(5));
+    CHECK(AfterSuccess(s, IsoUtc(kSystemNow + minutes(10))) == minutes(10));
+    CHECK(AfterSuccess(s, "9999-12-31T23:59:59Z") == hours(24));
+}
+
+void TestJitterBounds() {
+    RefreshScheduler s(RefreshScheduler::Policy(), 42);
+    const std::string expires = IsoUtc(kSystemNow + hours(4));
+    milliseconds lo = hours(2);
+    milliseconds hi{ 0 };
+    for (int i = 0; i < 2000; ++i) {
+        const milliseconds d = AfterSuccess(s, expires);
+        lo = (std::min)(lo, d);
+        hi = (std::max)(hi, d);
+    }
+    // 1 h +/- 10 %, and actually spread across most of that window.
+    CHECK(lo >= minutes(54) && hi <= minutes(66));
+    CHECK(lo < minutes(55) && hi > minutes(65));
+
+    // Rejected: minInterval with the same spread.
+    for (int i = 0; i < 200; ++i) {
+        s.OnOutcome(RefreshOutcome::Rejected, expires, kSteadyNow, kSystemNow);
+        const milliseconds d = std::chrono::duration_cast<milliseconds>(s.NextDue() - kSteadyNow);
+        CHECK(d >= minutes(9) && d <= minutes(11));
+    }
+}
+
+// Full jitter: the n-th consecutive Transient waits uniform(backoffFloor, ceiling) with
+// ceiling = min(backoffMax, backoffBase * 2^(n-1)).
+void TestBackoff() {
+    const RefreshScheduler::Policy policy;
+    constexpr int kFailures = 10;
+    milliseconds highest[kFailures + 1] = {};
+    for (uint64_t seed = 0; seed < 300; ++seed) {
+        RefreshScheduler s(policy, seed);
+        for (int n = 1; n <= kFailures; ++n) {
+            s.OnOutcome(RefreshOutcome::Transient, "", kSteadyNow, kSystemNow);
+            CHECK(s.ConsecutiveFailures() == n);
+            const milliseconds ceiling = (std::min)(milliseconds(policy.backoffMax),
+                milliseconds(policy.backoffBase) * (1 << (n - 1)));
+            const milliseconds d = std::chrono::duration_cast<milliseconds>(s.NextDue() - kSteadyNow);
+            CHECK(d >= policy.backoffFloor && d <= ceiling);
+            highest[n] = (std::max)(highest[n], d);
+        }
+    }
+    // The ceiling doubles (30 s, 60 s, ... 960 s) until backoffMax caps it from the 7th failure on.
+    for (int n = 1; n <= kFailures; ++n) {
+        const milliseconds ceiling = (std::min)(milliseconds(policy.backoffMax),
+            milliseconds(policy.backoffBase) * (1 << (n - 1)));
+        CHECK(highest[n] > ceiling * 9 / 10);
+    }
+
+    // Success and Rejected start the next streak from the base ceiling again.
+    for (const RefreshOutcome reset : { RefreshOutcome::Success, RefreshOutcome::Rejected }) {
+        RefreshScheduler s(policy, 7);
+        for (int n = 0; n < 8; ++n) s.OnOutcome(RefreshOutcome::Transient, "", kSteadyNow, kSystemNow);
+        s.OnOutcome(reset, "", kSteadyNow, kSystemNow);
+        CHECK(s.ConsecutiveFailures() == 0);
+        for (int i = 0; i < 50; ++i) {
+            s.OnOutcome(RefreshOutcome::Transient, "", kSteadyNow, kSystemNow);
+            CHECK(s.NextDue() - kSteadyNow <= policy.backoffBase);
+            s.OnOutcome(reset, "", kSteadyNow, kSystemNow);
+        }
+    }
+
+    // SessionCleared drops the plan.
+    RefreshScheduler s(policy, 3);
+    s.OnOutcome(RefreshOutcome::Transient, "", kSteadyNow, kSystemNow);
+    s.OnOutcome(RefreshOutcome::SessionCleared, "", kSteadyNow, kSystemNow);
+    CHECK(!s.HasPlan() && s.ConsecutiveFailures() == 0 && !s.IsDue(kSteadyNow + hours(48)));
+}
+
+bool InStartupWindow(const RefreshScheduler& s) {
+    return s.HasPlan() && s.NextDue() >= kSteadyNow &&
+        s.NextDue() <= kSteadyNow + RefreshScheduler::Policy().startupSpread;
+}
+
+void TestPlanFromPersisted() {
+    const std::string expires = IsoUtc(kSystemNow + hours(48));
+
+    // Overdue: runs within the startup spread, not immediately in lock-step.
+    RefreshScheduler overdue(NoJitter(), 1);
+    overdue.PlanFromPersisted(IsoUtc(kSystemNow - hours(2)), expires, kSteadyNow, kSystemNow);
+    CHECK(InStartupWindow(overdue));
+
+    // Not yet due: the rest of the interval. A pending backoff streak is forgotten.
+    RefreshScheduler pending(NoJitter(), 1);
+    pending.OnOutcome(RefreshOutcome::Transient, "", kSteadyNow, kSystemNow);
+    pending.PlanFromPersisted(IsoUtc(kSystemNow - minutes(20)), expires, kSteadyNow, kSystemNow);
+    CHECK(pending.ConsecutiveFailures() == 0);
+    CHECK(pending.NextDue() == kSteadyNow + minutes(40));
+    CHECK(!pending.IsDue(kSteadyNow + minutes(39)) && pending.IsDue(kSteadyNow + minutes(40)));
+
+    // The same instant as written by NowIsoLocal, and with an explicit offset.
+    RefreshScheduler local(NoJitter(), 1);
+    local.PlanFromPersisted(IsoLocal(kSystemNow - minutes(20)), expires, kSteadyNow, kSystemNow);
+    CHECK(local.NextDue() == kSteadyNow + minutes(40));
+    local.PlanFromPersisted("2029-12-31T23:40:00Z", expires, kSteadyNow, kSystemNow);
+    CHECK(local.NextDue() == kSteadyNow + minutes(40));
+    local.PlanFromPersisted("2030-01-01T08:40:00+09:00", expires, kSteadyNow, kSystemNow);
+    CHECK(local.NextDue() == kSteadyNow + minutes(40));
+
+    // A last success in the future (clock set back) or one that does not parse proves nothing.
+    for (const std::string& last : { IsoUtc(kSystemNow + hours(1)), std::string(), std::string("yesterday"),
+                                     std::string("2029-13-01T00:00:00"), std::string("2029-12-31T23:40:00Q") }) {
+        RefreshScheduler s(NoJitter(), 1);
+        s.PlanFromPersisted(last, expires, kSteadyNow, kSystemNow);
+        CHECK(InStartupWindow(s));
+    }
+}
+
+} // namespace
+
+int main() {
+    TestHalfLifetimeClamp();
+    TestJitterBounds();
+    TestBackoff();
+    TestPlanFromPersisted();
+    return TEST_EXIT_CODE();
+}
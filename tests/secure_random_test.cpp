@@ -0,0 +1,141 @@
+// secure_random_test
+// - SecureRandom: the ChaCha20 block against RFC 8439 2.3.2, parent and child output after
+//   fork(), distinct per-thread streams, reseeding (ReseedAll and the volume limit), the
+//   request/byte counters, and a byte chi-square over 4 MiB.
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SecureRandom.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+std::string Draw(size_t len) {
+    std::string out(len, '\0');
+    CHECK(SecureRandom::Fill(reinterpret_cast<uint8_t*>(&out[0]), len));
+    return out;
+}
+
+void TestChaCha20Vector() {
+    uint8_t key[32];
+    uint8_t nonce[12];
+    uint8_t expected[64];
+    uint8_t out[64];
+    TestHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", key);
+    TestHex("000000090000004a00000000", nonce);
+    TestHex("10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+            "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e", expected);
+    SecureRandom::Testing::ChaCha20Block(key, 1, nonce, out);
+    CHECK_MEM(out, expected, 64);
+}
+
+// The parent has buffered output when it forks; without the reseed, the child would return
+// exactly the bytes the parent returns next.
+void TestForkDiverges() {
+    Draw(16);
+
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        const std::string child = Draw(64);
+        const ssize_t written = write(fds[1], child.data(), child.size());
+        _exit(written == static_cast<ssize_t>(child.size()) ? 0 : 1);
+    }
+    CHECK(pid > 0);
+    close(fds[1]);
+    const std::string parent = Draw(64);
+
+    std::string child(64, '\0');
+    size_t got = 0;
+    while (got < child.size()) {
+        const ssize_t r = read(fds[0], &child[got], child.size() - got);
+        if (r <= 0) break;
+        got += static_cast<size_t>(r);
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(got == child.size());
+    CHECK(child != parent);
+}
+
+void TestThreadStreamsDiffer() {
+    constexpr int kThreads = 8;
+    std::vector<std::string> outputs(kThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&outputs, i]() { outputs[i] = Draw(64); });
+    }
+    for (auto& t : threads) t.join();
+
+    // Consecutive requests on one thread must not repeat either, across a refill too.
+    for (int i = 0; i < 20; ++i) outputs.push_back(Draw(32));
+    const std::set<std::string> distinct(outputs.begin(), outputs.end());
+    CHECK(distinct.size() == outputs.size());
+}
+
+void TestReseed() {
+    SecureRandom::Stats before = SecureRandom::GetStats();
+    Draw(1);
+    CHECK(SecureRandom::GetStats().osSeeds == before.osSeeds);
+
+    SecureRandom::ReseedAll();
+    Draw(1);
+    CHECK(SecureRandom::GetStats().osSeeds == before.osSeeds + 1);
+
+    // A fresh thread seeds once, then once more after kReseedBytes of output.
+    before = SecureRandom::GetStats();
+    std::thread([]() {
+        Draw(static_cast<size_t>(SecureRandom::kReseedBytes));
+        Draw(SecureRandom::kBufferBytes);
+    }).join();
+    CHECK(SecureRandom::GetStats().osSeeds == before.osSeeds + 2);
+}
+
+void TestStats() {
+    const SecureRandom::Stats before = SecureRandom::GetStats();
+    uint8_t buf[100];
+    CHECK(SecureRandom::Fill(buf, sizeof(buf)));
+    CHECK(SecureRandom::Fill(buf, 0));
+    CHECK(SecureRandom::Fill(buf, 12));
+    const SecureRandom::Stats after = SecureRandom::GetStats();
+    CHECK(after.requests == before.requests + 3);
+    CHECK(after.bytes == before.bytes + 112);
+}
+
+// 255 degrees of freedom: mean 255, standard deviation about 22.6. 400 is more than six
+// standard deviations out, so a healthy generator fails this about once in 10^8 runs.
+void TestChiSquare() {
+    constexpr size_t kBytes = 4 * 1024 * 1024;
+    std::vector<uint8_t> buf(kBytes);
+    CHECK(SecureRandom::Fill(buf.data(), buf.size()));
+    uint64_t counts[256] = {};
+    for (uint8_t b : buf) ++counts[b];
+    const double expected = kBytes / 256.0;
+    double chi = 0.0;
+    for (uint64_t c : counts) chi += (c - expected) * (c - expected) / expected;
+    if (chi >= 400.0) std::fprintf(stderr, "chi-square %.1f\n", chi);
+    CHECK(chi < 400.0);
+}
+
+} // namespace
+
+int main() {
+    TestChaCha20Vector();
+    TestForkDiverges();
+    TestThreadStreamsDiffer();
+    TestReseed();
+    TestStats();
+    TestChiSquare();
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,156 @@
+// sha512_test.c
+//
+// SHA-512 (hk_tweetnacl_sign.c), run once per block backend (scalar, and AVX2
+// when compiled in and supported by the CPU) by forcing the dispatch:
+// - FIPS 180-4 vectors: empty input, "abc", the 896-bit message, 1,000,000 x 'a'.
+// - Lengths around the padding boundaries (111/112 and 239/240 bytes).
+// - crypto_hash and the incremental API under every split, against the original
+//   TweetNaCl code (reference/tweetnacl_ref.c) for lengths 0..400.
+
+#include "hk_tweetnacl_sign.h"
+#include "reference/tweetnacl_ref.h"
+#include "support/TestCheck.h"
+
+#include <stdlib.h>
+
+// Not used by hashing; hk_sign and tweetnacl_ref link against it.
+void randombytes(uint8_t* out, uint64_t outlen)
+{
+    memset(out, 0, (size_t)outlen);
+}
+
+typedef struct Vector {
+    const char* msg;
+    const char* digest;
+} Vector;
+
+static const Vector kFipsVectors[] = {
+    { "",
+      "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce47d0d13c5d85f2b0ff8318d2877eec2f63b931bd47417a81a538327af927da3e" },
+    { "abc",
+      "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+      "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909" },
+};
+
+static const char kMillionA[] =
+    "e718483d0ce769644e2e42c7bc15b4638e1f98b13b2044285632a803afa973ebde0ff244877ea60a4cb0432ce577c31beb009c5c2c49aa2e4eadb217ad8cc09b";
+
+// Message bytes 0, 1, 2, ... (mod 256) of the given length.
+typedef struct CountingVector {
+    size_t len;
+    const char* digest;
+} CountingVector;
+
+static const CountingVector kBoundaryVectors[] = {
+    { 111, "a1a111449b198d9b1f538bad7f3fc1022b3a5b1a5e90a0bc860de8512746cbc31599e6c834de3a3235327af0b51ff57bf7acf1974a73014d9c3953812edc7c8d" },
+    { 112, "c5fbd731d19d2ae1180f001be72c2c1aaba1d7b094b3748880e24593b8e117a750e11c1bd867cc2f96dace8c8b74abd2d5c4f236be444e77d30d1916174070b9" },
+    { 239, "cb4c7fd522756d5781ad3a4f590a1d862906b960e7720136cb3fb36b563caa1ea5689134291fa79c80ccc2b4092b41df32ebdcb36dbe79db483440228c1622a8" },
+    { 240, "6c48466c9f6c07e4ab762c696b7eeb35cfe236fca73683e5fab873ac3489b4d2eb3d7afcce7e8165dbbf37aded3b5b0c889c0b7e0f1790a8330d8677429d91a5" },
+};
+
+static void TestFipsVectors(void)
+{
+    uint8_t out[64], expected[64];
+    size_t i;
+
+    for (i = 0; i < sizeof(kFipsVectors) / sizeof(kFipsVectors[0]); ++i) {
+        const char* msg = kFipsVectors[i].msg;
+        TestHex(kFipsVectors[i].digest, expected);
+        crypto_hash(out, (const uint8_t*)msg, strlen(msg));
+        CHECK_MEM(out, expected, 64);
+    }
+
+    // 1,000,000 x 'a', in one call and fed in 1000-byte pieces.
+    {
+        uint8_t* m = (uint8_t*)malloc(1000000);
+        hk_sha512_state s;
+        memset(m, 'a', 1000000);
+        TestHex(kMillionA, expected);
+        crypto_hash(out, m, 1000000);
+        CHECK_MEM(out, expected, 64);
+
+        hk_sha512_init(&s);
+        for (i = 0; i < 1000; ++i) hk_sha512_update(&s, m, 1000);
+        hk_sha512_final(&s, out);
+        CHECK_MEM(out, expected, 64);
+        free(m);
+    }
+}
+
+static void TestPaddingBoundaries(void)
+{
+    uint8_t m[256], out[64], expected[64];
+    size_t i;
+
+    for (i = 0; i < sizeof(m); ++i) m[i] = (uint8_t)i;
+    for (i = 0; i < sizeof(kBoundaryVectors) / sizeof(kBoundaryVectors[0]); ++i) {
+        TestHex(kBoundaryVectors[i].digest, expected);
+        crypto_hash(out, m, kBoundaryVectors[i].len);
+        CHECK_MEM(out, expected, 64);
+    }
+}
+
+static void TestAgainstReference(void)
+{
+    enum { kMaxLen = 400 };
+    static const size_t kSplits[] = { 1, 7, 64, 111, 112, 127, 128, 129, 255 };
+    uint8_t m[kMaxLen], out[64], expected[64];
+    size_t len, i;
+    int failuresBefore = g_testFailures;
+
+    for (i = 0; i < kMaxLen; ++i) m[i] = (uint8_t)(i * 131u + 7u);
+
+    for (len = 0; len <= kMaxLen && g_testFailures == failuresBefore; ++len) {
+        ref_crypto_hash(expected, m, len);
+
+        crypto_hash(out, m, len);
+        CHECK_MEM(out, expected, 64);
+
+        // Incremental: first piece of every length, then fixed-size pieces.
+        for (i = 0; i < sizeof(kSplits) / sizeof(kSplits[0]); ++i) {
+            hk_sha512_state s;
+            size_t pos = 0, piece = kSplits[i];
+            hk_sha512_init(&s);
+            hk_sha512_update(&s, m, len / 3);
+            pos = len / 3;
+            while (pos < len) {
+                size_t n = (len - pos < piece) ? len - pos : piece;
+                hk_sha512_update(&s, m + pos, n);
+                pos += n;
+            }
+            hk_sha512_final(&s, out);
+            CHECK_MEM(out, expected, 64);
+        }
+    }
+    if (g_testFailures != failuresBefore) {
+        fprintf(stderr, "  first mismatch against the reference at length %u\n", (unsigned)(len - 1));
+    }
+}
+
+static void RunAll(const char* name)
+{
+    int failuresBefore = g_testFailures;
+    TestFipsVectors();
+    TestPaddingBoundaries();
+    TestAgainstReference();
+    printf("%s backend: %s\n", name, g_testFailures == failuresBefore ? "ok" : "FAILED");
+}
+
+int main(void)
+{
+    CHECK(hk_sha512_set_backend(HK_SHA512_BACKEND_SCALAR) == 0);
+    CHECK(hk_sha512_backend() == HK_SHA512_BACKEND_SCALAR);
+    RunAll("scalar");
+
+    if (hk_sha512_set_backend(HK_SHA512_BACKEND_AVX2) == 0) {
+        CHECK(hk_sha512_backend() == HK_SHA512_BACKEND_AVX2);
+        RunAll("avx2");
+    } else {
+        printf("avx2 backend: not available, skipped\n");
+    }
+
+    CHECK(hk_sha512_set_backend(-1) == -1);
+    CHECK(hk_sha512_set_backend(HK_SHA512_BACKEND_AUTO) == 0);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,294 @@
+// socket_transport_test
+// - SocketHttpTransport and AsyncHttpClient against StubActivationServer: the three activation
+//   endpoints, every response framing, and servers that misbehave (reset, slow drip, endless
+//   body, oversized body, bogus chunk size).
+// - connect() bounded by the timeout, against a listener whose accept queue is full.
+// - Completion callbacks that throw, on the worker and after Shutdown().
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AsyncHttpClient.h"
+#include "JsonReader.h"
+#include "JsonWriter.h"
+#include "SocketHttpTransport.h"
+#include "support/StubActivationServer.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Reply = StubActivationServer::Reply;
+
+const std::wstring kNoncePath = L"/api/device_nonce.php";
+const std::wstring kRefreshPath = L"/api/device_refresh.php";
+const std::wstring kEnrollPath = L"/api/device_enroll.php";
+
+std::string EnrollBody() {
+    JsonWriter w;
+    w.BeginObject()
+        .String("pairing_code", "123456")
+        .String("role", "server")
+        .String("machine_id", "machine")
+        .String("device_name", "test")
+        .String("lan_ip", "127.0.0.1")
+        .String("device_pubkey_b64", "AAAA")
+        .EndObject();
+    return w.str();
+}
+
+double MsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void TestActivationRoundTrip(StubActivationServer& server) {
+    SocketHttpTransport transport(2000);
+    const std::wstring base = server.BaseUrl();
+
+    HttpJsonResult r = transport.PostJson(base, kEnrollPath, EnrollBody());
+    CHECK(r.transportOk && r.statusCode == 200);
+    const JsonReader enroll(r.body);
+    std::string deviceId;
+    std::string refreshToken;
+    CHECK(enroll.GetString("device_id", deviceId) && enroll.GetString("refresh_token", refreshToken));
+    CHECK(server.LastRequestBody("/api/device_enroll.php") == EnrollBody());
+
+    JsonWriter w;
+    w.BeginObject().String("device_id", deviceId).String("refresh_token", refreshToken).EndObject();
+    r = transport.PostJson(base, kNoncePath, w.str());
+    CHECK(r.transportOk && r.statusCode == 200);
+    const JsonReader nonce(r.body);
+    std::string nonceId;
+    std::string nonceValue;
+    CHECK(nonce.GetString("nonce_id", nonceId) && nonce.GetString("nonce", nonceValue));
+
+    w.Reset();
+    w.BeginObject()
+        .String("device_id", deviceId)
+        .String("refresh_token", refreshToken)
+        .String("nonce_id", nonceId)
+        .String("nonce", nonceValue)
+        .String("device_sig_b64", "sig")
+        .Bool("want_next_nonce", true)
+        .EndObject();
+    const std::string refreshBody = w.str();
+    r = transport.PostJson(base, kRefreshPath, refreshBody);
+    CHECK(r.transportOk && r.statusCode == 200);
+    const JsonReader refresh(r.body);
+    CHECK(refresh.StringOr("refresh_token") != refreshToken);
+    CHECK(refresh.Has("license_blob") && refresh.Has("next_nonce_id") && refresh.Has("next_nonce"));
+
+    // A nonce is single use, and the old refresh token was rotated: non-2xx still carries a body.
+    r = transport.PostJson(base, kRefreshPath, refreshBody);
+    CHECK(r.transportOk && r.statusCode == 401);
+    CHECK(JsonReader(r.body).StringOr("reason") == "invalid_refresh_token");
+
+    const HttpClientStats stats = transport.GetStats();
+    CHECK(stats.requests == 4 && stats.failures == 0);
+}
+
+void TestResponseFramings(StubActivationServer& server) {
+    SocketHttpTransport transport(2000);
+    const std::string body = "{\"framing\":\"" + std::string(10000, 'f') + "\"}";
+    const StubActivationServer::Framing framings[] = {
+        StubActivationServer::Framing::ContentLength,
+        StubActivationServer::Framing::Chunked,
+        StubActivationServer::Framing::UntilClose,
+    };
+    for (StubActivationServer::Framing framing : framings) {
+        Reply reply;
+        reply.status = 503;
+        reply.body = body;
+        reply.framing = framing;
+        server.Script("/api/device_nonce.php", reply);
+        const HttpJsonResult r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+        CHECK(r.transportOk);
+        CHECK(r.statusCode == 503);
+        CHECK(r.body == body);
+    }
+
+    // Empty chunked body.
+    Reply empty;
+    empty.framing = StubActivationServer::Framing::Chunked;
+    server.Script("/api/device_nonce.php", empty);
+    const HttpJsonResult r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(r.transportOk && r.body.empty());
+}
+
+void TestBadChunkSize(StubActivationServer& server) {
+    SocketHttpTransport transport(2000);
+    Reply reply;
+    reply.fault = StubActivationServer::Fault::BadChunkSize;
+    server.Script("/api/device_nonce.php", reply);
+    const HttpJsonResult r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(!r.transportOk);
+    CHECK(transport.GetStats().failures == 1);
+}
+
+// The server resets the connection while an 8 MB body is still being sent. The send must fail
+// cleanly; a SIGPIPE here would kill the test process (default action). Whether the kernel
+// reports EPIPE or ECONNRESET is timing dependent, so this guards MSG_NOSIGNAL but cannot
+// prove it on every run.
+void TestPeerResetDoesNotRaiseSigpipe(StubActivationServer& server) {
+    SocketHttpTransport transport(2000);
+    const std::string large(8 * 1024 * 1024, ' ');
+    for (int i = 0; i < 3; ++i) {
+        Reply reply;
+        reply.fault = StubActivationServer::Fault::CloseWithoutReply;
+        server.Script("/api/device_refresh.php", reply);
+        const HttpJsonResult r = transport.PostJson(server.BaseUrl(), kRefreshPath, large);
+        CHECK(!r.transportOk);
+    }
+}
+
+void TestTotalDeadline(StubActivationServer& server) {
+    SocketHttpTransport transport(500);
+
+    // 40 bytes at 100 ms each: every recv succeeds well within the old per-call timeout.
+    Reply drip;
+    drip.body = std::string(40, 'd');
+    drip.fault = StubActivationServer::Fault::SlowDrip;
+    server.Script("/api/device_nonce.php", drip);
+    Clock::time_point start = Clock::now();
+    HttpJsonResult r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(!r.transportOk);
+    CHECK(MsSince(start) < 1500.0);
+
+    // Same deadline, but a server that replies in time is unaffected.
+    server.SetDelayMs(100);
+    r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(r.transportOk && r.statusCode == 401);
+    server.SetDelayMs(0);
+}
+
+void TestResponseSizeLimit(StubActivationServer& server) {
+    SocketHttpTransport transport(5000, 64 * 1024);
+
+    Reply endless;
+    endless.fault = StubActivationServer::Fault::Endless;
+    server.Script("/api/device_nonce.php", endless);
+    const Clock::time_point start = Clock::now();
+    HttpJsonResult r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(!r.transportOk);
+    CHECK(MsSince(start) < 2500.0);
+
+    Reply large;
+    large.body = std::string(64 * 1024, 'x');
+    server.Script("/api/device_nonce.php", large);
+    r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(!r.transportOk);
+
+    Reply fits;
+    fits.body = std::string(32 * 1024, 'x');
+    server.Script("/api/device_nonce.php", fits);
+    r = transport.PostJson(server.BaseUrl(), kNoncePath, "{}");
+    CHECK(r.transportOk && r.body == fits.body);
+}
+
+void TestUnsupportedUrls() {
+    SocketHttpTransport transport(500);
+    CHECK(!transport.PostJson(L"https://127.0.0.1", kNoncePath, "{}").transportOk);
+    CHECK(!transport.PostJson(L"http://", kNoncePath, "{}").transportOk);
+    // Nothing listens on port 1.
+    CHECK(!transport.PostJson(L"http://127.0.0.1:1", kNoncePath, "{}").transportOk);
+}
+
+// A listener that never accepts, with its accept queue filled: further SYNs are dropped, so
+// connect() would hang for the SYN retries.
+void TestConnectDeadline() {
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    CHECK(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    CHECK(listen(listener, 0) == 0);
+    CHECK(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+
+    std::vector<int> fillers;
+    for (int i = 0; i < 8; ++i) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        (void)connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        fillers.push_back(fd);
+    }
+
+    SocketHttpTransport transport(300);
+    const std::wstring base = L"http://127.0.0.1:" + std::to_wstring(ntohs(addr.sin_port));
+    const Clock::time_point start = Clock::now();
+    CHECK(!transport.PostJson(base, kNoncePath, "{}").transportOk);
+    CHECK(MsSince(start) < 1000.0);
+
+    for (int fd : fillers) close(fd);
+    close(listener);
+}
+
+void TestAsyncClient(StubActivationServer& server) {
+    AsyncHttpClient client(std::make_unique<SocketHttpTransport>(2000), 4);
+    server.SetDelayMs(50);
+
+    std::vector<std::future<HttpJsonResult>> futures;
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < 8; ++i) {
+        futures.push_back(client.PostJsonAsync(server.BaseUrl(), kEnrollPath, EnrollBody()));
+    }
+    for (auto& f : futures) {
+        const HttpJsonResult r = f.get();
+        CHECK(r.transportOk && r.statusCode == 200);
+    }
+    // 8 requests over 4 workers: two rounds of the injected delay, not eight.
+    CHECK(MsSince(start) < 8 * 50.0);
+    server.SetDelayMs(0);
+
+    std::promise<HttpJsonResult> done;
+    client.PostJsonAsync(server.BaseUrl(), kEnrollPath, EnrollBody(),
+        [&done](const HttpJsonResult& r) { done.set_value(r); });
+    CHECK(done.get_future().get().statusCode == 200);
+
+    // A throwing callback must not take down the worker or skip the future.
+    std::promise<void> threw;
+    client.PostJsonAsync(server.BaseUrl(), kEnrollPath, EnrollBody(),
+        [&threw](const HttpJsonResult&) { threw.set_value(); throw std::runtime_error("callback"); });
+    threw.get_future().get();
+    CHECK(client.PostJson(server.BaseUrl(), kEnrollPath, EnrollBody()).statusCode == 200);
+
+    client.Shutdown();
+    CHECK(!client.PostJson(server.BaseUrl(), kEnrollPath, EnrollBody()).transportOk);
+
+    // Nor when it runs on the caller's thread, after Shutdown().
+    bool called = false;
+    client.PostJsonAsync(server.BaseUrl(), kEnrollPath, EnrollBody(),
+        [&called](const HttpJsonResult& r) { called = !r.transportOk; throw std::runtime_error("callback"); });
+    CHECK(called);
+}
+
+} // namespace
+
+int main() {
+    StubActivationServer server;
+    if (!server.Start()) {
+        std::printf("cannot listen on loopback\n");
+        return 1;
+    }
+
+    TestActivationRoundTrip(server);
+    TestResponseFramings(server);
+    TestBadChunkSize(server);
+    TestPeerResetDoesNotRaiseSigpipe(server);
+    TestTotalDeadline(server);
+    TestResponseSizeLimit(server);
+    TestUnsupportedUrls();
+    TestConnectDeadline();
+    TestAsyncClient(server);
+
+    server.Stop();
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,16 @@
+#include "DebugLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+// DebugLog for the Linux tests: quiet unless HK_TEST_LOG is set, then stderr.
+void DebugLog(const std::string& message) {
+    static const bool enabled = std::getenv("HK_TEST_LOG") != nullptr;
+    if (!enabled) {
+        return;
+    }
+    static std::mutex logMutex;
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::fprintf(stderr, "%s\n", message.c_str());
+}
@@ -0,0 +1,409 @@
+#include "StubActivationServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "JsonReader.h"
+#include "JsonWriter.h"
+
+namespace {
+
+constexpr const char* kEntitlementExpiresAt = "2099-01-01T00:00:00Z";
+
+bool SendAll(int sock, const char* data, size_t len) {
+    while (len > 0) {
+        const ssize_t sent = send(sock, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        data += sent;
+        len -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool SendAll(int sock, const std::string& s) {
+    return SendAll(sock, s.data(), s.size());
+}
+
+// Reads one request; returns false when the peer closed or sent something unusable.
+bool ReadRequest(int sock, std::string& path, std::string& body) {
+    std::string data;
+    char buf[4096];
+    size_t headerEnd = std::string::npos;
+    while (headerEnd == std::string::npos) {
+        const ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        data.append(buf, static_cast<size_t>(n));
+        headerEnd = data.find("\r\n\r\n");
+    }
+
+    const size_t pathBegin = data.find(' ');
+    const size_t pathEnd = (pathBegin == std::string::npos) ? pathBegin : data.find(' ', pathBegin + 1);
+    if (pathEnd == std::string::npos || pathEnd > headerEnd) return false;
+    path = data.substr(pathBegin + 1, pathEnd - pathBegin - 1);
+
+    size_t contentLength = 0;
+    for (size_t line = data.find("\r\n") + 2; line < headerEnd;) {
+        const size_t lineEnd = data.find("\r\n", line);
+        if (strncasecmp(data.c_str() + line, "content-length:", 15) == 0) {
+            contentLength = std::strtoul(data.c_str() + line + 15, nullptr, 10);
+        }
+        line = lineEnd + 2;
+    }
+
+    body = data.substr(headerEnd + 4);
+    while (body.size() < contentLength) {
+        const ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        body.append(buf, static_cast<size_t>(n));
+    }
+    body.resize(contentLength);
+    return true;
+}
+
+std::string StatusLine(uint32_t status) {
+    const char* text = (status == 200) ? "OK" : (status == 401) ? "Unauthorized" : (status == 400) ? "Bad Request" : "Error";
+    return "HTTP/1.1 " + std::to_string(status) + " " + text + "\r\nContent-Type: application/json\r\nConnection: close\r\n";
+}
+
+void WriteReply(int sock, const StubActivationServer::Reply& reply, const std::atomic<bool>& stopping) {
+    using Framing = StubActivationServer::Framing;
+    using Fault = StubActivationServer::Fault;
+
+    std::string head = StatusLine(reply.status);
+    switch (reply.fault) {
+        case Fault::SlowDrip: {
+            head += "Content-Length: " + std::to_string(reply.body.size()) + "\r\n\r\n";
+            if (!SendAll(sock, head)) return;
+            for (char ch : reply.body) {
+                if (stopping.load() || !SendAll(sock, &ch, 1)) return;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            return;
+        }
+        case Fault::Endless: {
+            if (!SendAll(sock, head + "\r\n")) return;
+            const std::string filler(4096, 'x');
+            while (!stopping.load() && SendAll(sock, filler)) {}
+            return;
+        }
+        case Fault::BadChunkSize:
+            SendAll(sock, head + "Transfer-Encoding: chunked\r\n\r\nffffffffffffffff\r\nabc\r\n0\r\n\r\n");
+            return;
+        case Fault::CloseWithoutReply:
+        case Fault::None:
+            break;
+    }
+
+    switch (reply.framing) {
+        case Framing::ContentLength:
+            SendAll(sock, head + "Content-Length: " + std::to_string(reply.body.size()) + "\r\n\r\n" + reply.body);
+            break;
+        case Framing::Chunked: {
+            // Up to three chunks, to exercise reassembly.
+            std::string out = head + "Transfer-Encoding: chunked\r\n\r\n";
+            const size_t step = reply.body.size() / 3 + 1;
+            for (size_t pos = 0; pos < reply.body.size(); pos += step) {
+                const std::string part = reply.body.substr(pos, step);
+                char size[32];
+                std::snprintf(size, sizeof(size), "%zx\r\n", part.size());
+                out += size;
+                out += part;
+                out += "\r\n";
+            }
+            out += "0\r\n\r\n";
+            SendAll(sock, out);
+            break;
+        }
+        case Framing::UntilClose:
+            SendAll(sock, head + "\r\n" + reply.body);
+            break;
+    }
+}
+
+} // namespace
+
+StubActivationServer::StubActivationServer()
+{
+    SetLicenseBlobBytes(512);
+}
+
+StubActivationServer::~StubActivationServer()
+{
+    Stop();
+}
+
+bool StubActivationServer::Start()
+{
+    listenSock_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSock_ < 0) {
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenSock_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (bind(listenSock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        listen(listenSock_, 128) != 0 ||
+        getsockname(listenSock_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        close(listenSock_);
+        listenSock_ = -1;
+        return false;
+    }
+    port_ = ntohs(addr.sin_port);
+    stopping_.store(false);
+    acceptThread_ = std::thread(&StubActivationServer::AcceptProc, this);
+    return true;
+}
+
+void StubActivationServer::Stop()
+{
+    if (listenSock_ < 0) {
+        return;
+    }
+    stopping_.store(true);
+    shutdown(listenSock_, SHUT_RDWR);
+    if (acceptThread_.joinable()) {
+        acceptThread_.join();
+    }
+    close(listenSock_);
+    listenSock_ = -1;
+
+    std::unique_lock<std::mutex> lock(connMutex_);
+    connCv_.wait(lock, [this]() { return activeConnections_ == 0; });
+}
+
+std::wstring StubActivationServer::BaseUrl() const
+{
+    const std::string url = "http://127.0.0.1:" + std::to_string(port_);
+    return std::wstring(url.begin(), url.end());
+}
+
+void StubActivationServer::SetNextNonceSupported(bool supported)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    nextNonceSupported_ = supported;
+}
+
+void StubActivationServer::SetLicenseBlobBytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    licenseBlob_.assign(bytes, 'L');
+}
+
+void StubActivationServer::Script(const std::string& path, Reply reply)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    scripts_[path].push_back(std::move(reply));
+}
+
+StubActivationServer::Counters StubActivationServer::GetCounters() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counters_;
+}
+
+std::string StubActivationServer::LastRequestBody(const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = lastBodies_.find(path);
+    return (it == lastBodies_.end()) ? std::string() : it->second;
+}
+
+void StubActivationServer::AcceptProc()
+{
+    while (!stopping_.load()) {
+        const int sock = accept(listenSock_, nullptr, nullptr);
+        if (sock < 0) {
+            if (stopping_.load()) break;
+            continue;
+        }
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        {
+            std::lock_guard<std::mutex> lock(connMutex_);
+            ++activeConnections_;
+        }
+        std::thread(&StubActivationServer::ConnectionProc, this, sock).detach();
+    }
+}
+
+void StubActivationServer::ConnectionProc(int sock)
+{
+    // A scripted reset is decided before the request is read, so the client may still be sending.
+    bool reset = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : scripts_) {
+            if (!entry.second.empty() && entry.second.front().fault == Fault::CloseWithoutReply) {
+                entry.second.pop_front();
+                reset = true;
+                break;
+            }
+        }
+    }
+
+    std::string path;
+    std::string body;
+    if (reset) {
+        linger lg = { 1, 0 };
+        setsockopt(sock, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    } else if (ReadRequest(sock, path, body)) {
+        const Reply reply = Handle(path, body);
+        const int delayMs = delayMs_.load();
+        if (delayMs > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        }
+        WriteReply(sock, reply, stopping_);
+        shutdown(sock, SHUT_WR);
+    }
+    close(sock);
+
+    std::lock_guard<std::mutex> lock(connMutex_);
+    --activeConnections_;
+    connCv_.notify_all();
+}
+
+StubActivationServer::Reply StubActivationServer::Handle(const std::string& path, const std::string& body)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    lastBodies_[path] = body;
+
+    auto script = scripts_.find(path);
+    if (script != scripts_.end() && !script->second.empty()) {
+        Reply reply = std::move(script->second.front());
+        script->second.pop_front();
+        return reply;
+    }
+
+    if (path == "/api/device_nonce.php") {
+        ++counters_.nonce;
+        return HandleNonce(body);
+    }
+    if (path == "/api/device_refresh.php") {
+        ++counters_.refresh;
+        return HandleRefresh(body);
+    }
+    if (path == "/api/device_enroll.php") {
+        ++counters_.enroll;
+        return HandleEnroll(body);
+    }
+    ++counters_.other;
+    return Reject(404, "not_found", "unknown_endpoint");
+}
+
+StubActivationServer::Reply StubActivationServer::Reject(uint32_t status, const char* error, const char* reason)
+{
+    ++counters_.rejected;
+    Reply reply;
+    reply.status = status;
+    JsonWriter w;
+    w.BeginObject().String("error", error).String("reason", reason).EndObject();
+    reply.body = w.str();
+    return reply;
+}
+
+void StubActivationServer::IssueNonce(Device& device, std::string& nonceId, std::string& nonce)
+{
+    const uint64_t id = nextId_++;
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "n-%llu", static_cast<unsigned long long>(id));
+    nonceId = buf;
+    std::snprintf(buf, sizeof(buf), "%016llx%016llx", static_cast<unsigned long long>(id * 0x9e3779b97f4a7c15ULL),
+        static_cast<unsigned long long>(~id * 0xc2b2ae3d27d4eb4fULL));
+    nonce = buf;
+    device.nonces[nonceId] = nonce;
+}
+
+StubActivationServer::Reply StubActivationServer::HandleEnroll(const std::string& body)
+{
+    const JsonReader json(body);
+    std::string pairingCode;
+    std::string pubkey;
+    if (!json.IsValid() || !json.GetString("pairing_code", pairingCode) || pairingCode.empty() ||
+        !json.GetString("device_pubkey_b64", pubkey) || pubkey.empty()) {
+        return Reject(400, "bad_request", "missing_fields");
+    }
+
+    const std::string deviceId = "dev-" + std::to_string(nextId_++);
+    Device& device = devices_[deviceId];
+    device.refreshToken = "rt-" + std::to_string(nextId_++);
+
+    Reply reply;
+    JsonWriter w(256 + licenseBlob_.size());
+    w.BeginObject()
+        .String("device_id", deviceId)
+        .String("refresh_token", device.refreshToken)
+        .String("license_blob", licenseBlob_)
+        .String("entitlement_expires_at", kEntitlementExpiresAt)
+        .EndObject();
+    reply.body = w.str();
+    return reply;
+}
+
+StubActivationServer::Reply StubActivationServer::HandleNonce(const std::string& body)
+{
+    const JsonReader json(body);
+    const std::string deviceId = json.StringOr("device_id");
+    auto it = devices_.find(deviceId);
+    if (it == devices_.end() || it->second.refreshToken != json.StringOr("refresh_token")) {
+        return Reject(401, "unauthorized", "invalid_refresh_token");
+    }
+
+    std::string nonceId;
+    std::string nonce;
+    IssueNonce(it->second, nonceId, nonce);
+    Reply reply;
+    JsonWriter w;
+    w.BeginObject().String("nonce_id", nonceId).String("nonce", nonce).Int64("expires_in", 60).EndObject();
+    reply.body = w.str();
+    return reply;
+}
+
+StubActivationServer::Reply StubActivationServer::HandleRefresh(const std::string& body)
+{
+    const JsonReader json(body);
+    const std::string deviceId = json.StringOr("device_id");
+    auto it = devices_.find(deviceId);
+    if (it == devices_.end() || it->second.refreshToken != json.StringOr("refresh_token")) {
+        return Reject(401, "unauthorized", "invalid_refresh_token");
+    }
+    Device& device = it->second;
+
+    auto nonce = device.nonces.find(json.StringOr("nonce_id"));
+    if (nonce == device.nonces.end() || nonce->second != json.StringOr("nonce") ||
+        json.StringOr("device_sig_b64").empty()) {
+        return Reject(401, "unauthorized", "nonce_invalid");
+    }
+    device.nonces.erase(nonce);
+    device.refreshToken = "rt-" + std::to_string(nextId_++);
+
+    Reply reply;
+    JsonWriter w(384 + licenseBlob_.size());
+    w.BeginObject()
+        .String("refresh_token", device.refreshToken)
+        .String("license_blob", licenseBlob_)
+        .String("entitlement_expires_at", kEntitlementExpiresAt);
+    if (nextNonceSupported_ && json.IsTrue("want_next_nonce")) {
+        std::string nextId;
+        std::string next;
+        IssueNonce(device, nextId, next);
+        w.String("next_nonce_id", nextId).String("next_nonce", next).Int64("next_nonce_expires_in", 60);
+    }
+    w.EndObject();
+    reply.body = w.str();
+    return reply;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// StubActivationServer
+// - In-process HTTP/1.1 server on 127.0.0.1 (ephemeral port) for the activation endpoints
+//   /api/device_nonce.php, /api/device_refresh.php and /api/device_enroll.php. POSIX only.
+// - The default handlers follow the server protocol closely enough for the client code paths:
+//   enroll issues a device id and refresh token, nonce hands out single-use nonces, refresh
+//   consumes one, rotates the refresh token and (when enabled) bundles the next nonce.
+//   Signatures are not checked.
+// - Scriptable: Script() queues canned replies for a path, served before the default handler,
+//   including misbehaving ones (slow drip, endless body, reset, bad chunk size).
+// - SetDelayMs() injects a delay before every reply, standing in for network round-trip time.
+// - One thread per connection, "Connection: close" like SocketHttpTransport.
+class StubActivationServer
+{
+public:
+    enum class Framing { ContentLength, Chunked, UntilClose };
+
+    enum class Fault {
+        None,
+        SlowDrip,           // headers, then one body byte every 100 ms
+        Endless,            // headers without a length, then body bytes until the peer goes away
+        CloseWithoutReply,  // reset the next connection, whatever its path, without reading it
+        BadChunkSize,       // chunked body whose first chunk size is 0xffffffffffffffff
+    };
+
+    struct Reply {
+        uint32_t status = 200;
+        std::string body;
+        Framing framing = Framing::ContentLength;
+        Fault fault = Fault::None;
+    };
+
+    struct Counters {
+        uint64_t nonce = 0;
+        uint64_t refresh = 0;
+        uint64_t enroll = 0;
+        uint64_t other = 0;
+        uint64_t rejected = 0;      // default-handler replies with a non-2xx status
+    };
+
+    StubActivationServer();
+    ~StubActivationServer();
+
+    StubActivationServer(const StubActivationServer&) = delete;
+    StubActivationServer& operator=(const StubActivationServer&) = delete;
+
+    bool Start();
+    void Stop();
+
+    uint16_t Port() const { return port_; }
+    std::wstring BaseUrl() const;
+
+    void SetDelayMs(int delayMs) { delayMs_.store(delayMs); }
+    void SetNextNonceSupported(bool supported);
+    void SetLicenseBlobBytes(size_t bytes);
+
+    // Queues reply for the next request to path (e.g. "/api/device_refresh.php").
+    void Script(const std::string& path, Reply reply);
+
+    Counters GetCounters() const;
+    std::string LastRequestBody(const std::string& path) const;
+
+private:
+    struct Device {
+        std::string refreshToken;
+        std::map<std::string, std::string> nonces;     // nonce_id -> nonce, single use
+    };
+
+    void AcceptProc();
+    void ConnectionProc(int sock);
+    Reply Handle(const std::string& path, const std::string& body);
+    Reply HandleEnroll(const std::string& body);
+    Reply HandleNonce(const std::string& body);
+    Reply HandleRefresh(const std::string& body);
+    void IssueNonce(Device& device, std::string& nonceId, std::string& nonce);
+    Reply Reject(uint32_t status, const char* error, const char* reason);
+
+    int listenSock_ = -1;
+    uint16_t port_ = 0;
+    std::thread acceptThread_;
+    std::atomic<bool> stopping_{ false };
+    std::atomic<int> delayMs_{ 0 };
+
+    std::mutex connMutex_;
+    std::condition_variable connCv_;
+    int activeConnections_ = 0;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, std::deque<Reply>> scripts_;
+    std::map<std::string, std::string> lastBodies_;
+    std::map<std::string, Device> devices_;
+    Counters counters_;
+    uint64_t nextId_ = 1;
+    bool nextNonceSupported_ = true;
+    std::string licenseBlob_;
+};
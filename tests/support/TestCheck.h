@@ -0,0 +1,36 @@
+#pragma once
+// TestCheck.h
+// - Assertion helpers shared by the Linux test executables (C and C++).
+// - CHECK records a failure and carries on, so one run reports every broken case;
+//   main returns TEST_EXIT_CODE().
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int g_testFailures = 0;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++g_testFailures; \
+        } \
+    } while (0)
+
+#define CHECK_MEM(a, b, n) CHECK(memcmp((a), (b), (n)) == 0)
+
+#define TEST_EXIT_CODE() \
+    (g_testFailures == 0 ? (printf("%s: all checks passed\n", __FILE__), 0) \
+                         : (printf("%s: %d check(s) failed\n", __FILE__, g_testFailures), 1))
+
+// Decodes a hex string into out (strlen(hex) / 2 bytes); returns the byte count.
+static inline size_t TestHex(const char* hex, uint8_t* out)
+{
+    size_t n = strlen(hex) / 2;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned v = 0;
+        sscanf(hex + 2 * i, "%2x", &v);
+        out[i] = (uint8_t)v;
+    }
+    return n;
+}
@@ -0,0 +1,232 @@
+// timer_scheduler_test
+// - TimerScheduler on a ManualClock with startThreads = false, so every schedule is exact:
+//   expiries that cascade from level 1, level 2 and beyond the top level, slack aligning two
+//   periodic jobs onto shared wakeups, Reschedule and Cancel on a job that is already due, a
+//   timer registered idle at TimePoint::max(), the wakeups-per-minute counter, and posted jobs
+//   drained by RunDue() (without a worker pool) and dropped by Shutdown().
+
+#include <chrono>
+#include <vector>
+
+#include "TimerScheduler.h"
+#include "support/TestCheck.h"
+
+namespace {
+
+using Duration = TimerScheduler::Duration;
+using TimePoint = TimerScheduler::TimePoint;
+
+constexpr Duration kTick{ 10 };
+
+TimerScheduler::Options ManualOptions(const ManualClock& clock) {
+    TimerScheduler::Options options;
+    options.tick = kTick;
+    options.startThreads = false;
+    options.now = clock.AsFunction();
+    return options;
+}
+
+// Advances the clock one tick at a time, calling RunDue() after each; returns jobs run.
+size_t Step(ManualClock& clock, TimerScheduler& scheduler, Duration span) {
+    size_t ran = 0;
+    for (Duration d{ 0 }; d < span; d += kTick) {
+        clock.Advance(kTick);
+        ran += scheduler.RunDue();
+    }
+    return ran;
+}
+
+int64_t TicksSince(TimePoint start, TimePoint t) {
+    return std::chrono::duration_cast<Duration>(t - start).count() / kTick.count();
+}
+
+// Expiries on every wheel level must fire at their exact tick, not at a cascade boundary.
+void TestCascade() {
+    ManualClock clock;
+    TimerScheduler scheduler(ManualOptions(clock));
+    const TimePoint start = clock.Now();
+
+    // 64 ticks per level-0 rotation, 4096 per level 1, 262144 per level 2.
+    const int64_t delays[] = { 1, 63, 64, 65, 100, 4095, 4096, 4097, 5000, 262143, 262144, 270000 };
+    std::vector<int64_t> fired(sizeof(delays) / sizeof(delays[0]), -1);
+    for (size_t i = 0; i < fired.size(); ++i) {
+        scheduler.ScheduleAfter(kTick * delays[i], [&clock, &fired, start, i]() {
+            fired[i] = TicksSince(start, clock.Now());
+        });
+    }
+
+    Step(clock, scheduler, kTick * 270000);
+    for (size_t i = 0; i < fired.size(); ++i) {
+        if (fired[i] != delays[i]) std::fprintf(stderr, "  delay %lld fired at %lld\n",
+            static_cast<long long>(delays[i]), static_cast<long long>(fired[i]));
+        CHECK(fired[i] == delays[i]);
+    }
+    CHECK(scheduler.GetStats().cascades > 0);
+    CHECK(scheduler.GetStats().jobsRun == fired.size());
+}
+
+// 64^5 ticks is past the top level; such timers wait in the overflow list.
+void TestBeyondTopLevel() {
+    ManualClock clock;
+    TimerScheduler scheduler(ManualOptions(clock));
+    const int64_t ticks = (1ll << 30) + 12345;
+
+    int runs = 0;
+    scheduler.ScheduleAfter(kTick * ticks, [&runs]() { runs++; });
+    clock.Advance(kTick * (ticks - 1));
+    CHECK(scheduler.RunDue() == 0);
+    clock.Advance(kTick);
+    CHECK(scheduler.RunDue() == 1);
+    CHECK(runs == 1);
+}
+
+// Two minute-periodic jobs created half a second apart with 5 s of slack share every wakeup;
+// without slack they need one each.
+void TestSlackAlignsPeriodicJobs() {
+    for (const Duration slack : { Duration(0), Duration(5000) }) {
+        ManualClock clock;
+        TimerScheduler scheduler(ManualOptions(clock));
+
+        int runsA = 0;
+        int runsB = 0;
+        scheduler.SchedulePeriodic(Duration(60000), [&runsA]() { runsA++; }, slack);
+        clock.Advance(Duration(500));
+        scheduler.SchedulePeriodic(Duration(60000), [&runsB]() { runsB++; }, slack);
+
+        // The third aligned run lands at 184.32 s.
+        Step(clock, scheduler, Duration(3 * 60000 + 5000));
+        const TimerScheduler::Stats stats = scheduler.GetStats();
+        CHECK(runsA == 3 && runsB == 3);
+        if (slack.count() > 0) {
+            CHECK(stats.wakeups == 3);
+            CHECK(stats.aligned > 0);
+        } else {
+            CHECK(stats.wakeups == 6);
+            CHECK(stats.aligned == 0);
+        }
+    }
+}
+
+void TestRescheduleAndCancelWhenDue() {
+    ManualClock clock;
+    TimerScheduler scheduler(ManualOptions(clock));
+
+    int cancelledRuns = 0;
+    int movedRuns = 0;
+    const TimerScheduler::TimerId cancelled = scheduler.ScheduleAfter(Duration(100), [&cancelledRuns]() { cancelledRuns++; });
+    const TimerScheduler::TimerId moved = scheduler.ScheduleAfter(Duration(100), [&movedRuns]() { movedRuns++; });
+
+    // Both are past due, but RunDue() has not been called yet.
+    clock.Advance(Duration(200));
+    CHECK(scheduler.Cancel(cancelled));
+    CHECK(!scheduler.Cancel(cancelled));
+    CHECK(scheduler.Reschedule(moved, clock.Now() + Duration(300)));
+    CHECK(scheduler.RunDue() == 0);
+    CHECK(scheduler.GetStats().timers == 1);
+
+    Step(clock, scheduler, Duration(290));
+    CHECK(movedRuns == 0);
+    Step(clock, scheduler, kTick);
+    CHECK(movedRuns == 1);
+    CHECK(cancelledRuns == 0);
+
+    // A fired one-shot stays registered. Re-armed for a time already passed, it runs on the next
+    // tick: the current one has been processed.
+    CHECK(scheduler.Reschedule(moved, clock.Now() - Duration(1000)));
+    CHECK(scheduler.RunDue() == 0);
+    CHECK(Step(clock, scheduler, kTick) == 1);
+    CHECK(movedRuns == 2);
+
+    // From inside the job: re-arm itself, and cancel itself without deadlocking.
+    TimerScheduler::TimerId self = 0;
+    int selfRuns = 0;
+    self = scheduler.ScheduleAfter(Duration(0), [&]() {
+        selfRuns++;
+        if (selfRuns == 1) {
+            scheduler.Reschedule(self, clock.Now() + Duration(50));
+        } else {
+            scheduler.Cancel(self);
+        }
+    });
+    CHECK(Step(clock, scheduler, kTick) == 1);
+    CHECK(selfRuns == 1);
+    Step(clock, scheduler, Duration(50));
+    CHECK(selfRuns == 2);
+    Step(clock, scheduler, Duration(1000));
+    CHECK(selfRuns == 2);
+    CHECK(scheduler.GetStats().timers == 1);
+
+    CHECK(!scheduler.Reschedule(cancelled, clock.Now()));
+
+    // Registered at TimePoint::max(), a timer stays idle until it is re-armed.
+    int idleRuns = 0;
+    const TimerScheduler::TimerId idle = scheduler.ScheduleAt(TimePoint::max(), [&idleRuns]() { idleRuns++; });
+    Step(clock, scheduler, Duration(1000));
+    CHECK(idleRuns == 0);
+    CHECK(scheduler.Reschedule(idle, clock.Now()));
+    Step(clock, scheduler, kTick);
+    CHECK(idleRuns == 1);
+}
+
+void TestWakeupsPerMinute() {
+    ManualClock clock;
+    TimerScheduler scheduler(ManualOptions(clock));
+
+    const TimerScheduler::TimerId id = scheduler.SchedulePeriodic(Duration(1000), []() {});
+    Step(clock, scheduler, Duration(120000));
+    TimerScheduler::Stats stats = scheduler.GetStats();
+    CHECK(stats.wakeups == 120);
+    // The window includes both ends: wakeups at 60 s .. 120 s.
+    CHECK(stats.wakeupsLastMinute == 61);
+
+    // RunDue() calls that find nothing due are not wakeups.
+    CHECK(scheduler.Cancel(id));
+    Step(clock, scheduler, Duration(30000));
+    stats = scheduler.GetStats();
+    CHECK(stats.wakeups == 120);
+    CHECK(stats.wakeupsLastMinute == 31);
+    Step(clock, scheduler, Duration(31000));
+    CHECK(scheduler.GetStats().wakeupsLastMinute == 0);
+}
+
+// Without workers, posted jobs wait for the next RunDue(), due or not; they are not timers.
+void TestPost() {
+    ManualClock clock;
+    TimerScheduler scheduler(ManualOptions(clock));
+
+    int posted = 0;
+    scheduler.Post([&posted]() { posted++; });
+    CHECK(posted == 0);
+    CHECK(scheduler.GetStats().timers == 0);
+    CHECK(scheduler.RunDue() == 1);
+    CHECK(posted == 1);
+    CHECK(scheduler.RunDue() == 0);
+    CHECK(scheduler.GetStats().jobsRun == 1);
+    CHECK(scheduler.GetStats().timers == 0);
+
+    // Posted from a job that RunDue() is running: waits for the next call.
+    scheduler.ScheduleAfter(kTick, [&]() { scheduler.Post([&posted]() { posted++; }); });
+    CHECK(Step(clock, scheduler, kTick) == 1);
+    CHECK(posted == 1);
+    CHECK(scheduler.RunDue() == 1);
+    CHECK(posted == 2);
+
+    // Shutdown() drops what is queued and ignores later posts.
+    scheduler.Post([&posted]() { posted++; });
+    scheduler.Shutdown();
+    scheduler.Post([&posted]() { posted++; });
+    CHECK(scheduler.RunDue() == 0);
+    CHECK(posted == 2);
+}
+
+} // namespace
+
+int main() {
+    TestCascade();
+    TestBeyondTopLevel();
+    TestSlackAlignsPeriodicJobs();
+    TestRescheduleAndCancelWhenDue();
+    TestWakeupsPerMinute();
+    TestPost();
+    return TEST_EXIT_CODE();
+}